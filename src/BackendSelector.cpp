@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include "BackendSelector.h"
+#include "ImagePreprocessor.h"
+#include "LatencyStats.h"
+#include "OpenCvBackend.h"
+#include "Timing.h"
+#include "TorchBackend.h"
+
+namespace
+{
+/** The number of frames processed before latency is measured. */
+constexpr int WARM_UP_FRAMES = 3;
+/** The number of frames measured for each backend. */
+constexpr int BENCHMARK_FRAMES = 20;
+/** Maximum absolute difference of steering or throttle between a backend and the torch backend on the same input. */
+constexpr float OUTPUT_TOLERANCE = 0.01f;
+
+/**
+ * Computes the largest difference between outputs of two backends.
+ *  @param reference outputs of the reference backend.
+ *  @param outputs outputs of the compared backend.
+ *  @return the largest absolute difference, infinity if the numbers of outputs differ.
+ */
+float maxDifference(const std::vector<cv::Vec2f>& reference, const std::vector<cv::Vec2f>& outputs)
+{
+    float difference = 0.0f;
+    if (reference.size() != outputs.size())
+    {
+        return std::numeric_limits<float>::infinity();
+    }
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        difference = std::max(difference, std::max(std::fabs(reference[i][0] - outputs[i][0]), std::fabs(reference[i][1] - outputs[i][1])));
+    }
+    return difference;
+}
+} // end of anonymouse namespace
+
+BackendSelector::BackendSelector(const std::string& torchModel, const std::string& onnxModel, const cv::Size& imageSize, const bool isMono,
+                                 const bool optimiseTorch)
+: mTorchModel(torchModel),
+  mOnnxModel(onnxModel),
+  mImageSize(imageSize),
+  mIsMono(isMono),
+  mOptimiseTorch(optimiseTorch)
+{
+}
+
+BackendSelector::~BackendSelector()
+{
+}
+
+std::unique_ptr<IInferenceBackend> BackendSelector::select(const std::string& name, const bool tta) const
+{
+    std::unique_ptr<IInferenceBackend> best;
+    std::unique_ptr<IInferenceBackend> candidate;
+    std::vector<cv::Vec2f> reference;
+    std::vector<cv::Vec2f> outputs;
+    cv::Mat blob;
+    double bestLatency = 0.0;
+    double latency;
+    float difference;
+
+    createInput(tta, blob);
+    if (name != "auto")
+    {
+        return create(name, blob);
+    }
+    // the torch backend runs the model the car was trained for, so other backends have to agree with it
+    for (const char* candidateName : {"torch", "opencv"})
+    {
+        candidate = create(candidateName, blob);
+        if (candidate)
+        {
+            candidate->process(blob, outputs);
+            difference = reference.empty() ? 0.0f : maxDifference(reference, outputs);
+            if (!(difference <= OUTPUT_TOLERANCE))
+            {
+                printf("Backend %s rejected, its outputs differ from the torch backend by %.4f \n", candidateName, difference);
+                continue;
+            }
+            if (reference.empty())
+            {
+                reference = outputs;
+            }
+            latency = benchmark(*candidate, blob);
+            printf("Backend %s: median latency %.2f ms \n", candidateName, latency * 1000.0);
+            if (!best || latency < bestLatency)
+            {
+                best = std::move(candidate);
+                bestLatency = latency;
+            }
+        }
+    }
+
+    if (best)
+    {
+        printf("Selected %s inference backend \n", best->getName());
+    }
+    return best;
+}
+
+std::unique_ptr<IInferenceBackend> BackendSelector::create(const std::string& name, const cv::Mat& blob) const
+{
+    std::unique_ptr<IInferenceBackend> backend;
+    std::string path;
+    if (name == "torch")
+    {
+        backend = std::make_unique<TorchBackend>(mOptimiseTorch);
+        path = mTorchModel;
+    }
+    else if (name == "opencv")
+    {
+        backend = std::make_unique<OpenCvBackend>();
+        path = mOnnxModel;
+    }
+    else
+    {
+        printf("Unknown inference backend: %s \n", name.c_str());
+        return nullptr;
+    }
+
+    if (path.empty() || !backend->initialise(path, blob))
+    {
+        return nullptr;
+    }
+    return backend;
+}
+
+void BackendSelector::createInput(const bool tta, cv::Mat& blob) const
+{
+    ImagePreprocessor preprocessor;
+    cv::Mat image(mImageSize, mIsMono ? CV_8UC3 : CV_8UC1);
+    cv::Mat rightImage;
+
+    cv::randu(image, 0, 255);
+    if (!mIsMono)
+    {
+        rightImage = image.clone();
+    }
+    preprocessor.createBlob(tta, image, rightImage, blob);
+}
+
+double BackendSelector::benchmark(IInferenceBackend& backend, const cv::Mat& blob) const
+{
+    std::vector<cv::Vec2f> outputs;
+    LatencyStats stats(BENCHMARK_FRAMES);
+    double startTime;
+
+    for (int i = 0; i < WARM_UP_FRAMES + BENCHMARK_FRAMES; ++i)
+    {
+        startTime = getMonotonicTime();
+        backend.process(blob, outputs);
+        if (i >= WARM_UP_FRAMES)
+        {
+            stats.addSample(getMonotonicTime() - startTime);
+        }
+    }
+    return stats.getPercentile(50.0);
+}
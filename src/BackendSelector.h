@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "IInferenceBackend.h"
+
+/**
+ * Creates inference backends. In automatic mode all backends for which a model is configured are loaded and run
+ * on the same synthetic input. Backends whose outputs differ from the torch backend are rejected, and the fastest
+ * of the remaining ones is selected.
+ */
+class BackendSelector
+{
+public:
+    /**
+     * Initialises paths to models for all backends.
+     *  @param torchModel path to TorchScript model, empty if not available.
+     *  @param onnxModel path to ONNX model, empty if not available.
+     *  @param imageSize size of a single image.
+     *  @param isMono true for a mono camera system.
+     *  @param optimiseTorch true to freeze and optimise the TorchScript model, see TorchScriptCache.
+     */
+    BackendSelector(const std::string& torchModel, const std::string& onnxModel, const cv::Size& imageSize, const bool isMono,
+                    const bool optimiseTorch);
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~BackendSelector();
+
+    /**
+     * Creates and initialises the backend.
+     *  @param name the name of the backend: torch, opencv, or auto to select the fastest one.
+     *  @param tta true if test time augmentations will be used, so the benchmark runs with the same batch size.
+     *  @return the initialised backend, or nullptr if it could not be created.
+     */
+    std::unique_ptr<IInferenceBackend> select(const std::string& name, const bool tta) const;
+
+private:
+    /**
+     * Creates and initialises a single backend.
+     *  @param name the name of the backend: torch or opencv.
+     *  @param blob an input of the shape the backend will process.
+     *  @return the initialised backend, or nullptr if it could not be created.
+     */
+    std::unique_ptr<IInferenceBackend> create(const std::string& name, const cv::Mat& blob) const;
+
+    /**
+     * Creates the input of backends from random images.
+     *  @param tta true to add flipped images of test time augmentations to the batch.
+     *  @param blob the input of backends.
+     */
+    void createInput(const bool tta, cv::Mat& blob) const;
+
+    /**
+     * Measures median latency of the backend on synthetic input.
+     *  @param backend the backend to benchmark.
+     *  @param blob the input of the backend.
+     *  @return the median latency in seconds.
+     */
+    double benchmark(IInferenceBackend& backend, const cv::Mat& blob) const;
+
+    /** Path to TorchScript model. */
+    std::string mTorchModel;
+    /** Path to ONNX model. */
+    std::string mOnnxModel;
+    /** Size of a single image. */
+    cv::Size mImageSize;
+    /** Flag indicating mono camera system. */
+    bool mIsMono;
+    /** Flag indicating that the TorchScript model is frozen and optimised. */
+    bool mOptimiseTorch;
+};
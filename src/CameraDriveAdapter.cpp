@@ -20,9 +20,18 @@
 // SOFTWARE.
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
-#include <ATen/ATen.h>
+#include <utility>
+#include <ATen/Parallel.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include "BackendSelector.h"
 #include "CameraDriveAdapter.h"
+#include "Logger.h"
+#include "Settings.h"
+#include "Timing.h"
 
 namespace
 {
@@ -35,58 +44,354 @@ inline int boolToInt(const bool value)
 {
     return static_cast<int>(value) * 2 - 1;
 }
+
+/** The weight of the latest sample in the moving average of latency. */
+constexpr double LATENCY_SMOOTHING = 0.2;
+/** The number of frames each model processes before its latency is measured. */
+constexpr int WARM_UP_FRAMES = 3;
+/** The number of frames from which the initial latency of each model is measured. */
+constexpr int PROBE_FRAMES = 5;
+/** The number of frames after which a model skipped for its latency is tried again, as its latency may have dropped. */
+constexpr unsigned long REPROBE_FRAMES = 300;
+/** The number of latency samples kept for each model. */
+constexpr size_t LATENCY_SAMPLES = 1000;
 } /* end of anonymous namespace */
 
 CameraDriveAdapter::CameraDriveAdapter()
-: GenericListener<CameraData>(),
-  GenericTalker<DriveCommands>(),
-  mTTA(false),
-  mIsInitialised(false)
+: IDriveModel(),
+  mTTA(TTA_OFF),
+  mSteeringThreshold(0.5f),
+  mChangeThreshold(0.2f),
+  mTimeBudget(0.0),
+  mIntraOpThreads(0),
+  mLastCommands(),
+  mSkipThreshold(0.0),
+  mMaxSkippedFrames(0),
+  mSkippedInRow(0),
+  mSignature(),
+  mInferredSignature(),
+  mFrameDivider(1),
+  mReceivedFrames(0),
+  mSkippedFrames(0),
+  mFrames(0),
+  mTtaFrames(0),
+  mIsInitialised(false),
+  mLevels(),
+  mLevel(0),
+  mMinimumLevel(0),
+  mHysteresis(0.0f),
+  mLatencyBudget(0.0),
+  mResized(),
+  mPreprocessor(),
+  mBlob(),
+  mOutputs(),
+  mLogLimiter(1.0)
 {
 }
 
 CameraDriveAdapter::~CameraDriveAdapter()
 {
+    if (isInitialised())
+    {
+        printStatistics();
+    }
 }
 
-void CameraDriveAdapter::initialise(const std::string& pathToModel, const cv::Size& imageSize, const bool isMono, const bool tta)
+void CameraDriveAdapter::initialise(std::unique_ptr<IInferenceBackend> backend, const E_TtaMode tta)
 {
-    if (!isInitialised())
+    if (!isInitialised() && backend)
     {
         mTTA = tta;
-        mTorchInference.initialise(pathToModel, imageSize.width, imageSize.height, isMono ? 3 : 1);
+        mLevels.push_back({std::move(backend), cv::Size(), 0.0f, 0.0, 0, LatencyStats(LATENCY_SAMPLES)});
         mIsInitialised = true;
     }
 }
 
+void CameraDriveAdapter::initialise(const Settings& settings)
+{
+    const cv::Size imageSize(settings.mWidth, settings.mHeight);
+    BackendSelector selector(settings.mModel, settings.mOnnxModel, imageSize, settings.mIsMono, settings.mOptimiseModel);
+
+    initialise(selector.select(settings.mBackend, settings.mTta == TTA_ALWAYS), settings.mTta);
+    setAdaptiveTta(settings.mTtaSteeringThreshold, settings.mTtaChangeThreshold, settings.mTtaTimeBudget);
+    setInferenceSkipping(settings.mSkipThreshold, settings.mSkipMaxFrames);
+
+    for (const ResolutionModel& model : settings.mResolutionModels)
+    {
+        const cv::Size size(model.mWidth, model.mHeight);
+        const bool isOnnx = model.mPath.size() > 5 && model.mPath.compare(model.mPath.size() - 5, 5, ".onnx") == 0;
+        BackendSelector levelSelector(isOnnx ? "" : model.mPath, isOnnx ? model.mPath : "", size, settings.mIsMono, settings.mOptimiseModel);
+        Logger::log(LOG_INFO, "Loading %dx%d model %s used from throttle %.2f", size.width, size.height, model.mPath, model.mThrottle);
+        addResolution(levelSelector.select(isOnnx ? "opencv" : "torch", settings.mTta == TTA_ALWAYS), size, model.mThrottle);
+    }
+
+    setResolutionSwitching(settings.mResolutionHysteresis, 
+                           settings.mResolutionLatencyBudget > 0.0 ? settings.mResolutionLatencyBudget : 1.0 / settings.mFramerate);
+    if (isInitialised())
+    {
+        warmUp(imageSize, settings.mIsMono);
+    }
+}
+
+void CameraDriveAdapter::addResolution(std::unique_ptr<IInferenceBackend> backend, const cv::Size& imageSize, const float throttle)
+{
+    if (isInitialised() && backend)
+    {
+        mLevels.push_back({std::move(backend), imageSize, throttle, 0.0, 0, LatencyStats(LATENCY_SAMPLES)});
+        std::stable_sort(mLevels.begin(), mLevels.end(), [](const ModelLevel& a, const ModelLevel& b) { return a.mThrottle < b.mThrottle; });
+    }
+}
+
+void CameraDriveAdapter::setResolutionSwitching(const float hysteresis, const double latencyBudget)
+{
+    mHysteresis = hysteresis;
+    mLatencyBudget = latencyBudget;
+}
+
+void CameraDriveAdapter::setThreads(const int intraOpThreads, const int interOpThreads)
+{
+    if (intraOpThreads > 0)
+    {
+        at::set_num_threads(intraOpThreads);
+    }
+    if (interOpThreads > 0)
+    {
+        try
+        {
+            at::set_num_interop_threads(interOpThreads);
+        }
+        catch (const c10::Error&)
+        {
+            puts("Inter-op threads can only be set once, before any inference.");
+        }
+    }
+    printf("Torch threads: intra-op=%d, inter-op=%d \n", at::get_num_threads(), at::get_num_interop_threads());
+}
+
+void CameraDriveAdapter::setAdaptiveTta(const float steeringThreshold, const float changeThreshold, const double timeBudget)
+{
+    mSteeringThreshold = steeringThreshold;
+    mChangeThreshold = changeThreshold;
+    mTimeBudget = timeBudget;
+}
+
+void CameraDriveAdapter::setInferenceSkipping(const double threshold, const unsigned int maxSkippedFrames)
+{
+    mSkipThreshold = threshold;
+    mMaxSkippedFrames = maxSkippedFrames;
+}
+
 void CameraDriveAdapter::update(const CameraData& camData)
 {
     DriveCommands driveCommands;
-    at::Tensor output;
-    printf("Received image! \n");
+    if (mLogLimiter.allow())
+    {
+        Logger::log(LOG_DEBUG, "Received image!");
+    }
     if (camData.mImage.size() == 1)
     {
-        mTorchInference.processImage(mTTA, camData.mImage[0].createMatHeader(), output);
+        processImages(camData.mImage[0].createMatHeader(), cv::Mat(), driveCommands);
     }
     else
     {
-        mTorchInference.processGreyImage(mTTA, camData.mImage[0].createMatHeader(), camData.mImage[1].createMatHeader(), output);
+        processImages(camData.mImage[0].createMatHeader(), camData.mImage[1].createMatHeader(), driveCommands);
     }
-    processResults(output, driveCommands);
     notifyListeners(driveCommands);
 }
 
-void CameraDriveAdapter::processResults(const at::Tensor& results, DriveCommands& driveCommands) const
+bool CameraDriveAdapter::processImages(const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands)
+{
+    if (0 != (mReceivedFrames++ % mFrameDivider))
+    {
+        ++mSkippedFrames;
+        driveCommands = mLastCommands;
+        return false;
+    }
+    if (mSkipThreshold > 0.0)
+    {
+        // the left image alone is enough to tell whether the scene has changed
+        mSignature.compute(image);
+        if (mSkippedInRow < mMaxSkippedFrames && mSignature.difference(mInferredSignature) < mSkipThreshold)
+        {
+            ++mSkippedInRow;
+            ++mSkippedFrames;
+            driveCommands = mLastCommands;
+            return false;
+        }
+        std::swap(mSignature, mInferredSignature);
+        mSkippedInRow = 0;
+    }
+    predict(image, rightImage, driveCommands);
+    return true;
+}
+
+void CameraDriveAdapter::predict(const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands)
+{
+    // the thread count of libtorch is thread local, so it is applied by the thread running inference
+    int intraOpThreads = mIntraOpThreads;
+    if (intraOpThreads > 0 && intraOpThreads != at::get_num_threads())
+    {
+        at::set_num_threads(intraOpThreads);
+        Logger::log(LOG_INFO, "Torch intra-op threads changed to %d", intraOpThreads);
+    }
+
+    size_t level = selectLevel();
+    ModelLevel& model = mLevels[level];
+    const cv::Mat* input = &image;
+    const cv::Mat* rightInput = &rightImage;
+    if (!model.mSize.empty() && model.mSize != image.size())
+    {
+        cv::resize(image, mResized[0], model.mSize, 0, 0, cv::INTER_AREA);
+        input = &mResized[0];
+        if (!rightImage.empty())
+        {
+            cv::resize(rightImage, mResized[1], model.mSize, 0, 0, cv::INTER_AREA);
+            rightInput = &mResized[1];
+        }
+    }
+
+    double startTime = getMonotonicTime();
+    E_TtaMode ttaMode = mTTA;
+    bool tta = (ttaMode == TTA_ALWAYS);
+    mPreprocessor.createBlob(tta, *input, *rightInput, mBlob);
+    model.mBackend->process(mBlob, mOutputs);
+    processResults(mOutputs, tta, driveCommands);
+
+    if (ttaMode == TTA_ADAPTIVE)
+    {
+        // assume that the flipped pass takes as long as the original one
+        double elapsed = getMonotonicTime() - startTime;
+        if (fabs(driveCommands.mSteering) > mSteeringThreshold ||
+            fabs(driveCommands.mSteering - mLastCommands.mSteering) > mChangeThreshold ||
+            (mTimeBudget > 0.0 && 2.0 * elapsed < mTimeBudget))
+        {
+            DriveCommands flippedCommands;
+            predictFlipped(*model.mBackend, *input, *rightInput, flippedCommands);
+            driveCommands.mSteering = 0.5f * (driveCommands.mSteering - flippedCommands.mSteering);
+            driveCommands.mThrottle = 0.5f * (driveCommands.mThrottle + flippedCommands.mThrottle);
+            tta = true;
+        }
+    }
+
+    double latency = getMonotonicTime() - startTime;
+    // the average of a model that was not used for a while is stale, so it restarts from the latest frame
+    bool stale = (model.mLatency <= 0.0) || (mFrames - model.mLastFrame >= REPROBE_FRAMES);
+    model.mLatency = stale ? latency : (1.0 - LATENCY_SMOOTHING) * model.mLatency + LATENCY_SMOOTHING * latency;
+    model.mLastFrame = mFrames;
+    model.mStats.addSample(latency);
+    if (level != mLevel)
+    {
+        Logger::log(LOG_INFO, "Switching to model %zu of %zu at throttle %.2f", level + 1, mLevels.size(), mLastCommands.mThrottle);
+        mLevel = level;
+    }
+
+    ++mFrames;
+    if (tta)
+    {
+        ++mTtaFrames;
+    }
+    mLastCommands = driveCommands;
+}
+
+void CameraDriveAdapter::printStatistics() const
 {
-    if (static_cast<int>(results.size(0)) > 0)
+    unsigned long frames = mFrames;
+    unsigned long ttaFrames = mTtaFrames;
+    unsigned long skippedFrames = mSkippedFrames;
+    printf("Torch drive: processed %lu frames, TTA applied to %lu (%.1f%%), inference skipped for %lu (%.1f%%) \n",
+           frames, ttaFrames, frames > 0 ? 100.0 * ttaFrames / frames : 0.0,
+           skippedFrames, frames + skippedFrames > 0 ? 100.0 * skippedFrames / (frames + skippedFrames) : 0.0);
+
+    char name[64];
+    for (const ModelLevel& model : mLevels)
     {
-        for (int i = 0; i < static_cast<int>(results.size(0)); ++i)
+        if (model.mSize.empty())
+        {
+            snprintf(name, sizeof(name), "Model at camera resolution");
+        }
+        else
         {
-            driveCommands.mSteering -= boolToInt(mTTA && (i >= (static_cast<int>(results.size(0)) / 2))) * results[i][0].item().toFloat();
-            driveCommands.mThrottle += results[i][1].item().toFloat();
+            snprintf(name, sizeof(name), "Model at %dx%d", model.mSize.width, model.mSize.height);
         }
-        driveCommands.mSteering /= static_cast<int>(results.size(0));
-        driveCommands.mThrottle /= static_cast<int>(results.size(0));
+        model.mStats.print(name);
     }
+}
+
+size_t CameraDriveAdapter::selectLevel() const
+{
+    float throttle = fabs(mLastCommands.mThrottle);
+    size_t level = mLevel;
 
-}
\ No newline at end of file
+    // move to lower resolutions as the throttle rises, and back only once it has dropped below the threshold by the hysteresis
+    while (level + 1 < mLevels.size() && throttle >= mLevels[level + 1].mThrottle + mHysteresis)
+    {
+        ++level;
+    }
+    while (level > 0 && throttle < mLevels[level].mThrottle - mHysteresis)
+    {
+        --level;
+    }
+
+    // models that do not fit in the latency budget are replaced by lower resolution ones, but tried again now and then
+    unsigned long frames = mFrames;
+    while (mLatencyBudget > 0.0 && level + 1 < mLevels.size() && mLevels[level].mLatency > mLatencyBudget &&
+           frames - mLevels[level].mLastFrame < REPROBE_FRAMES)
+    {
+        ++level;
+    }
+    return std::max(level, std::min(static_cast<size_t>(mMinimumLevel), mLevels.size() - 1));
+}
+
+void CameraDriveAdapter::warmUp(const cv::Size& imageSize, const bool isMono)
+{
+    std::vector<cv::Vec2f> outputs;
+    const bool tta = (mTTA == TTA_ALWAYS);
+    double startTime;
+
+    for (ModelLevel& model : mLevels)
+    {
+        const cv::Size size = model.mSize.empty() ? imageSize : model.mSize;
+        cv::Mat image(size, isMono ? CV_8UC3 : CV_8UC1);
+        cv::Mat rightImage;
+        LatencyStats stats(PROBE_FRAMES);
+        cv::randu(image, 0, 255);
+        if (!isMono)
+        {
+            rightImage = image.clone();
+        }
+        for (int i = 0; i < WARM_UP_FRAMES + PROBE_FRAMES; ++i)
+        {
+            startTime = getMonotonicTime();
+            mPreprocessor.createBlob(tta, image, rightImage, mBlob);
+            model.mBackend->process(mBlob, outputs);
+            if (i >= WARM_UP_FRAMES)
+            {
+                stats.addSample(getMonotonicTime() - startTime);
+            }
+        }
+        model.mLatency = stats.getPercentile(50.0);
+        Logger::log(LOG_INFO, "Model at %dx%d warmed up, median latency %.2f ms", size.width, size.height, model.mLatency * 1000.0);
+    }
+}
+
+void CameraDriveAdapter::processResults(const std::vector<cv::Vec2f>& results, const bool tta, DriveCommands& driveCommands) const
+{
+    if (static_cast<int>(results.size()) > 0)
+    {
+        for (int i = 0; i < static_cast<int>(results.size()); ++i)
+        {
+            driveCommands.mSteering -= boolToInt(tta && (i >= (static_cast<int>(results.size()) / 2))) * results[i][0];
+            driveCommands.mThrottle += results[i][1];
+        }
+        driveCommands.mSteering /= static_cast<int>(results.size());
+        driveCommands.mThrottle /= static_cast<int>(results.size());
+    }
+
+}
+
+void CameraDriveAdapter::predictFlipped(IInferenceBackend& backend, const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands)
+{
+    mPreprocessor.createFlippedBlob(image, rightImage, mBlob);
+    backend.process(mBlob, mOutputs);
+    processResults(mOutputs, false, driveCommands);
+}
@@ -22,22 +22,28 @@
 
 #pragma once
 
-#include <CameraData.h>
-#include <DriveCommands.h>
-#include <TorchInference.h>
-#include <GenericListener.h>
-#include <GenericTalker.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "IDriveModel.h"
+#include "IInferenceBackend.h"
+#include "ImagePreprocessor.h"
+#include "ImageSignature.h"
+#include "LatencyStats.h"
+#include "Logger.h"
 
+struct Settings;
 
 /**
- * Class that takes images, passes them through libtorch and notifies jetracer with drive commands.
+ * Class that takes images, normalises them once with ImagePreprocessor, passes the same input to the inference backend
+ * of the selected model and notifies jetracer with drive commands.
  */
-class CameraDriveAdapter : public GenericListener<CameraData>,
-                           public GenericTalker<DriveCommands>
+class CameraDriveAdapter : public IDriveModel
 {
 public:
     /**
-     * Initialises the underhood TorchInference class.
+     * Basic constructor, the inference backend is provided at initialisation.
      */
     CameraDriveAdapter();
 
@@ -47,13 +53,94 @@ public:
     virtual ~CameraDriveAdapter();
 
     /**
-     * Initialises the torch inference class.
-     *  @param pathToModel path to JIT model for liborch to load.
-     *  @param imageSize size of a single image. For stereo camera double width is taken.
-     *  @param isMono true for a mono camera system.
-     *  @param tta true to enable test time augmentations.
+     * Initialises the class with an inference backend that has already loaded the model.
+     *  @param backend the initialised inference backend, see BackendSelector.
+     *  @param tta the test time augmentations mode.
      */
-    void initialise(const std::string& pathToModel, const cv::Size& imageSize, const bool isMono, const bool tta);
+    void initialise(std::unique_ptr<IInferenceBackend> backend, const E_TtaMode tta);
+
+    /**
+     * Selects inference backends, loads models and configures test time augmentations, inference skipping
+     * and resolution switching from the configuration.
+     *  @param settings the settings of the application.
+     */
+    void initialise(const Settings& settings) override;
+
+    /**
+     * Adds a model that runs at a lower resolution. Models are switched per frame based on the absolute throttle
+     * of the last prediction, so that the control rate can be raised when driving fast.
+     *  @param backend the initialised inference backend of the model.
+     *  @param imageSize size of a single image expected by the model, camera images are resized to it.
+     *  @param throttle the absolute throttle from which this model is used.
+     */
+    void addResolution(std::unique_ptr<IInferenceBackend> backend, const cv::Size& imageSize, const float throttle);
+
+    /**
+     * Sets how models of different resolutions are switched.
+     *  @param hysteresis the margin of throttle around model thresholds which prevents switching back and forth.
+     *  @param latencyBudget the time in seconds per frame, models that exceed it are replaced by lower resolution ones, 0 to disable.
+     */
+    void setResolutionSwitching(const float hysteresis, const double latencyBudget);
+
+    /**
+     * Sets the number of threads used by libtorch. Inter-op threads can only be set once per process, before any inference.
+     *  @param intraOpThreads the number of threads used within an operation, 0 for libtorch default.
+     *  @param interOpThreads the number of threads used to run independent operations, 0 for libtorch default.
+     */
+    static void setThreads(const int intraOpThreads, const int interOpThreads);
+
+    /**
+     * Changes the test time augmentations mode. This function is thread safe.
+     *  @param tta the test time augmentations mode.
+     */
+    inline void setTtaMode(const E_TtaMode tta) override
+    {
+        mTTA = tta;
+    }
+
+    /**
+     * Sets conditions under which the flipped image is processed in the adaptive TTA mode. This function is thread safe.
+     *  @param steeringThreshold the absolute steering above which the prediction is considered uncertain.
+     *  @param changeThreshold the absolute change of steering from the previous frame above which the prediction is considered uncertain.
+     *  @param timeBudget the time in seconds per frame within which the flipped image is always processed, 0 to disable.
+     */
+    void setAdaptiveTta(const float steeringThreshold, const float changeThreshold, const double timeBudget) override;
+
+    /**
+     * Changes the number of libtorch threads used within an operation, applied by the thread that predicts the next
+     * frame. This function is thread safe.
+     *  @param threads the number of threads, 0 to keep the current number.
+     */
+    inline void setIntraOpThreads(const int threads) override
+    {
+        mIntraOpThreads = threads;
+    }
+
+    /**
+     * Enables reuse of the previous drive commands for frames that are nearly identical to the last inferred frame.
+     *  @param threshold the mean grey-level difference [0, 255] of downsampled frames below which inference is skipped, 0 to disable.
+     *  @param maxSkippedFrames the maximum number of consecutive frames for which inference can be skipped.
+     */
+    void setInferenceSkipping(const double threshold, const unsigned int maxSkippedFrames);
+
+    /**
+     * Lowers the control rate by running inference only on every n-th frame, previous drive commands are reused for the others.
+     * This function is thread safe.
+     *  @param divider run inference on every @p divider frame, 1 for every frame.
+     */
+    inline void setFrameDivider(const unsigned int divider) override
+    {
+        mFrameDivider = std::max(divider, 1u);
+    }
+
+    /**
+     * Prevents models with resolutions higher than the given one from being used. This function is thread safe.
+     *  @param level the index of the highest resolution model that can be used, 0 for no limit.
+     */
+    inline void setMinimumLevel(const size_t level) override
+    {
+        mMinimumLevel = level;
+    }
 
     /**
      * Receives camera images to predict drive commands for JetRacer.
@@ -61,26 +148,148 @@ public:
      */
     void update(const CameraData& camData) override;
 
+    /**
+     * Predicts drive commands from images unless inference is skipped for this frame, in which case the previous
+     * drive commands are returned.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param driveCommands the predicted or previous drive commands.
+     *  @return true if inference ran, false if it was skipped.
+     */
+    bool processImages(const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands) override;
+
+    /**
+     * Predicts drive commands from images, applying the configured test time augmentations.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param driveCommands the predicted drive commands.
+     */
+    void predict(const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands);
+
+    /**
+     * Prints how often the flipped image was processed, how many frames were skipped, and latency of each resolution.
+     */
+    void printStatistics() const override;
+
     /**
      *  @return true of the class was initialised.
      */
-    inline bool isInitialised() const
+    inline bool isInitialised() const override
     {
         return mIsInitialised;
     }
 
+    /**
+     *  @return false, drive commands are predicted on the thread that passes images.
+     */
+    inline bool isAsynchronous() const override
+    {
+        return false;
+    }
+
 private:
+    /**
+     * A model with its resolution and latency statistics.
+     */
+    struct ModelLevel
+    {
+        /** The inference backend. */
+        std::unique_ptr<IInferenceBackend> mBackend;
+        /** Size of a single image expected by the model, empty for camera resolution. */
+        cv::Size mSize;
+        /** The absolute throttle from which the model is used. */
+        float mThrottle;
+        /** Exponential moving average of latency in seconds. */
+        double mLatency;
+        /** The number of processed frames when the model was last used. */
+        unsigned long mLastFrame;
+        /** Latency statistics. */
+        LatencyStats mStats;
+    };
+
+    /**
+     * Selects the model for the next frame based on the last throttle and latency of models.
+     *  @return the index of the selected model.
+     */
+    size_t selectLevel() const;
+
+    /**
+     * Runs every model on random images, so that the slow first frames of a backend are not taken for its latency,
+     * and sets the latency of each model to the median of the following frames.
+     *  @param imageSize size of camera images, used by the model at camera resolution.
+     *  @param isMono true for a mono camera, false for a stereo camera.
+     */
+    void warmUp(const cv::Size& imageSize, const bool isMono);
+
     /**
      * Converts results into drive command.
      *  @param result the result of inference.
+     *  @param tta true if the second half of the results were obtained from flipped images.
      *  @param driveCommands the drive commands to be issued.
      */
-    void processResults(const at::Tensor& results, DriveCommands& driveCommands) const;
+    void processResults(const std::vector<cv::Vec2f>& results, const bool tta, DriveCommands& driveCommands) const;
+
+    /**
+     * Runs the model on horizontally flipped images, i.e., on the mirrored scene.
+     *  @param backend the inference backend of the model.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param driveCommands the drive commands predicted for the mirrored scene.
+     */
+    void predictFlipped(IInferenceBackend& backend, const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands);
 
-    /** Flag to indicate if test time augmentations should be applied. */
-    bool mTTA;
+    /** The test time augmentations mode. */
+    std::atomic<E_TtaMode> mTTA;
+    /** Absolute steering above which the adaptive TTA processes the flipped image. */
+    std::atomic<float> mSteeringThreshold;
+    /** Absolute change of steering above which the adaptive TTA processes the flipped image. */
+    std::atomic<float> mChangeThreshold;
+    /** Time budget in seconds per frame within which the adaptive TTA always processes the flipped image. */
+    std::atomic<double> mTimeBudget;
+    /** libtorch threads used within an operation requested for the next frame, 0 to keep the current number. */
+    std::atomic<int> mIntraOpThreads;
+    /** The last predicted drive commands. */
+    DriveCommands mLastCommands;
+    /** The difference between frames below which inference is skipped, 0 if disabled. */
+    double mSkipThreshold;
+    /** The maximum number of consecutive frames for which inference can be skipped. */
+    unsigned int mMaxSkippedFrames;
+    /** The number of consecutive frames for which inference was skipped. */
+    unsigned int mSkippedInRow;
+    /** The signature of the current frame. */
+    ImageSignature mSignature;
+    /** The signature of the last frame that was passed through the model. */
+    ImageSignature mInferredSignature;
+    /** Inference runs on every n-th frame. */
+    std::atomic<unsigned int> mFrameDivider;
+    /** The number of frames received. */
+    unsigned long mReceivedFrames;
+    /** The number of frames for which inference was skipped. */
+    std::atomic<unsigned long> mSkippedFrames;
+    /** The number of frames processed. */
+    std::atomic<unsigned long> mFrames;
+    /** The number of frames for which the flipped image was processed. */
+    std::atomic<unsigned long> mTtaFrames;
     /** Flag to indicate if the class was initialised. */
     bool mIsInitialised;
-    /** Wrapper class to perform Torch inference. */
-    TorchInference mTorchInference;
+    /** Models sorted by throttle, the first one runs at camera resolution. */
+    std::vector<ModelLevel> mLevels;
+    /** The index of the model used for the last frame. */
+    size_t mLevel;
+    /** The index of the highest resolution model that can be used. */
+    std::atomic<size_t> mMinimumLevel;
+    /** The margin of throttle around model thresholds. */
+    float mHysteresis;
+    /** The time in seconds per frame that models should not exceed, 0 if disabled. */
+    double mLatencyBudget;
+    /** Buffers for resized images. */
+    cv::Mat mResized[2];
+    /** Converts images into the input of all backends. */
+    ImagePreprocessor mPreprocessor;
+    /** Input of the inference backend. */
+    cv::Mat mBlob;
+    /** Outputs of the inference backend. */
+    std::vector<cv::Vec2f> mOutputs;
+    /** Limits per-frame log messages. */
+    LogRateLimiter mLogLimiter;
 };
@@ -0,0 +1,205 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "ConfigWatcher.h"
+#include "Logger.h"
+
+namespace
+{
+/** Time in milliseconds after which the watcher checks whether it should stop. */
+constexpr int POLL_TIMEOUT = 100;
+/** Events of files that were written or moved into place, which covers editors that save through a temporary file. */
+constexpr uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+/**
+ *  @param path a path to a file.
+ *  @return the folder of the file, "." for a file in the working folder.
+ */
+std::string getFolder(const std::string& path)
+{
+    size_t separator = path.find_last_of('/');
+    if (std::string::npos == separator)
+    {
+        return ".";
+    }
+    return (0 == separator) ? "/" : path.substr(0, separator);
+}
+
+/**
+ *  @param path a path to a file.
+ *  @return the name of the file without its folder.
+ */
+std::string getName(const std::string& path)
+{
+    size_t separator = path.find_last_of('/');
+    return (std::string::npos == separator) ? path : path.substr(separator + 1);
+}
+} // end of anonymouse namespace
+
+ConfigWatcher::ConfigWatcher(const Configuration& config, const std::string& path, const std::function<void(const Settings&)>& callback)
+: GenericThread<ConfigWatcher>(),
+  mConfig(config),
+  mPath(path),
+  mOverlayPath(config.at("overlay")),
+  mCallback(callback),
+  mInotify(-1)
+{
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    stopThread();
+}
+
+bool ConfigWatcher::startThread()
+{
+    if (mInotify < 0)
+    {
+        mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (mInotify < 0)
+        {
+            Logger::log(LOG_ERROR, "Failed to initialise inotify: %s", strerror(errno));
+            return false;
+        }
+        // the same folder is watched once, inotify returns the existing watch for it
+        if (!watch(mPath) || (!mOverlayPath.empty() && !watch(mOverlayPath)))
+        {
+            close(mInotify);
+            mInotify = -1;
+            return false;
+        }
+    }
+    Logger::log(LOG_INFO, "Watching configuration at %s for changes", mPath);
+    return GenericThread<ConfigWatcher>::startThread();
+}
+
+void ConfigWatcher::stopThread()
+{
+    // the thread polls inotify with a timeout, so it does not need to be cancelled
+    GenericThread<ConfigWatcher>::stopThread(false);
+    if (mInotify >= 0)
+    {
+        close(mInotify);
+        mInotify = -1;
+    }
+}
+
+bool ConfigWatcher::watch(const std::string& path)
+{
+    if (inotify_add_watch(mInotify, getFolder(path).c_str(), WATCH_EVENTS) < 0)
+    {
+        Logger::log(LOG_ERROR, "Failed to watch folder of %s: %s", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool ConfigWatcher::reload()
+{
+    Configuration config;
+    Settings settings;
+    bool reloadable = false;
+
+    if (!config.loadConfiguration(mPath))
+    {
+        Logger::log(LOG_WARNING, "Failed to reload configuration from %s", mPath);
+        return false;
+    }
+    if (!mOverlayPath.empty() && !config.mergeConfiguration(mOverlayPath))
+    {
+        Logger::log(LOG_WARNING, "Failed to reload configuration overlay from %s", mOverlayPath);
+        return false;
+    }
+    if (!settings.parse(config))
+    {
+        Logger::log(LOG_ERROR, "Rejected reloaded configuration with invalid values, previous values are kept");
+        return false;
+    }
+
+    for (const std::pair<const std::string, std::string>& entry : config)
+    {
+        Configuration::const_iterator previous = mConfig.find(entry.first);
+        if (mConfig.end() != previous && previous->second == entry.second)
+        {
+            continue;
+        }
+        const std::string previousValue = (mConfig.end() != previous) ? previous->second : "";
+        if (Settings::isReloadable(entry.first))
+        {
+            Logger::log(LOG_INFO, "Configuration %s changed from %s to %s", entry.first, previousValue, entry.second);
+            reloadable = true;
+        }
+        else
+        {
+            Logger::log(LOG_WARNING, "Configuration %s changed from %s to %s, restart to apply", entry.first, previousValue, entry.second);
+        }
+    }
+    mConfig = config;
+    if (reloadable)
+    {
+        mCallback(settings);
+    }
+    return true;
+}
+
+void* ConfigWatcher::threadBody()
+{
+    struct pollfd events = {mInotify, POLLIN, 0};
+    // inotify events are aligned to their header, names follow it
+    alignas(struct inotify_event) char buffer[4096];
+    const std::string configName = getName(mPath);
+    const std::string overlayName = getName(mOverlayPath);
+    ssize_t length;
+    bool changed;
+
+    while (isRunning())
+    {
+        if (poll(&events, 1, POLL_TIMEOUT) <= 0 || !(events.revents & POLLIN))
+        {
+            continue;
+        }
+        changed = false;
+        while ((length = read(mInotify, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* next = buffer; next < buffer + length; )
+            {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(next);
+                if (event->len > 0 && (configName == event->name || (!mOverlayPath.empty() && overlayName == event->name)))
+                {
+                    changed = true;
+                }
+                next += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        // editors may write several events for a single save, so all pending events result in one reload
+        if (changed)
+        {
+            reload();
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <GenericThread.h>
+#include "Configuration.h"
+#include "Settings.h"
+
+/**
+ * Watches the configuration file and its overlay with inotify and reloads them when they are written or replaced.
+ * A reloaded configuration is parsed into settings and passed on only if all values are valid, so a half-written or
+ * mistyped file never reaches the car. Changes of values that cannot be applied while running are reported instead.
+ */
+class ConfigWatcher : public GenericThread<ConfigWatcher>
+{
+public:
+    /**
+     * Basic constructor.
+     *  @param config the configuration loaded at startup, including its overlay.
+     *  @param path the path to the configuration file.
+     *  @param callback the function receiving settings of a valid reloaded configuration.
+     */
+    ConfigWatcher(const Configuration& config, const std::string& path, const std::function<void(const Settings&)>& callback);
+
+    /**
+     * Stops the thread and closes the inotify instance.
+     */
+    virtual ~ConfigWatcher();
+
+    /**
+     * Overrides/shadows the baseclass function to watch folders of the configuration and its overlay.
+     *  @return true if the folders are watched and the thread started.
+     */
+    bool startThread();
+
+    /**
+     * Overrides/shadows the baseclass function to close the inotify instance.
+     */
+    void stopThread();
+
+    /**
+     * Loads the configuration and its overlay, validates them and passes settings to the callback if any value that
+     * can be changed while running differs from the last loaded configuration.
+     *  @return true if the configuration was loaded and is valid.
+     */
+    bool reload();
+
+    /**
+     * The main body of the watcher thread.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /**
+     * Adds a watch of the folder of a file.
+     *  @param path the path to the file.
+     *  @return true if the folder is watched.
+     */
+    bool watch(const std::string& path);
+
+    /** The last loaded configuration. */
+    Configuration mConfig;
+    /** The path to the configuration file. */
+    std::string mPath;
+    /** The path to the configuration overlay, empty if none. */
+    std::string mOverlayPath;
+    /** The function receiving settings of a valid reloaded configuration. */
+    std::function<void(const Settings&)> mCallback;
+    /** The inotify instance. */
+    int mInotify;
+};
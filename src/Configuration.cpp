@@ -21,9 +21,47 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <algorithm>
-#include <fstream>
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
 #include "Configuration.h"
 
+namespace
+{
+/**
+ * Parses a value with a function of std::sto* family and reports missing keys and invalid values.
+ *  @param config the configuration.
+ *  @param key the key.
+ *  @param type description of the expected value used in the report.
+ *  @param parse the function that parses the whole string and returns the number of parsed characters.
+ *  @return true if the key is present and the whole value was parsed.
+ */
+bool parseValue(const Configuration& config, const std::string& key, const char* type, const std::function<size_t(const std::string&)>& parse)
+{
+    Configuration::const_iterator it = config.find(key);
+    size_t parsed = 0;
+    if (it == config.end())
+    {
+        printf("Configuration key %s is missing \n", key.c_str());
+        return false;
+    }
+    try
+    {
+        parsed = parse(it->second);
+    }
+    catch (const std::logic_error&)
+    {
+        parsed = 0;
+    }
+    if (it->second.empty() || parsed != it->second.size())
+    {
+        printf("Configuration key %s has invalid value '%s', expected %s \n", key.c_str(), it->second.c_str(), type);
+        return false;
+    }
+    return true;
+}
+} // end of anonymouse namespace
+
 
 bool Configuration::loadConfiguration(const std::string& path, const std::string& delimiter, const char comment)
 {
@@ -31,18 +69,125 @@ bool Configuration::loadConfiguration(const std::string& path, const std::string
     bool retVal = cFile.is_open();
     if (retVal)
     {
-        std::string line;
         clear();
+        readFile(cFile, delimiter, comment, false);
+    }
+    return retVal;
+}
 
-        while (getline(cFile, line))
+bool Configuration::mergeConfiguration(const std::string& path, const std::string& delimiter, const char comment)
+{
+    std::ifstream cFile(path);
+    bool retVal = cFile.is_open();
+    if (retVal)
+    {
+        readFile(cFile, delimiter, comment, true);
+    }
+    return retVal;
+}
+
+void Configuration::readFile(std::ifstream& cFile, const std::string& delimiter, const char comment, const bool overwrite)
+{
+    std::string line;
+    while (getline(cFile, line))
+    {
+        line.erase(std::remove_if(line.begin(), line.end(), isspace), line.end());
+        if (!line.empty() && line[0] != comment)
         {
-            line.erase(std::remove_if(line.begin(), line.end(), isspace), line.end());
-            if (!line.empty() && line[0] != comment)
+            size_t delimiterPos = line.find(delimiter);
+            if (overwrite)
+            {
+                (*this)[line.substr(0, delimiterPos)] = line.substr(delimiterPos + 1);
+            }
+            else
             {
-                size_t delimiterPos = line.find(delimiter);
                 insert(std::pair<std::string, std::string>(line.substr(0, delimiterPos), line.substr(delimiterPos + 1)));
             }
         }
     }
+}
+
+bool Configuration::getValue(const std::string& key, int& value, const int base) const
+{
+    int parsedValue = 0;
+    bool retVal = parseValue(*this, key, "an integer", [&parsedValue, base](const std::string& text)
+    {
+        size_t parsed;
+        parsedValue = std::stoi(text, &parsed, base);
+        return parsed;
+    });
+    value = retVal ? parsedValue : value;
+    return retVal;
+}
+
+bool Configuration::getValue(const std::string& key, unsigned long& value) const
+{
+    // std::stoul accepts negative numbers and wraps them around
+    unsigned long parsedValue = 0;
+    bool retVal = parseValue(*this, key, "a non-negative integer", [&parsedValue](const std::string& text)
+    {
+        size_t parsed;
+        parsedValue = std::stoul(text, &parsed);
+        return (text[0] == '-') ? 0 : parsed;
+    });
+    value = retVal ? parsedValue : value;
+    return retVal;
+}
+
+bool Configuration::getValue(const std::string& key, float& value) const
+{
+    float parsedValue = 0.0f;
+    bool retVal = parseValue(*this, key, "a number", [&parsedValue](const std::string& text)
+    {
+        size_t parsed;
+        parsedValue = std::stof(text, &parsed);
+        return parsed;
+    });
+    value = retVal ? parsedValue : value;
+    return retVal;
+}
+
+bool Configuration::getValue(const std::string& key, double& value) const
+{
+    double parsedValue = 0.0;
+    bool retVal = parseValue(*this, key, "a number", [&parsedValue](const std::string& text)
+    {
+        size_t parsed;
+        parsedValue = std::stod(text, &parsed);
+        return parsed;
+    });
+    value = retVal ? parsedValue : value;
     return retVal;
-}
\ No newline at end of file
+}
+
+bool Configuration::getValue(const std::string& key, bool& value) const
+{
+    bool retVal = parseValue(*this, key, "true or false", [](const std::string& text)
+    {
+        return isBool(text) ? text.size() : 0;
+    });
+    value = retVal ? strToBool(at(key)) : value;
+    return retVal;
+}
+
+bool Configuration::getValue(const std::string& key, std::string& value) const
+{
+    const_iterator it = find(key);
+    if (it == end())
+    {
+        printf("Configuration key %s is missing \n", key.c_str());
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+bool Configuration::strToBool(const std::string& value)
+{
+    return value == "true" || value == "True" || value == "1";
+}
+
+bool Configuration::isBool(const std::string& value)
+{
+    return strToBool(value) || value == "false" || value == "False" || value == "0";
+}
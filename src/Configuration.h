@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <fstream>
+#include <string>
 #include <unordered_map>
 
 /** 
@@ -38,4 +40,85 @@ public:
      *  @return true if the file was successfully opened.
      */
     bool loadConfiguration(const std::string& path, const std::string& delimiter = "=", const char comment = '#');
+
+    /**
+     * Loads configuration overlay from the file. Values from the overlay replace already loaded values, other values are kept.
+     *  @param path a path to configuration overlay file.
+     *  @param delimiter an optional delimiter for key-value pairs.
+     *  @param comment an optional character which comments a line in the configuration file.
+     *  @return true if the file was successfully opened.
+     */
+    bool mergeConfiguration(const std::string& path, const std::string& delimiter = "=", const char comment = '#');
+
+    /**
+     * Parses an integer value. Missing keys and values that are not integers are reported.
+     *  @param key the key.
+     *  @param value the parsed value, unchanged on failure.
+     *  @param base the base of the number, 0 to detect it from the prefix (e.g. 0x for hexadecimal).
+     *  @return true if the value was parsed.
+     */
+    bool getValue(const std::string& key, int& value, const int base = 10) const;
+
+    /**
+     * Parses a non-negative integer value. Missing keys and values that are not non-negative integers are reported.
+     *  @param key the key.
+     *  @param value the parsed value, unchanged on failure.
+     *  @return true if the value was parsed.
+     */
+    bool getValue(const std::string& key, unsigned long& value) const;
+
+    /**
+     * Parses a floating point value. Missing keys and values that are not numbers are reported.
+     *  @param key the key.
+     *  @param value the parsed value, unchanged on failure.
+     *  @return true if the value was parsed.
+     */
+    bool getValue(const std::string& key, float& value) const;
+
+    /**
+     * Parses a floating point value. Missing keys and values that are not numbers are reported.
+     *  @param key the key.
+     *  @param value the parsed value, unchanged on failure.
+     *  @return true if the value was parsed.
+     */
+    bool getValue(const std::string& key, double& value) const;
+
+    /**
+     * Parses a boolean value, one of true, True, 1, false, False or 0. Missing keys and other values are reported.
+     *  @param key the key.
+     *  @param value the parsed value, unchanged on failure.
+     *  @return true if the value was parsed.
+     */
+    bool getValue(const std::string& key, bool& value) const;
+
+    /**
+     * Gets a string value. Missing keys are reported.
+     *  @param key the key.
+     *  @param value the value, unchanged on failure.
+     *  @return true if the key is present.
+     */
+    bool getValue(const std::string& key, std::string& value) const;
+
+    /**
+     * Converts a configuration value into bool.
+     *  @param value the configuration value.
+     *  @return true for true, True or 1, false otherwise.
+     */
+    static bool strToBool(const std::string& value);
+
+    /**
+     *  @param value the configuration value.
+     *  @return true if the value is one of true, True, 1, false, False or 0.
+     */
+    static bool isBool(const std::string& value);
+
+private:
+    /**
+     * Reads key-value pairs from the file.
+     *  @param cFile an opened configuration file.
+     *  @param delimiter a delimiter for key-value pairs.
+     *  @param comment a character which comments a line in the configuration file.
+     *  @param overwrite true to replace values of keys that are already present.
+     */
+    void readFile(std::ifstream& cFile, const std::string& delimiter, const char comment, const bool overwrite);
 };
@@ -22,12 +22,14 @@
 
 #include <cmath>
 #include <experimental/filesystem>
+#include <sys/stat.h>
 #include <opencv2/imgcodecs.hpp>
 #include <ScopedLock.h>
 #include <CameraData.h>
 #include <GenericTalker.h>
-#include "Configuration.h"
 #include "DataSaver.h"
+#include "Logger.h"
+#include "Settings.h"
 
 
 namespace
@@ -42,33 +44,42 @@ double getTime()
     return static_cast<double>(timeStruct.tv_sec) + static_cast<double>(timeStruct.tv_nsec / 1000000) / 1000;
 }
 
-bool strToBool(const std::string& value)
-{
-    return value == "true" || value == "True" || value == "1";
-}
-
 } // end of anonymouse namespace
 
 
 // DataSaver::DataSaver(const std::string& mainFolder, const int height, const int width, const int type)
-DataSaver::DataSaver(const Configuration& config)
+DataSaver::DataSaver(const Settings& settings)
 : GenericListener<CameraData>(),
   GenericListener<DriveCommands>(),
   GenericThread<DataSaver>(),
   mUid(0),
   mFolderName(),
-  mImage()
+  mImage(),
+  mDriveCommands(),
+  mFrameSelector(),
+  mJpegQuality(settings.mSaverQuality),
+  mSavedImages(0),
+  mBytesWritten(0)
 {
-    if (strToBool(config.at("isMono")))
+    if (settings.mIsMono)
     {
-        mImage = cv::Mat(std::stod(config.at("height")), std::stod(config.at("width")), CV_8UC3);
+        mImage = cv::Mat(settings.mHeight, settings.mWidth, CV_8UC3);
         mFolderName = ("./mono/" + std::to_string(getTime()));
     }
     else
     {
-        mImage = cv::Mat(std::stod(config.at("height")), std::stod(config.at("width")) * 2, CV_8UC1);
+        mImage = cv::Mat(settings.mHeight, settings.mWidth * 2, CV_8UC1);
         mFolderName = ("./stereo/" + std::to_string(getTime()));
     }
+
+    if (settings.mFrameSelection)
+    {
+        mFrameSelector = std::make_unique<FrameSelector>(settings.mSelectionMinDifference,
+                                                         settings.mSelectionMinPerBin,
+                                                         settings.mSelectionMaxPerBin,
+                                                         settings.mSelectionSteeringBins,
+                                                         settings.mSelectionThrottleBins);
+    }
 }
 
 DataSaver::~DataSaver()
@@ -78,15 +89,27 @@ DataSaver::~DataSaver()
 
 void DataSaver::update(const CameraData& cameraData)
 {
-    ScopedLock lock(mMutex);
     if (cameraData.mImage.size() == 1)
     {
-        cameraData.mImage[0].createMatHeader().copyTo(mImage);
+        update(cameraData.mImage[0].createMatHeader(), cv::Mat());
+    }
+    else
+    {
+        update(cameraData.mImage[0].createMatHeader(), cameraData.mImage[1].createMatHeader());
+    }
+}
+
+void DataSaver::update(const cv::Mat& image, const cv::Mat& rightImage)
+{
+    ScopedLock lock(mMutex);
+    if (rightImage.empty())
+    {
+        image.copyTo(mImage);
     }
     else
     {
-        cameraData.mImage[0].createMatHeader().copyTo(mImage(cv::Rect(0, 0, cameraData.mImage[0].cols, cameraData.mImage[0].rows)));
-        cameraData.mImage[1].createMatHeader().copyTo(mImage(cv::Rect(cameraData.mImage[0].cols, 0, cameraData.mImage[1].cols, cameraData.mImage[1].rows)));
+        image.copyTo(mImage(cv::Rect(0, 0, image.cols, image.rows)));
+        rightImage.copyTo(mImage(cv::Rect(image.cols, 0, rightImage.cols, rightImage.rows)));
     }
     sem_post(&mSemaphore);
 }
@@ -104,22 +127,49 @@ bool DataSaver::startThread()
     return GenericThread<DataSaver>::startThread();
 }
 
+void DataSaver::stopThread(const bool cancel)
+{
+    bool wasRunning = isRunning();
+    GenericThread<DataSaver>::stopThread(cancel);
+    if (wasRunning && mFrameSelector)
+    {
+        mFrameSelector->printStatistics();
+    }
+}
+
+int DataSaver::getQueueDepth()
+{
+    int depth = 0;
+    sem_getvalue(&mSemaphore, &depth);
+    return depth;
+}
+
 void* DataSaver::threadBody()
 {
     int bytesWritten;
     char path[256] = {0};
+    LogRateLimiter logLimiter(1.0);
+    struct stat fileStatus;
     
     while (isRunning())
     {
         if (0 == sem_wait(&mSemaphore))
         {
             ScopedLock lock(mMutex);
-            if (fabs(mDriveCommands.mThrottle) > 1e-6f)
+            if (fabs(mDriveCommands.mThrottle) > 1e-6f && (!mFrameSelector || mFrameSelector->select(mImage, mDriveCommands)))
             {
                 bytesWritten = snprintf(path, 256, "%s/%f_%f_%lu.jpg", mFolderName.c_str(), mDriveCommands.mSteering, mDriveCommands.mThrottle, mUid++);
                 memset(path + bytesWritten, '\0', 256 - bytesWritten);
-                imwrite(path, mImage);
-                printf("Image saved at: %s \n", path);
+                imwrite(path, mImage, {cv::IMWRITE_JPEG_QUALITY, mJpegQuality});
+                if (0 == stat(path, &fileStatus))
+                {
+                    ++mSavedImages;
+                    mBytesWritten += static_cast<unsigned long>(fileStatus.st_size);
+                }
+                if (logLimiter.allow())
+                {
+                    Logger::log(LOG_INFO, "Image saved at: %s", path);
+                }
             }
         }
     }
@@ -22,17 +22,21 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <DriveCommands.h>
 #include <GenericListener.h>
 #include <GenericThread.h>
+#include "FrameSelector.h"
 
 struct CameraData;
-class Configuration;
+struct Settings;
 
 /**
  * Dedicated class for saving images with associated steering and throttle to a file.
  * Images path are built like that: [steering]_[throttle]_[uid].jpg
+ * Optionally, frames are filtered by FrameSelector so that only novel or under-represented frames are saved.
  * Because the thread waits on semaphore, it needs to be cancelled when stopping.
  */
 class DataSaver : public GenericListener<CameraData>,
@@ -42,9 +46,9 @@ class DataSaver : public GenericListener<CameraData>,
 public:
     /**
      * Constructor that initialises path to where images should be saved and pre-allocates image buffer.
-     *  @param config the main configuration.
+     *  @param settings the settings of the application.
      */
-    explicit DataSaver(const Configuration& config);
+    explicit DataSaver(const Settings& settings);
 
     /**
      * Destructor, stops the thread.
@@ -57,6 +61,13 @@ public:
      */
     void update(const CameraData& cameraData) override;
 
+    /**
+     * Copies images and notifies the semaphore to resume separate thread to save the data to a file.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     */
+    void update(const cv::Mat& image, const cv::Mat& rightImage);
+
     /**
      * Saves the @p driveCommands to be encoded into the image path. 
      *  @param driveCommands the latest drive command.
@@ -69,6 +80,42 @@ public:
      */ 
     bool startThread();
 
+    /**
+     * Overrides/shadows the baseclass function to print frame selection statistics.
+     *  @param cancel true to cancel the thread which waits on the semaphore.
+     */
+    void stopThread(const bool cancel);
+
+    /**
+     * Changes the quality of saved images. This function is thread safe.
+     *  @param quality JPEG quality [0-100].
+     */
+    inline void setJpegQuality(const int quality)
+    {
+        mJpegQuality = quality;
+    }
+
+    /**
+     *  @return the number of frames received but not yet processed by the saving thread.
+     */
+    int getQueueDepth();
+
+    /**
+     *  @return the number of saved images.
+     */
+    inline unsigned long getSavedImages() const
+    {
+        return mSavedImages;
+    }
+
+    /**
+     *  @return the number of bytes written to disk.
+     */
+    inline unsigned long getBytesWritten() const
+    {
+        return mBytesWritten;
+    }
+
     /**
      * The main body of the data saver thread.
      *  @return nullptr.
@@ -84,4 +131,12 @@ private:
     cv::Mat mImage;
     /** The latest drive command received from the talker. */
     DriveCommands mDriveCommands;
+    /** Optional filter of saved frames, nullptr when all frames are saved. */
+    std::unique_ptr<FrameSelector> mFrameSelector;
+    /** JPEG quality of saved images. */
+    std::atomic<int> mJpegQuality;
+    /** The number of saved images. */
+    std::atomic<unsigned long> mSavedImages;
+    /** The number of bytes written to disk. */
+    std::atomic<unsigned long> mBytesWritten;
 };
@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "CameraDriveAdapter.h"
+#include "InferenceTuner.h"
+#include "RoundRobinDriveModel.h"
+
+/*
+ * Entry points of the inference plugin, see IDriveModel.h. They are the only symbols looked up with dlsym, everything
+ * else of the plugin is reached through the IDriveModel interface.
+ */
+extern "C"
+{
+IDriveModel* createDriveModel()
+{
+    return new RoundRobinDriveModel();
+}
+
+void destroyDriveModel(IDriveModel* model)
+{
+    delete model;
+}
+
+void setInferenceThreads(const int intraOpThreads, const int interOpThreads)
+{
+    CameraDriveAdapter::setThreads(intraOpThreads, interOpThreads);
+}
+
+bool runInferenceTuner(const Settings& settings)
+{
+    InferenceTuner tuner(settings);
+    return tuner.run();
+}
+} // extern "C"
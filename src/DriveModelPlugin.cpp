@@ -0,0 +1,267 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <dlfcn.h>
+#include <ScopedLock.h>
+#include "DriveModelPlugin.h"
+#include "Logger.h"
+#include "Settings.h"
+#include "StartupTimeline.h"
+#include "Timing.h"
+
+namespace
+{
+/**
+ * Looks up a function of the plugin.
+ *  @param library handle of the shared library.
+ *  @param name the name of the function.
+ *  @param function the function, nullptr if not found.
+ *  @return true if the function was found.
+ */
+template <typename T>
+bool lookUp(void* library, const char* name, T& function)
+{
+    function = reinterpret_cast<T>(dlsym(library, name));
+    if (!function)
+    {
+        Logger::log(LOG_ERROR, "Inference plugin does not export %s", name);
+    }
+    return function != nullptr;
+}
+} // end of anonymouse namespace
+
+DriveModelPlugin::DriveModelPlugin()
+: IDriveModel(),
+  GenericListener<DriveCommands>(),
+  mLibrary(nullptr),
+  mCreateModel(nullptr),
+  mDestroyModel(nullptr),
+  mSetThreads(nullptr),
+  mRunTuner(nullptr),
+  mModel(nullptr),
+  mTta(TTA_OFF),
+  mHasTta(false),
+  mFrameDivider(1),
+  mMinimumLevel(0),
+  mTtaSteeringThreshold(0.0f),
+  mTtaChangeThreshold(0.0f),
+  mTtaTimeBudget(0.0),
+  mHasAdaptiveTta(false),
+  mIntraOpThreads(0),
+  mLatency()
+{
+    pthread_mutex_init(&mMutex, nullptr);
+}
+
+DriveModelPlugin::~DriveModelPlugin()
+{
+    IDriveModel* model = mModel;
+    if (model)
+    {
+        static_cast<GenericListener<DriveCommands>&>(*this).unregisterFrom(model);
+        mDestroyModel(model);
+    }
+    // libtorch cannot be unloaded safely, so the library stays mapped until the process exits
+    pthread_mutex_destroy(&mMutex);
+}
+
+void DriveModelPlugin::initialise(const Settings& settings)
+{
+    if (isInitialised() || !load(settings.mInferencePlugin))
+    {
+        return;
+    }
+
+    mSetThreads(settings.mIntraOpThreads, settings.mInterOpThreads);
+    IDriveModel* model = mCreateModel();
+    model->initialise(settings);
+    if (!model->isInitialised())
+    {
+        mDestroyModel(model);
+        return;
+    }
+
+    ScopedLock lock(mMutex);
+    if (mHasTta)
+    {
+        model->setTtaMode(mTta);
+    }
+    model->setFrameDivider(mFrameDivider);
+    model->setMinimumLevel(mMinimumLevel);
+    if (mHasAdaptiveTta)
+    {
+        model->setAdaptiveTta(mTtaSteeringThreshold, mTtaChangeThreshold, mTtaTimeBudget);
+    }
+    model->setIntraOpThreads(mIntraOpThreads);
+    if (model->isAsynchronous())
+    {
+        static_cast<GenericListener<DriveCommands>&>(*this).registerTo(model);
+    }
+    mModel = model;
+    Logger::log(LOG_INFO, "Inference model initialised, resident memory %.1f MB", StartupTimeline::getResidentMemory());
+}
+
+bool DriveModelPlugin::load(const std::string& path)
+{
+    if (mLibrary)
+    {
+        return true;
+    }
+
+    double start = getMonotonicTime();
+    double residentMemory = StartupTimeline::getResidentMemory();
+    void* library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!library)
+    {
+        Logger::log(LOG_ERROR, "Failed to load inference plugin: %s", dlerror());
+        return false;
+    }
+    if (!lookUp(library, CREATE_DRIVE_MODEL, mCreateModel) || !lookUp(library, DESTROY_DRIVE_MODEL, mDestroyModel) ||
+        !lookUp(library, SET_INFERENCE_THREADS, mSetThreads) || !lookUp(library, RUN_INFERENCE_TUNER, mRunTuner))
+    {
+        dlclose(library);
+        return false;
+    }
+    mLibrary = library;
+    Logger::log(LOG_INFO, "Loaded inference plugin %s in %.1f ms, resident memory %.1f MB -> %.1f MB", path,
+                (getMonotonicTime() - start) * 1000.0, residentMemory, StartupTimeline::getResidentMemory());
+    return true;
+}
+
+bool DriveModelPlugin::runTuner(const Settings& settings)
+{
+    return load(settings.mInferencePlugin) && mRunTuner(settings);
+}
+
+bool DriveModelPlugin::isInitialised() const
+{
+    return mModel.load() != nullptr;
+}
+
+bool DriveModelPlugin::isAsynchronous() const
+{
+    IDriveModel* model = mModel;
+    return model && model->isAsynchronous();
+}
+
+void DriveModelPlugin::setTtaMode(const E_TtaMode tta)
+{
+    ScopedLock lock(mMutex);
+    mTta = tta;
+    mHasTta = true;
+    if (mModel)
+    {
+        mModel.load()->setTtaMode(tta);
+    }
+}
+
+void DriveModelPlugin::setFrameDivider(const unsigned int divider)
+{
+    ScopedLock lock(mMutex);
+    mFrameDivider = divider;
+    if (mModel)
+    {
+        mModel.load()->setFrameDivider(divider);
+    }
+}
+
+void DriveModelPlugin::setMinimumLevel(const size_t level)
+{
+    ScopedLock lock(mMutex);
+    mMinimumLevel = level;
+    if (mModel)
+    {
+        mModel.load()->setMinimumLevel(level);
+    }
+}
+
+void DriveModelPlugin::setAdaptiveTta(const float steeringThreshold, const float changeThreshold, const double timeBudget)
+{
+    ScopedLock lock(mMutex);
+    mTtaSteeringThreshold = steeringThreshold;
+    mTtaChangeThreshold = changeThreshold;
+    mTtaTimeBudget = timeBudget;
+    mHasAdaptiveTta = true;
+    if (mModel)
+    {
+        mModel.load()->setAdaptiveTta(steeringThreshold, changeThreshold, timeBudget);
+    }
+}
+
+void DriveModelPlugin::setIntraOpThreads(const int threads)
+{
+    ScopedLock lock(mMutex);
+    mIntraOpThreads = threads;
+    if (mModel)
+    {
+        mModel.load()->setIntraOpThreads(threads);
+    }
+}
+
+void DriveModelPlugin::update(const CameraData& camData)
+{
+    IDriveModel* model = mModel;
+    DriveCommands driveCommands;
+    if (model && model->isAsynchronous())
+    {
+        model->update(camData);
+    }
+    else if (model)
+    {
+        double start = getMonotonicTime();
+        bool inferred;
+        if (camData.mImage.size() == 1)
+        {
+            inferred = model->processImages(camData.mImage[0].createMatHeader(), cv::Mat(), driveCommands);
+        }
+        else
+        {
+            inferred = model->processImages(camData.mImage[0].createMatHeader(), camData.mImage[1].createMatHeader(), driveCommands);
+        }
+        // frames that reuse previous commands would fill the lowest bucket with samples of no inference
+        if (inferred)
+        {
+            mLatency.observe(getMonotonicTime() - start);
+        }
+        notifyListeners(driveCommands);
+    }
+}
+
+void DriveModelPlugin::update(const DriveCommands& driveCommands)
+{
+    notifyListeners(driveCommands);
+}
+
+bool DriveModelPlugin::processImages(const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands)
+{
+    IDriveModel* model = mModel;
+    return model && model->processImages(image, rightImage, driveCommands);
+}
+
+void DriveModelPlugin::printStatistics() const
+{
+    IDriveModel* model = mModel;
+    if (model)
+    {
+        model->printStatistics();
+    }
+}
@@ -0,0 +1,184 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <pthread.h>
+#include <string>
+#include "IDriveModel.h"
+#include "LatencyHistogram.h"
+
+/**
+ * Drive model that loads the inference plugin (CameraDriveAdapter, inference backends and libtorch) with dlopen
+ * only when it is initialised, so that RC and data collection sessions do not pay for loading libtorch.
+ * Images are passed to the model of the plugin and its drive commands to listeners of this class, either right
+ * away or, for an asynchronous model, when the model notifies them. Settings applied before initialisation are kept
+ * and passed to the model once it is created.
+ */
+class DriveModelPlugin : public IDriveModel,
+                         public GenericListener<DriveCommands>
+{
+public:
+    /**
+     * Basic constructor, the plugin is not loaded until initialisation.
+     */
+    DriveModelPlugin();
+
+    /**
+     * Destroys the model of the plugin.
+     */
+    virtual ~DriveModelPlugin();
+
+    /**
+     * Loads the plugin given by "inferencePlugin" configuration key, sets libtorch threads, then creates and
+     * initialises the model.
+     *  @param settings the settings of the application.
+     */
+    void initialise(const Settings& settings) override;
+
+    /**
+     * Loads the plugin and looks up its functions. Does nothing if the plugin has already been loaded.
+     *  @param path the path to the shared library of the plugin.
+     *  @return true if the plugin is loaded.
+     */
+    bool load(const std::string& path);
+
+    /**
+     * Runs the inference tuner of the plugin, see InferenceTuner.
+     *  @param settings the settings of the application.
+     *  @return true if the sweep was completed and the overlay was written.
+     */
+    bool runTuner(const Settings& settings);
+
+    /**
+     *  @return true of the model was initialised.
+     */
+    bool isInitialised() const override;
+
+    /**
+     *  @return true if the model of the plugin is asynchronous.
+     */
+    bool isAsynchronous() const override;
+
+    /**
+     * Changes the test time augmentations mode. This function is thread safe.
+     *  @param tta the test time augmentations mode.
+     */
+    void setTtaMode(const E_TtaMode tta) override;
+
+    /**
+     * Lowers the control rate by running inference only on every n-th frame. This function is thread safe.
+     *  @param divider run inference on every @p divider frame, 1 for every frame.
+     */
+    void setFrameDivider(const unsigned int divider) override;
+
+    /**
+     * Prevents models with resolutions higher than the given one from being used. This function is thread safe.
+     *  @param level the index of the highest resolution model that can be used, 0 for no limit.
+     */
+    void setMinimumLevel(const size_t level) override;
+
+    /**
+     * Sets conditions under which the flipped image is processed in the adaptive TTA mode. This function is thread safe.
+     *  @param steeringThreshold the absolute steering above which the prediction is considered uncertain.
+     *  @param changeThreshold the absolute change of steering from the previous frame above which the prediction is considered uncertain.
+     *  @param timeBudget the time in seconds per frame within which the flipped image is always processed, 0 to disable.
+     */
+    void setAdaptiveTta(const float steeringThreshold, const float changeThreshold, const double timeBudget) override;
+
+    /**
+     * Changes the number of libtorch threads used within an operation. This function is thread safe.
+     *  @param threads the number of threads, 0 to keep the current number.
+     */
+    void setIntraOpThreads(const int threads) override;
+
+    /**
+     * Passes camera images to the model and notifies listeners with predicted drive commands.
+     *  @param camData the camera data, can be from either mono or stereo camera.
+     */
+    void update(const CameraData& camData) override;
+
+    /**
+     * Passes drive commands of an asynchronous model to listeners.
+     *  @param driveCommands the predicted drive commands.
+     */
+    void update(const DriveCommands& driveCommands) override;
+
+    /**
+     * Predicts drive commands from images.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param driveCommands the predicted drive commands.
+     *  @return true if inference ran, false if previous drive commands were reused for this frame.
+     */
+    bool processImages(const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands) override;
+
+    /**
+     * Prints statistics of the model.
+     */
+    void printStatistics() const override;
+
+    /**
+     *  @return the histogram of time spent by the model on each frame with inference, empty for an asynchronous model.
+     */
+    inline const LatencyHistogram& getLatencyHistogram() const
+    {
+        return mLatency;
+    }
+
+private:
+    /** Handle of the shared library of the plugin. */
+    void* mLibrary;
+    /** Creates the model. */
+    CreateDriveModelFunction mCreateModel;
+    /** Destroys the model. */
+    DestroyDriveModelFunction mDestroyModel;
+    /** Sets libtorch threads. */
+    SetInferenceThreadsFunction mSetThreads;
+    /** Runs the inference tuner. */
+    RunInferenceTunerFunction mRunTuner;
+    /** The model of the plugin, nullptr until initialised. */
+    std::atomic<IDriveModel*> mModel;
+    /** The test time augmentations mode applied before initialisation. */
+    E_TtaMode mTta;
+    /** Flag indicating if the test time augmentations mode was changed before initialisation. */
+    bool mHasTta;
+    /** The frame divider applied before initialisation. */
+    unsigned int mFrameDivider;
+    /** The minimum level applied before initialisation. */
+    size_t mMinimumLevel;
+    /** Absolute steering above which the adaptive TTA processes the flipped image, applied before initialisation. */
+    float mTtaSteeringThreshold;
+    /** Absolute change of steering above which the adaptive TTA processes the flipped image, applied before initialisation. */
+    float mTtaChangeThreshold;
+    /** Time budget of the adaptive TTA in seconds, applied before initialisation. */
+    double mTtaTimeBudget;
+    /** Flag indicating if the adaptive TTA was changed before initialisation. */
+    bool mHasAdaptiveTta;
+    /** libtorch threads used within an operation applied before initialisation, 0 to keep the configured number. */
+    int mIntraOpThreads;
+    /** The time spent by the model on each frame with inference. */
+    LatencyHistogram mLatency;
+    /** Mutex protecting creation of the model and settings, which are changed by the performance governor and configuration reloads. */
+    pthread_mutex_t mMutex;
+};
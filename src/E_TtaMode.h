@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include "Configuration.h"
+
+/**
+ * An enum representing test time augmentation modes.
+ */
+enum E_TtaMode
+{
+    TTA_OFF         = 0, // only the original image is processed
+    TTA_ALWAYS      = 1, // the original and flipped images are processed for every frame
+    TTA_ADAPTIVE    = 2  // the flipped image is processed only when the prediction is uncertain or time allows
+};
+
+/**
+ * Converts configuration value into TTA mode. Boolean values are accepted for backwards compatibility.
+ *  @param value the configuration value: false, true or adaptive.
+ *  @return the TTA mode.
+ */
+inline E_TtaMode strToTtaMode(const std::string& value)
+{
+    if (value == "adaptive" || value == "Adaptive")
+    {
+        return TTA_ADAPTIVE;
+    }
+    return Configuration::strToBool(value) ? TTA_ALWAYS : TTA_OFF;
+}
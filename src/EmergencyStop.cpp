@@ -0,0 +1,194 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/joystick.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "EmergencyStop.h"
+#include "Logger.h"
+#include "Settings.h"
+
+namespace
+{
+/** The period in milliseconds after which the thread checks whether it should stop. */
+constexpr int POLL_TIMEOUT = 100;
+} // end of anonymouse namespace
+
+EmergencyStop::EmergencyStop(const Settings& settings, GenericListener<DriveCommands>& racer)
+: GenericListener<DriveCommands>(),
+  GenericThread<EmergencyStop>(),
+  mRacer(racer),
+  mDevice(settings.mGamepadDevice),
+  mStopButton(settings.mStopButton),
+  mPriority(settings.mEmergencyStopPriority),
+  mFd(-1),
+  mPipe{-1, -1},
+  mEngaged(false),
+  mListening(false),
+  mInFlight(0),
+  mSteering(0.0f),
+  mCallback()
+{
+    if (0 != pipe2(mPipe, O_NONBLOCK | O_CLOEXEC))
+    {
+        Logger::log(LOG_ERROR, "Failed to create the emergency stop pipe");
+    }
+}
+
+EmergencyStop::~EmergencyStop()
+{
+    stopThread();
+    for (int fd : mPipe)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+void EmergencyStop::setCallback(const std::function<void()>& callback)
+{
+    mCallback = callback;
+}
+
+bool EmergencyStop::startThread()
+{
+    // the device can be opened more than once, each reader receives all events
+    mFd = open(mDevice.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (mFd < 0)
+    {
+        Logger::log(LOG_WARNING, "Failed to open %s, emergency stop only reacts to the gamepad thread and signals", mDevice);
+    }
+    return GenericThread<EmergencyStop>::startThread();
+}
+
+void EmergencyStop::stopThread()
+{
+    if (isRunning())
+    {
+        GenericThread<EmergencyStop>::stopThread(false);
+    }
+    if (mFd >= 0)
+    {
+        close(mFd);
+        mFd = -1;
+    }
+}
+
+void EmergencyStop::update(const DriveCommands& driveCommands)
+{
+    // paired with engage(): either this call sees the stop engaged, or engage() sees the call in flight
+    ++mInFlight;
+    if (!mEngaged)
+    {
+        mSteering = driveCommands.mSteering;
+        mRacer.update(driveCommands);
+    }
+    --mInFlight;
+}
+
+void EmergencyStop::engage()
+{
+    if (mEngaged.exchange(true))
+    {
+        return;
+    }
+    mRacer.update(DriveCommands(mSteering, 0.0f));
+    // a command that was passed on before the stop engaged may reach the racer after zero throttle, so it is repeated
+    if (mInFlight > 0)
+    {
+        while (mInFlight > 0)
+        {
+            sched_yield();
+        }
+        mRacer.update(DriveCommands(mSteering, 0.0f));
+    }
+    Logger::log(LOG_WARNING, "Emergency stop engaged");
+    if (mCallback)
+    {
+        mCallback();
+    }
+}
+
+bool EmergencyStop::trigger()
+{
+    char byte = 1;
+    return mListening && 1 == write(mPipe[1], &byte, 1);
+}
+
+void* EmergencyStop::threadBody()
+{
+    struct pollfd descriptors[2];
+    struct js_event event;
+    nfds_t count;
+
+    if (mPriority > 0)
+    {
+        struct sched_param parameters = {};
+        parameters.sched_priority = mPriority;
+        if (0 != pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters))
+        {
+            Logger::log(LOG_WARNING, "Failed to set real-time priority %d of the emergency stop", mPriority);
+        }
+    }
+
+    mListening = true;
+    while (isRunning() && !mEngaged)
+    {
+        descriptors[0] = {mPipe[0], POLLIN, 0};
+        descriptors[1] = {mFd, POLLIN, 0};
+        count = (mFd >= 0) ? 2 : 1;
+        if (poll(descriptors, count, POLL_TIMEOUT) <= 0)
+        {
+            continue;
+        }
+        if (descriptors[0].revents & POLLIN)
+        {
+            engage();
+        }
+        else if (count > 1 && (descriptors[1].revents & POLLIN))
+        {
+            while (sizeof(event) == read(mFd, &event, sizeof(event)))
+            {
+                // initial states of buttons are reported on open and are not presses
+                if (JS_EVENT_BUTTON == event.type && mStopButton == event.number && 1 == event.value)
+                {
+                    engage();
+                    break;
+                }
+            }
+        }
+        else if (count > 1 && (descriptors[1].revents & (POLLHUP | POLLERR)))
+        {
+            Logger::log(LOG_WARNING, "Emergency stop lost %s", mDevice);
+            close(mFd);
+            mFd = -1;
+        }
+    }
+    mListening = false;
+    return nullptr;
+}
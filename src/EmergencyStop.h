@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <DriveCommands.h>
+#include <GenericListener.h>
+#include <GenericThread.h>
+
+struct Settings;
+
+/**
+ * The emergency stop, which sits between all producers of drive commands and the racer. It reads the gamepad device
+ * on its own thread, independently of the gamepad class and the state machine, so that pressing the stop button zeroes
+ * throttle even if the gamepad thread is blocked in a state transition. Once engaged, throttle is zeroed from the thread
+ * that engaged it, and further drive commands are no longer passed to the racer. The stop can also be triggered from
+ * a signal handler. Shutdown of other components is left to the callback.
+ */
+class EmergencyStop : public GenericListener<DriveCommands>, public GenericThread<EmergencyStop>
+{
+public:
+    /**
+     * Initialises parameters of the emergency stop.
+     *  @param settings the settings of the application.
+     *  @param racer the racer that receives drive commands.
+     */
+    EmergencyStop(const Settings& settings, GenericListener<DriveCommands>& racer);
+
+    /**
+     * Stops the thread and closes the device.
+     */
+    virtual ~EmergencyStop();
+
+    /**
+     * Sets the function called once the stop has engaged, from the thread that engaged it.
+     *  @param callback the function that shuts down the application.
+     */
+    void setCallback(const std::function<void()>& callback);
+
+    /**
+     * Overrides/shadows the baseclass function to open the gamepad device.
+     *  @return true if the thread started.
+     */
+    bool startThread();
+
+    /**
+     * Overrides/shadows the baseclass function to close the device.
+     */
+    void stopThread();
+
+    /**
+     * Passes drive commands to the racer unless the stop has engaged.
+     *  @param driveCommands the drive commands.
+     */
+    void update(const DriveCommands& driveCommands) override;
+
+    /**
+     * Zeroes throttle, blocks further drive commands and calls the callback. Only the first call has an effect.
+     */
+    void engage();
+
+    /**
+     * Wakes up the thread to engage the stop. It is async-signal-safe.
+     *  @return true if the thread is waiting and will engage the stop, false if it has to be engaged otherwise.
+     */
+    bool trigger();
+
+    /**
+     *  @return true if the stop has engaged.
+     */
+    inline bool isEngaged() const
+    {
+        return mEngaged;
+    }
+
+    /**
+     * The main body of the thread that waits for the stop button or a trigger.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /** The racer. */
+    GenericListener<DriveCommands>& mRacer;
+    /** The path to the gamepad device. */
+    std::string mDevice;
+    /** The number of the stop button. */
+    int mStopButton;
+    /** The real-time priority of the thread, 0 to keep the default scheduling. */
+    int mPriority;
+    /** The file descriptor of the gamepad device. */
+    int mFd;
+    /** Descriptors of the pipe used to wake up the thread. */
+    int mPipe[2];
+    /** Flag indicating that the stop has engaged. */
+    std::atomic<bool> mEngaged;
+    /** Flag indicating that the thread waits for the stop button or a trigger. */
+    std::atomic<bool> mListening;
+    /** The number of drive commands being passed to the racer. */
+    std::atomic<int> mInFlight;
+    /** The latest steering passed to the racer, kept when throttle is zeroed. */
+    std::atomic<float> mSteering;
+    /** The function called once the stop has engaged. */
+    std::function<void()> mCallback;
+};
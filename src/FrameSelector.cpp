@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+#include "FrameSelector.h"
+
+FrameSelector::FrameSelector(const double minDifference, const unsigned long minPerBin, const unsigned long maxPerBin,
+                             const int steeringBins, const int throttleBins)
+: mMinDifference(minDifference),
+  mMinPerBin(minPerBin),
+  mMaxPerBin(maxPerBin),
+  mSteeringBins(std::max(1, steeringBins)),
+  mThrottleBins(std::max(1, throttleBins)),
+  mHistogram(mSteeringBins * mThrottleBins, 0),
+  mCurrent(),
+  mLastKept(),
+  mKept(0),
+  mSkippedSimilar(0),
+  mSkippedBudget(0)
+{
+}
+
+FrameSelector::~FrameSelector()
+{
+}
+
+bool FrameSelector::select(const cv::Mat& image, const DriveCommands& driveCommands)
+{
+    int bin = getBin(driveCommands);
+    bool keep = mHistogram[bin] < mMinPerBin;
+
+    mCurrent.compute(image);
+    if (!keep)
+    {
+        if (mCurrent.difference(mLastKept) < mMinDifference)
+        {
+            ++mSkippedSimilar;
+        }
+        else if (mMaxPerBin > 0 && mHistogram[bin] >= mMaxPerBin)
+        {
+            ++mSkippedBudget;
+        }
+        else
+        {
+            keep = true;
+        }
+    }
+
+    if (keep)
+    {
+        ++mHistogram[bin];
+        ++mKept;
+        // swapping keeps both buffers allocated and avoids a deep copy
+        std::swap(mCurrent, mLastKept);
+    }
+    return keep;
+}
+
+void FrameSelector::printStatistics() const
+{
+    unsigned long total = mKept + mSkippedSimilar + mSkippedBudget;
+    int coveredBins = static_cast<int>(std::count_if(mHistogram.begin(), mHistogram.end(), [](const unsigned long count) { return count > 0; }));
+    printf("Frame selection: kept %lu of %lu frames (%.1f%%), skipped %lu similar and %lu over budget, %d of %d bins covered \n",
+           mKept, total, total > 0 ? 100.0 * mKept / total : 0.0, mSkippedSimilar, mSkippedBudget, coveredBins, static_cast<int>(mHistogram.size()));
+}
+
+int FrameSelector::getBin(const DriveCommands& driveCommands) const
+{
+    int steering = static_cast<int>((std::clamp(driveCommands.mSteering, -1.0f, 1.0f) + 1.0f) * 0.5f * mSteeringBins);
+    int throttle = static_cast<int>((std::clamp(driveCommands.mThrottle, -1.0f, 1.0f) + 1.0f) * 0.5f * mThrottleBins);
+    return std::min(throttle, mThrottleBins - 1) * mSteeringBins + std::min(steering, mSteeringBins - 1);
+}
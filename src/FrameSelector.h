@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <DriveCommands.h>
+#include "ImageSignature.h"
+
+/**
+ * Decides which of the captured frames are worth saving. A frame is kept when it is sufficiently different from
+ * the last kept frame and its steering-throttle bin has not exhausted its budget, or when its bin is under-represented
+ * regardless of how similar the frame is. This removes long runs of near-identical images while keeping rare manoeuvres.
+ */
+class FrameSelector
+{
+public:
+    /**
+     * Initialises the selector and the steering-throttle histogram.
+     *  @param minDifference the minimum mean grey-level difference from the last kept frame for a frame to be novel.
+     *  @param minPerBin the number of frames below which a bin is under-represented and frames are always kept.
+     *  @param maxPerBin the maximum number of frames kept per bin, 0 for no limit.
+     *  @param steeringBins the number of histogram bins for steering in range [-1, 1].
+     *  @param throttleBins the number of histogram bins for throttle in range [-1, 1].
+     */
+    FrameSelector(const double minDifference, const unsigned long minPerBin, const unsigned long maxPerBin,
+                  const int steeringBins, const int throttleBins);
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~FrameSelector();
+
+    /**
+     * Decides whether the @p image with associated @p driveCommands should be saved and updates the statistics.
+     *  @param image the image to be saved.
+     *  @param driveCommands the drive commands associated with the image.
+     *  @return true if the frame should be saved.
+     */
+    bool select(const cv::Mat& image, const DriveCommands& driveCommands);
+
+    /**
+     * Prints how many frames were kept and skipped, and the histogram coverage.
+     */
+    void printStatistics() const;
+
+    /**
+     *  @return the number of frames kept so far.
+     */
+    inline unsigned long getKeptFrames() const
+    {
+        return mKept;
+    }
+
+    /**
+     *  @return the number of frames skipped so far.
+     */
+    inline unsigned long getSkippedFrames() const
+    {
+        return mSkippedSimilar + mSkippedBudget;
+    }
+
+private:
+    /**
+     * Finds the histogram bin for given drive commands.
+     *  @param driveCommands the drive commands.
+     *  @return the index of the bin.
+     */
+    int getBin(const DriveCommands& driveCommands) const;
+
+    /** The minimum difference from the last kept frame for a frame to be novel. */
+    double mMinDifference;
+    /** The number of frames below which a bin is under-represented. */
+    unsigned long mMinPerBin;
+    /** The maximum number of frames per bin, 0 for no limit. */
+    unsigned long mMaxPerBin;
+    /** The number of steering bins. */
+    int mSteeringBins;
+    /** The number of throttle bins. */
+    int mThrottleBins;
+    /** Number of kept frames in each steering-throttle bin. */
+    std::vector<unsigned long> mHistogram;
+    /** The signature of the current frame. */
+    ImageSignature mCurrent;
+    /** The signature of the last kept frame. */
+    ImageSignature mLastKept;
+    /** The number of kept frames. */
+    unsigned long mKept;
+    /** The number of frames skipped because they were too similar to the last kept frame. */
+    unsigned long mSkippedSimilar;
+    /** The number of frames skipped because their bin has exhausted its budget. */
+    unsigned long mSkippedBudget;
+};
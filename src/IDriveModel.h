@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <CameraData.h>
+#include <DriveCommands.h>
+#include <GenericListener.h>
+#include <GenericTalker.h>
+#include "E_TtaMode.h"
+
+struct Settings;
+
+/**
+ * Interface of models that take camera images and notify listeners with predicted drive commands. It separates the
+ * application from the inference plugin, which is loaded at runtime so that libtorch is only mapped when it is needed.
+ */
+class IDriveModel : public GenericListener<CameraData>,
+                    public GenericTalker<DriveCommands>
+{
+public:
+    /**
+     * Basic destructor.
+     */
+    virtual ~IDriveModel()
+    {
+    }
+
+    /**
+     * Loads models and configures the model from the configuration.
+     *  @param settings the settings of the application.
+     */
+    virtual void initialise(const Settings& settings) = 0;
+
+    /**
+     *  @return true of the model was initialised.
+     */
+    virtual bool isInitialised() const = 0;
+
+    /**
+     *  @return true if drive commands are predicted on threads of the model and passed to its listeners once ready,
+     *  false if they are predicted on the thread that passes images.
+     */
+    virtual bool isAsynchronous() const = 0;
+
+    /**
+     * Changes the test time augmentations mode. This function is thread safe.
+     *  @param tta the test time augmentations mode.
+     */
+    virtual void setTtaMode(const E_TtaMode tta) = 0;
+
+    /**
+     * Lowers the control rate by running inference only on every n-th frame. This function is thread safe.
+     *  @param divider run inference on every @p divider frame, 1 for every frame.
+     */
+    virtual void setFrameDivider(const unsigned int divider) = 0;
+
+    /**
+     * Prevents models with resolutions higher than the given one from being used. This function is thread safe.
+     *  @param level the index of the highest resolution model that can be used, 0 for no limit.
+     */
+    virtual void setMinimumLevel(const size_t level) = 0;
+
+    /**
+     * Sets conditions under which the flipped image is processed in the adaptive TTA mode. This function is thread safe.
+     *  @param steeringThreshold the absolute steering above which the prediction is considered uncertain.
+     *  @param changeThreshold the absolute change of steering from the previous frame above which the prediction is considered uncertain.
+     *  @param timeBudget the time in seconds per frame within which the flipped image is always processed, 0 to disable.
+     */
+    virtual void setAdaptiveTta(const float steeringThreshold, const float changeThreshold, const double timeBudget) = 0;
+
+    /**
+     * Changes the number of libtorch threads used within an operation. The threads running inference apply it before
+     * their next frame. This function is thread safe.
+     *  @param threads the number of threads, 0 to keep the current number.
+     */
+    virtual void setIntraOpThreads(const int threads) = 0;
+
+    /**
+     * Predicts drive commands from images.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param driveCommands the predicted drive commands.
+     *  @return true if inference ran, false if previous drive commands were reused for this frame.
+     */
+    virtual bool processImages(const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands) = 0;
+
+    /**
+     * Prints statistics of processed frames.
+     */
+    virtual void printStatistics() const = 0;
+};
+
+/** Names and signatures of functions exported by the inference plugin with C linkage. */
+constexpr const char* CREATE_DRIVE_MODEL = "createDriveModel";
+typedef IDriveModel* (*CreateDriveModelFunction)();
+constexpr const char* DESTROY_DRIVE_MODEL = "destroyDriveModel";
+typedef void (*DestroyDriveModelFunction)(IDriveModel*);
+constexpr const char* SET_INFERENCE_THREADS = "setInferenceThreads";
+typedef void (*SetInferenceThreadsFunction)(const int, const int);
+constexpr const char* RUN_INFERENCE_TUNER = "runInferenceTuner";
+typedef bool (*RunInferenceTunerFunction)(const Settings&);
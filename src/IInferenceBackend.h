@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * Interface for inference backends that run the road following model. All backends take the same input, normalised
+ * once by ImagePreprocessor, and produce steering and throttle for each image in the batch, so they are interchangeable.
+ */
+class IInferenceBackend
+{
+public:
+    /**
+     * Basic destructor.
+     */
+    virtual ~IInferenceBackend()
+    {
+    }
+
+    /**
+     * Loads the model.
+     *  @param pathToModel path to the model file.
+     *  @param input a pre-processed input of the shape the backend will process, side-by-side for a stereo camera.
+     *  @return true if the model was loaded.
+     */
+    virtual bool initialise(const std::string& pathToModel, const cv::Mat& input) = 0;
+
+    /**
+     * Runs the model on a pre-processed input.
+     *  @param blob the NCHW float input created by ImagePreprocessor, flipped images of test time augmentations are
+     *              placed in the second half of the batch.
+     *  @param outputs steering and throttle predicted for each image in the batch.
+     */
+    virtual void process(const cv::Mat& blob, std::vector<cv::Vec2f>& outputs) = 0;
+
+    /**
+     *  @return the name of the backend.
+     */
+    virtual const char* getName() const = 0;
+};
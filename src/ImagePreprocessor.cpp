@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgproc.hpp>
+#include "ImagePreprocessor.h"
+
+namespace
+{
+/** ImageNet mean of RGB channels. */
+const cv::Scalar RGB_MEAN(0.485, 0.456, 0.406);
+/** ImageNet standard deviation of RGB channels. */
+const cv::Scalar RGB_STD(0.229, 0.224, 0.225);
+/** ImageNet mean averaged over channels, used for greyscale images. */
+const cv::Scalar GREY_MEAN(0.449);
+/** ImageNet standard deviation averaged over channels, used for greyscale images. */
+const cv::Scalar GREY_STD(0.226);
+} // end of anonymouse namespace
+
+ImagePreprocessor::ImagePreprocessor()
+: mCombined(),
+  mNormalised(2)
+{
+}
+
+ImagePreprocessor::~ImagePreprocessor()
+{
+}
+
+void ImagePreprocessor::normalise(const cv::Mat& image, const cv::Mat& rightImage, const bool flip, cv::Mat& normalised)
+{
+    if (rightImage.empty())
+    {
+        cv::cvtColor(image, mCombined, cv::COLOR_BGR2RGB);
+    }
+    else
+    {
+        cv::hconcat(image, rightImage, mCombined);
+    }
+
+    if (flip)
+    {
+        cv::flip(mCombined, mCombined, 1);
+    }
+
+    mCombined.convertTo(normalised, CV_32F, 1.0 / 255.0);
+    cv::subtract(normalised, rightImage.empty() ? RGB_MEAN : GREY_MEAN, normalised);
+    cv::divide(normalised, rightImage.empty() ? RGB_STD : GREY_STD, normalised);
+}
+
+void ImagePreprocessor::createBlob(const bool tta, const cv::Mat& image, const cv::Mat& rightImage, cv::Mat& blob)
+{
+    normalise(image, rightImage, false, mNormalised[0]);
+    if (tta)
+    {
+        cv::flip(mNormalised[0], mNormalised[1], 1);
+        cv::dnn::blobFromImages(mNormalised, blob);
+    }
+    else
+    {
+        cv::dnn::blobFromImage(mNormalised[0], blob);
+    }
+}
+
+void ImagePreprocessor::createFlippedBlob(const cv::Mat& image, const cv::Mat& rightImage, cv::Mat& blob)
+{
+    // flipping side-by-side images swaps the cameras, as they see the mirrored scene
+    normalise(image, rightImage, true, mNormalised[1]);
+    cv::dnn::blobFromImage(mNormalised[1], blob);
+}
@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * Converts camera images into normalised model input. Colour images are converted from BGR to RGB and normalised
+ * with ImageNet mean and standard deviation. Stereo greyscale images are placed side by side, as they are saved
+ * by DataSaver for training, and normalised with the mean and standard deviation averaged over ImageNet channels.
+ * This is the only conversion of images into model input: CameraDriveAdapter passes its blobs to every inference
+ * backend, and TrainingDataset uses it for training samples.
+ */
+class ImagePreprocessor
+{
+public:
+    /**
+     * Basic constructor.
+     */
+    ImagePreprocessor();
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~ImagePreprocessor();
+
+    /**
+     * Converts images into a normalised HWC float image.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param flip true to flip the result horizontally, i.e., to produce the input of the mirrored scene.
+     *  @param normalised the normalised float image.
+     */
+    void normalise(const cv::Mat& image, const cv::Mat& rightImage, const bool flip, cv::Mat& normalised);
+
+    /**
+     * Converts images into a normalised NCHW float blob.
+     *  @param tta true to add the flipped images as the second item of the batch.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param blob the blob with one or two (TTA) items.
+     */
+    void createBlob(const bool tta, const cv::Mat& image, const cv::Mat& rightImage, cv::Mat& blob);
+
+    /**
+     * Converts images of the mirrored scene into a normalised NCHW float blob with a single item. For a stereo camera
+     * the flipped right image becomes the left one and vice versa.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param blob the blob with the flipped images.
+     */
+    void createFlippedBlob(const cv::Mat& image, const cv::Mat& rightImage, cv::Mat& blob);
+
+private:
+    /** Buffer for side-by-side or RGB images. */
+    cv::Mat mCombined;
+    /** Normalised images, the second one is flipped. */
+    std::vector<cv::Mat> mNormalised;
+};
@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <opencv2/imgproc.hpp>
+#include "ImageSignature.h"
+
+ImageSignature::ImageSignature(const cv::Size& size)
+: mSize(size),
+  mGrey(),
+  mThumbnail()
+{
+}
+
+ImageSignature::~ImageSignature()
+{
+}
+
+void ImageSignature::compute(const cv::Mat& image)
+{
+    if (image.channels() == 3)
+    {
+        cv::cvtColor(image, mGrey, cv::COLOR_BGR2GRAY);
+        cv::resize(mGrey, mThumbnail, mSize, 0, 0, cv::INTER_AREA);
+    }
+    else
+    {
+        cv::resize(image, mThumbnail, mSize, 0, 0, cv::INTER_AREA);
+    }
+}
+
+double ImageSignature::difference(const ImageSignature& other) const
+{
+    if (isEmpty() || other.isEmpty() || mThumbnail.size() != other.mThumbnail.size())
+    {
+        return 255.0;
+    }
+    return cv::norm(mThumbnail, other.mThumbnail, cv::NORM_L1) / static_cast<double>(mThumbnail.total());
+}
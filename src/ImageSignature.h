@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <opencv2/core.hpp>
+
+/**
+ * A cheap signature of an image: a tiny greyscale thumbnail that can be compared with other signatures
+ * to tell whether two frames are nearly identical.
+ */
+class ImageSignature
+{
+public:
+    /**
+     * Initialises the signature without computing it.
+     *  @param size the size of the thumbnail.
+     */
+    explicit ImageSignature(const cv::Size& size = cv::Size(16, 16));
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~ImageSignature();
+
+    /**
+     * Computes the signature of the @p image. Colour images are converted to greyscale first.
+     *  @param image the image to compute the signature for.
+     */
+    void compute(const cv::Mat& image);
+
+    /**
+     * Calculates the mean absolute difference between two signatures.
+     *  @param other the signature to compare against.
+     *  @return the difference in grey levels [0, 255], or the maximum difference if either signature is empty.
+     */
+    double difference(const ImageSignature& other) const;
+
+    /**
+     *  @return true if the signature has not been computed yet.
+     */
+    inline bool isEmpty() const
+    {
+        return mThumbnail.empty();
+    }
+
+private:
+    /** The size of the thumbnail. */
+    cv::Size mSize;
+    /** Buffer for the greyscale conversion of colour images. */
+    cv::Mat mGrey;
+    /** The thumbnail that forms the signature. */
+    cv::Mat mThumbnail;
+};
@@ -0,0 +1,254 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#include "ImuReader.h"
+#include "Logger.h"
+#include "Settings.h"
+#include "Timing.h"
+
+namespace
+{
+/** Registers of MPU-6050 compatible IMUs. */
+constexpr unsigned char REGISTER_CONFIG = 0x1A;
+constexpr unsigned char REGISTER_GYRO_CONFIG = 0x1B;
+constexpr unsigned char REGISTER_ACCEL_CONFIG = 0x1C;
+constexpr unsigned char REGISTER_ACCEL_XOUT_H = 0x3B;
+constexpr unsigned char REGISTER_PWR_MGMT_1 = 0x6B;
+/** Gyroscope full scale of 500 deg/s and its resolution converted to rad/s. */
+constexpr unsigned char GYRO_500DPS = 0x08;
+constexpr float GYRO_SCALE = static_cast<float>(M_PI / 180.0 / 65.5);
+/** Accelerometer full scale of 4 g and its resolution converted to m/s^2. */
+constexpr unsigned char ACCEL_4G = 0x08;
+constexpr float ACCEL_SCALE = 9.80665f / 8192.0f;
+/** Digital low pass filter with 44 Hz bandwidth. */
+constexpr unsigned char DLPF_44HZ = 0x03;
+
+/**
+ * Writes a single register of the IMU.
+ *  @param fd the file descriptor of the I2C bus.
+ *  @param reg the register.
+ *  @param value the value to write.
+ *  @return true if the value was written.
+ */
+bool writeRegister(const int fd, const unsigned char reg, const unsigned char value)
+{
+    unsigned char buffer[2] = {reg, value};
+    return 2 == write(fd, buffer, 2);
+}
+
+/**
+ * Adds a period to an absolute time.
+ *  @param time the time to advance.
+ *  @param period the period in seconds.
+ */
+void advance(struct timespec& time, const double period)
+{
+    time.tv_nsec += static_cast<long>(period * 1e9);
+    while (time.tv_nsec >= 1000000000L)
+    {
+        ++time.tv_sec;
+        time.tv_nsec -= 1000000000L;
+    }
+}
+} // end of anonymouse namespace
+
+ImuReader::ImuReader(const Settings& settings)
+: GenericTalker<ImuData>(),
+  GenericThread<ImuReader>(),
+  mDevice(settings.mImuDevice),
+  mAddress(settings.mImuAddress),
+  mRate(settings.mImuRate),
+  mReplayPath(settings.mImuReplay),
+  mRecordPath(settings.mImuRecord),
+  mFd(-1),
+  mReplay(nullptr),
+  mRecord(nullptr),
+  mSamples(0)
+{
+}
+
+ImuReader::~ImuReader()
+{
+    stopThread();
+}
+
+bool ImuReader::startThread()
+{
+    if (!mReplayPath.empty())
+    {
+        mReplay = fopen(mReplayPath.c_str(), "r");
+        if (nullptr == mReplay)
+        {
+            Logger::log(LOG_ERROR, "Failed to open IMU recording %s", mReplayPath);
+            return false;
+        }
+        Logger::log(LOG_INFO, "Replaying IMU samples from %s", mReplayPath);
+    }
+    else if (openDevice())
+    {
+        if (!mRecordPath.empty())
+        {
+            mRecord = fopen(mRecordPath.c_str(), "w");
+            if (nullptr == mRecord)
+            {
+                Logger::log(LOG_WARNING, "Failed to open %s, IMU samples will not be recorded", mRecordPath);
+            }
+        }
+        Logger::log(LOG_INFO, "Sampling IMU at 0x%02x on %s at %.0f Hz", mAddress, mDevice, mRate);
+    }
+    else
+    {
+        return false;
+    }
+    return GenericThread<ImuReader>::startThread();
+}
+
+void ImuReader::stopThread()
+{
+    if (isRunning())
+    {
+        GenericThread<ImuReader>::stopThread(false);
+        Logger::log(LOG_INFO, "IMU samples: %lu", mSamples.load());
+    }
+    if (mFd >= 0)
+    {
+        close(mFd);
+        mFd = -1;
+    }
+    if (nullptr != mReplay)
+    {
+        fclose(mReplay);
+        mReplay = nullptr;
+    }
+    if (nullptr != mRecord)
+    {
+        fclose(mRecord);
+        mRecord = nullptr;
+    }
+}
+
+void* ImuReader::threadBody()
+{
+    struct timespec wakeUp;
+    ImuData sample;
+    double period = 1.0 / mRate;
+    double recordedStart = 0.0;
+    double start = getMonotonicTime();
+
+    clock_gettime(CLOCK_MONOTONIC, &wakeUp);
+    while (isRunning())
+    {
+        if (nullptr != mReplay)
+        {
+            if (!readFile(sample))
+            {
+                Logger::log(LOG_INFO, "End of IMU recording after %lu samples", mSamples.load());
+                break;
+            }
+            // recorded times are shifted to the current clock and samples are passed on at the recorded pace
+            if (0 == mSamples)
+            {
+                recordedStart = sample.mTime;
+            }
+            sample.mTime = start + sample.mTime - recordedStart;
+            wakeUp.tv_sec = static_cast<time_t>(sample.mTime);
+            wakeUp.tv_nsec = static_cast<long>((sample.mTime - static_cast<double>(wakeUp.tv_sec)) * 1e9);
+            while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, nullptr))
+            {
+            }
+        }
+        else
+        {
+            advance(wakeUp, period);
+            while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, nullptr))
+            {
+            }
+            if (!readDevice(sample))
+            {
+                Logger::log(LOG_WARNING, "Failed to read IMU sample");
+                continue;
+            }
+            if (nullptr != mRecord)
+            {
+                fprintf(mRecord, "%.6f %f %f %f %f %f %f\n", sample.mTime, sample.mGyro[0], sample.mGyro[1], sample.mGyro[2],
+                        sample.mAccel[0], sample.mAccel[1], sample.mAccel[2]);
+            }
+        }
+        ++mSamples;
+        notifyListeners(sample);
+    }
+    return nullptr;
+}
+
+bool ImuReader::openDevice()
+{
+    mFd = open(mDevice.c_str(), O_RDWR);
+    if (mFd < 0)
+    {
+        Logger::log(LOG_ERROR, "Failed to open %s", mDevice);
+        return false;
+    }
+    if (ioctl(mFd, I2C_SLAVE, mAddress) < 0 || !writeRegister(mFd, REGISTER_PWR_MGMT_1, 0x00)
+        || !writeRegister(mFd, REGISTER_CONFIG, DLPF_44HZ) || !writeRegister(mFd, REGISTER_GYRO_CONFIG, GYRO_500DPS)
+        || !writeRegister(mFd, REGISTER_ACCEL_CONFIG, ACCEL_4G))
+    {
+        Logger::log(LOG_ERROR, "No IMU responded at 0x%02x on %s", mAddress, mDevice);
+        close(mFd);
+        mFd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool ImuReader::readDevice(ImuData& sample)
+{
+    unsigned char reg = REGISTER_ACCEL_XOUT_H;
+    unsigned char buffer[14];
+    int i;
+
+    if (1 != write(mFd, &reg, 1) || 14 != read(mFd, buffer, 14))
+    {
+        return false;
+    }
+    sample.mTime = getMonotonicTime();
+    // registers are big-endian: accelerations, temperature and angular rates
+    for (i = 0; i < 3; ++i)
+    {
+        sample.mAccel[i] = static_cast<float>(static_cast<int16_t>((buffer[2 * i] << 8) | buffer[2 * i + 1])) * ACCEL_SCALE;
+        sample.mGyro[i] = static_cast<float>(static_cast<int16_t>((buffer[8 + 2 * i] << 8) | buffer[9 + 2 * i])) * GYRO_SCALE;
+    }
+    return true;
+}
+
+bool ImuReader::readFile(ImuData& sample)
+{
+    return 7 == fscanf(mReplay, "%lf %f %f %f %f %f %f", &sample.mTime, &sample.mGyro[0], &sample.mGyro[1], &sample.mGyro[2],
+                       &sample.mAccel[0], &sample.mAccel[1], &sample.mAccel[2]);
+}
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <GenericTalker.h>
+#include <GenericThread.h>
+#include "ImuData.h"
+
+struct Settings;
+
+/**
+ * Samples gyroscope and accelerometer of an MPU-6050 compatible IMU over I2C at a fixed rate and passes samples to listeners.
+ * Instead of the device, samples can be replayed in real time from a recorded file with one "time gx gy gz ax ay az" line
+ * per sample, so that the consumers can be tested without the hardware. Samples read from the device can be recorded
+ * in the same format.
+ */
+class ImuReader : public GenericTalker<ImuData>, public GenericThread<ImuReader>
+{
+public:
+    /**
+     * Initialises parameters of the reader.
+     *  @param settings the settings of the application.
+     */
+    explicit ImuReader(const Settings& settings);
+
+    /**
+     * Stops the thread and closes the device.
+     */
+    virtual ~ImuReader();
+
+    /**
+     * Overrides/shadows the baseclass function to open the device or the recorded file.
+     *  @return true if the source was opened and the thread started.
+     */
+    bool startThread();
+
+    /**
+     * Overrides/shadows the baseclass function to close the source.
+     */
+    void stopThread();
+
+    /**
+     *  @return the number of samples passed to listeners.
+     */
+    inline unsigned long getSamples() const
+    {
+        return mSamples;
+    }
+
+    /**
+     * The main body of the thread that reads samples.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /**
+     * Opens the I2C device, wakes the IMU up and sets full scale ranges.
+     *  @return true if the IMU responded.
+     */
+    bool openDevice();
+
+    /**
+     * Reads a single sample from the device.
+     *  @param sample the sample with converted units.
+     *  @return true if the sample was read.
+     */
+    bool readDevice(ImuData& sample);
+
+    /**
+     * Reads the next sample from the recorded file.
+     *  @param sample the sample with its recorded time.
+     *  @return true if the sample was read, false at the end of the file.
+     */
+    bool readFile(ImuData& sample);
+
+    /** The path to the I2C bus. */
+    std::string mDevice;
+    /** The address of the IMU on the bus. */
+    int mAddress;
+    /** The sampling rate of the device in Hz. */
+    double mRate;
+    /** The path to the recorded file to replay, empty to read the device. */
+    std::string mReplayPath;
+    /** The path to the file where samples of the device are recorded, empty to disable. */
+    std::string mRecordPath;
+    /** The file descriptor of the I2C bus. */
+    int mFd;
+    /** The replayed file. */
+    FILE* mReplay;
+    /** The recording file. */
+    FILE* mRecord;
+    /** The number of samples passed to listeners. */
+    std::atomic<unsigned long> mSamples;
+};
@@ -0,0 +1,218 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <experimental/filesystem>
+#include <fstream>
+#include <thread>
+#include <opencv2/imgcodecs.hpp>
+#include "BackendSelector.h"
+#include "CameraDriveAdapter.h"
+#include "InferenceTuner.h"
+#include "LatencyStats.h"
+#include "Settings.h"
+#include "Timing.h"
+
+namespace
+{
+/** The number of frames processed before latency is measured. */
+constexpr int WARM_UP_FRAMES = 5;
+/** The number of synthetic frames generated when replayed frames are not configured. */
+constexpr int SYNTHETIC_FRAMES = 16;
+
+const char* ttaToStr(const E_TtaMode tta)
+{
+    switch (tta)
+    {
+        case TTA_ALWAYS: return "true";
+        case TTA_ADAPTIVE: return "adaptive";
+        case TTA_OFF:
+        default: return "false";
+    }
+}
+} // end of anonymouse namespace
+
+InferenceTuner::InferenceTuner(const Settings& settings)
+: mSettings(settings),
+  mImages(),
+  mRightImages(),
+  mResults()
+{
+}
+
+InferenceTuner::~InferenceTuner()
+{
+}
+
+bool InferenceTuner::run()
+{
+    if (!loadFrames())
+    {
+        puts("No frames available for tuning.");
+        return false;
+    }
+
+    const E_TtaMode ttaModes[] = {TTA_OFF, TTA_ADAPTIVE, TTA_ALWAYS};
+    const int iterations = static_cast<int>(mSettings.mTuneIterations);
+    const int maxThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const double framePeriod = 1.0 / mSettings.mFramerate;
+    CameraDriveAdapter adapter;
+    DriveCommands driveCommands;
+    LatencyStats stats(iterations);
+    double startTime;
+
+    CameraDriveAdapter::setThreads(0, mSettings.mInterOpThreads);
+    BackendSelector selector(mSettings.mModel, 
+                             mSettings.mOnnxModel, 
+                             cv::Size(mSettings.mWidth, mSettings.mHeight), 
+                             mSettings.mIsMono,
+                             mSettings.mOptimiseModel);
+    adapter.initialise(selector.select(mSettings.mBackend, false), TTA_OFF);
+    if (!adapter.isInitialised())
+    {
+        puts("Failed to initialise inference backend.");
+        return false;
+    }
+    adapter.setAdaptiveTta(mSettings.mTtaSteeringThreshold, mSettings.mTtaChangeThreshold, mSettings.mTtaTimeBudget);
+    mResults.clear();
+
+    for (int threads = 1; threads <= maxThreads; ++threads)
+    {
+        CameraDriveAdapter::setThreads(threads, 0);
+        for (const E_TtaMode tta : ttaModes)
+        {
+            adapter.setTtaMode(tta);
+            stats.clear();
+            for (int i = 0; i < WARM_UP_FRAMES + iterations; ++i)
+            {
+                size_t index = i % mImages.size();
+                startTime = getMonotonicTime();
+                adapter.predict(mImages[index], mRightImages.empty() ? cv::Mat() : mRightImages[index], driveCommands);
+                if (i >= WARM_UP_FRAMES)
+                {
+                    stats.addSample(getMonotonicTime() - startTime);
+                }
+            }
+            mResults.push_back({threads, tta, stats.getPercentile(50.0), stats.getPercentile(99.0)});
+            printf("threads=%d, tta=%s: p50=%.2f ms, p99=%.2f ms \n", threads, ttaToStr(tta), 
+                   mResults.back().mP50 * 1000.0, mResults.back().mP99 * 1000.0);
+        }
+    }
+
+    // prefer the strongest TTA that fits within the frame period, otherwise the fastest setting
+    const Result* best = nullptr;
+    for (int i = 2; i >= 0 && !best; --i)
+    {
+        for (const Result& result : mResults)
+        {
+            if (result.mTta == ttaModes[i] && result.mP99 <= framePeriod && (!best || result.mP99 < best->mP99))
+            {
+                best = &result;
+            }
+        }
+    }
+    if (!best)
+    {
+        best = &(*std::min_element(mResults.begin(), mResults.end(), [](const Result& a, const Result& b) { return a.mP99 < b.mP99; }));
+    }
+    printf("Best setting: intraOpThreads=%d, tta=%s, p50=%.2f ms, p99=%.2f ms \n", best->mThreads, ttaToStr(best->mTta), 
+           best->mP50 * 1000.0, best->mP99 * 1000.0);
+    return writeOverlay(*best);
+}
+
+bool InferenceTuner::loadFrames()
+{
+    const std::string& folder = mSettings.mTuneFrames;
+    const cv::Size imageSize(mSettings.mWidth, mSettings.mHeight);
+    const bool isMono = mSettings.mIsMono;
+    const size_t maxFrames = mSettings.mTuneIterations;
+    cv::Mat image;
+
+    mImages.clear();
+    mRightImages.clear();
+    if (!folder.empty())
+    {
+        // frames saved by DataSaver: colour images for mono, side-by-side greyscale images for stereo
+        for (const std::experimental::filesystem::directory_entry& entry : std::experimental::filesystem::directory_iterator(folder))
+        {
+            if (entry.path().extension() == ".jpg" && mImages.size() < maxFrames)
+            {
+                image = cv::imread(entry.path().string(), isMono ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
+                if (isMono && image.size() == imageSize)
+                {
+                    mImages.push_back(image);
+                }
+                else if (!isMono && image.size() == cv::Size(imageSize.width * 2, imageSize.height))
+                {
+                    mImages.push_back(image(cv::Rect(0, 0, imageSize.width, imageSize.height)).clone());
+                    mRightImages.push_back(image(cv::Rect(imageSize.width, 0, imageSize.width, imageSize.height)).clone());
+                }
+            }
+        }
+        printf("Loaded %zu frames from %s \n", mImages.size(), folder.c_str());
+    }
+    else
+    {
+        for (int i = 0; i < SYNTHETIC_FRAMES; ++i)
+        {
+            mImages.push_back(cv::Mat(imageSize, isMono ? CV_8UC3 : CV_8UC1));
+            cv::randu(mImages.back(), 0, 255);
+            if (!isMono)
+            {
+                mRightImages.push_back(cv::Mat(imageSize, CV_8UC1));
+                cv::randu(mRightImages.back(), 0, 255);
+            }
+        }
+        printf("Generated %zu synthetic frames \n", mImages.size());
+    }
+    return !mImages.empty();
+}
+
+bool InferenceTuner::writeOverlay(const Result& best) const
+{
+    const std::string& path = mSettings.mOverlay;
+    std::ofstream file(path);
+    bool retVal = file.is_open();
+    if (retVal)
+    {
+        time_t now = time(nullptr);
+        char date[32] = {0};
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+        file << "### Generated by --tune on " << date << " for model " << mSettings.mModel << " ###\n";
+        for (const Result& result : mResults)
+        {
+            file << "# threads=" << result.mThreads << ", tta=" << ttaToStr(result.mTta) 
+                 << ": p50=" << result.mP50 * 1000.0 << " ms, p99=" << result.mP99 * 1000.0 << " ms\n";
+        }
+        file << "# selected: p50=" << best.mP50 * 1000.0 << " ms, p99=" << best.mP99 * 1000.0 << " ms\n";
+        file << "intraOpThreads=" << best.mThreads << "\n";
+        file << "tta=" << ttaToStr(best.mTta) << "\n";
+        printf("Tuned settings written to %s \n", path.c_str());
+    }
+    else
+    {
+        printf("Failed to write tuned settings to %s \n", path.c_str());
+    }
+    return retVal;
+}
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "E_TtaMode.h"
+
+struct Settings;
+
+/**
+ * Sweeps libtorch intra-op threads and TTA modes on synthetic or replayed frames, measures latency of each
+ * combination and writes the best setting into the configuration overlay. The best setting is the one with
+ * the strongest TTA whose p99 latency fits within the camera frame period, using the fastest number of threads.
+ * Inter-op threads can only be set once per process, thus they are taken from the configuration and not swept.
+ */
+class InferenceTuner
+{
+public:
+    /**
+     * Basic constructor.
+     *  @param settings the settings of the application.
+     */
+    explicit InferenceTuner(const Settings& settings);
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~InferenceTuner();
+
+    /**
+     * Runs the sweep and writes the best setting into the overlay file given by "overlay" configuration key.
+     *  @return true if the sweep was completed and the overlay was written.
+     */
+    bool run();
+
+private:
+    /**
+     * Result of a single combination.
+     */
+    struct Result
+    {
+        /** The number of intra-op threads. */
+        int mThreads;
+        /** The TTA mode. */
+        E_TtaMode mTta;
+        /** The median latency in seconds. */
+        double mP50;
+        /** The 99th percentile latency in seconds. */
+        double mP99;
+    };
+
+    /**
+     * Loads replayed frames from "tuneFrames" folder, or generates synthetic frames if the folder is not configured.
+     *  @return true if at least one frame is available.
+     */
+    bool loadFrames();
+
+    /**
+     * Writes the best result into the overlay file.
+     *  @param best the best result.
+     *  @return true if the file was written.
+     */
+    bool writeOverlay(const Result& best) const;
+
+    /** The settings of the application. */
+    const Settings& mSettings;
+    /** Left or mono frames. */
+    std::vector<cv::Mat> mImages;
+    /** Right frames, empty for a mono camera. */
+    std::vector<cv::Mat> mRightImages;
+    /** Results of all combinations. */
+    std::vector<Result> mResults;
+};
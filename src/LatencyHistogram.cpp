@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "LatencyHistogram.h"
+
+const double LatencyHistogram::BOUNDS[LatencyHistogram::BUCKETS] = {0.005, 0.01, 0.02, 0.03, 0.05, 0.075, 0.1, 0.15, 0.25, 0.5};
+
+LatencyHistogram::LatencyHistogram()
+: mSum(0)
+{
+    for (std::atomic<unsigned long>& bucket : mBuckets)
+    {
+        bucket = 0;
+    }
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+}
+
+void LatencyHistogram::observe(const double latency)
+{
+    size_t bucket = 0;
+    while (bucket < BUCKETS && latency > BOUNDS[bucket])
+    {
+        ++bucket;
+    }
+    mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(static_cast<unsigned long>(latency * 1e6), std::memory_order_relaxed);
+}
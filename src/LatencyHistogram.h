@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Lock-free histogram of latencies with fixed buckets, cheap enough to be updated on every frame and read
+ * concurrently by the metrics server.
+ */
+class LatencyHistogram
+{
+public:
+    /** The number of buckets, excluding the overflow bucket. */
+    static constexpr size_t BUCKETS = 10;
+    /** Upper bounds of buckets in seconds. */
+    static const double BOUNDS[BUCKETS];
+
+    /**
+     * Basic constructor.
+     */
+    LatencyHistogram();
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~LatencyHistogram();
+
+    /**
+     * Adds a sample. This function is thread safe.
+     *  @param latency the latency in seconds.
+     */
+    void observe(const double latency);
+
+    /**
+     *  @param bucket the index of the bucket, BUCKETS for the overflow bucket.
+     *  @return the number of samples that fell into the bucket.
+     */
+    inline unsigned long getBucket(const size_t bucket) const
+    {
+        return mBuckets[bucket].load(std::memory_order_relaxed);
+    }
+
+    /**
+     *  @return the sum of all samples in seconds.
+     */
+    inline double getSum() const
+    {
+        return static_cast<double>(mSum.load(std::memory_order_relaxed)) * 1e-6;
+    }
+
+private:
+    /** The number of samples per bucket, the last one for samples above all bounds. */
+    std::atomic<unsigned long> mBuckets[BUCKETS + 1];
+    /** The sum of all samples in microseconds. */
+    std::atomic<unsigned long> mSum;
+};
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "LatencyStats.h"
+
+LatencyStats::LatencyStats(const size_t capacity)
+: mCapacity(std::max<size_t>(capacity, 1)),
+  mNext(0),
+  mSamples(),
+  mSorted()
+{
+    mSamples.reserve(mCapacity);
+}
+
+LatencyStats::~LatencyStats()
+{
+}
+
+void LatencyStats::addSample(const double latency)
+{
+    if (mSamples.size() < mCapacity)
+    {
+        mSamples.push_back(latency);
+    }
+    else
+    {
+        mSamples[mNext] = latency;
+        mNext = (mNext + 1) % mCapacity;
+    }
+}
+
+void LatencyStats::clear()
+{
+    mSamples.clear();
+    mNext = 0;
+}
+
+double LatencyStats::getPercentile(const double percentile) const
+{
+    if (mSamples.empty())
+    {
+        return 0.0;
+    }
+    mSorted = mSamples;
+    size_t index = static_cast<size_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * mSorted.size()));
+    index = std::min(std::max<size_t>(index, 1), mSorted.size()) - 1;
+    std::nth_element(mSorted.begin(), mSorted.begin() + index, mSorted.end());
+    return mSorted[index];
+}
+
+void LatencyStats::print(const char* name) const
+{
+    printf("%s: %zu samples, p50=%.2f ms, p99=%.2f ms, max=%.2f ms \n", name, getCount(),
+           getPercentile(50.0) * 1000.0, getPercentile(99.0) * 1000.0, getPercentile(100.0) * 1000.0);
+}
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+/**
+ * Collects the most recent latency samples and calculates their percentiles. The class is not thread safe.
+ */
+class LatencyStats
+{
+public:
+    /**
+     * Initialises an empty set of samples.
+     *  @param capacity the maximum number of samples, the oldest samples are replaced when it is reached.
+     */
+    explicit LatencyStats(const size_t capacity = 1024);
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~LatencyStats();
+
+    /**
+     * Adds a new sample.
+     *  @param latency the latency in seconds.
+     */
+    void addSample(const double latency);
+
+    /**
+     * Removes all samples.
+     */
+    void clear();
+
+    /**
+     * Calculates the percentile of collected samples.
+     *  @param percentile the percentile in range [0, 100].
+     *  @return the latency in seconds at given percentile, or 0 if there are no samples.
+     */
+    double getPercentile(const double percentile) const;
+
+    /**
+     *  @return the number of collected samples.
+     */
+    inline size_t getCount() const
+    {
+        return mSamples.size();
+    }
+
+    /**
+     * Prints the number of samples, p50, p99 and the maximum latency.
+     *  @param name the name printed with the statistics.
+     */
+    void print(const char* name) const;
+
+private:
+    /** The maximum number of samples. */
+    size_t mCapacity;
+    /** The index of the next sample to replace once the capacity is reached. */
+    size_t mNext;
+    /** Collected samples in seconds. */
+    std::vector<double> mSamples;
+    /** Buffer used for sorting samples. */
+    mutable std::vector<double> mSorted;
+};
@@ -0,0 +1,379 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <ScopedLock.h>
+#include "Logger.h"
+
+namespace
+{
+/** Time in microseconds between flushes of ring buffers. */
+constexpr useconds_t FLUSH_PERIOD = 10000;
+
+/** Letters identifying log levels in formatted lines. */
+const char LEVEL_LETTERS[] = {'D', 'I', 'W', 'E'};
+
+/**
+ * Length modifiers which are replaced, because captured arguments are always promoted to the widest type.
+ *  @param c the character of the format specification.
+ *  @return true if @p c is a length modifier.
+ */
+inline bool isLengthModifier(const char c)
+{
+    return c == 'h' || c == 'l' || c == 'L' || c == 'q' || c == 'j' || c == 'z' || c == 't';
+}
+
+/**
+ *  @return the time in nanoseconds of a monotonic clock.
+ */
+inline int64_t getNanoseconds()
+{
+    struct timespec timeStruct;
+    clock_gettime(CLOCK_MONOTONIC, &timeStruct);
+    return static_cast<int64_t>(timeStruct.tv_sec) * 1000000000LL + timeStruct.tv_nsec;
+}
+} // end of anonymouse namespace
+
+LogRateLimiter::LogRateLimiter(const double period)
+: mPeriod(static_cast<int64_t>(period * 1e9)),
+  mLast(0)
+{
+}
+
+bool LogRateLimiter::allow()
+{
+    int64_t now = getNanoseconds();
+    int64_t last = mLast.load(std::memory_order_relaxed);
+    return (now - last >= mPeriod || last == 0) && mLast.compare_exchange_strong(last, now, std::memory_order_relaxed);
+}
+
+Logger::BufferOwner::~BufferOwner()
+{
+    if (mBuffer)
+    {
+        mBuffer->mOwned.store(false, std::memory_order_release);
+    }
+}
+
+Logger& Logger::getInstance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+: GenericThread<Logger>(),
+  mLevel(LOG_INFO),
+  mSink(stdout),
+  mBuffers(),
+  mPending(),
+  mLine(),
+  mDropped(0)
+{
+    pthread_mutex_init(&mBuffersMutex, nullptr);
+}
+
+Logger::~Logger()
+{
+    stop();
+    pthread_mutex_destroy(&mBuffersMutex);
+}
+
+bool Logger::initialise(const std::string& sink, const E_LogLevel level)
+{
+    mLevel = level;
+    if (sink != "stdout")
+    {
+        FILE* file = fopen(sink.c_str(), "a");
+        if (!file)
+        {
+            printf("Failed to open log file: %s \n", sink.c_str());
+            return false;
+        }
+        mSink = file;
+    }
+    return isRunning() || startThread();
+}
+
+void Logger::stop()
+{
+    if (isRunning())
+    {
+        stopThread();
+        flush();
+    }
+    if (mSink != stdout)
+    {
+        fclose(mSink);
+        mSink = stdout;
+    }
+}
+
+E_LogLevel Logger::strToLevel(const std::string& value)
+{
+    if (value == "debug")
+    {
+        return LOG_DEBUG;
+    }
+    else if (value == "warning")
+    {
+        return LOG_WARNING;
+    }
+    else if (value == "error")
+    {
+        return LOG_ERROR;
+    }
+    return LOG_INFO;
+}
+
+void* Logger::threadBody()
+{
+    while (isRunning())
+    {
+        usleep(FLUSH_PERIOD);
+        flush();
+    }
+    return nullptr;
+}
+
+void Logger::capture(Record& record, const char* value)
+{
+    if (record.mArgumentCount < MAX_ARGUMENTS)
+    {
+        Argument& argument = record.mArguments[record.mArgumentCount++];
+        int length = value ? static_cast<int>(strnlen(value, STRINGS_SIZE)) : 0;
+        length = std::min(length, STRINGS_SIZE - record.mStringsUsed - 1);
+        argument.mType = ARG_STRING;
+        argument.mOffset = record.mStringsUsed;
+        if (length > 0)
+        {
+            memcpy(record.mStrings + record.mStringsUsed, value, length);
+        }
+        record.mStringsUsed += std::max(length, 0);
+        record.mStrings[record.mStringsUsed++] = '\0';
+    }
+}
+
+void Logger::capture(Record& record, char* value)
+{
+    capture(record, static_cast<const char*>(value));
+}
+
+void Logger::capture(Record& record, const std::string& value)
+{
+    capture(record, value.c_str());
+}
+
+void Logger::push(const Record& record)
+{
+    RingBuffer* buffer = isRunning() ? getThreadBuffer() : nullptr;
+    if (buffer)
+    {
+        size_t head = buffer->mHead.load(std::memory_order_relaxed);
+        if (head - buffer->mTail.load(std::memory_order_acquire) < RING_SIZE)
+        {
+            buffer->mRecords[head % RING_SIZE] = record;
+            buffer->mHead.store(head + 1, std::memory_order_release);
+        }
+        else
+        {
+            ++mDropped;
+        }
+    }
+    else
+    {
+        std::string line;
+        format(record, line);
+        fputs(line.c_str(), mSink);
+    }
+}
+
+Logger::RingBuffer* Logger::getThreadBuffer()
+{
+    static thread_local BufferOwner owner;
+    if (!owner.mBuffer)
+    {
+        ScopedLock lock(mBuffersMutex);
+        // reuse a buffer of a thread that has exited once all its records are written
+        for (std::unique_ptr<RingBuffer>& buffer : mBuffers)
+        {
+            if (!buffer->mOwned.load(std::memory_order_acquire) && 
+                buffer->mHead.load(std::memory_order_acquire) == buffer->mTail.load(std::memory_order_acquire))
+            {
+                owner.mBuffer = buffer.get();
+                break;
+            }
+        }
+        if (!owner.mBuffer)
+        {
+            mBuffers.push_back(std::make_unique<RingBuffer>());
+            owner.mBuffer = mBuffers.back().get();
+        }
+        owner.mBuffer->mOwned.store(true, std::memory_order_release);
+    }
+    return owner.mBuffer;
+}
+
+void Logger::format(const Record& record, std::string& line) const
+{
+    char buffer[512];
+    char specification[32];
+    struct tm localTime;
+    int argument = 0;
+    int length;
+    const char* start;
+    const char* format = record.mFormat;
+
+    localtime_r(&record.mTime.tv_sec, &localTime);
+    length = static_cast<int>(strftime(buffer, sizeof(buffer), "%H:%M:%S", &localTime));
+    snprintf(buffer + length, sizeof(buffer) - length, ".%03ld %c ", record.mTime.tv_nsec / 1000000L, LEVEL_LETTERS[record.mLevel]);
+    line = buffer;
+
+    while (*format)
+    {
+        if (*format != '%')
+        {
+            line += *format++;
+            continue;
+        }
+        if (*(format + 1) == '%')
+        {
+            line += '%';
+            format += 2;
+            continue;
+        }
+
+        // copy flags, width and precision, and replace length modifiers according to the captured type
+        start = format++;
+        while (*format && (strchr("-+ #0.", *format) || isdigit(*format)))
+        {
+            ++format;
+        }
+        length = static_cast<int>(format - start);
+        while (*format && isLengthModifier(*format))
+        {
+            ++format;
+        }
+        if (!*format || length + 4 > static_cast<int>(sizeof(specification)) || argument >= record.mArgumentCount)
+        {
+            line += "<?>";
+            if (*format)
+            {
+                ++format;
+            }
+            continue;
+        }
+
+        memcpy(specification, start, length);
+        const Argument& value = record.mArguments[argument++];
+        const char conversion = *format++;
+        if (strchr("diouxX", conversion))
+        {
+            memcpy(specification + length, "ll", 2);
+            length += 2;
+        }
+        specification[length] = conversion;
+        specification[length + 1] = '\0';
+
+        // arguments are converted to the type expected by the conversion, so that mismatches do not cause undefined behaviour
+        if (strchr("diouxXc", conversion))
+        {
+            long long integer = (value.mType == ARG_SIGNED || value.mType == ARG_UNSIGNED) ? value.mSigned : 
+                                (value.mType == ARG_DOUBLE) ? static_cast<long long>(value.mDouble) : 0;
+            if (conversion == 'c')
+            {
+                snprintf(buffer, sizeof(buffer), specification, static_cast<int>(integer));
+            }
+            else
+            {
+                snprintf(buffer, sizeof(buffer), specification, integer);
+            }
+        }
+        else if (strchr("eEfFgGaA", conversion))
+        {
+            snprintf(buffer, sizeof(buffer), specification, (value.mType == ARG_DOUBLE) ? value.mDouble :
+                     (value.mType == ARG_SIGNED) ? static_cast<double>(value.mSigned) : 
+                     (value.mType == ARG_UNSIGNED) ? static_cast<double>(value.mUnsigned) : 0.0);
+        }
+        else if (conversion == 's' && value.mType == ARG_STRING)
+        {
+            snprintf(buffer, sizeof(buffer), specification, record.mStrings + value.mOffset);
+        }
+        else if (conversion == 'p' && value.mType == ARG_POINTER)
+        {
+            snprintf(buffer, sizeof(buffer), specification, value.mPointer);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), "<?>");
+        }
+        line += buffer;
+    }
+
+    // messages are single lines, which are terminated here if needed
+    while (!line.empty() && (line.back() == '\n' || line.back() == ' '))
+    {
+        line.pop_back();
+    }
+    line += '\n';
+}
+
+void Logger::flush()
+{
+    size_t head;
+    size_t tail;
+    unsigned long dropped = mDropped.exchange(0);
+
+    {
+        ScopedLock lock(mBuffersMutex);
+        for (std::unique_ptr<RingBuffer>& buffer : mBuffers)
+        {
+            head = buffer->mHead.load(std::memory_order_acquire);
+            for (tail = buffer->mTail.load(std::memory_order_relaxed); tail != head; ++tail)
+            {
+                mPending.push_back(buffer->mRecords[tail % RING_SIZE]);
+            }
+            buffer->mTail.store(tail, std::memory_order_release);
+        }
+    }
+
+    if (!mPending.empty() || dropped > 0)
+    {
+        std::stable_sort(mPending.begin(), mPending.end(), [](const Record& a, const Record& b) 
+        { 
+            return a.mTime.tv_sec < b.mTime.tv_sec || (a.mTime.tv_sec == b.mTime.tv_sec && a.mTime.tv_nsec < b.mTime.tv_nsec);
+        });
+        for (const Record& record : mPending)
+        {
+            format(record, mLine);
+            fputs(mLine.c_str(), mSink);
+        }
+        if (dropped > 0)
+        {
+            fprintf(mSink, "Logger dropped %lu messages \n", dropped);
+        }
+        fflush(mSink);
+        mPending.clear();
+    }
+}
@@ -0,0 +1,337 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <GenericThread.h>
+
+/**
+ * An enum representing log levels.
+ */
+enum E_LogLevel
+{
+    LOG_DEBUG   = 0, // per-frame details
+    LOG_INFO    = 1, // state changes and progress
+    LOG_WARNING = 2, // recoverable problems
+    LOG_ERROR   = 3  // failures
+};
+
+/**
+ * Limits how often a message is logged, intended for messages issued for every frame.
+ */
+class LogRateLimiter
+{
+public:
+    /**
+     * Basic constructor.
+     *  @param period the minimum time in seconds between two allowed messages.
+     */
+    explicit LogRateLimiter(const double period);
+
+    /**
+     * Checks whether a message can be logged now. This function is thread safe and lock free.
+     *  @return true if the period has elapsed since the last allowed message.
+     */
+    bool allow();
+
+private:
+    /** The minimum time in nanoseconds between two allowed messages. */
+    int64_t mPeriod;
+    /** The time in nanoseconds of the last allowed message. */
+    std::atomic<int64_t> mLast;
+};
+
+/**
+ * Asynchronous logger. Each thread writes log records into its own lock-free ring buffer, capturing the format
+ * string and copies of arguments. Records are formatted and written to the sink (stdout or a file) by a background
+ * thread, so logging never waits for the console or the disk. When a ring buffer is full, records are dropped and counted.
+ * Format strings must be string literals as they are formatted later. Until the logger is initialised, messages are
+ * formatted and printed immediately.
+ */
+class Logger : protected GenericThread<Logger>
+{
+    friend class GenericThread<Logger>;
+
+public:
+    /**
+     *  @return the logger instance.
+     */
+    static Logger& getInstance();
+
+    /**
+     * Stops the thread and closes the sink.
+     */
+    virtual ~Logger();
+
+    /**
+     * Opens the sink and starts the background thread.
+     *  @param sink "stdout" or a path to a file where messages are appended.
+     *  @param level the minimum level of logged messages.
+     *  @return true if the sink was opened and the thread started.
+     */
+    bool initialise(const std::string& sink, const E_LogLevel level);
+
+    /**
+     * Writes all pending messages and stops the background thread. Subsequent messages are printed immediately.
+     */
+    void stop();
+
+    /**
+     * Logs a printf-style message. Supported arguments are integers, floating point numbers, pointers, C strings and std::string.
+     *  @param level the level of the message.
+     *  @param format the format string, must be a string literal.
+     *  @param args the arguments of the message.
+     */
+    template <typename... Args>
+    static void log(const E_LogLevel level, const char* format, const Args&... args)
+    {
+        Logger& logger = getInstance();
+        if (level >= logger.mLevel)
+        {
+            Record record;
+            record.mLevel = level;
+            record.mFormat = format;
+            record.mArgumentCount = 0;
+            record.mStringsUsed = 0;
+            clock_gettime(CLOCK_REALTIME, &record.mTime);
+            (logger.capture(record, args), ...);
+            logger.push(record);
+        }
+    }
+
+    /**
+     *  @return the number of messages dropped because ring buffers were full.
+     */
+    inline unsigned long getDroppedMessages() const
+    {
+        return mDropped;
+    }
+
+    /**
+     * Converts configuration value into log level.
+     *  @param value the configuration value: debug, info, warning or error.
+     *  @return the log level, info for unknown values.
+     */
+    static E_LogLevel strToLevel(const std::string& value);
+
+protected:
+    /**
+     * The main body of the thread that formats and writes messages.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /** The maximum number of arguments of a single message. */
+    static constexpr int MAX_ARGUMENTS = 8;
+    /** The size of the buffer for copies of string arguments. */
+    static constexpr int STRINGS_SIZE = 192;
+    /** The number of records in each ring buffer. */
+    static constexpr size_t RING_SIZE = 256;
+
+    /**
+     * Type of captured argument.
+     */
+    enum E_ArgumentType
+    {
+        ARG_SIGNED,
+        ARG_UNSIGNED,
+        ARG_DOUBLE,
+        ARG_POINTER,
+        ARG_STRING
+    };
+
+    /**
+     * A captured argument.
+     */
+    struct Argument
+    {
+        /** The type of the argument. */
+        E_ArgumentType mType;
+        union
+        {
+            /** Signed integer value. */
+            long long mSigned;
+            /** Unsigned integer value. */
+            unsigned long long mUnsigned;
+            /** Floating point value. */
+            double mDouble;
+            /** Pointer value. */
+            const void* mPointer;
+            /** Offset of the string in the record's string buffer. */
+            int mOffset;
+        };
+    };
+
+    /**
+     * A log message with captured arguments.
+     */
+    struct Record
+    {
+        /** The time when the message was logged. */
+        struct timespec mTime;
+        /** The level of the message. */
+        E_LogLevel mLevel;
+        /** The format string. */
+        const char* mFormat;
+        /** The number of captured arguments. */
+        int mArgumentCount;
+        /** The number of bytes used in the string buffer. */
+        int mStringsUsed;
+        /** Captured arguments. */
+        Argument mArguments[MAX_ARGUMENTS];
+        /** Copies of string arguments. */
+        char mStrings[STRINGS_SIZE];
+    };
+
+    /**
+     * Single-producer single-consumer lock-free ring buffer of records owned by a single logging thread.
+     */
+    struct RingBuffer
+    {
+        /** Records. */
+        Record mRecords[RING_SIZE];
+        /** The index of the next record to write, modified only by the producer. */
+        std::atomic<size_t> mHead{0};
+        /** The index of the next record to read, modified only by the consumer. */
+        std::atomic<size_t> mTail{0};
+        /** Flag indicating if a thread writes to this buffer. */
+        std::atomic<bool> mOwned{false};
+    };
+
+    /**
+     * Releases the ring buffer when the owning thread exits, so that it can be reused by another thread.
+     */
+    struct BufferOwner
+    {
+        /** Releases the buffer. */
+        ~BufferOwner();
+        /** The owned buffer. */
+        RingBuffer* mBuffer = nullptr;
+    };
+
+    /**
+     * Basic constructor, the logger prints messages immediately until initialised.
+     */
+    Logger();
+
+    /**
+     * Captures an integer, floating point or pointer argument.
+     *  @param record the record to store the argument in.
+     *  @param value the value of the argument.
+     */
+    template <typename T>
+    void capture(Record& record, const T& value)
+    {
+        if (record.mArgumentCount < MAX_ARGUMENTS)
+        {
+            Argument& argument = record.mArguments[record.mArgumentCount++];
+            if constexpr (std::is_floating_point<T>::value)
+            {
+                argument.mType = ARG_DOUBLE;
+                argument.mDouble = static_cast<double>(value);
+            }
+            else if constexpr (std::is_pointer<T>::value)
+            {
+                argument.mType = ARG_POINTER;
+                argument.mPointer = static_cast<const void*>(value);
+            }
+            else if constexpr (std::is_signed<T>::value)
+            {
+                argument.mType = ARG_SIGNED;
+                argument.mSigned = static_cast<long long>(value);
+            }
+            else
+            {
+                argument.mType = ARG_UNSIGNED;
+                argument.mUnsigned = static_cast<unsigned long long>(value);
+            }
+        }
+    }
+
+    /**
+     * Captures a copy of a C string argument.
+     *  @param record the record to store the argument in.
+     *  @param value the string.
+     */
+    void capture(Record& record, const char* value);
+
+    /**
+     * Captures a copy of a C string argument.
+     *  @param record the record to store the argument in.
+     *  @param value the string.
+     */
+    void capture(Record& record, char* value);
+
+    /**
+     * Captures a copy of a string argument.
+     *  @param record the record to store the argument in.
+     *  @param value the string.
+     */
+    void capture(Record& record, const std::string& value);
+
+    /**
+     * Puts the record into the ring buffer of the calling thread, or prints it immediately if the logger is not running.
+     *  @param record the record.
+     */
+    void push(const Record& record);
+
+    /**
+     *  @return the ring buffer of the calling thread, registering a new one when called for the first time.
+     */
+    RingBuffer* getThreadBuffer();
+
+    /**
+     * Formats the record into a line of text.
+     *  @param record the record.
+     *  @param line the formatted line.
+     */
+    void format(const Record& record, std::string& line) const;
+
+    /**
+     * Moves all pending records from ring buffers, sorts them by time, and writes them to the sink.
+     */
+    void flush();
+
+    /** The minimum level of logged messages. */
+    std::atomic<int> mLevel;
+    /** The sink, stdout or an opened file. */
+    FILE* mSink;
+    /** Ring buffers of logging threads. */
+    std::vector<std::unique_ptr<RingBuffer>> mBuffers;
+    /** Records collected from ring buffers by the background thread. */
+    std::vector<Record> mPending;
+    /** Buffer for formatted lines. */
+    std::string mLine;
+    /** The number of dropped messages. */
+    std::atomic<unsigned long> mDropped;
+    /** Mutex for registering ring buffers, never taken when logging from a registered thread. */
+    pthread_mutex_t mBuffersMutex;
+};
@@ -0,0 +1,265 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Logger.h"
+#include "MetricsServer.h"
+#include "Settings.h"
+
+namespace
+{
+/** Time in milliseconds after which the server checks whether it should stop. */
+constexpr int POLL_TIMEOUT = 100;
+/** Time in milliseconds within which a client has to send the request. */
+constexpr int REQUEST_TIMEOUT = 1000;
+
+/**
+ * Appends a sample to the exposition.
+ *  @param output the exposition.
+ *  @param name the name of the sample.
+ *  @param labels labels of the sample, empty for none.
+ *  @param value the value.
+ */
+void appendSample(std::string& output, const std::string& name, const std::string& labels, const double value)
+{
+    char number[32];
+    snprintf(number, sizeof(number), "%.9g", value);
+    output += name;
+    if (!labels.empty())
+    {
+        output += "{" + labels + "}";
+    }
+    output += " ";
+    output += number;
+    output += "\n";
+}
+
+/**
+ * Writes all data to a socket.
+ *  @param socket the socket.
+ *  @param data the data.
+ *  @param size the size of the data.
+ */
+void writeAll(const int socket, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = send(socket, data, size, MSG_NOSIGNAL);
+        if (written <= 0)
+        {
+            break;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+} // end of anonymouse namespace
+
+MetricsServer::MetricsServer(const Settings& settings)
+: GenericListener<CameraData>(),
+  GenericThread<MetricsServer>(),
+  mAddress(settings.mMetricsAddress),
+  mPort(settings.mMetricsPort),
+  mSocket(-1),
+  mMetrics(),
+  mFrames(0)
+{
+    addCounter("jetracer_camera_frames_total", "Camera frames received.", [this]() { return static_cast<double>(mFrames.load()); });
+}
+
+MetricsServer::~MetricsServer()
+{
+    stopThread();
+}
+
+void MetricsServer::addCounter(const std::string& name, const std::string& help, const std::function<double()>& value, const std::string& labels)
+{
+    mMetrics.push_back({name, help, "counter", labels, value, nullptr});
+}
+
+void MetricsServer::addGauge(const std::string& name, const std::string& help, const std::function<double()>& value, const std::string& labels)
+{
+    mMetrics.push_back({name, help, "gauge", labels, value, nullptr});
+}
+
+void MetricsServer::addHistogram(const std::string& name, const std::string& help, const LatencyHistogram& histogram)
+{
+    mMetrics.push_back({name, help, "histogram", "", nullptr, &histogram});
+}
+
+void MetricsServer::update(const CameraData&)
+{
+    mFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string MetricsServer::render() const
+{
+    std::string output;
+    const std::string* previousName = nullptr;
+    char bound[32];
+
+    for (const Metric& metric : mMetrics)
+    {
+        // series of the same metric share a single description
+        if (!previousName || *previousName != metric.mName)
+        {
+            output += "# HELP " + metric.mName + " " + metric.mHelp + "\n";
+            output += "# TYPE " + metric.mName + " " + metric.mType + "\n";
+            previousName = &metric.mName;
+        }
+        if (metric.mHistogram)
+        {
+            unsigned long count = 0;
+            for (size_t i = 0; i <= LatencyHistogram::BUCKETS; ++i)
+            {
+                count += metric.mHistogram->getBucket(i);
+                if (i < LatencyHistogram::BUCKETS)
+                {
+                    snprintf(bound, sizeof(bound), "le=\"%g\"", LatencyHistogram::BOUNDS[i]);
+                }
+                else
+                {
+                    snprintf(bound, sizeof(bound), "le=\"+Inf\"");
+                }
+                appendSample(output, metric.mName + "_bucket", bound, static_cast<double>(count));
+            }
+            appendSample(output, metric.mName + "_sum", "", metric.mHistogram->getSum());
+            appendSample(output, metric.mName + "_count", "", static_cast<double>(count));
+        }
+        else
+        {
+            appendSample(output, metric.mName, metric.mLabels, metric.mValue());
+        }
+    }
+    return output;
+}
+
+bool MetricsServer::startThread()
+{
+    struct sockaddr_in address = {};
+    int reuse = 1;
+
+    if (mSocket < 0)
+    {
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(mPort));
+        if (1 != inet_pton(AF_INET, mAddress.c_str(), &address.sin_addr))
+        {
+            Logger::log(LOG_ERROR, "Invalid metrics address: %s", mAddress);
+            return false;
+        }
+        mSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (mSocket < 0)
+        {
+            Logger::log(LOG_ERROR, "Failed to open metrics socket: %s", strerror(errno));
+            return false;
+        }
+        setsockopt(mSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (0 != bind(mSocket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) || 0 != listen(mSocket, 4))
+        {
+            Logger::log(LOG_ERROR, "Failed to bind metrics server to %s:%d: %s", mAddress, mPort, strerror(errno));
+            close(mSocket);
+            mSocket = -1;
+            return false;
+        }
+    }
+    Logger::log(LOG_INFO, "Serving metrics at http://%s:%d/metrics", mAddress, getPort());
+    return GenericThread<MetricsServer>::startThread();
+}
+
+void MetricsServer::stopThread()
+{
+    // the thread polls the socket with a timeout, so it does not need to be cancelled
+    GenericThread<MetricsServer>::stopThread(false);
+    if (mSocket >= 0)
+    {
+        close(mSocket);
+        mSocket = -1;
+    }
+}
+
+int MetricsServer::getPort() const
+{
+    struct sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    if (mSocket >= 0 && 0 == getsockname(mSocket, reinterpret_cast<struct sockaddr*>(&address), &length))
+    {
+        return ntohs(address.sin_port);
+    }
+    return mPort;
+}
+
+void* MetricsServer::threadBody()
+{
+    struct pollfd listening = {mSocket, POLLIN, 0};
+    int client;
+
+    while (isRunning())
+    {
+        if (poll(&listening, 1, POLL_TIMEOUT) > 0 && (listening.revents & POLLIN))
+        {
+            client = accept(mSocket, nullptr, nullptr);
+            if (client >= 0)
+            {
+                serve(client);
+                close(client);
+            }
+        }
+    }
+    return nullptr;
+}
+
+void MetricsServer::serve(const int client) const
+{
+    struct pollfd request = {client, POLLIN, 0};
+    char buffer[1024];
+    ssize_t received;
+    std::string body;
+    std::string status;
+
+    // only the request line matters, headers are not needed to serve metrics
+    if (poll(&request, 1, REQUEST_TIMEOUT) <= 0 || (received = recv(client, buffer, sizeof(buffer) - 1, 0)) <= 0)
+    {
+        return;
+    }
+    buffer[received] = '\0';
+    if (0 == strncmp(buffer, "GET /metrics ", 13) || 0 == strncmp(buffer, "GET /metrics?", 13))
+    {
+        status = "200 OK";
+        body = render();
+    }
+    else
+    {
+        status = "404 Not Found";
+        body = "Not found\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    writeAll(client, response.data(), response.size());
+}
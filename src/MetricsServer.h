@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include <CameraData.h>
+#include <GenericListener.h>
+#include <GenericThread.h>
+#include "LatencyHistogram.h"
+
+struct Settings;
+
+/**
+ * Minimal HTTP server that serves metrics in the Prometheus text exposition format at /metrics.
+ * Metrics are read through functions that load atomic counters, so serving a scrape never locks the control path.
+ * It also counts camera frames, so that the frame rate can be derived from the counter.
+ * All metrics must be added before the thread is started.
+ */
+class MetricsServer : public GenericListener<CameraData>,
+                      public GenericThread<MetricsServer>
+{
+public:
+    /**
+     * Reads the address and port of the server.
+     *  @param settings the settings of the application.
+     */
+    explicit MetricsServer(const Settings& settings);
+
+    /**
+     * Stops the thread and closes the socket.
+     */
+    virtual ~MetricsServer();
+
+    /**
+     * Adds a counter, i.e., a value that only grows.
+     *  @param name the name of the metric.
+     *  @param help the description of the metric.
+     *  @param value the function that reads the current value.
+     *  @param labels labels of this series, e.g. edge="camera>dataSaver", empty for none.
+     */
+    void addCounter(const std::string& name, const std::string& help, const std::function<double()>& value, const std::string& labels = "");
+
+    /**
+     * Adds a gauge, i.e., a value that can go up and down.
+     *  @param name the name of the metric.
+     *  @param help the description of the metric.
+     *  @param value the function that reads the current value.
+     *  @param labels labels of this series, empty for none.
+     */
+    void addGauge(const std::string& name, const std::string& help, const std::function<double()>& value, const std::string& labels = "");
+
+    /**
+     * Adds a histogram of latencies.
+     *  @param name the name of the metric.
+     *  @param help the description of the metric.
+     *  @param histogram the histogram, which must outlive the server.
+     */
+    void addHistogram(const std::string& name, const std::string& help, const LatencyHistogram& histogram);
+
+    /**
+     * Counts camera frames.
+     *  @param cameraData the latest camera data.
+     */
+    void update(const CameraData& cameraData) override;
+
+    /**
+     *  @return all metrics in the Prometheus text exposition format.
+     */
+    std::string render() const;
+
+    /**
+     * Overrides/shadows the baseclass function to open the listening socket.
+     *  @return true if the socket was bound and the thread started.
+     */
+    bool startThread();
+
+    /**
+     * Overrides/shadows the baseclass function to close the socket.
+     */
+    void stopThread();
+
+    /**
+     *  @return the port the server listens on, useful when configured with port 0.
+     */
+    int getPort() const;
+
+    /**
+     * The main body of the server thread.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /**
+     * A single series of a metric.
+     */
+    struct Metric
+    {
+        /** The name of the metric. */
+        std::string mName;
+        /** The description of the metric. */
+        std::string mHelp;
+        /** The type of the metric: counter, gauge or histogram. */
+        std::string mType;
+        /** Labels of the series. */
+        std::string mLabels;
+        /** Reads the value of counters and gauges. */
+        std::function<double()> mValue;
+        /** The histogram, nullptr for counters and gauges. */
+        const LatencyHistogram* mHistogram;
+    };
+
+    /**
+     * Reads the request and writes the response.
+     *  @param client the socket of the client.
+     */
+    void serve(const int client) const;
+
+    /** The address to bind to. */
+    std::string mAddress;
+    /** The port to bind to. */
+    int mPort;
+    /** The listening socket. */
+    int mSocket;
+    /** Metrics in the order of adding. */
+    std::vector<Metric> mMetrics;
+    /** The number of camera frames. */
+    std::atomic<unsigned long> mFrames;
+};
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include "OpenCvBackend.h"
+
+OpenCvBackend::OpenCvBackend()
+: IInferenceBackend(),
+  mNet(),
+  mOutput()
+{
+}
+
+OpenCvBackend::~OpenCvBackend()
+{
+}
+
+bool OpenCvBackend::initialise(const std::string& pathToModel, const cv::Mat& /*input*/)
+{
+    try
+    {
+        mNet = cv::dnn::readNetFromONNX(pathToModel);
+        mNet.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        mNet.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    }
+    catch (const cv::Exception& error)
+    {
+        printf("Failed to load ONNX model %s: %s \n", pathToModel.c_str(), error.what());
+        return false;
+    }
+    return !mNet.empty();
+}
+
+void OpenCvBackend::process(const cv::Mat& blob, std::vector<cv::Vec2f>& outputs)
+{
+    mNet.setInput(blob);
+    mOutput = mNet.forward().reshape(1, blob.size[0]);
+
+    outputs.resize(static_cast<size_t>(mOutput.rows));
+    for (int i = 0; i < mOutput.rows; ++i)
+    {
+        outputs[i] = cv::Vec2f(mOutput.at<float>(i, 0), mOutput.at<float>(i, 1));
+    }
+}
@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <opencv2/dnn.hpp>
+#include "IInferenceBackend.h"
+
+/**
+ * Inference backend that runs an ONNX model with OpenCV DNN module on the CPU.
+ */
+class OpenCvBackend : public IInferenceBackend
+{
+public:
+    /**
+     * Basic constructor.
+     */
+    OpenCvBackend();
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~OpenCvBackend();
+
+    bool initialise(const std::string& pathToModel, const cv::Mat& input) override;
+
+    void process(const cv::Mat& blob, std::vector<cv::Vec2f>& outputs) override;
+
+    inline const char* getName() const override
+    {
+        return "opencv";
+    }
+
+private:
+    /** The network loaded from ONNX file. */
+    cv::dnn::Net mNet;
+    /** Network output. */
+    cv::Mat mOutput;
+};
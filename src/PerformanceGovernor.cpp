@@ -0,0 +1,226 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cerrno>
+#include <experimental/filesystem>
+#include <fstream>
+#include <time.h>
+#include "Logger.h"
+#include "PerformanceGovernor.h"
+#include "Settings.h"
+
+namespace
+{
+/**
+ * Reads numbers from a sysfs file.
+ *  @param path the path to the file.
+ *  @param values the numbers read from the file.
+ *  @return true if at least one number was read.
+ */
+bool readNumbers(const std::string& path, std::vector<double>& values)
+{
+    std::ifstream file(path);
+    double value;
+    values.clear();
+    while (file >> value)
+    {
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+/**
+ * Computes the ratio of the allowed maximum frequency to the maximum frequency of the power mode. The power mode (e.g.
+ * nvpmodel) lowers the allowed frequency below the supported one, so its maximum is the highest allowed frequency seen.
+ *  @param allowedPath the path to the file with the currently allowed maximum frequency.
+ *  @param maximum the maximum frequency of the power mode, raised if the allowed frequency exceeds it.
+ *  @return the ratio, or 1 if the file could not be read.
+ */
+double getFrequencyRatio(const std::string& allowedPath, double& maximum)
+{
+    std::vector<double> allowed;
+    if (readNumbers(allowedPath, allowed) && allowed[0] > 0.0)
+    {
+        maximum = std::max(maximum, allowed[0]);
+        return allowed[0] / maximum;
+    }
+    return 1.0;
+}
+} // end of anonymouse namespace
+
+PerformanceGovernor::PerformanceGovernor(const Settings& settings)
+: GenericThread<PerformanceGovernor>(),
+  mRoot(settings.mGovernorSysfsRoot),
+  mGpuPath(settings.mGovernorGpuPath),
+  mThermalZones(),
+  mThresholds(settings.mGovernorTemperatures),
+  mHysteresis(settings.mGovernorHysteresis),
+  mMinFrequencyRatio(settings.mGovernorMinFrequency),
+  mPeriod(settings.mGovernorPeriod),
+  mCpuMaxFrequency(0.0),
+  mGpuMaxFrequency(0.0),
+  mThrottleLevel(-1),
+  mLevel(0),
+  mTemperature(0.0),
+  mCallback()
+{
+    std::sort(mThresholds.begin(), mThresholds.end());
+}
+
+PerformanceGovernor::~PerformanceGovernor()
+{
+    stopThread(true);
+}
+
+void PerformanceGovernor::setLevelCallback(const std::function<void(const int)>& callback)
+{
+    mCallback = callback;
+}
+
+bool PerformanceGovernor::startThread()
+{
+    findThermalZones();
+    if (mThermalZones.empty())
+    {
+        Logger::log(LOG_WARNING, "No thermal zones found in %s/class/thermal", mRoot);
+        return false;
+    }
+    Logger::log(LOG_INFO, "Performance governor monitors %zu thermal zones, levels from %.1f C", mThermalZones.size(),
+                mThresholds.empty() ? 0.0 : mThresholds[0]);
+    return GenericThread<PerformanceGovernor>::startThread();
+}
+
+int PerformanceGovernor::step()
+{
+    if (mThermalZones.empty())
+    {
+        findThermalZones();
+    }
+
+    double temperature = readTemperature();
+    double frequencyRatio = readFrequencyRatio();
+    mTemperature = temperature;
+    int maxLevel = static_cast<int>(mThresholds.size());
+    int previous = mLevel;
+    int level = previous;
+
+    while (level < maxLevel && temperature >= mThresholds[level])
+    {
+        ++level;
+    }
+    while (level > 0 && temperature < mThresholds[level - 1] - mHysteresis)
+    {
+        --level;
+    }
+    // the kernel has capped the clocks, so shed load once per cap and keep it shed until the cap is lifted
+    if (frequencyRatio < mMinFrequencyRatio)
+    {
+        if (mThrottleLevel < 0)
+        {
+            mThrottleLevel = std::min(std::max(level, previous + 1), maxLevel);
+        }
+        level = std::max(level, mThrottleLevel);
+    }
+    else
+    {
+        mThrottleLevel = -1;
+    }
+
+    if (level != previous)
+    {
+        mLevel = level;
+        Logger::log(LOG_WARNING, "Performance level %d -> %d at %.1f C, frequency at %.0f%% of maximum",
+                    previous, level, temperature, 100.0 * frequencyRatio);
+        if (mCallback)
+        {
+            mCallback(level);
+        }
+    }
+    return level;
+}
+
+void* PerformanceGovernor::threadBody()
+{
+    struct timespec wakeUp;
+
+    while (isRunning())
+    {
+        step();
+        clock_gettime(CLOCK_REALTIME, &wakeUp);
+        wakeUp.tv_sec += static_cast<time_t>(mPeriod);
+        wakeUp.tv_nsec += static_cast<long>((mPeriod - static_cast<time_t>(mPeriod)) * 1e9);
+        if (wakeUp.tv_nsec >= 1000000000L)
+        {
+            ++wakeUp.tv_sec;
+            wakeUp.tv_nsec -= 1000000000L;
+        }
+        // the semaphore is only used to sleep and to wake up early when the thread is stopped
+        while (-1 == sem_timedwait(&mSemaphore, &wakeUp) && EINTR == errno)
+        {
+        }
+    }
+    return nullptr;
+}
+
+void PerformanceGovernor::findThermalZones()
+{
+    std::error_code error;
+    std::string temperaturePath;
+    mThermalZones.clear();
+    for (const std::experimental::filesystem::directory_entry& entry : 
+         std::experimental::filesystem::directory_iterator(mRoot + "/class/thermal", error))
+    {
+        if (entry.path().filename().string().rfind("thermal_zone", 0) == 0)
+        {
+            temperaturePath = entry.path().string() + "/temp";
+            if (std::experimental::filesystem::exists(temperaturePath, error))
+            {
+                mThermalZones.push_back(temperaturePath);
+            }
+        }
+    }
+    std::sort(mThermalZones.begin(), mThermalZones.end());
+}
+
+double PerformanceGovernor::readTemperature() const
+{
+    std::vector<double> values;
+    double temperature = 0.0;
+    for (const std::string& zone : mThermalZones)
+    {
+        // temperatures are reported in millidegrees Celsius
+        if (readNumbers(zone, values))
+        {
+            temperature = std::max(temperature, values[0] / 1000.0);
+        }
+    }
+    return temperature;
+}
+
+double PerformanceGovernor::readFrequencyRatio()
+{
+    const std::string cpuPath = mRoot + "/devices/system/cpu/cpu0/cpufreq/";
+    const std::string gpuPath = mRoot + "/" + mGpuPath + "/";
+    return std::min(getFrequencyRatio(cpuPath + "scaling_max_freq", mCpuMaxFrequency),
+                    getFrequencyRatio(gpuPath + "max_freq", mGpuMaxFrequency));
+}
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include <GenericThread.h>
+
+struct Settings;
+
+/**
+ * Periodically reads thermal zones and CPU/GPU frequency limits from sysfs and steps the pipeline through performance
+ * levels before the board throttles. Level 0 is full performance, each temperature threshold that is exceeded adds one level.
+ * A level is left only once the temperature drops below its threshold by the hysteresis. When the kernel caps the frequency
+ * below the maximum of the power mode, which is the highest allowed frequency seen since start, the level is raised by one
+ * and kept until the cap is lifted. The meaning of levels is up to the callback.
+ * The sysfs root is configurable so that the governor can be tested with a fake directory.
+ */
+class PerformanceGovernor : public GenericThread<PerformanceGovernor>
+{
+public:
+    /**
+     * Initialises parameters of the governor.
+     *  @param settings the settings of the application.
+     */
+    explicit PerformanceGovernor(const Settings& settings);
+
+    /**
+     * Stops the thread.
+     */
+    virtual ~PerformanceGovernor();
+
+    /**
+     * Sets the function called from the governor thread whenever the performance level changes.
+     *  @param callback the function that applies a performance level.
+     */
+    void setLevelCallback(const std::function<void(const int)>& callback);
+
+    /**
+     * Overrides/shadows the baseclass function to find thermal zones.
+     *  @return true if any thermal zone was found and the thread started.
+     */
+    bool startThread();
+
+    /**
+     * Reads sensors, updates the performance level and calls the callback if it has changed.
+     *  @return the current performance level.
+     */
+    int step();
+
+    /**
+     *  @return the current performance level.
+     */
+    inline int getLevel() const
+    {
+        return mLevel;
+    }
+
+    /**
+     *  @return the number of performance levels above full performance.
+     */
+    inline int getLevelCount() const
+    {
+        return static_cast<int>(mThresholds.size());
+    }
+
+    /**
+     *  @return the highest temperature of all thermal zones in degrees Celsius at the last reading.
+     */
+    inline double getTemperature() const
+    {
+        return mTemperature;
+    }
+
+    /**
+     * The main body of the governor thread.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /**
+     * Finds thermal zones under the sysfs root.
+     */
+    void findThermalZones();
+
+    /**
+     *  @return the highest temperature of all thermal zones in degrees Celsius.
+     */
+    double readTemperature() const;
+
+    /**
+     * Reads allowed frequencies of the CPU and GPU and raises the maximum frequencies of the power mode if they are exceeded.
+     *  @return the lowest ratio of the allowed to the maximum frequency of the power mode of the CPU and GPU, 1 if unknown.
+     */
+    double readFrequencyRatio();
+
+    /** The root of sysfs. */
+    std::string mRoot;
+    /** The path to the GPU devfreq directory relative to the root. */
+    std::string mGpuPath;
+    /** Paths to temperature files of thermal zones. */
+    std::vector<std::string> mThermalZones;
+    /** Temperatures in degrees Celsius from which consecutive performance levels are entered. */
+    std::vector<double> mThresholds;
+    /** The drop of temperature below a threshold required to leave a level. */
+    double mHysteresis;
+    /** The frequency ratio below which the board is considered throttled. */
+    double mMinFrequencyRatio;
+    /** The time in seconds between readings. */
+    double mPeriod;
+    /** The highest allowed CPU frequency seen since start, i.e., the maximum of the current power mode, 0 if unknown. */
+    double mCpuMaxFrequency;
+    /** The highest allowed GPU frequency seen since start, i.e., the maximum of the current power mode, 0 if unknown. */
+    double mGpuMaxFrequency;
+    /** The level entered when the frequency was capped, -1 if the frequency is not capped. */
+    int mThrottleLevel;
+    /** The current performance level. */
+    std::atomic<int> mLevel;
+    /** The temperature in degrees Celsius at the last reading. */
+    std::atomic<double> mTemperature;
+    /** The function that applies performance levels. */
+    std::function<void(const int)> mCallback;
+};
@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <ctime>
+#include "PipelineEdge.h"
+
+namespace
+{
+/** The period in seconds after which the worker checks whether it should stop. */
+constexpr double WORKER_TIMEOUT = 0.1;
+} // end of anonymouse namespace
+
+PipelineEdgeBase::PipelineEdgeBase(const std::string& name, const E_EdgePolicy policy, const size_t capacity)
+: mName(name),
+  mPolicy(policy),
+  mCapacity(capacity),
+  mDepth(0),
+  mMaxDepth(0),
+  mDelivered(0),
+  mDropped(0)
+{
+}
+
+PipelineEdgeBase::~PipelineEdgeBase()
+{
+}
+
+void PipelineEdgeBase::printStatistics() const
+{
+    unsigned long delivered = mDelivered;
+    unsigned long dropped = mDropped;
+    size_t maxDepth = mMaxDepth;
+    printf("Pipeline edge %s: delivered %lu, dropped %lu, maximum depth %zu of %zu \n", mName.c_str(), delivered, dropped, maxDepth, mCapacity);
+}
+
+PipelineWorker::PipelineWorker(const std::string& name)
+: GenericThread<PipelineWorker>(),
+  mName(name),
+  mEdges(),
+  mPool(nullptr),
+  mTaskClass(TASK_CONTROL),
+  mPending(0)
+{
+}
+
+PipelineWorker::PipelineWorker(const std::string& name, TaskPool* pool, const E_TaskClass taskClass)
+: GenericThread<PipelineWorker>(),
+  mName(name),
+  mEdges(),
+  mPool(pool),
+  mTaskClass(taskClass),
+  mPending(0)
+{
+}
+
+PipelineWorker::~PipelineWorker()
+{
+    stopThread(false);
+}
+
+void PipelineWorker::addEdge(PipelineEdgeBase* edge)
+{
+    mEdges.push_back(edge);
+}
+
+void PipelineWorker::notify()
+{
+    if (nullptr == mPool)
+    {
+        sem_post(&mSemaphore);
+    }
+    else if (0 == mPending++)
+    {
+        mPool->submit(mTaskClass, [this]()
+        {
+            // the task finishes only if nothing was queued while it was delivering, otherwise it delivers again
+            unsigned long pending;
+            do
+            {
+                pending = mPending;
+                deliverAll();
+            } while (!mPending.compare_exchange_strong(pending, 0));
+        });
+    }
+}
+
+void* PipelineWorker::threadBody()
+{
+    struct timespec wakeUp;
+
+    while (isRunning())
+    {
+        clock_gettime(CLOCK_REALTIME, &wakeUp);
+        wakeUp.tv_nsec += static_cast<long>(WORKER_TIMEOUT * 1e9);
+        if (wakeUp.tv_nsec >= 1000000000L)
+        {
+            ++wakeUp.tv_sec;
+            wakeUp.tv_nsec -= 1000000000L;
+        }
+        sem_timedwait(&mSemaphore, &wakeUp);
+        deliverAll();
+    }
+    return nullptr;
+}
+
+void PipelineWorker::deliverAll()
+{
+    bool delivered;
+    // edges take turns, so that a busy edge does not starve the others assigned to the same thread
+    do
+    {
+        delivered = false;
+        for (PipelineEdgeBase* edge : mEdges)
+        {
+            delivered = edge->deliver() || delivered;
+        }
+    } while (delivered && (nullptr != mPool || isRunning()));
+}
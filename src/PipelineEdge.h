@@ -0,0 +1,396 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <CameraData.h>
+#include <GenericListener.h>
+#include <GenericTalker.h>
+#include <GenericThread.h>
+#include <ScopedLock.h>
+#include "TaskPool.h"
+
+/**
+ * An enum representing how an edge of the pipeline graph delivers items.
+ */
+enum E_EdgePolicy
+{
+    EDGE_SYNC   = 0, // the consumer is called on the producer thread
+    EDGE_LATEST = 1, // only the newest item is kept and delivered on the worker thread
+    EDGE_QUEUE  = 2  // items are queued up to a capacity, dropping the oldest, and delivered on the worker thread
+};
+
+class PipelineWorker;
+
+/**
+ * Type independent part of an edge of the pipeline graph: activation and delivery statistics.
+ */
+class PipelineEdgeBase
+{
+public:
+    /**
+     * Initialises statistics.
+     *  @param name the name of the edge, producer>consumer.
+     *  @param policy the delivery policy.
+     *  @param capacity the maximum number of queued items, 0 for synchronous edges.
+     */
+    PipelineEdgeBase(const std::string& name, const E_EdgePolicy policy, const size_t capacity);
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~PipelineEdgeBase();
+
+    /**
+     * Registers the edge to the producer.
+     */
+    virtual void activate() = 0;
+
+    /**
+     * Unregisters the edge from the producer, drops queued items and waits for the item being delivered.
+     */
+    virtual void deactivate() = 0;
+
+    /**
+     * Delivers the oldest queued item to the consumer, called by the worker thread.
+     *  @return true if an item was delivered.
+     */
+    virtual bool deliver() = 0;
+
+    /**
+     * Prints the number of delivered and dropped items and the maximum depth of the queue.
+     */
+    void printStatistics() const;
+
+    /**
+     *  @return the name of the edge, producer>consumer.
+     */
+    inline const std::string& getName() const
+    {
+        return mName;
+    }
+
+    /**
+     *  @return the delivery policy.
+     */
+    inline E_EdgePolicy getPolicy() const
+    {
+        return mPolicy;
+    }
+
+    /**
+     *  @return the number of items waiting for delivery.
+     */
+    inline size_t getDepth() const
+    {
+        return mDepth;
+    }
+
+    /**
+     *  @return the number of delivered items.
+     */
+    inline unsigned long getDelivered() const
+    {
+        return mDelivered;
+    }
+
+    /**
+     *  @return the number of items dropped because the queue was full.
+     */
+    inline unsigned long getDropped() const
+    {
+        return mDropped;
+    }
+
+protected:
+    /** The name of the edge. */
+    std::string mName;
+    /** The delivery policy. */
+    E_EdgePolicy mPolicy;
+    /** The maximum number of queued items. */
+    size_t mCapacity;
+    /** The number of items waiting for delivery. */
+    std::atomic<size_t> mDepth;
+    /** The maximum number of items that waited for delivery. */
+    std::atomic<size_t> mMaxDepth;
+    /** The number of delivered items. */
+    std::atomic<unsigned long> mDelivered;
+    /** The number of dropped items. */
+    std::atomic<unsigned long> mDropped;
+};
+
+/**
+ * Thread that delivers queued items of all edges assigned to it, in the order of assignment. Alternatively, items are
+ * delivered by tasks of the shared task pool, of which at most one runs at a time, so that consumers are called
+ * from a single thread at a time either way.
+ */
+class PipelineWorker : public GenericThread<PipelineWorker>
+{
+public:
+    /**
+     * Basic constructor of a worker with its own thread.
+     *  @param name the name of the thread given in the pipeline configuration.
+     */
+    explicit PipelineWorker(const std::string& name);
+
+    /**
+     * Basic constructor of a worker that delivers items with tasks of the pool.
+     *  @param name the name of the worker.
+     *  @param pool the task pool.
+     *  @param taskClass the priority class of delivery tasks.
+     */
+    PipelineWorker(const std::string& name, TaskPool* pool, const E_TaskClass taskClass);
+
+    /**
+     * Stops the thread.
+     */
+    virtual ~PipelineWorker();
+
+    /**
+     * Assigns an edge to the thread. Edges must be assigned before the thread is started.
+     *  @param edge the edge.
+     */
+    void addEdge(PipelineEdgeBase* edge);
+
+    /**
+     * Wakes up the thread, or submits a delivery task unless one is already pending, to deliver new items.
+     */
+    void notify();
+
+    /**
+     *  @return the task pool that delivers items, nullptr if the worker has its own thread.
+     */
+    inline TaskPool* getPool() const
+    {
+        return mPool;
+    }
+
+    /**
+     *  @return the name of the thread.
+     */
+    inline const std::string& getName() const
+    {
+        return mName;
+    }
+
+    /**
+     * The main body of the worker thread.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /**
+     * Delivers items of all edges in turns until none are left.
+     */
+    void deliverAll();
+
+    /** The name of the thread. */
+    std::string mName;
+    /** Edges delivered by the thread. */
+    std::vector<PipelineEdgeBase*> mEdges;
+    /** The task pool that delivers items, nullptr if the worker has its own thread. */
+    TaskPool* mPool;
+    /** The priority class of delivery tasks. */
+    E_TaskClass mTaskClass;
+    /** The number of notifications since the pending delivery task started, 0 if no task is pending. */
+    std::atomic<unsigned long> mPending;
+};
+
+/**
+ * Copies an item into a queue slot, which keeps its buffers between items.
+ *  @param item the item to copy.
+ *  @param slot the queue slot.
+ */
+template <typename T>
+inline void copyItem(const T& item, T& slot)
+{
+    slot = item;
+}
+
+/**
+ * Copies camera images into a queue slot, because the camera reuses its buffers for the next frame.
+ *  @param item the camera data to copy.
+ *  @param slot the queue slot, whose buffers are reallocated only when the image size changes.
+ */
+inline void copyItem(const CameraData& item, CameraData& slot)
+{
+    slot.mImage.resize(item.mImage.size());
+    for (size_t i = 0; i < item.mImage.size(); ++i)
+    {
+        if (slot.mImage[i].rows != item.mImage[i].rows || slot.mImage[i].cols != item.mImage[i].cols || slot.mImage[i].type() != item.mImage[i].type())
+        {
+            slot.mImage[i].create(item.mImage[i].rows, item.mImage[i].cols, item.mImage[i].type());
+        }
+        cv::Mat destination = slot.mImage[i].createMatHeader();
+        item.mImage[i].createMatHeader().copyTo(destination);
+    }
+}
+
+/**
+ * An edge of the pipeline graph that passes items of type T from a producer to a consumer with the given policy.
+ * Queued items are copied into pre-allocated slots, so that the producer can reuse its buffers.
+ */
+template <typename T>
+class PipelineEdge : public PipelineEdgeBase, public GenericListener<T>
+{
+public:
+    /**
+     * Creates the edge and assigns it to the worker thread unless it is synchronous.
+     *  @param name the name of the edge, producer>consumer.
+     *  @param producer the producer of items.
+     *  @param consumer the consumer of items.
+     *  @param policy the delivery policy.
+     *  @param capacity the maximum number of queued items, ignored by synchronous and latest-only edges.
+     *  @param worker the thread that delivers items, nullptr for synchronous edges.
+     */
+    PipelineEdge(const std::string& name, GenericTalker<T>* producer, GenericListener<T>* consumer, const E_EdgePolicy policy,
+                 const size_t capacity, PipelineWorker* worker)
+    : PipelineEdgeBase(name, policy, policy == EDGE_SYNC ? 0 : (policy == EDGE_LATEST ? 1 : std::max(capacity, static_cast<size_t>(1)))),
+      GenericListener<T>(),
+      mProducer(producer),
+      mConsumer(consumer),
+      mWorker(worker),
+      mSlots(mCapacity),
+      mCurrent(),
+      mHead(0),
+      mCount(0)
+    {
+        pthread_mutex_init(&mQueueMutex, nullptr);
+        pthread_mutex_init(&mDeliveryMutex, nullptr);
+        if (mWorker)
+        {
+            mWorker->addEdge(this);
+        }
+    }
+
+    /**
+     * Unregisters the edge and destroys mutexes.
+     */
+    virtual ~PipelineEdge()
+    {
+        deactivate();
+        pthread_mutex_destroy(&mQueueMutex);
+        pthread_mutex_destroy(&mDeliveryMutex);
+    }
+
+    /**
+     * Registers the edge to the producer.
+     */
+    void activate() override
+    {
+        GenericListener<T>::registerTo(mProducer);
+    }
+
+    /**
+     * Unregisters the edge from the producer, drops queued items and waits for the item being delivered.
+     */
+    void deactivate() override
+    {
+        GenericListener<T>::unregisterFrom(mProducer);
+        {
+            ScopedLock lock(mQueueMutex);
+            mCount = 0;
+            mDepth = 0;
+        }
+        ScopedLock lock(mDeliveryMutex);
+    }
+
+    /**
+     * Passes the item to the consumer, or queues it and wakes up the worker thread.
+     *  @param item the item received from the producer.
+     */
+    void update(const T& item) override
+    {
+        if (!mWorker)
+        {
+            mConsumer->update(item);
+            ++mDelivered;
+            return;
+        }
+
+        {
+            ScopedLock lock(mQueueMutex);
+            if (mCount == mCapacity)
+            {
+                mHead = (mHead + 1) % mCapacity;
+                --mCount;
+                ++mDropped;
+            }
+            copyItem(item, mSlots[(mHead + mCount) % mCapacity]);
+            mDepth = ++mCount;
+            if (mCount > mMaxDepth)
+            {
+                mMaxDepth = mCount;
+            }
+        }
+        mWorker->notify();
+    }
+
+    /**
+     * Delivers the oldest queued item to the consumer, called by the worker thread.
+     *  @return true if an item was delivered.
+     */
+    bool deliver() override
+    {
+        ScopedLock deliveryLock(mDeliveryMutex);
+        {
+            ScopedLock lock(mQueueMutex);
+            if (0 == mCount)
+            {
+                return false;
+            }
+            // the slot takes the buffers of the previously delivered item, so nothing is allocated
+            std::swap(mSlots[mHead], mCurrent);
+            mHead = (mHead + 1) % mCapacity;
+            mDepth = --mCount;
+        }
+        mConsumer->update(mCurrent);
+        ++mDelivered;
+        return true;
+    }
+
+private:
+    /** The producer of items. */
+    GenericTalker<T>* mProducer;
+    /** The consumer of items. */
+    GenericListener<T>* mConsumer;
+    /** The thread that delivers items, nullptr for synchronous edges. */
+    PipelineWorker* mWorker;
+    /** Queue slots. */
+    std::vector<T> mSlots;
+    /** The item being delivered. */
+    T mCurrent;
+    /** The index of the oldest queued item. */
+    size_t mHead;
+    /** The number of queued items. */
+    size_t mCount;
+    /** Mutex protecting the queue. */
+    pthread_mutex_t mQueueMutex;
+    /** Mutex held while an item is delivered, so that deactivation waits for it. */
+    pthread_mutex_t mDeliveryMutex;
+};
@@ -0,0 +1,212 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <sstream>
+#include "Logger.h"
+#include "PipelineGraph.h"
+
+PipelineGraph::PipelineGraph()
+: mCameraNodes(),
+  mCommandNodes(),
+  mGraphs(),
+  mWorkers(),
+  mPool(nullptr),
+  mActive()
+{
+}
+
+PipelineGraph::~PipelineGraph()
+{
+    stop();
+}
+
+void PipelineGraph::setTaskPool(TaskPool* pool)
+{
+    mPool = pool;
+}
+
+bool PipelineGraph::addGraph(const std::string& name, const std::string& description)
+{
+    std::vector<std::unique_ptr<PipelineEdgeBase>>& graph = mGraphs[name];
+    std::stringstream edges(description);
+    std::string edge;
+    char producer[64];
+    char consumer[64];
+    char policy[64];
+    char thread[64];
+    unsigned int capacity;
+    bool retVal = true;
+
+    while (std::getline(edges, edge, ','))
+    {
+        thread[0] = '\0';
+        if (3 > sscanf(edge.c_str(), " %63[^>]>%63[^:]:%63[^:]:%63s", producer, consumer, policy, thread))
+        {
+            Logger::log(LOG_WARNING, "Invalid edge of pipeline %s: %s", name, edge);
+            retVal = false;
+            continue;
+        }
+
+        E_EdgePolicy edgePolicy;
+        capacity = 1;
+        std::string policyName(policy);
+        if (policyName == "sync")
+        {
+            edgePolicy = EDGE_SYNC;
+        }
+        else if (policyName == "latest")
+        {
+            edgePolicy = EDGE_LATEST;
+        }
+        else if (1 == sscanf(policy, "queue%u", &capacity) || policyName == "queue")
+        {
+            edgePolicy = EDGE_QUEUE;
+        }
+        else
+        {
+            Logger::log(LOG_WARNING, "Invalid policy of pipeline %s: %s", name, edge);
+            retVal = false;
+            continue;
+        }
+
+        // pooled workers are per consumer, so that a consumer is never called from two tasks at once
+        std::string threadName = ('\0' == thread[0]) ? std::string(consumer) : std::string(thread);
+        if ('@' == thread[0])
+        {
+            threadName = std::string(consumer) + thread;
+        }
+        if (!addEdge<CameraData>(graph, producer, consumer, edgePolicy, capacity, threadName) &&
+            !addEdge<DriveCommands>(graph, producer, consumer, edgePolicy, capacity, threadName))
+        {
+            Logger::log(LOG_WARNING, "Unknown producer or consumer in pipeline %s: %s", name, edge);
+            retVal = false;
+        }
+    }
+    return retVal;
+}
+
+bool PipelineGraph::activate(const std::string& name)
+{
+    std::map<std::string, std::vector<std::unique_ptr<PipelineEdgeBase>>>::iterator it = mGraphs.find(name);
+    if (it == mGraphs.end())
+    {
+        Logger::log(LOG_ERROR, "Unknown pipeline %s", name);
+        return false;
+    }
+
+    deactivate();
+    for (std::pair<const std::string, std::unique_ptr<PipelineWorker>>& worker : mWorkers)
+    {
+        if (nullptr != worker.second->getPool())
+        {
+            if (!worker.second->getPool()->isRunning() && !worker.second->getPool()->start())
+            {
+                Logger::log(LOG_ERROR, "Failed to start task pool");
+            }
+        }
+        else if (!worker.second->isRunning() && !worker.second->startThread())
+        {
+            Logger::log(LOG_ERROR, "Failed to start pipeline thread %s", worker.first);
+        }
+    }
+    for (std::unique_ptr<PipelineEdgeBase>& edge : it->second)
+    {
+        edge->activate();
+    }
+    mActive = name;
+    return true;
+}
+
+void PipelineGraph::deactivate()
+{
+    if (!mActive.empty())
+    {
+        for (std::unique_ptr<PipelineEdgeBase>& edge : mGraphs[mActive])
+        {
+            edge->deactivate();
+        }
+        mActive.clear();
+    }
+}
+
+void PipelineGraph::stop()
+{
+    deactivate();
+    for (std::pair<const std::string, std::unique_ptr<PipelineWorker>>& worker : mWorkers)
+    {
+        worker.second->stopThread(false);
+    }
+}
+
+void PipelineGraph::printStatistics() const
+{
+    for (const std::pair<const std::string, std::vector<std::unique_ptr<PipelineEdgeBase>>>& graph : mGraphs)
+    {
+        for (const std::unique_ptr<PipelineEdgeBase>& edge : graph.second)
+        {
+            if (edge->getDelivered() > 0 || edge->getDropped() > 0)
+            {
+                printf("%s: ", graph.first.c_str());
+                edge->printStatistics();
+            }
+        }
+    }
+}
+
+std::vector<const PipelineEdgeBase*> PipelineGraph::getEdges(const std::string& name) const
+{
+    std::vector<const PipelineEdgeBase*> edges;
+    std::map<std::string, std::vector<std::unique_ptr<PipelineEdgeBase>>>::const_iterator it = mGraphs.find(name);
+    if (it != mGraphs.end())
+    {
+        for (const std::unique_ptr<PipelineEdgeBase>& edge : it->second)
+        {
+            edges.push_back(edge.get());
+        }
+    }
+    return edges;
+}
+
+PipelineWorker* PipelineGraph::getWorker(const std::string& name)
+{
+    std::unique_ptr<PipelineWorker>& worker = mWorkers[name];
+    std::string::size_type separator = name.find('@');
+    E_TaskClass taskClass;
+    if (!worker)
+    {
+        if (std::string::npos == separator)
+        {
+            worker = std::make_unique<PipelineWorker>(name);
+        }
+        else if (nullptr != mPool && TaskPool::strToTaskClass(name.substr(separator + 1), taskClass))
+        {
+            worker = std::make_unique<PipelineWorker>(name, mPool, taskClass);
+        }
+        else
+        {
+            Logger::log(LOG_WARNING, "No task pool or unknown task class for %s, a dedicated thread is used", name);
+            worker = std::make_unique<PipelineWorker>(name);
+        }
+    }
+    return worker.get();
+}
@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <CameraData.h>
+#include <DriveCommands.h>
+#include "PipelineEdge.h"
+
+/**
+ * Graphs of edges between named producers and consumers of camera data and drive commands, one graph per state.
+ * Graphs are described as comma separated edges: producer>consumer:policy[:thread], where policy is sync, latest,
+ * or queue[N] (e.g. queue4), and thread names the worker that delivers items of non-synchronous edges, by default
+ * the consumer name. Edges assigned to the same thread are delivered in turns. A thread named after a priority class
+ * of the task pool (e.g. @recording) delivers items with tasks of the pool instead, one worker per consumer and class.
+ * Only one graph is active at a time.
+ */
+class PipelineGraph
+{
+public:
+    /**
+     * Basic constructor.
+     */
+    PipelineGraph();
+
+    /**
+     * Deactivates the graph and stops workers.
+     */
+    virtual ~PipelineGraph();
+
+    /**
+     * Adds a named producer.
+     *  @param name the name used in graph descriptions.
+     *  @param talker the producer.
+     */
+    template <typename T>
+    void addProducer(const std::string& name, GenericTalker<T>* talker)
+    {
+        getNodes<T>().mProducers[name] = talker;
+    }
+
+    /**
+     * Adds a named consumer.
+     *  @param name the name used in graph descriptions.
+     *  @param listener the consumer.
+     */
+    template <typename T>
+    void addConsumer(const std::string& name, GenericListener<T>* listener)
+    {
+        getNodes<T>().mConsumers[name] = listener;
+    }
+
+    /**
+     * Sets the task pool used by edges whose thread names a priority class. It must be set before graphs are added,
+     * and stopped before the graph is destroyed.
+     *  @param pool the task pool.
+     */
+    void setTaskPool(TaskPool* pool);
+
+    /**
+     * Creates a graph from its description. All producers and consumers must be added before.
+     *  @param name the name of the graph.
+     *  @param description comma separated edges: producer>consumer:policy[:thread].
+     *  @return true if all edges were valid.
+     */
+    bool addGraph(const std::string& name, const std::string& description);
+
+    /**
+     * Deactivates the current graph, starts workers of the new one and activates its edges.
+     *  @param name the name of the graph.
+     *  @return true if the graph exists.
+     */
+    bool activate(const std::string& name);
+
+    /**
+     * Deactivates the current graph.
+     */
+    void deactivate();
+
+    /**
+     * Deactivates the current graph and stops all workers.
+     */
+    void stop();
+
+    /**
+     * Prints statistics of all edges.
+     */
+    void printStatistics() const;
+
+    /**
+     *  @param name the name of the graph.
+     *  @return edges of the graph, empty if the graph does not exist.
+     */
+    std::vector<const PipelineEdgeBase*> getEdges(const std::string& name) const;
+
+    /**
+     *  @return the name of the active graph, empty if none is active.
+     */
+    inline const std::string& getActive() const
+    {
+        return mActive;
+    }
+
+private:
+    /**
+     * Named producers and consumers of one type of items.
+     */
+    template <typename T>
+    struct Nodes
+    {
+        /** Producers by name. */
+        std::map<std::string, GenericTalker<T>*> mProducers;
+        /** Consumers by name. */
+        std::map<std::string, GenericListener<T>*> mConsumers;
+    };
+
+    /**
+     *  @return named producers and consumers of items of type T.
+     */
+    template <typename T>
+    Nodes<T>& getNodes();
+
+    /**
+     * Creates an edge if both the producer and the consumer handle items of type T.
+     *  @param graph the graph to add the edge to.
+     *  @param producer the name of the producer.
+     *  @param consumer the name of the consumer.
+     *  @param policy the delivery policy.
+     *  @param capacity the maximum number of queued items.
+     *  @param thread the name of the worker thread.
+     *  @return true if the edge was created.
+     */
+    template <typename T>
+    bool addEdge(std::vector<std::unique_ptr<PipelineEdgeBase>>& graph, const std::string& producer, const std::string& consumer,
+                 const E_EdgePolicy policy, const size_t capacity, const std::string& thread)
+    {
+        Nodes<T>& nodes = getNodes<T>();
+        if (nodes.mProducers.count(producer) == 0 || nodes.mConsumers.count(consumer) == 0)
+        {
+            return false;
+        }
+        graph.push_back(std::make_unique<PipelineEdge<T>>(producer + ">" + consumer, nodes.mProducers[producer], nodes.mConsumers[consumer],
+                                                          policy, capacity, (policy == EDGE_SYNC) ? nullptr : getWorker(thread)));
+        return true;
+    }
+
+    /**
+     * Finds or creates a worker thread.
+     *  @param name the name of the thread.
+     *  @return the worker.
+     */
+    PipelineWorker* getWorker(const std::string& name);
+
+    /** Producers and consumers of camera data. */
+    Nodes<CameraData> mCameraNodes;
+    /** Producers and consumers of drive commands. */
+    Nodes<DriveCommands> mCommandNodes;
+    /** Edges of graphs by name. */
+    std::map<std::string, std::vector<std::unique_ptr<PipelineEdgeBase>>> mGraphs;
+    /** Worker threads by name. */
+    std::map<std::string, std::unique_ptr<PipelineWorker>> mWorkers;
+    /** The task pool used by pooled workers. */
+    TaskPool* mPool;
+    /** The name of the active graph. */
+    std::string mActive;
+};
+
+template <>
+inline PipelineGraph::Nodes<CameraData>& PipelineGraph::getNodes<CameraData>()
+{
+    return mCameraNodes;
+}
+
+template <>
+inline PipelineGraph::Nodes<DriveCommands>& PipelineGraph::getNodes<DriveCommands>()
+{
+    return mCommandNodes;
+}
@@ -0,0 +1,260 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <netdb.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <ScopedLock.h>
+#include <GenericTalker.h>
+#include "Logger.h"
+#include "PreviewStreamer.h"
+#include "Settings.h"
+#include "Timing.h"
+
+namespace
+{
+/** The maximum payload of a UDP datagram. */
+constexpr size_t MAX_DATAGRAM = 65507;
+
+/**
+ *  @return CPU time in seconds used by the calling thread.
+ */
+double getThreadCpuTime()
+{
+    struct timespec timeStruct;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &timeStruct);
+    return static_cast<double>(timeStruct.tv_sec) + static_cast<double>(timeStruct.tv_nsec) * 1e-9;
+}
+} // end of anonymouse namespace
+
+PreviewStreamer::PreviewStreamer(const Settings& settings)
+: GenericListener<CameraData>(),
+  GenericListener<DriveCommands>(),
+  GenericThread<PreviewStreamer>(),
+  mHost(settings.mPreviewHost),
+  mPort(settings.mPreviewPort),
+  mPeriod(1.0 / settings.mPreviewRate),
+  mScale(settings.mPreviewScale),
+  mQuality(settings.mPreviewQuality),
+  mSocket(-1),
+  mAddress(),
+  mImage(),
+  mHasImage(false),
+  mLastAccepted(0.0),
+  mPreview(),
+  mDatagram(),
+  mJpeg(),
+  mSteering(0.0f),
+  mThrottle(0.0f),
+  mSent(0),
+  mDropped(0),
+  mBytes(0),
+  mCpuTime(0),
+  mStartTime(0.0)
+{
+}
+
+PreviewStreamer::~PreviewStreamer()
+{
+    stopThread(true);
+}
+
+void PreviewStreamer::update(const CameraData& cameraData)
+{
+    // never wait for the streaming thread, the frame is simply dropped when it is busy
+    if (0 != pthread_mutex_trylock(&mMutex))
+    {
+        ++mDropped;
+        return;
+    }
+
+    double now = getMonotonicTime();
+    if (mHasImage || now - mLastAccepted < mPeriod)
+    {
+        ++mDropped;
+    }
+    else
+    {
+        if (cameraData.mImage.size() == 1)
+        {
+            cameraData.mImage[0].createMatHeader().copyTo(mImage);
+        }
+        else
+        {
+            mImage.create(cameraData.mImage[0].rows, cameraData.mImage[0].cols + cameraData.mImage[1].cols, cameraData.mImage[0].type());
+            cameraData.mImage[0].createMatHeader().copyTo(mImage(cv::Rect(0, 0, cameraData.mImage[0].cols, cameraData.mImage[0].rows)));
+            cameraData.mImage[1].createMatHeader().copyTo(mImage(cv::Rect(cameraData.mImage[0].cols, 0, cameraData.mImage[1].cols, cameraData.mImage[1].rows)));
+        }
+        mHasImage = true;
+        mLastAccepted = now;
+        sem_post(&mSemaphore);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void PreviewStreamer::update(const DriveCommands& driveCommands)
+{
+    mSteering = driveCommands.mSteering;
+    mThrottle = driveCommands.mThrottle;
+}
+
+bool PreviewStreamer::startThread()
+{
+    struct addrinfo hints = {};
+    struct addrinfo* result = nullptr;
+
+    if (mSocket < 0)
+    {
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        if (0 != getaddrinfo(mHost.c_str(), nullptr, &hints, &result) || !result)
+        {
+            Logger::log(LOG_ERROR, "Failed to resolve preview host: %s", mHost);
+            return false;
+        }
+        memcpy(&mAddress, result->ai_addr, sizeof(mAddress));
+        mAddress.sin_port = htons(static_cast<uint16_t>(mPort));
+        freeaddrinfo(result);
+
+        mSocket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (mSocket < 0)
+        {
+            Logger::log(LOG_ERROR, "Failed to open preview socket: %s", strerror(errno));
+            return false;
+        }
+    }
+    mStartTime = getMonotonicTime();
+    Logger::log(LOG_INFO, "Streaming preview to %s:%d", mHost, mPort);
+    return GenericThread<PreviewStreamer>::startThread();
+}
+
+void PreviewStreamer::stopThread(const bool cancel)
+{
+    bool wasRunning = isRunning();
+    GenericThread<PreviewStreamer>::stopThread(cancel);
+    if (mSocket >= 0)
+    {
+        close(mSocket);
+        mSocket = -1;
+    }
+    if (wasRunning)
+    {
+        printStatistics();
+    }
+}
+
+void PreviewStreamer::printStatistics() const
+{
+    double duration = getMonotonicTime() - mStartTime;
+    double cpuTime = static_cast<double>(mCpuTime) * 1e-6;
+    printf("Preview: sent %lu frames (%.1f kB/s), dropped %lu, streaming thread used %.2f s of CPU (%.2f%% of one core) \n",
+           static_cast<unsigned long>(mSent), duration > 0.0 ? mBytes / duration / 1000.0 : 0.0, static_cast<unsigned long>(mDropped),
+           cpuTime, duration > 0.0 ? 100.0 * cpuTime / duration : 0.0);
+}
+
+void* PreviewStreamer::threadBody()
+{
+    // the preview must only use CPU time that no other thread wants
+    struct sched_param param = {};
+    if (0 != pthread_setschedparam(pthread_self(), SCHED_IDLE, &param))
+    {
+        Logger::log(LOG_WARNING, "Failed to lower priority of the preview thread");
+    }
+
+    const std::vector<int> encoding = {cv::IMWRITE_JPEG_QUALITY, mQuality};
+    PreviewHeader header = {PREVIEW_MAGIC, 0, 0.0f, 0.0f};
+    double cpuStart;
+    bool hasImage;
+
+    while (isRunning())
+    {
+        if (0 == sem_wait(&mSemaphore))
+        {
+            cpuStart = getThreadCpuTime();
+            {
+                ScopedLock lock(mMutex);
+                hasImage = mHasImage;
+                if (hasImage)
+                {
+                    cv::resize(mImage, mPreview, cv::Size(), mScale, mScale, cv::INTER_AREA);
+                    mHasImage = false;
+                }
+            }
+            if (!hasImage)
+            {
+                continue;
+            }
+
+            if (mPreview.channels() == 1)
+            {
+                cv::cvtColor(mPreview, mPreview, cv::COLOR_GRAY2BGR);
+            }
+            header.mSteering = mSteering;
+            header.mThrottle = mThrottle;
+            drawCommands(header.mSteering, header.mThrottle);
+            cv::imencode(".jpg", mPreview, mJpeg, encoding);
+
+            if (sizeof(header) + mJpeg.size() <= MAX_DATAGRAM)
+            {
+                ++header.mFrame;
+                mDatagram.resize(sizeof(header) + mJpeg.size());
+                memcpy(mDatagram.data(), &header, sizeof(header));
+                memcpy(mDatagram.data() + sizeof(header), mJpeg.data(), mJpeg.size());
+                if (sendto(mSocket, mDatagram.data(), mDatagram.size(), MSG_DONTWAIT, 
+                           reinterpret_cast<const struct sockaddr*>(&mAddress), sizeof(mAddress)) > 0)
+                {
+                    ++mSent;
+                    mBytes += mDatagram.size();
+                }
+                else
+                {
+                    ++mDropped;
+                }
+            }
+            else
+            {
+                ++mDropped;
+            }
+            mCpuTime += static_cast<unsigned long>((getThreadCpuTime() - cpuStart) * 1e6);
+        }
+    }
+    return nullptr;
+}
+
+void PreviewStreamer::drawCommands(const float steering, const float throttle)
+{
+    char text[32];
+    int centre = mPreview.cols / 2;
+    int bottom = mPreview.rows - 4;
+
+    // steering as a horizontal bar from the centre and throttle as a vertical bar on the left side
+    cv::line(mPreview, cv::Point(centre, bottom), cv::Point(centre + static_cast<int>(steering * centre), bottom), cv::Scalar(0, 255, 0), 3);
+    cv::line(mPreview, cv::Point(4, mPreview.rows / 2), cv::Point(4, mPreview.rows / 2 - static_cast<int>(throttle * mPreview.rows / 2)), 
+             cv::Scalar(0, 0, 255), 3);
+    snprintf(text, sizeof(text), "S:%+.2f T:%+.2f", steering, throttle);
+    cv::putText(mPreview, text, cv::Point(10, 14), cv::FONT_HERSHEY_PLAIN, 0.9, cv::Scalar(0, 255, 255), 1);
+}
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <CameraData.h>
+#include <DriveCommands.h>
+#include <GenericListener.h>
+#include <GenericThread.h>
+
+struct Settings;
+
+/**
+ * Header of a preview datagram, followed by a JPEG image.
+ */
+struct PreviewHeader
+{
+    /** Magic number identifying preview datagrams. */
+    uint32_t mMagic;
+    /** The number of the frame. */
+    uint32_t mFrame;
+    /** The latest steering. */
+    float mSteering;
+    /** The latest throttle. */
+    float mThrottle;
+};
+
+/** Magic number of preview datagrams, "JRPV". */
+constexpr uint32_t PREVIEW_MAGIC = 0x5650524a;
+
+/**
+ * Streams downsampled camera images with drive commands overlaid as JPEG encoded UDP datagrams for a live preview.
+ * Images are accepted at a capped rate and only when the previous one has been sent, otherwise they are dropped,
+ * so the camera thread never waits. Encoding and sending happen on a thread with the idle scheduling policy,
+ * whose CPU time is measured and reported.
+ */
+class PreviewStreamer : public GenericListener<CameraData>,
+                        public GenericListener<DriveCommands>,
+                        public GenericThread<PreviewStreamer>
+{
+public:
+    /**
+     * Initialises parameters of the stream.
+     *  @param settings the settings of the application.
+     */
+    explicit PreviewStreamer(const Settings& settings);
+
+    /**
+     * Stops the thread and closes the socket.
+     */
+    virtual ~PreviewStreamer();
+
+    /**
+     * Copies the image if the rate cap allows and the thread is idle, otherwise drops it.
+     *  @param cameraData the latest camera data received from either mono or stereo camera.
+     */
+    void update(const CameraData& cameraData) override;
+
+    /**
+     * Stores the drive commands to be overlaid on the next image.
+     *  @param driveCommands the latest drive commands.
+     */
+    void update(const DriveCommands& driveCommands) override;
+
+    /**
+     * Overrides/shadows the baseclass function to open the socket.
+     *  @return true if the socket was opened and the thread started.
+     */
+    bool startThread();
+
+    /**
+     * Overrides/shadows the baseclass function to print statistics.
+     *  @param cancel true to cancel the thread which waits on the semaphore.
+     */
+    void stopThread(const bool cancel);
+
+    /**
+     * Prints the number of sent and dropped frames, bandwidth and CPU usage of the streaming thread.
+     */
+    void printStatistics() const;
+
+    /**
+     * The main body of the streaming thread.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /**
+     * Draws steering and throttle on the preview image.
+     *  @param steering the steering to draw.
+     *  @param throttle the throttle to draw.
+     */
+    void drawCommands(const float steering, const float throttle);
+
+    /** The destination host. */
+    std::string mHost;
+    /** The destination port. */
+    int mPort;
+    /** The minimum time in seconds between two frames. */
+    double mPeriod;
+    /** The scale of the preview image with respect to the camera image. */
+    double mScale;
+    /** JPEG quality. */
+    int mQuality;
+    /** The socket. */
+    int mSocket;
+    /** The destination address. */
+    struct sockaddr_in mAddress;
+    /** The latest accepted camera image, side by side for a stereo camera. */
+    cv::Mat mImage;
+    /** Flag indicating if the image is waiting to be sent. */
+    bool mHasImage;
+    /** The monotonic time of the last accepted image. */
+    double mLastAccepted;
+    /** The downsampled colour preview image. */
+    cv::Mat mPreview;
+    /** Buffer for the datagram. */
+    std::vector<uint8_t> mDatagram;
+    /** Buffer for the encoded image. */
+    std::vector<uint8_t> mJpeg;
+    /** The latest steering. */
+    std::atomic<float> mSteering;
+    /** The latest throttle. */
+    std::atomic<float> mThrottle;
+    /** The number of sent frames. */
+    std::atomic<unsigned long> mSent;
+    /** The number of frames dropped because of the rate cap or a busy thread. */
+    std::atomic<unsigned long> mDropped;
+    /** The number of sent bytes. */
+    std::atomic<unsigned long> mBytes;
+    /** CPU time in microseconds used by the streaming thread. */
+    std::atomic<unsigned long> mCpuTime;
+    /** The monotonic time when the thread started. */
+    double mStartTime;
+};
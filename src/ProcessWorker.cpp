@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <csignal>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "DataSaver.h"
+#include "DriveModelPlugin.h"
+#include "Logger.h"
+#include "ProcessWorker.h"
+#include "Settings.h"
+#include "SharedFrameRing.h"
+
+namespace
+{
+/** Set when the worker is requested to stop. */
+volatile sig_atomic_t STOP_REQUESTED = 0;
+/** The time in seconds to wait for a frame before checking if the worker should stop. */
+constexpr double FRAME_TIMEOUT = 0.1;
+/** The number of 100 ms attempts to open the ring created by the main process. */
+constexpr int OPEN_ATTEMPTS = 100;
+
+/**
+ * Handler for signals that stop the worker.
+ *  @param signum the type of received signal.
+ */
+void handleStopSignals(int signum)
+{
+    (void)signum;
+    STOP_REQUESTED = 1;
+}
+
+/**
+ * Pins the process to CPUs and sets its nice value.
+ *  @param cpus CPUs of the process, empty for no pinning.
+ *  @param niceValue the nice value of the process.
+ */
+void applyScheduling(const std::vector<int>& cpus, const int niceValue)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        CPU_SET(cpu, &set);
+    }
+    if (CPU_COUNT(&set) > 0 && 0 != sched_setaffinity(0, sizeof(set), &set))
+    {
+        Logger::log(LOG_WARNING, "Failed to pin worker to %zu CPUs", cpus.size());
+    }
+    if (0 != setpriority(PRIO_PROCESS, 0, niceValue))
+    {
+        Logger::log(LOG_WARNING, "Failed to set nice value %d of worker", niceValue);
+    }
+}
+} // end of anonymouse namespace
+
+ProcessWorker::ProcessWorker(const Settings& settings, const std::string& role)
+: mSettings(settings),
+  mRole(role)
+{
+}
+
+ProcessWorker::~ProcessWorker()
+{
+}
+
+int ProcessWorker::run()
+{
+    SharedFrameRing ring;
+
+    if (mRole != "inference" && mRole != "recorder")
+    {
+        Logger::log(LOG_ERROR, "Unknown worker role: %s", mRole);
+        return 1;
+    }
+
+    signal(SIGTERM, handleStopSignals);
+    signal(SIGINT, handleStopSignals);
+    if (mRole == "inference")
+    {
+        applyScheduling(mSettings.mInferenceCpus, mSettings.mInferenceNice);
+    }
+    else
+    {
+        applyScheduling(mSettings.mRecorderCpus, mSettings.mRecorderNice);
+    }
+
+    // the main process may still be creating the ring
+    for (int i = 0; i < OPEN_ATTEMPTS && !STOP_REQUESTED && !ring.open(mSettings.mFrameRingName); ++i)
+    {
+        usleep(100000);
+    }
+    if (!ring.isOpen())
+    {
+        Logger::log(LOG_ERROR, "Failed to open shared frame ring %s", mSettings.mFrameRingName);
+        return 1;
+    }
+
+    Logger::log(LOG_INFO, "Worker %s started with PID %d", mRole, static_cast<int>(getpid()));
+    return (mRole == "inference") ? runInference(ring) : runRecorder(ring);
+}
+
+int ProcessWorker::runInference(SharedFrameRing& ring)
+{
+    DriveModelPlugin torchDrive;
+    DriveCommands driveCommands;
+    FrameView view;
+    uint64_t lastFrame = 0;
+
+    torchDrive.initialise(mSettings);
+    if (!torchDrive.isInitialised())
+    {
+        Logger::log(LOG_ERROR, "Failed to initialise inference backend");
+        return 1;
+    }
+
+    ring.releaseAll(CONSUMER_INFERENCE);
+    while (!STOP_REQUESTED)
+    {
+        if (ring.acquire(CONSUMER_INFERENCE, lastFrame, FRAME_TIMEOUT, view))
+        {
+            // the slot stays pinned while images are processed in place
+            if (ring.hasConsumer(CONSUMER_INFERENCE))
+            {
+                torchDrive.processImages(view.mImage[0], view.mImage[1], driveCommands);
+                ring.publishCommands(driveCommands);
+            }
+            ring.release(view);
+        }
+    }
+    return 0;
+}
+
+int ProcessWorker::runRecorder(SharedFrameRing& ring)
+{
+    DataSaver dataSaver(mSettings);
+    FrameView view;
+    uint64_t lastFrame = 0;
+
+    ring.releaseAll(CONSUMER_RECORDER);
+    while (!STOP_REQUESTED)
+    {
+        if (ring.acquire(CONSUMER_RECORDER, lastFrame, FRAME_TIMEOUT, view))
+        {
+            if (ring.hasConsumer(CONSUMER_RECORDER))
+            {
+                // the folder is only created once something is recorded
+                if (!dataSaver.isRunning())
+                {
+                    dataSaver.startThread();
+                }
+                dataSaver.update(view.mCommands);
+                dataSaver.update(view.mImage[0], view.mImage[1]);
+            }
+            ring.release(view);
+        }
+    }
+    dataSaver.stopThread(true);
+    return 0;
+}
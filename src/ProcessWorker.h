@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+struct Settings;
+class SharedFrameRing;
+
+/**
+ * The body of a worker process in the multi-process mode, started by WorkerSupervisor. It opens the shared frame ring
+ * created by the main process and reads frames in place while they are pinned. The "inference" worker predicts drive commands and publishes
+ * them back through the ring, the "recorder" worker saves frames with the applied drive commands using DataSaver.
+ * Each worker can be pinned to CPUs and given its own nice value.
+ */
+class ProcessWorker
+{
+public:
+    /**
+     * Initialises the worker.
+     *  @param settings the settings of the application.
+     *  @param role either "inference" or "recorder".
+     */
+    ProcessWorker(const Settings& settings, const std::string& role);
+
+    /**
+     * Class destructor.
+     */
+    virtual ~ProcessWorker();
+
+    /**
+     * Runs the worker until it receives SIGTERM or SIGINT.
+     *  @return the exit status of the process.
+     */
+    int run();
+
+private:
+    /**
+     * Predicts drive commands from published frames.
+     *  @param ring the opened frame ring.
+     *  @return the exit status of the process.
+     */
+    int runInference(SharedFrameRing& ring);
+
+    /**
+     * Saves published frames.
+     *  @param ring the opened frame ring.
+     *  @return the exit status of the process.
+     */
+    int runRecorder(SharedFrameRing& ring);
+
+    /** The settings of the application. */
+    const Settings& mSettings;
+    /** The role of the worker. */
+    std::string mRole;
+};
@@ -0,0 +1,326 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <experimental/filesystem>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+#include "Logger.h"
+#include "RectificationCache.h"
+
+namespace
+{
+/** Identifies cache files, "JRRM". */
+constexpr uint32_t CACHE_MAGIC = 0x4d52524a;
+/** The version of the cache format. */
+constexpr uint32_t CACHE_VERSION = 1;
+/** Alignment of maps in the cache file. */
+constexpr size_t ALIGNMENT = 64;
+/** Flags of cv::stereoRectify, principal points of both rectified images are at the same pixel. */
+constexpr int RECTIFY_FLAGS = cv::CALIB_ZERO_DISPARITY;
+/** Free scaling of cv::stereoRectify, rectified images only contain valid pixels. */
+constexpr double RECTIFY_ALPHA = 0.0;
+
+/**
+ * The header of the cache file, followed by map1 and map2 of the left camera and map1 and map2 of the right camera.
+ */
+struct CacheHeader
+{
+    /** Identifies cache files. */
+    uint32_t mMagic;
+    /** The version of the format. */
+    uint32_t mVersion;
+    /** The hash of the calibration. */
+    uint64_t mHash;
+    /** The width of images. */
+    int32_t mWidth;
+    /** The height of images. */
+    int32_t mHeight;
+    /** Offsets of maps from the beginning of the file. */
+    uint64_t mOffsets[4];
+};
+
+/**
+ * Rounds up the size to the alignment.
+ *  @param size the size in bytes.
+ *  @return the aligned size.
+ */
+inline size_t align(const size_t size)
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+/**
+ * Updates 64-bit FNV-1a hash with data.
+ *  @param hash the hash to update.
+ *  @param data the data.
+ *  @param size the size of the data.
+ */
+void fnv1a(uint64_t& hash, const void* data, const size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+}
+
+/**
+ * Reads the first of the given nodes that exists in the calibration file.
+ *  @param storage the calibration file.
+ *  @param names names of the node used by different calibration tools.
+ *  @return the matrix, empty if none of the nodes exists.
+ */
+cv::Mat readMatrix(const cv::FileStorage& storage, const std::vector<std::string>& names)
+{
+    cv::Mat matrix;
+    for (const std::string& name : names)
+    {
+        if (!storage[name].empty())
+        {
+            storage[name] >> matrix;
+            break;
+        }
+    }
+    return matrix;
+}
+} // end of anonymouse namespace
+
+RectificationCache::RectificationCache()
+: mMap1(),
+  mMap2(),
+  mMemory(nullptr),
+  mSize(0)
+{
+}
+
+RectificationCache::~RectificationCache()
+{
+    unmap();
+}
+
+bool RectificationCache::load(const std::string& calibrationFolder, const cv::Size& imageSize, const std::string& cacheFolder,
+                              const std::function<bool(const RectificationCache&)>& verify)
+{
+    uint64_t hash = hashCalibration(calibrationFolder, imageSize);
+    char name[64];
+
+    if (0 == hash)
+    {
+        Logger::log(LOG_ERROR, "Failed to read stereo calibration from %s", calibrationFolder);
+        return false;
+    }
+
+    snprintf(name, sizeof(name), "/rectification_%016llx_%dx%d.bin", static_cast<unsigned long long>(hash), imageSize.width, imageSize.height);
+    if (map(cacheFolder + name, hash, imageSize))
+    {
+        Logger::log(LOG_INFO, "Loaded rectification maps from %s%s", cacheFolder, name);
+        return true;
+    }
+
+    if (!computeFromCalibration(calibrationFolder, imageSize))
+    {
+        return false;
+    }
+    if (verify && !verify(*this))
+    {
+        Logger::log(LOG_ERROR, "Rectification maps computed from %s failed verification, they are not cached", calibrationFolder);
+        unmap();
+        return false;
+    }
+    std::error_code error;
+    std::experimental::filesystem::create_directories(cacheFolder, error);
+    if (save(cacheFolder + name, hash))
+    {
+        Logger::log(LOG_INFO, "Cached rectification maps in %s%s", cacheFolder, name);
+    }
+    return true;
+}
+
+void RectificationCache::compute(const cv::Mat cameraMatrix[2], const cv::Mat distortion[2], const cv::Mat& rotation, 
+                                 const cv::Mat& translation, const cv::Size& imageSize)
+{
+    cv::Mat rectification[2];
+    cv::Mat projection[2];
+    cv::Mat disparityToDepth;
+
+    unmap();
+    cv::stereoRectify(cameraMatrix[0], distortion[0], cameraMatrix[1], distortion[1], imageSize, rotation, translation, 
+                      rectification[0], rectification[1], projection[0], projection[1], disparityToDepth, RECTIFY_FLAGS, RECTIFY_ALPHA);
+    for (int i = 0; i < 2; ++i)
+    {
+        cv::initUndistortRectifyMap(cameraMatrix[i], distortion[i], rectification[i], projection[i], imageSize, CV_16SC2, mMap1[i], mMap2[i]);
+    }
+}
+
+bool RectificationCache::save(const std::string& path, const uint64_t hash) const
+{
+    CacheHeader header = {CACHE_MAGIC, CACHE_VERSION, hash, mMap1[0].cols, mMap1[0].rows, {0, 0, 0, 0}};
+    const cv::Mat* maps[4] = {&mMap1[0], &mMap2[0], &mMap1[1], &mMap2[1]};
+    size_t offset = align(sizeof(header));
+    std::string temporaryPath = path + ".tmp";
+    std::ofstream file;
+    std::vector<char> padding(ALIGNMENT, 0);
+
+    if (!isLoaded())
+    {
+        return false;
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        header.mOffsets[i] = offset;
+        offset += align(maps[i]->total() * maps[i]->elemSize());
+    }
+
+    // the file is written under a temporary name and renamed, so that a crash never leaves a partial cache behind
+    file.open(temporaryPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(padding.data(), align(sizeof(header)) - sizeof(header));
+    for (int i = 0; i < 4; ++i)
+    {
+        size_t bytes = maps[i]->total() * maps[i]->elemSize();
+        cv::Mat continuous = maps[i]->isContinuous() ? *maps[i] : maps[i]->clone();
+        file.write(reinterpret_cast<const char*>(continuous.data), bytes);
+        file.write(padding.data(), align(bytes) - bytes);
+    }
+    file.close();
+    return file.good() && 0 == rename(temporaryPath.c_str(), path.c_str());
+}
+
+bool RectificationCache::map(const std::string& path, const uint64_t hash, const cv::Size& imageSize)
+{
+    struct stat status;
+    int fd = open(path.c_str(), O_RDONLY);
+    void* memory;
+
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (0 != fstat(fd, &status) || status.st_size < static_cast<off_t>(sizeof(CacheHeader)))
+    {
+        ::close(fd);
+        return false;
+    }
+    memory = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == memory)
+    {
+        return false;
+    }
+
+    const CacheHeader* header = static_cast<const CacheHeader*>(memory);
+    size_t pixels = static_cast<size_t>(imageSize.area());
+    if (header->mMagic != CACHE_MAGIC || header->mVersion != CACHE_VERSION || header->mHash != hash ||
+        header->mWidth != imageSize.width || header->mHeight != imageSize.height ||
+        header->mOffsets[3] + pixels * sizeof(uint16_t) > static_cast<size_t>(status.st_size))
+    {
+        munmap(memory, static_cast<size_t>(status.st_size));
+        return false;
+    }
+
+    unmap();
+    mMemory = memory;
+    mSize = static_cast<size_t>(status.st_size);
+    // maps are only read by cv::remap, so they can point directly into the read-only mapping
+    uint8_t* base = static_cast<uint8_t*>(memory);
+    mMap1[0] = cv::Mat(imageSize, CV_16SC2, base + header->mOffsets[0]);
+    mMap2[0] = cv::Mat(imageSize, CV_16UC1, base + header->mOffsets[1]);
+    mMap1[1] = cv::Mat(imageSize, CV_16SC2, base + header->mOffsets[2]);
+    mMap2[1] = cv::Mat(imageSize, CV_16UC1, base + header->mOffsets[3]);
+    return true;
+}
+
+void RectificationCache::rectify(const cv::Mat& image, cv::Mat& rectified, const int camera) const
+{
+    cv::remap(image, rectified, mMap1[camera], mMap2[camera], cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+}
+
+uint64_t RectificationCache::hashCalibration(const std::string& calibrationFolder, const cv::Size& imageSize)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char* name : {"/left.xml", "/right.xml", "/stereo.xml"})
+    {
+        std::ifstream file(calibrationFolder + name, std::ios::binary);
+        if (!file.is_open())
+        {
+            return 0;
+        }
+        std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        fnv1a(hash, content.data(), content.size());
+    }
+    fnv1a(hash, &RECTIFY_FLAGS, sizeof(RECTIFY_FLAGS));
+    fnv1a(hash, &RECTIFY_ALPHA, sizeof(RECTIFY_ALPHA));
+    fnv1a(hash, &imageSize.width, sizeof(imageSize.width));
+    fnv1a(hash, &imageSize.height, sizeof(imageSize.height));
+    return hash;
+}
+
+bool RectificationCache::computeFromCalibration(const std::string& calibrationFolder, const cv::Size& imageSize)
+{
+    const char* names[2] = {"/left.xml", "/right.xml"};
+    cv::Mat cameraMatrix[2];
+    cv::Mat distortion[2];
+    cv::Mat rotation;
+    cv::Mat translation;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        cv::FileStorage storage(calibrationFolder + names[i], cv::FileStorage::READ);
+        cameraMatrix[i] = readMatrix(storage, {"K", "cameraMatrix", "camera_matrix"});
+        distortion[i] = readMatrix(storage, {"D", "distCoeffs", "distortion_coefficients"});
+    }
+    cv::FileStorage storage(calibrationFolder + "/stereo.xml", cv::FileStorage::READ);
+    rotation = readMatrix(storage, {"R", "rotation"});
+    translation = readMatrix(storage, {"T", "translation"});
+
+    if (cameraMatrix[0].empty() || cameraMatrix[1].empty() || rotation.empty() || translation.empty())
+    {
+        Logger::log(LOG_ERROR, "Incomplete stereo calibration in %s", calibrationFolder);
+        return false;
+    }
+    compute(cameraMatrix, distortion, rotation, translation, imageSize);
+    return true;
+}
+
+void RectificationCache::unmap()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        mMap1[i].release();
+        mMap2[i].release();
+    }
+    if (mMemory)
+    {
+        munmap(mMemory, mSize);
+        mMemory = nullptr;
+        mSize = 0;
+    }
+}
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <opencv2/core.hpp>
+
+/**
+ * Stereo rectification maps in the fixed-point form (CV_16SC2 + CV_16UC1) that cv::remap processes fastest.
+ * Maps are computed from the calibration files left.xml, right.xml and stereo.xml, and cached in a binary file
+ * named after a hash of the calibration, the rectification parameters and the image size, which is memory-mapped on
+ * subsequent starts. Computed maps can be verified before they are cached.
+ */
+class RectificationCache
+{
+public:
+    /**
+     * Basic constructor.
+     */
+    RectificationCache();
+
+    /**
+     * Unmaps the cache file.
+     */
+    virtual ~RectificationCache();
+
+    /**
+     * Loads maps from the cache, or computes them from the calibration and writes them into the cache.
+     *  @param calibrationFolder the folder with left.xml, right.xml and stereo.xml.
+     *  @param imageSize the size of a single image.
+     *  @param cacheFolder the folder with cached maps.
+     *  @param verify called with computed maps before they are cached, maps that it rejects are neither cached nor kept.
+     *  @return true if the maps are available.
+     */
+    bool load(const std::string& calibrationFolder, const cv::Size& imageSize, const std::string& cacheFolder,
+              const std::function<bool(const RectificationCache&)>& verify = nullptr);
+
+    /**
+     * Computes rectification maps.
+     *  @param cameraMatrix camera matrices of the left and right camera.
+     *  @param distortion distortion coefficients of the left and right camera.
+     *  @param rotation the rotation from the left to the right camera.
+     *  @param translation the translation from the left to the right camera.
+     *  @param imageSize the size of a single image.
+     */
+    void compute(const cv::Mat cameraMatrix[2], const cv::Mat distortion[2], const cv::Mat& rotation, const cv::Mat& translation, 
+                 const cv::Size& imageSize);
+
+    /**
+     * Writes maps into a cache file.
+     *  @param path the path to the file.
+     *  @param hash the hash of the calibration stored in the file.
+     *  @return true if the file was written.
+     */
+    bool save(const std::string& path, const uint64_t hash) const;
+
+    /**
+     * Memory-maps maps from a cache file.
+     *  @param path the path to the file.
+     *  @param hash the expected hash of the calibration.
+     *  @param imageSize the expected size of a single image.
+     *  @return true if the file was valid and mapped.
+     */
+    bool map(const std::string& path, const uint64_t hash, const cv::Size& imageSize);
+
+    /**
+     * Rectifies an image.
+     *  @param image the image captured by the camera.
+     *  @param rectified the rectified image.
+     *  @param camera 0 for the left and 1 for the right camera.
+     */
+    void rectify(const cv::Mat& image, cv::Mat& rectified, const int camera) const;
+
+    /**
+     * Computes a hash of the calibration files, the rectification flags and alpha, and the image size.
+     *  @param calibrationFolder the folder with left.xml, right.xml and stereo.xml.
+     *  @param imageSize the size of a single image.
+     *  @return the hash, 0 if any file could not be read.
+     */
+    static uint64_t hashCalibration(const std::string& calibrationFolder, const cv::Size& imageSize);
+
+    /**
+     *  @param camera 0 for the left and 1 for the right camera.
+     *  @return fixed-point coordinates of the camera.
+     */
+    inline const cv::Mat& getMap1(const int camera) const
+    {
+        return mMap1[camera];
+    }
+
+    /**
+     *  @param camera 0 for the left and 1 for the right camera.
+     *  @return interpolation coefficients of the camera.
+     */
+    inline const cv::Mat& getMap2(const int camera) const
+    {
+        return mMap2[camera];
+    }
+
+    /**
+     *  @return true if maps are available.
+     */
+    inline bool isLoaded() const
+    {
+        return !mMap1[0].empty() && !mMap1[1].empty();
+    }
+
+private:
+    /**
+     * Reads calibration files and computes maps.
+     *  @param calibrationFolder the folder with left.xml, right.xml and stereo.xml.
+     *  @param imageSize the size of a single image.
+     *  @return true if the calibration was read.
+     */
+    bool computeFromCalibration(const std::string& calibrationFolder, const cv::Size& imageSize);
+
+    /**
+     * Unmaps the cache file.
+     */
+    void unmap();
+
+    /** Fixed-point coordinates of the left and right camera. */
+    cv::Mat mMap1[2];
+    /** Interpolation coefficients of the left and right camera. */
+    cv::Mat mMap2[2];
+    /** The memory-mapped cache file, nullptr if maps were computed. */
+    void* mMemory;
+    /** The size of the memory-mapped cache file. */
+    size_t mSize;
+};
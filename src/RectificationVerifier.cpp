@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <unistd.h>
+#include <vector>
+#include <CSI_StereoCamera.h>
+#include <GenericListener.h>
+#include "Logger.h"
+#include "RectificationCache.h"
+#include "RectificationVerifier.h"
+
+namespace
+{
+/** The framerate of the camera while capturing. */
+constexpr int FRAMERATE = 30;
+/** The number of frames the camera delivers before a pair is kept, so that exposure settles. */
+constexpr int SETTLE_FRAMES = 30;
+/** The mean absolute difference of grey levels between both rectifications above which maps are considered different. */
+constexpr double MAX_DIFFERENCE = 4.0;
+
+/**
+ * Keeps the latest stereo pair delivered by the camera.
+ */
+class FrameGrabber : public GenericListener<CameraData>
+{
+public:
+    FrameGrabber() : GenericListener<CameraData>(), mFrames(0), mImages()
+    {
+    }
+
+    void update(const CameraData& cameraData) override
+    {
+        if (cameraData.mImage.size() == 2)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                cameraData.mImage[i].createMatHeader().copyTo(mImages[i]);
+            }
+            ++mFrames;
+        }
+    }
+
+    /** The number of received stereo pairs. */
+    std::atomic<int> mFrames;
+    /** The latest stereo pair. */
+    cv::Mat mImages[2];
+};
+} // end of anonymouse namespace
+
+RectificationVerifier::RectificationVerifier(const std::string& calibrationFolder, const cv::Size& imageSize)
+: mCalibration(calibrationFolder),
+  mImageSize(imageSize),
+  mDifference{-1.0, -1.0}
+{
+}
+
+RectificationVerifier::~RectificationVerifier()
+{
+}
+
+bool RectificationVerifier::verify(const RectificationCache& cache)
+{
+    cv::Mat raw[2];
+    cv::Mat reference[2];
+    cv::Mat rectified;
+    bool retVal = true;
+
+    mDifference[0] = -1.0;
+    mDifference[1] = -1.0;
+    if (!cache.isLoaded() || !capture(false, raw) || !capture(true, reference))
+    {
+        Logger::log(LOG_WARNING, "Failed to capture stereo images to verify rectification maps");
+        return false;
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+        cache.rectify(raw[i], rectified, i);
+        mDifference[i] = cv::norm(rectified, reference[i], cv::NORM_L1) / static_cast<double>(rectified.total() * rectified.channels());
+        retVal = (mDifference[i] <= MAX_DIFFERENCE) && retVal;
+    }
+    if (!retVal)
+    {
+        Logger::log(LOG_WARNING, "Rectification maps differ from the camera's rectification by %.2f and %.2f grey levels",
+                    mDifference[0], mDifference[1]);
+    }
+    return retVal;
+}
+
+bool RectificationVerifier::capture(const bool isRectified, cv::Mat images[2]) const
+{
+    CSI_StereoCamera camera(mImageSize);
+    FrameGrabber grabber;
+    std::vector<uint8_t> ids = {0, 1};
+
+    if (isRectified && !camera.loadCalibration(mCalibration))
+    {
+        Logger::log(LOG_ERROR, "Failed to load stereo camera calibration from %s", mCalibration);
+        return false;
+    }
+    grabber.registerTo(&camera);
+    camera.startCamera(mImageSize, FRAMERATE, 0, ids, 2, false, true);
+    for (int i = 0; i < 10 * SETTLE_FRAMES && grabber.mFrames < SETTLE_FRAMES; ++i)
+    {
+        usleep(10000);
+    }
+    camera.stopCamera();
+    grabber.unregisterFrom(&camera);
+    for (int i = 0; i < 2; ++i)
+    {
+        images[i] = grabber.mImages[i];
+    }
+    return grabber.mFrames >= SETTLE_FRAMES;
+}
@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <opencv2/core.hpp>
+
+class RectificationCache;
+
+/**
+ * Checks rectification maps against the stereo camera's own rectification of the same calibration files. A raw and a
+ * camera-rectified pair are captured one after another, so the camera has to look at a static scene.
+ */
+class RectificationVerifier
+{
+public:
+    /**
+     * Basic constructor.
+     *  @param calibrationFolder the folder with left.xml, right.xml and stereo.xml loaded by the camera.
+     *  @param imageSize the size of a single image.
+     */
+    RectificationVerifier(const std::string& calibrationFolder, const cv::Size& imageSize);
+
+    /**
+     * Class destructor.
+     */
+    virtual ~RectificationVerifier();
+
+    /**
+     * Rectifies a raw pair with the maps and compares it with the pair rectified by the camera.
+     *  @param cache the maps to check.
+     *  @return true if both images match the camera's rectification, false if they differ or could not be captured.
+     */
+    bool verify(const RectificationCache& cache);
+
+    /**
+     *  @param camera 0 for the left and 1 for the right camera.
+     *  @return the mean absolute difference of grey levels measured by the last verification, negative if not measured.
+     */
+    inline double getDifference(const int camera) const
+    {
+        return mDifference[camera];
+    }
+
+private:
+    /**
+     * Captures a stereo pair.
+     *  @param isRectified true to load the calibration into the camera, false for raw images.
+     *  @param images the captured pair.
+     *  @return true if the pair was captured.
+     */
+    bool capture(const bool isRectified, cv::Mat images[2]) const;
+
+    /** The folder with calibration files. */
+    std::string mCalibration;
+    /** The size of a single image. */
+    cv::Size mImageSize;
+    /** The mean absolute difference of the left and right image. */
+    double mDifference[2];
+};
@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Logger.h"
+#include "RemoteDriveAdapter.h"
+#include "Settings.h"
+
+RemoteDriveAdapter::RemoteDriveAdapter(const Settings& settings)
+: GenericListener<CameraData>(),
+  GenericListener<DriveCommands>(),
+  GenericTalker<DriveCommands>(),
+  GenericThread<RemoteDriveAdapter>(),
+  mRing(),
+  mRingName(settings.mFrameRingName),
+  mSlots(static_cast<uint32_t>(settings.mFrameRingSlots)),
+  mImageSize(settings.mWidth, settings.mHeight),
+  mIsMono(settings.mIsMono),
+  mTimeout(settings.mRemoteTimeout),
+  mSteering(0.0f),
+  mThrottle(0.0f),
+  mTimedOut(false),
+  mCommands(0),
+  mTimeouts(0),
+  mDroppedFrames(0)
+{
+}
+
+RemoteDriveAdapter::~RemoteDriveAdapter()
+{
+    stopThread(true);
+}
+
+bool RemoteDriveAdapter::initialise()
+{
+    return mRing.isOpen() || mRing.create(mRingName, mSlots, mImageSize, mIsMono ? CV_8UC3 : CV_8UC1, mIsMono ? 1 : 2);
+}
+
+void RemoteDriveAdapter::update(const CameraData& cameraData)
+{
+    if (mRing.hasConsumer(CONSUMER_INFERENCE) || mRing.hasConsumer(CONSUMER_RECORDER))
+    {
+        if (!mRing.publish(cameraData, DriveCommands(mSteering, mThrottle)))
+        {
+            ++mDroppedFrames;
+        }
+    }
+}
+
+void RemoteDriveAdapter::update(const DriveCommands& driveCommands)
+{
+    mSteering = driveCommands.mSteering;
+    mThrottle = driveCommands.mThrottle;
+}
+
+void RemoteDriveAdapter::setConsumers(const uint32_t consumers)
+{
+    mRing.setConsumers(consumers);
+}
+
+void RemoteDriveAdapter::stopThread(const bool cancel)
+{
+    bool wasRunning = isRunning();
+    GenericThread<RemoteDriveAdapter>::stopThread(cancel);
+    if (wasRunning)
+    {
+        printf("Remote drive: received %lu drive commands, inference timed out %lu times, dropped %lu frames \n",
+               static_cast<unsigned long>(mCommands), static_cast<unsigned long>(mTimeouts), static_cast<unsigned long>(mDroppedFrames));
+    }
+}
+
+void* RemoteDriveAdapter::threadBody()
+{
+    DriveCommands driveCommands;
+    uint32_t lastCommands = 0;
+
+    while (isRunning())
+    {
+        if (mRing.waitForCommands(lastCommands, mTimeout, driveCommands))
+        {
+            // commands that arrive after inference was deselected are stale
+            if (mRing.hasConsumer(CONSUMER_INFERENCE))
+            {
+                ++mCommands;
+                if (mTimedOut)
+                {
+                    Logger::log(LOG_INFO, "Inference process resumed");
+                    mTimedOut = false;
+                }
+                notifyListeners(driveCommands);
+            }
+        }
+        else if (!mRing.hasConsumer(CONSUMER_INFERENCE))
+        {
+            mTimedOut = false;
+        }
+        else if (!mTimedOut)
+        {
+            ++mTimeouts;
+            mTimedOut = true;
+            Logger::log(LOG_WARNING, "No drive commands from inference process for %.0f ms, stopping", mTimeout * 1000.0);
+            notifyListeners(DriveCommands(0.0f, 0.0f));
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <CameraData.h>
+#include <DriveCommands.h>
+#include <GenericListener.h>
+#include <GenericTalker.h>
+#include <GenericThread.h>
+#include "SharedFrameRing.h"
+
+struct Settings;
+
+/**
+ * Counterpart of CameraDriveAdapter for the multi-process mode. Camera images are published into a shared frame ring,
+ * which is consumed by the inference and recording processes, and drive commands predicted by the inference process
+ * are passed on to jetracer. If no commands arrive within the timeout while inference is active, zero throttle is issued
+ * once, so a crashed or stalled inference process stops the car without affecting remote control.
+ */
+class RemoteDriveAdapter : public GenericListener<CameraData>,
+                           public GenericListener<DriveCommands>,
+                           public GenericTalker<DriveCommands>,
+                           public GenericThread<RemoteDriveAdapter>
+{
+public:
+    /**
+     * Initialises parameters of the adapter.
+     *  @param settings the settings of the application.
+     */
+    explicit RemoteDriveAdapter(const Settings& settings);
+
+    /**
+     * Stops the thread.
+     */
+    virtual ~RemoteDriveAdapter();
+
+    /**
+     * Creates the shared frame ring.
+     *  @return true if the ring was created.
+     */
+    bool initialise();
+
+    /**
+     * Publishes camera images into the ring if any process consumes them.
+     *  @param cameraData the latest camera data received from either mono or stereo camera.
+     */
+    void update(const CameraData& cameraData) override;
+
+    /**
+     * Stores the drive commands applied to the racer, which are published along with images for recording.
+     *  @param driveCommands the latest drive commands.
+     */
+    void update(const DriveCommands& driveCommands) override;
+
+    /**
+     * Selects which processes consume published images. Drive commands are passed on only while inference is selected.
+     *  @param consumers bitmask of E_FrameConsumer, 0 for none.
+     */
+    void setConsumers(const uint32_t consumers);
+
+    /**
+     * Overrides/shadows the baseclass function to print statistics.
+     *  @param cancel true to cancel the thread which waits for drive commands.
+     */
+    void stopThread(const bool cancel);
+
+    /**
+     * The main body of the thread that waits for drive commands from the inference process.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /** The shared frame ring. */
+    SharedFrameRing mRing;
+    /** The name of the shared memory object. */
+    std::string mRingName;
+    /** The number of frames in the ring. */
+    uint32_t mSlots;
+    /** The size of a single image. */
+    cv::Size mImageSize;
+    /** True for a mono camera. */
+    bool mIsMono;
+    /** The time in seconds without drive commands after which the car is stopped. */
+    double mTimeout;
+    /** The latest applied steering. */
+    std::atomic<float> mSteering;
+    /** The latest applied throttle. */
+    std::atomic<float> mThrottle;
+    /** Flag indicating that the inference process has timed out. */
+    bool mTimedOut;
+    /** The number of received drive commands. */
+    std::atomic<unsigned long> mCommands;
+    /** The number of timeouts. */
+    std::atomic<unsigned long> mTimeouts;
+    /** The number of frames dropped because every slot of the ring was pinned. */
+    std::atomic<unsigned long> mDroppedFrames;
+};
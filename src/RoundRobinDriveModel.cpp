@@ -0,0 +1,351 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <sched.h>
+#include <thread>
+#include <ATen/Parallel.h>
+#include <ScopedLock.h>
+#include "Logger.h"
+#include "RoundRobinDriveModel.h"
+#include "Settings.h"
+#include "Timing.h"
+
+namespace
+{
+/** The period in seconds after which an idle instance checks whether it should stop. */
+constexpr double INSTANCE_TIMEOUT = 0.1;
+} // end of anonymouse namespace
+
+InferenceInstance::InferenceInstance(RoundRobinDriveModel& owner, const size_t index, const int firstCpu, const int cpus)
+: GenericThread<InferenceInstance>(),
+  mOwner(owner),
+  mIndex(index),
+  mFirstCpu(firstCpu),
+  mCpus(cpus),
+  mAdapter(),
+  mImages(),
+  mSequence(0),
+  mBusy(false),
+  mFrames(0),
+  mBusyTime(0),
+  mStartTime(0.0)
+{
+}
+
+InferenceInstance::~InferenceInstance()
+{
+    stopThread(false);
+}
+
+void* InferenceInstance::threadBody()
+{
+    struct timespec wakeUp;
+    DriveCommands driveCommands;
+    double startTime;
+
+    if (mFirstCpu >= 0)
+    {
+        // libtorch threads created by this thread inherit its cores
+        const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int i = 0; i < mCpus; ++i)
+        {
+            CPU_SET((mFirstCpu + i) % cores, &cpus);
+        }
+        if (0 != pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))
+        {
+            Logger::log(LOG_WARNING, "Failed to pin inference instance %zu", mIndex);
+        }
+    }
+    at::set_num_threads(mCpus);
+    mStartTime = getMonotonicTime();
+
+    while (isRunning())
+    {
+        clock_gettime(CLOCK_REALTIME, &wakeUp);
+        wakeUp.tv_nsec += static_cast<long>(INSTANCE_TIMEOUT * 1e9);
+        if (wakeUp.tv_nsec >= 1000000000L)
+        {
+            ++wakeUp.tv_sec;
+            wakeUp.tv_nsec -= 1000000000L;
+        }
+        if ((0 != sem_timedwait(&mSemaphore, &wakeUp)) || !mBusy)
+        {
+            continue;
+        }
+
+        startTime = getMonotonicTime();
+        driveCommands = DriveCommands();
+        {
+            ScopedLock lock(mMutex);
+            mAdapter.predict(mImages[0], mImages[1], driveCommands);
+        }
+        mBusyTime += static_cast<unsigned long>((getMonotonicTime() - startTime) * 1e9);
+        ++mFrames;
+        mOwner.publish(mSequence, driveCommands);
+        if (mOwner.mShadow.isEnabled())
+        {
+            // each instance receives every n-th frame at most
+            mOwner.mShadow.offer(mImages[0], mImages[1], driveCommands, getMonotonicTime() - startTime,
+                                 mOwner.mFramePeriod * static_cast<double>(mOwner.mInstances.size()));
+        }
+        mBusy = false;
+    }
+    return nullptr;
+}
+
+double InferenceInstance::getUtilisation() const
+{
+    double elapsed = getMonotonicTime() - mStartTime;
+    return (mStartTime > 0.0 && elapsed > 0.0) ? static_cast<double>(mBusyTime) * 1e-9 / elapsed : 0.0;
+}
+
+RoundRobinDriveModel::RoundRobinDriveModel()
+: IDriveModel(),
+  mInstances(),
+  mIsInitialised(false),
+  mFrameDivider(1),
+  mReceivedFrames(0),
+  mNextInstance(0),
+  mSequence(0),
+  mPublished(0),
+  mDroppedFrames(0),
+  mStaleResults(0),
+  mFramePeriod(0.0),
+  mShadow()
+{
+    pthread_mutex_init(&mPublishMutex, nullptr);
+}
+
+RoundRobinDriveModel::~RoundRobinDriveModel()
+{
+    for (std::unique_ptr<InferenceInstance>& instance : mInstances)
+    {
+        instance->stopThread(false);
+    }
+    // instances print their own statistics when destroyed
+    printInstances();
+    mInstances.clear();
+    pthread_mutex_destroy(&mPublishMutex);
+}
+
+void RoundRobinDriveModel::initialise(const Settings& settings)
+{
+    if (isInitialised())
+    {
+        return;
+    }
+
+    const int count = std::max(1, settings.mInferenceInstances);
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int intraOpThreads = settings.mIntraOpThreads;
+    const bool pinned = settings.mInferenceInstancesPinned;
+    const int cpus = std::max(1, cores / count);
+
+    // each instance loads its own backends, so that instances do not share any state
+    for (int i = 0; i < count; ++i)
+    {
+        mInstances.push_back(std::make_unique<InferenceInstance>(*this, i, pinned ? i * cpus : -1, (intraOpThreads > 0) ? intraOpThreads : cpus));
+        mInstances.back()->mAdapter.initialise(settings);
+        if (!mInstances.back()->mAdapter.isInitialised())
+        {
+            Logger::log(LOG_ERROR, "Failed to initialise inference instance %d of %d", i + 1, count);
+            mInstances.clear();
+            return;
+        }
+    }
+
+    if (isAsynchronous())
+    {
+        if (settings.mSkipThreshold > 0.0)
+        {
+            Logger::log(LOG_WARNING, "Inference skipping is not supported with %d inference instances", count);
+        }
+        for (std::unique_ptr<InferenceInstance>& instance : mInstances)
+        {
+            instance->startThread();
+        }
+        Logger::log(LOG_INFO, "Started %d inference instances with %d threads each%s", count, mInstances[0]->mCpus, pinned ? ", pinned" : "");
+    }
+    mFramePeriod = 1.0 / settings.mFramerate;
+    mShadow.initialise(settings);
+    mIsInitialised = true;
+}
+
+void RoundRobinDriveModel::setTtaMode(const E_TtaMode tta)
+{
+    for (std::unique_ptr<InferenceInstance>& instance : mInstances)
+    {
+        instance->mAdapter.setTtaMode(tta);
+    }
+    mShadow.setTtaMode(tta);
+}
+
+void RoundRobinDriveModel::setFrameDivider(const unsigned int divider)
+{
+    mFrameDivider = std::max(divider, 1u);
+    if (!isAsynchronous() && !mInstances.empty())
+    {
+        mInstances[0]->mAdapter.setFrameDivider(divider);
+    }
+}
+
+void RoundRobinDriveModel::setMinimumLevel(const size_t level)
+{
+    for (std::unique_ptr<InferenceInstance>& instance : mInstances)
+    {
+        instance->mAdapter.setMinimumLevel(level);
+    }
+}
+
+void RoundRobinDriveModel::setAdaptiveTta(const float steeringThreshold, const float changeThreshold, const double timeBudget)
+{
+    for (std::unique_ptr<InferenceInstance>& instance : mInstances)
+    {
+        instance->mAdapter.setAdaptiveTta(steeringThreshold, changeThreshold, timeBudget);
+    }
+    mShadow.setAdaptiveTta(steeringThreshold, changeThreshold, timeBudget);
+}
+
+void RoundRobinDriveModel::setIntraOpThreads(const int threads)
+{
+    if (isAsynchronous())
+    {
+        if (threads > 0)
+        {
+            Logger::log(LOG_WARNING, "Intra-op threads are split between %zu inference instances and cannot be changed", mInstances.size());
+        }
+    }
+    else if (!mInstances.empty())
+    {
+        mInstances[0]->mAdapter.setIntraOpThreads(threads);
+    }
+}
+
+void RoundRobinDriveModel::update(const CameraData& camData)
+{
+    const cv::Mat rightImage = (camData.mImage.size() == 1) ? cv::Mat() : camData.mImage[1].createMatHeader();
+    if (!isInitialised())
+    {
+        return;
+    }
+    if (isAsynchronous())
+    {
+        if (0 == (mReceivedFrames++ % mFrameDivider))
+        {
+            dispatch(camData.mImage[0].createMatHeader(), rightImage);
+        }
+        return;
+    }
+
+    DriveCommands driveCommands;
+    double startTime = getMonotonicTime();
+    bool inferred = processImages(camData.mImage[0].createMatHeader(), rightImage, driveCommands);
+    notifyListeners(driveCommands);
+    // frames without inference carry stale commands, and the cycles they save are left to the governor
+    if (inferred && mShadow.isEnabled())
+    {
+        mShadow.offer(camData.mImage[0].createMatHeader(), rightImage, driveCommands, getMonotonicTime() - startTime, mFramePeriod);
+    }
+}
+
+bool RoundRobinDriveModel::processImages(const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands)
+{
+    if (isInitialised())
+    {
+        ScopedLock lock(mInstances[0]->mMutex);
+        return mInstances[0]->mAdapter.processImages(image, rightImage, driveCommands);
+    }
+    return false;
+}
+
+void RoundRobinDriveModel::printStatistics() const
+{
+    printInstances();
+    for (const std::unique_ptr<InferenceInstance>& instance : mInstances)
+    {
+        instance->mAdapter.printStatistics();
+    }
+    if (mShadow.isEnabled())
+    {
+        mShadow.printStatistics();
+    }
+}
+
+void RoundRobinDriveModel::printInstances() const
+{
+    if (isInitialised() && isAsynchronous())
+    {
+        for (const std::unique_ptr<InferenceInstance>& instance : mInstances)
+        {
+            printf("Inference instance %zu: %lu frames, utilisation %.1f%% \n",
+                   instance->mIndex + 1, instance->mFrames.load(), instance->getUtilisation() * 100.0);
+        }
+        printf("Inference instances: %lu frames dropped while all instances were busy, %lu late results dropped \n",
+               mDroppedFrames.load(), mStaleResults.load());
+    }
+}
+
+void RoundRobinDriveModel::dispatch(const cv::Mat& image, const cv::Mat& rightImage)
+{
+    for (size_t i = 0; i < mInstances.size(); ++i)
+    {
+        InferenceInstance& instance = *mInstances[(mNextInstance + i) % mInstances.size()];
+        if (!instance.mBusy)
+        {
+            // camera buffers are reused for the next frame, so the instance gets its own copy
+            image.copyTo(instance.mImages[0]);
+            if (rightImage.empty())
+            {
+                instance.mImages[1].release();
+            }
+            else
+            {
+                rightImage.copyTo(instance.mImages[1]);
+            }
+            instance.mSequence = ++mSequence;
+            instance.mBusy = true;
+            sem_post(&instance.mSemaphore);
+            mNextInstance = (instance.mIndex + 1) % mInstances.size();
+            return;
+        }
+    }
+    ++mDroppedFrames;
+}
+
+void RoundRobinDriveModel::publish(const unsigned long sequence, const DriveCommands& driveCommands)
+{
+    // listeners are notified under the lock, so that they receive results in the order of frames
+    ScopedLock lock(mPublishMutex);
+    if (sequence > mPublished)
+    {
+        mPublished = sequence;
+        notifyListeners(driveCommands);
+    }
+    else
+    {
+        ++mStaleResults;
+    }
+}
@@ -0,0 +1,237 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <pthread.h>
+#include <vector>
+#include <GenericThread.h>
+#include "CameraDriveAdapter.h"
+#include "ShadowEvaluator.h"
+
+class RoundRobinDriveModel;
+
+/**
+ * A model instance with its own thread that predicts drive commands for frames dispatched to it.
+ */
+class InferenceInstance : public GenericThread<InferenceInstance>
+{
+public:
+    /**
+     * Basic constructor.
+     *  @param owner the model that dispatches frames and publishes results.
+     *  @param index the index of the instance.
+     *  @param firstCpu the first core of the instance, -1 to leave the thread unpinned.
+     *  @param cpus the number of cores of the instance, which is also the number of its libtorch threads.
+     */
+    InferenceInstance(RoundRobinDriveModel& owner, const size_t index, const int firstCpu, const int cpus);
+
+    /**
+     * Stops the thread.
+     */
+    virtual ~InferenceInstance();
+
+    /**
+     * The main body of the instance thread.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+    /**
+     * Returns the share of time the instance spent on inference since it started.
+     *  @return the utilisation between 0 and 1.
+     */
+    double getUtilisation() const;
+
+private:
+    friend class RoundRobinDriveModel;
+
+    /** The model that dispatches frames and publishes results. */
+    RoundRobinDriveModel& mOwner;
+    /** The index of the instance. */
+    size_t mIndex;
+    /** The first core of the instance, -1 if unpinned. */
+    int mFirstCpu;
+    /** The number of cores and libtorch threads of the instance. */
+    int mCpus;
+    /** The model with its own inference backends. */
+    CameraDriveAdapter mAdapter;
+    /** Copies of the dispatched images, the right one is empty for a mono camera. */
+    cv::Mat mImages[2];
+    /** The sequence number of the dispatched frame. */
+    unsigned long mSequence;
+    /** Flag indicating that a frame was dispatched and its result was not published yet. */
+    std::atomic<bool> mBusy;
+    /** The number of processed frames. */
+    std::atomic<unsigned long> mFrames;
+    /** Time spent on inference in nanoseconds. */
+    std::atomic<unsigned long> mBusyTime;
+    /** The monotonic time at which the thread started. */
+    double mStartTime;
+};
+
+/**
+ * Drive model that runs several instances of CameraDriveAdapter on separate threads, so that frames can be processed
+ * at the camera rate even if a single instance takes longer than the frame period. Frames are dispatched round-robin
+ * to idle instances and dropped when all of them are busy. Results are published in the order of frames, a result
+ * that arrives after the result of a newer frame is dropped. With a single instance, frames are processed on the
+ * caller's thread as by CameraDriveAdapter. Frames processed by the instances are offered to the shadow model if one
+ * is configured.
+ */
+class RoundRobinDriveModel : public IDriveModel
+{
+public:
+    /**
+     * Basic constructor, instances are created at initialisation.
+     */
+    RoundRobinDriveModel();
+
+    /**
+     * Stops and destroys the instances.
+     */
+    virtual ~RoundRobinDriveModel();
+
+    /**
+     * Creates "inferenceInstances" instances initialised from the configuration and starts their threads.
+     *  @param settings the settings of the application.
+     */
+    void initialise(const Settings& settings) override;
+
+    /**
+     *  @return true of all instances were initialised.
+     */
+    inline bool isInitialised() const override
+    {
+        return mIsInitialised;
+    }
+
+    /**
+     *  @return true if results are published from threads of the instances.
+     */
+    inline bool isAsynchronous() const override
+    {
+        return mInstances.size() > 1;
+    }
+
+    /**
+     * Changes the test time augmentations mode of all instances. This function is thread safe.
+     *  @param tta the test time augmentations mode.
+     */
+    void setTtaMode(const E_TtaMode tta) override;
+
+    /**
+     * Lowers the control rate by dispatching only every n-th frame. This function is thread safe.
+     *  @param divider dispatch every @p divider frame, 1 for every frame.
+     */
+    void setFrameDivider(const unsigned int divider) override;
+
+    /**
+     * Prevents models with resolutions higher than the given one from being used. This function is thread safe.
+     *  @param level the index of the highest resolution model that can be used, 0 for no limit.
+     */
+    void setMinimumLevel(const size_t level) override;
+
+    /**
+     * Sets conditions under which the flipped image is processed in the adaptive TTA mode by all instances and the
+     * shadow model. This function is thread safe.
+     *  @param steeringThreshold the absolute steering above which the prediction is considered uncertain.
+     *  @param changeThreshold the absolute change of steering from the previous frame above which the prediction is considered uncertain.
+     *  @param timeBudget the time in seconds per frame within which the flipped image is always processed, 0 to disable.
+     */
+    void setAdaptiveTta(const float steeringThreshold, const float changeThreshold, const double timeBudget) override;
+
+    /**
+     * Changes the number of libtorch threads used within an operation by a single instance. Several instances keep
+     * their share of cores. This function is thread safe.
+     *  @param threads the number of threads, 0 to keep the current number.
+     */
+    void setIntraOpThreads(const int threads) override;
+
+    /**
+     * Dispatches camera images to the next idle instance, listeners are notified once its result is published.
+     * With a single instance, predicts drive commands and notifies listeners on the caller's thread.
+     *  @param camData the camera data, can be from either mono or stereo camera.
+     */
+    void update(const CameraData& camData) override;
+
+    /**
+     * Predicts drive commands on the caller's thread with the first instance.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param driveCommands the predicted drive commands.
+     *  @return true if inference ran, false if previous drive commands were reused for this frame.
+     */
+    bool processImages(const cv::Mat& image, const cv::Mat& rightImage, DriveCommands& driveCommands) override;
+
+    /**
+     * Prints utilisation of each instance, dropped frames and results, statistics of each instance and of the shadow model.
+     */
+    void printStatistics() const override;
+
+private:
+    friend class InferenceInstance;
+
+    /**
+     * Prints utilisation of each instance and dropped frames and results.
+     */
+    void printInstances() const;
+
+    /**
+     * Copies images to the next idle instance and wakes it up.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     */
+    void dispatch(const cv::Mat& image, const cv::Mat& rightImage);
+
+    /**
+     * Notifies listeners with the result of an instance unless the result of a newer frame was already published.
+     *  @param sequence the sequence number of the frame.
+     *  @param driveCommands the predicted drive commands.
+     */
+    void publish(const unsigned long sequence, const DriveCommands& driveCommands);
+
+    /** Model instances. */
+    std::vector<std::unique_ptr<InferenceInstance>> mInstances;
+    /** Flag to indicate if the class was initialised. */
+    bool mIsInitialised;
+    /** Frames are dispatched on every n-th frame. */
+    std::atomic<unsigned int> mFrameDivider;
+    /** The number of frames received. */
+    unsigned long mReceivedFrames;
+    /** The index of the instance that is tried first for the next frame. */
+    size_t mNextInstance;
+    /** The sequence number of the last dispatched frame. */
+    unsigned long mSequence;
+    /** The sequence number of the last published result. */
+    unsigned long mPublished;
+    /** Guards publishing of results. */
+    pthread_mutex_t mPublishMutex;
+    /** The number of frames dropped because all instances were busy. */
+    std::atomic<unsigned long> mDroppedFrames;
+    /** The number of results dropped because the result of a newer frame was published first. */
+    std::atomic<unsigned long> mStaleResults;
+    /** The camera frame period in seconds. */
+    double mFramePeriod;
+    /** Evaluates the candidate model on frames of the instances. */
+    ShadowEvaluator mShadow;
+};
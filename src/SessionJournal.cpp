@@ -0,0 +1,322 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cerrno>
+#include <cstring>
+#include <time.h>
+#include <unistd.h>
+#include <ScopedLock.h>
+#include "Logger.h"
+#include "SessionJournal.h"
+#include "Timing.h"
+
+namespace
+{
+/** The time in seconds after which the writer thread checks if it should stop. */
+constexpr double WRITER_TIMEOUT = 0.1;
+/** The time in microseconds between checks whether reserved records were filled while closing. */
+constexpr useconds_t FILL_WAIT = 1000;
+} // end of anonymouse namespace
+
+SessionJournal::SessionJournal(const E_JournalFrames frames, const size_t maxQueuedFrames)
+: GenericThread<SessionJournal>(),
+  mFrames(frames),
+  mMaxQueuedFrames(maxQueuedFrames),
+  mJournal(nullptr),
+  mFrameStore(nullptr),
+  mQueue(),
+  mQueueStart(0),
+  mFreeBuffers(),
+  mQueuedFrames(0),
+  mUnfilledRecords(0),
+  mIsClosing(false),
+  mFrameIndex(0),
+  mRecords(0),
+  mDroppedFrames(0)
+{
+}
+
+SessionJournal::~SessionJournal()
+{
+    close();
+}
+
+bool SessionJournal::open(const std::string& path)
+{
+    JournalHeader header = {JOURNAL_MAGIC, JOURNAL_VERSION};
+
+    if (isOpen())
+    {
+        return false;
+    }
+
+    {
+        // records left by a previous session must not be written into this one
+        ScopedLock lock(mMutex);
+        mQueue.clear();
+        mQueueStart = 0;
+        mQueuedFrames = 0;
+        mUnfilledRecords = 0;
+        mIsClosing = false;
+    }
+
+    mJournal = fopen(path.c_str(), "wb");
+    if (!mJournal)
+    {
+        Logger::log(LOG_ERROR, "Failed to open journal %s: %s", path, strerror(errno));
+        return false;
+    }
+    if (mFrames == FRAMES_STORE)
+    {
+        mFrameStore = fopen((path + ".frames").c_str(), "wb");
+        if (!mFrameStore)
+        {
+            Logger::log(LOG_ERROR, "Failed to open frame store %s.frames: %s", path, strerror(errno));
+            fclose(mJournal);
+            mJournal = nullptr;
+            return false;
+        }
+    }
+    fwrite(&header, sizeof(header), 1, mJournal);
+    mFrameIndex = 0;
+    mRecords = 0;
+    mDroppedFrames = 0;
+
+    Logger::log(LOG_INFO, "Recording session journal to %s", path);
+    return startThread();
+}
+
+void SessionJournal::close()
+{
+    bool wasOpen = isOpen();
+    bool isFilling = true;
+
+    {
+        ScopedLock lock(mMutex);
+        mIsClosing = true;
+    }
+    // the writer thread wakes up periodically, so it does not need to be cancelled in the middle of writing
+    stopThread(false);
+    // talkers that reserved a record before closing are still copying it, later records would be held back by it
+    while (isFilling)
+    {
+        {
+            ScopedLock lock(mMutex);
+            isFilling = mUnfilledRecords > 0;
+        }
+        if (isFilling)
+        {
+            usleep(FILL_WAIT);
+        }
+    }
+    flush();
+
+    ScopedLock lock(mMutex);
+    if (mJournal)
+    {
+        fclose(mJournal);
+        mJournal = nullptr;
+    }
+    if (mFrameStore)
+    {
+        fclose(mFrameStore);
+        mFrameStore = nullptr;
+    }
+    if (wasOpen)
+    {
+        printf("Session journal: written %lu records with %lu frames, dropped %lu frames \n", 
+               mRecords, static_cast<unsigned long>(mFrameIndex), mDroppedFrames);
+    }
+}
+
+void SessionJournal::record(const GamepadEventData& eventData)
+{
+    JournalGamepad payload = {static_cast<uint8_t>(eventData.mIsAxis), 0, static_cast<int16_t>(eventData.mValue), 
+                              static_cast<int32_t>(eventData.mNumber)};
+    queue(JOURNAL_GAMEPAD, &payload, sizeof(payload), nullptr);
+}
+
+void SessionJournal::record(const CameraData& cameraData)
+{
+    if (!cameraData.mImage.empty())
+    {
+        queue(JOURNAL_CAMERA, nullptr, 0, &cameraData);
+    }
+}
+
+void SessionJournal::record(const E_JournalStream stream, const DriveCommands& driveCommands)
+{
+    float payload[2] = {driveCommands.mSteering, driveCommands.mThrottle};
+    queue(stream, payload, sizeof(payload), nullptr);
+}
+
+void SessionJournal::recordState(const int state)
+{
+    int32_t payload = state;
+    queue(JOURNAL_STATE, &payload, sizeof(payload), nullptr);
+}
+
+E_JournalFrames SessionJournal::strToFrames(const std::string& value)
+{
+    if (value == "inline")
+    {
+        return FRAMES_INLINE;
+    }
+    else if (value == "store")
+    {
+        return FRAMES_STORE;
+    }
+    return FRAMES_OFF;
+}
+
+void* SessionJournal::threadBody()
+{
+    struct timespec wakeUp;
+
+    while (isRunning())
+    {
+        clock_gettime(CLOCK_REALTIME, &wakeUp);
+        wakeUp.tv_nsec += static_cast<long>(WRITER_TIMEOUT * 1e9);
+        if (wakeUp.tv_nsec >= 1000000000L)
+        {
+            ++wakeUp.tv_sec;
+            wakeUp.tv_nsec -= 1000000000L;
+        }
+        sem_timedwait(&mSemaphore, &wakeUp);
+        flush();
+    }
+    return nullptr;
+}
+
+void SessionJournal::queue(const E_JournalStream stream, const void* payload, const size_t size, const CameraData* cameraData)
+{
+    JournalRecord record = {stream, {0, 0, 0}, static_cast<uint32_t>(size), 0.0};
+    JournalFrame frame = {0, 0, 0, 0, 0, mFrames, 0};
+    std::vector<uint8_t> buffer;
+    size_t imageBytes = 0;
+    uint64_t sequence;
+
+    if (cameraData)
+    {
+        const cv::cuda::HostMem& image = cameraData->mImage[0];
+        frame.mWidth = image.cols;
+        frame.mHeight = image.rows;
+        frame.mType = image.type();
+        frame.mImages = static_cast<int32_t>(cameraData->mImage.size());
+        imageBytes = (mFrames == FRAMES_OFF) ? 0 : image.createMatHeader().total() * image.createMatHeader().elemSize();
+        // frames in the store are referenced by their index, only their description is written into the journal
+        record.mSize = static_cast<uint32_t>(sizeof(frame) + (mFrames == FRAMES_INLINE ? imageBytes * frame.mImages : 0));
+    }
+
+    {
+        ScopedLock lock(mMutex);
+        if (!isOpen() || mIsClosing)
+        {
+            return;
+        }
+        if (cameraData)
+        {
+            if (mFrames != FRAMES_OFF && mQueuedFrames >= mMaxQueuedFrames)
+            {
+                ++mDroppedFrames;
+                return;
+            }
+            frame.mIndex = mFrameIndex++;
+            mQueuedFrames += static_cast<size_t>(mFrames != FRAMES_OFF);
+        }
+        if (!mFreeBuffers.empty())
+        {
+            buffer = std::move(mFreeBuffers.back());
+            mFreeBuffers.pop_back();
+        }
+        // records of different talkers are written in the order of their timestamps, which replay relies on
+        record.mTime = getMonotonicTime();
+        sequence = mQueueStart + mQueue.size();
+        mQueue.emplace_back();
+        ++mUnfilledRecords;
+    }
+
+    // copying happens outside of the lock, so that talkers do not wait for each other
+    if (cameraData)
+    {
+        buffer.resize(sizeof(record) + sizeof(frame) + imageBytes * frame.mImages);
+        memcpy(buffer.data() + sizeof(record), &frame, sizeof(frame));
+        for (int i = 0; imageBytes > 0 && i < frame.mImages; ++i)
+        {
+            cv::Mat destination(frame.mHeight, frame.mWidth, frame.mType, buffer.data() + sizeof(record) + sizeof(frame) + imageBytes * i);
+            cameraData->mImage[i].createMatHeader().copyTo(destination);
+        }
+    }
+    else
+    {
+        buffer.resize(sizeof(record) + size);
+        memcpy(buffer.data() + sizeof(record), payload, size);
+    }
+    memcpy(buffer.data(), &record, sizeof(record));
+
+    ScopedLock lock(mMutex);
+    mQueue[sequence - mQueueStart] = std::move(buffer);
+    --mUnfilledRecords;
+    sem_post(&mSemaphore);
+}
+
+void SessionJournal::flush()
+{
+    std::vector<uint8_t> buffer;
+    JournalRecord record;
+    size_t journalBytes;
+
+    while (true)
+    {
+        {
+            ScopedLock lock(mMutex);
+            if (!buffer.empty())
+            {
+                mFreeBuffers.push_back(std::move(buffer));
+                buffer.clear();
+            }
+            // a record that is still being copied holds back later records
+            if (mQueue.empty() || mQueue.front().empty() || !mJournal)
+            {
+                break;
+            }
+            buffer = std::move(mQueue.front());
+            mQueue.pop_front();
+            ++mQueueStart;
+        }
+
+        memcpy(&record, buffer.data(), sizeof(record));
+        journalBytes = sizeof(record) + record.mSize;
+        fwrite(buffer.data(), 1, journalBytes, mJournal);
+        if (buffer.size() > journalBytes && mFrameStore)
+        {
+            fwrite(buffer.data() + journalBytes, 1, buffer.size() - journalBytes, mFrameStore);
+        }
+        ++mRecords;
+
+        if (record.mStream == JOURNAL_CAMERA && mFrames != FRAMES_OFF)
+        {
+            ScopedLock lock(mMutex);
+            --mQueuedFrames;
+        }
+    }
+}
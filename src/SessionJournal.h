@@ -0,0 +1,300 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <CameraData.h>
+#include <DriveCommands.h>
+#include <GamepadEventData.h>
+#include <GenericListener.h>
+#include <GenericThread.h>
+
+/**
+ * Streams recorded in the journal.
+ */
+enum E_JournalStream : uint8_t
+{
+    JOURNAL_GAMEPAD = 0,
+    JOURNAL_CAMERA = 1,
+    JOURNAL_GAMEPAD_DRIVE = 2,
+    JOURNAL_TORCH_DRIVE = 3,
+    JOURNAL_STATE = 4
+};
+
+/**
+ * How camera frames are recorded.
+ */
+enum E_JournalFrames
+{
+    /** Only the time and number of frames. */
+    FRAMES_OFF,
+    /** Frames are written into the journal. */
+    FRAMES_INLINE,
+    /** Frames are written into a separate frame store and referenced by their index. */
+    FRAMES_STORE
+};
+
+/**
+ * The header of the journal file.
+ */
+struct JournalHeader
+{
+    /** Identifies journal files, "JRSJ". */
+    uint32_t mMagic;
+    /** The version of the format. */
+    uint32_t mVersion;
+};
+
+/**
+ * The header of each record, followed by mSize bytes of payload:
+ * gamepad events are JournalGamepad, drive commands are two floats (steering, throttle), states are int32,
+ * and camera frames are JournalFrame followed by image data if written inline.
+ */
+struct JournalRecord
+{
+    /** The stream, see E_JournalStream. */
+    uint8_t mStream;
+    /** Unused. */
+    uint8_t mReserved[3];
+    /** The size of the payload in bytes. */
+    uint32_t mSize;
+    /** Monotonic time in seconds. */
+    double mTime;
+};
+
+/**
+ * Payload of a gamepad event.
+ */
+struct JournalGamepad
+{
+    /** True for an axis event. */
+    uint8_t mIsAxis;
+    /** Unused. */
+    uint8_t mReserved;
+    /** The value of the axis or button. */
+    int16_t mValue;
+    /** The number of the axis or button. */
+    int32_t mNumber;
+};
+
+/**
+ * Payload of a camera frame.
+ */
+struct JournalFrame
+{
+    /** The number of the frame, also its index in the frame store. */
+    uint64_t mIndex;
+    /** The width of images. */
+    int32_t mWidth;
+    /** The height of images. */
+    int32_t mHeight;
+    /** The OpenCV type of images. */
+    int32_t mType;
+    /** The number of images, 1 for mono and 2 for stereo camera. */
+    int32_t mImages;
+    /** Where the image data is, see E_JournalFrames. */
+    int32_t mFrames;
+    /** Unused. */
+    int32_t mReserved;
+};
+
+/** Identifies journal files, "JRSJ". */
+constexpr uint32_t JOURNAL_MAGIC = 0x4a53524a;
+/** The version of the journal format. */
+constexpr uint32_t JOURNAL_VERSION = 1;
+
+/**
+ * Records events of all talker streams with monotonic timestamps into a compact binary journal, so that a session
+ * can be replayed by SessionReplay. Records are queued by the talker threads and written by a separate thread.
+ * Camera frames are dropped if too many of them are waiting to be written, other events are never dropped.
+ */
+class SessionJournal : public GenericThread<SessionJournal>
+{
+public:
+    /**
+     * Initialises parameters of the journal.
+     *  @param frames how camera frames are recorded.
+     *  @param maxQueuedFrames the maximum number of frames waiting to be written.
+     */
+    SessionJournal(const E_JournalFrames frames, const size_t maxQueuedFrames);
+
+    /**
+     * Stops the thread and closes files.
+     */
+    virtual ~SessionJournal();
+
+    /**
+     * Opens the journal file, and the frame store at [path].frames if needed, and starts the writer thread.
+     *  @param path the path to the journal file.
+     *  @return true if the journal was opened.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * Writes all queued records, stops the thread and closes files.
+     */
+    void close();
+
+    /**
+     * Records a gamepad event.
+     *  @param eventData the gamepad event.
+     */
+    void record(const GamepadEventData& eventData);
+
+    /**
+     * Records a camera frame.
+     *  @param cameraData the camera data from either mono or stereo camera.
+     */
+    void record(const CameraData& cameraData);
+
+    /**
+     * Records drive commands.
+     *  @param stream either JOURNAL_GAMEPAD_DRIVE or JOURNAL_TORCH_DRIVE.
+     *  @param driveCommands the drive commands.
+     */
+    void record(const E_JournalStream stream, const DriveCommands& driveCommands);
+
+    /**
+     * Records a state transition.
+     *  @param state the new state.
+     */
+    void recordState(const int state);
+
+    /**
+     *  @return true if the journal is open.
+     */
+    inline bool isOpen() const
+    {
+        return mJournal != nullptr;
+    }
+
+    /**
+     * Converts a string into frames recording mode.
+     *  @param value either "off", "inline" or "store".
+     *  @return the frames recording mode, FRAMES_OFF for unknown values.
+     */
+    static E_JournalFrames strToFrames(const std::string& value);
+
+    /**
+     * The main body of the writer thread.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /**
+     * Queues a record. The record is timestamped and its place in the queue is reserved under the lock, so that records
+     * are written in the order of their timestamps, while camera frames are copied into the record outside of the lock.
+     *  @param stream the stream of the record.
+     *  @param payload the payload, ignored for camera frames.
+     *  @param size the size of the payload.
+     *  @param cameraData the camera frame to record, nullptr for other records.
+     */
+    void queue(const E_JournalStream stream, const void* payload, const size_t size, const CameraData* cameraData);
+
+    /**
+     * Writes queued records.
+     */
+    void flush();
+
+    /** How camera frames are recorded. */
+    E_JournalFrames mFrames;
+    /** The maximum number of frames waiting to be written. */
+    size_t mMaxQueuedFrames;
+    /** The journal file. */
+    FILE* mJournal;
+    /** The frame store file. */
+    FILE* mFrameStore;
+    /** Records waiting to be written, empty while a record is being copied into its reserved place. */
+    std::deque<std::vector<uint8_t>> mQueue;
+    /** The sequence number of the first record in the queue. */
+    uint64_t mQueueStart;
+    /** Buffers of written records to be reused. */
+    std::vector<std::vector<uint8_t>> mFreeBuffers;
+    /** The number of frames waiting to be written. */
+    size_t mQueuedFrames;
+    /** The number of records reserved in the queue that are still being copied. */
+    size_t mUnfilledRecords;
+    /** True while the journal is being closed, new records are rejected. */
+    bool mIsClosing;
+    /** The number of recorded frames. */
+    uint64_t mFrameIndex;
+    /** The number of records written. */
+    unsigned long mRecords;
+    /** The number of dropped frames. */
+    unsigned long mDroppedFrames;
+};
+
+/**
+ * Listener that forwards data of a talker to the journal as the given stream.
+ */
+template <typename T>
+class JournalTap : public GenericListener<T>
+{
+public:
+    /**
+     * Initialises the tap.
+     *  @param journal the journal to record data to.
+     *  @param stream the stream of the recorded data.
+     */
+    JournalTap(SessionJournal& journal, const E_JournalStream stream)
+    : GenericListener<T>(),
+      mJournal(journal),
+      mStream(stream)
+    {
+    }
+
+    /**
+     * Class destructor.
+     */
+    virtual ~JournalTap()
+    {
+    }
+
+    /**
+     * Records the data.
+     *  @param data the data from the talker.
+     */
+    void update(const T& data) override
+    {
+        if constexpr (std::is_same<T, DriveCommands>::value)
+        {
+            mJournal.record(mStream, data);
+        }
+        else
+        {
+            mJournal.record(data);
+        }
+    }
+
+private:
+    /** The journal to record data to. */
+    SessionJournal& mJournal;
+    /** The stream of the recorded data. */
+    E_JournalStream mStream;
+};
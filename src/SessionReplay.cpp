@@ -0,0 +1,226 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+#include "Logger.h"
+#include "SessionReplay.h"
+#include "Timing.h"
+
+namespace
+{
+/** The number of frame processing times kept. */
+constexpr size_t FRAME_SAMPLES = 100000;
+} // end of anonymouse namespace
+
+SessionReplay::SessionReplay(const std::string& path)
+: GenericTalker<GamepadEventData>(),
+  GenericTalker<CameraData>(),
+  GenericListener<DriveCommands>(),
+  mPath(path),
+  mJournal(nullptr),
+  mFrameStore(nullptr),
+  mCameraData(),
+  mGamepadEvents(0),
+  mFrames(0),
+  mSkippedFrames(0),
+  mComparisons(0),
+  mSteeringError(0.0),
+  mThrottleError(0.0),
+  mMaxSteeringError(0.0),
+  mPrediction(),
+  mHasPrediction(false),
+  mFrameStats(FRAME_SAMPLES),
+  mDuration(0.0),
+  mRecordedDuration(0.0)
+{
+}
+
+SessionReplay::~SessionReplay()
+{
+    if (mJournal)
+    {
+        fclose(mJournal);
+    }
+    if (mFrameStore)
+    {
+        fclose(mFrameStore);
+    }
+}
+
+bool SessionReplay::open()
+{
+    JournalHeader header;
+
+    mJournal = fopen(mPath.c_str(), "rb");
+    if (!mJournal || 1 != fread(&header, sizeof(header), 1, mJournal) || 
+        header.mMagic != JOURNAL_MAGIC || header.mVersion != JOURNAL_VERSION)
+    {
+        Logger::log(LOG_ERROR, "Failed to open journal %s", mPath);
+        return false;
+    }
+    mFrameStore = fopen((mPath + ".frames").c_str(), "rb");
+    return true;
+}
+
+void SessionReplay::run(const bool realTime, const int state)
+{
+    JournalRecord record;
+    JournalGamepad gamepad;
+    JournalFrame frame;
+    GamepadEventData eventData;
+    std::vector<uint8_t> payload;
+    int32_t recordedState = -1;
+    double firstTime = -1.0;
+    double startTime = getMonotonicTime();
+    double frameStart;
+    double delay;
+    float commands[2];
+
+    while (mJournal && 1 == fread(&record, sizeof(record), 1, mJournal))
+    {
+        if (firstTime < 0.0)
+        {
+            firstTime = record.mTime;
+        }
+        mRecordedDuration = record.mTime - firstTime;
+        if (realTime)
+        {
+            delay = mRecordedDuration - (getMonotonicTime() - startTime);
+            if (delay > 0.0)
+            {
+                usleep(static_cast<useconds_t>(delay * 1e6));
+            }
+        }
+
+        switch (record.mStream)
+        {
+            case JOURNAL_GAMEPAD:
+                if (record.mSize == sizeof(gamepad) && 1 == fread(&gamepad, sizeof(gamepad), 1, mJournal))
+                {
+                    eventData.mIsAxis = static_cast<bool>(gamepad.mIsAxis);
+                    eventData.mNumber = gamepad.mNumber;
+                    eventData.mValue = gamepad.mValue;
+                    ++mGamepadEvents;
+                    GenericTalker<GamepadEventData>::notifyListeners(eventData);
+                }
+                break;
+            case JOURNAL_CAMERA:
+                if (record.mSize < sizeof(frame) || 1 != fread(&frame, sizeof(frame), 1, mJournal))
+                {
+                    break;
+                }
+                if ((state < 0 || state == recordedState) && readFrame(frame))
+                {
+                    mHasPrediction = false;
+                    frameStart = getMonotonicTime();
+                    GenericTalker<CameraData>::notifyListeners(mCameraData);
+                    mFrameStats.addSample(getMonotonicTime() - frameStart);
+                    ++mFrames;
+                }
+                else
+                {
+                    ++mSkippedFrames;
+                    if (frame.mFrames == FRAMES_INLINE)
+                    {
+                        fseek(mJournal, static_cast<long>(record.mSize - sizeof(frame)), SEEK_CUR);
+                    }
+                }
+                break;
+            case JOURNAL_TORCH_DRIVE:
+                if (record.mSize == sizeof(commands) && 1 == fread(commands, sizeof(commands), 1, mJournal) && mHasPrediction)
+                {
+                    double steeringError = fabs(commands[0] - mPrediction.mSteering);
+                    mSteeringError += steeringError;
+                    mThrottleError += fabs(commands[1] - mPrediction.mThrottle);
+                    mMaxSteeringError = std::max(mMaxSteeringError, steeringError);
+                    ++mComparisons;
+                    mHasPrediction = false;
+                }
+                break;
+            case JOURNAL_STATE:
+                if (record.mSize == sizeof(recordedState) && 1 == fread(&recordedState, sizeof(recordedState), 1, mJournal))
+                {
+                    Logger::log(LOG_INFO, "Replaying state %d at %.3f s", recordedState, mRecordedDuration);
+                }
+                break;
+            default:
+                payload.resize(record.mSize);
+                if (record.mSize > 0 && 1 != fread(payload.data(), record.mSize, 1, mJournal))
+                {
+                    Logger::log(LOG_WARNING, "Truncated journal");
+                }
+                break;
+        }
+    }
+    mDuration = getMonotonicTime() - startTime;
+}
+
+void SessionReplay::update(const DriveCommands& driveCommands)
+{
+    mPrediction = driveCommands;
+    mHasPrediction = true;
+}
+
+void SessionReplay::printStatistics() const
+{
+    printf("Replay: %lu gamepad events and %lu frames (%lu skipped) of a %.1f s session replayed in %.1f s \n",
+           mGamepadEvents, mFrames, mSkippedFrames, mRecordedDuration, mDuration);
+    mFrameStats.print("Frame processing");
+    if (mComparisons > 0)
+    {
+        printf("Predicted vs recorded drive commands: %lu compared, mean steering error %.4f (max %.4f), mean throttle error %.4f \n",
+               mComparisons, mSteeringError / mComparisons, mMaxSteeringError, mThrottleError / mComparisons);
+    }
+}
+
+bool SessionReplay::readFrame(const JournalFrame& frame)
+{
+    size_t imageBytes = static_cast<size_t>(frame.mWidth) * frame.mHeight * CV_ELEM_SIZE(frame.mType);
+    FILE* source = (frame.mFrames == FRAMES_INLINE) ? mJournal : mFrameStore;
+
+    if (frame.mFrames == FRAMES_OFF || !source)
+    {
+        return false;
+    }
+    if (frame.mFrames == FRAMES_STORE && 0 != fseek(source, static_cast<long>(frame.mIndex * imageBytes * frame.mImages), SEEK_SET))
+    {
+        return false;
+    }
+
+    mCameraData.mImage.resize(frame.mImages);
+    for (int i = 0; i < frame.mImages; ++i)
+    {
+        if (mCameraData.mImage[i].rows != frame.mHeight || mCameraData.mImage[i].cols != frame.mWidth || mCameraData.mImage[i].type() != frame.mType)
+        {
+            mCameraData.mImage[i].create(frame.mHeight, frame.mWidth, frame.mType);
+        }
+        if (1 != fread(mCameraData.mImage[i].createMatHeader().data, imageBytes, 1, source))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <CameraData.h>
+#include <DriveCommands.h>
+#include <GamepadEventData.h>
+#include <GenericListener.h>
+#include <GenericTalker.h>
+#include "LatencyStats.h"
+#include "SessionJournal.h"
+
+/**
+ * Replays a session recorded by SessionJournal, either in real time or as fast as possible. Gamepad events are passed to
+ * registered gamepad listeners and camera frames to registered camera listeners, e.g. CameraDriveAdapter. Frames are routed
+ * according to the recorded state transitions, i.e., by default only frames captured in the ML state are replayed.
+ * Drive commands predicted by the model are compared with the recorded ones, and the time of processing each frame is measured,
+ * which allows end-to-end comparisons of builds using real laps.
+ */
+class SessionReplay : public GenericTalker<GamepadEventData>,
+                      public GenericTalker<CameraData>,
+                      public GenericListener<DriveCommands>
+{
+public:
+    /**
+     * Initialises the replay.
+     *  @param path the path to the journal file.
+     */
+    explicit SessionReplay(const std::string& path);
+
+    /**
+     * Closes files.
+     */
+    virtual ~SessionReplay();
+
+    /**
+     * Opens the journal, and the frame store if it exists.
+     *  @return true if the journal was opened.
+     */
+    bool open();
+
+    /**
+     * Replays the whole journal.
+     *  @param realTime true to keep the recorded timing, false to replay as fast as possible.
+     *  @param state frames are replayed only when this state was active, -1 for all frames.
+     */
+    void run(const bool realTime, const int state);
+
+    /**
+     * Receives drive commands predicted for a replayed frame.
+     *  @param driveCommands the predicted drive commands.
+     */
+    void update(const DriveCommands& driveCommands) override;
+
+    /**
+     * Prints the number of replayed events, processing time of frames and differences between predicted and recorded drive commands.
+     */
+    void printStatistics() const;
+
+private:
+    /**
+     * Reads image data of a frame into the camera data buffers.
+     *  @param frame the description of the frame.
+     *  @return true if the images were read.
+     */
+    bool readFrame(const JournalFrame& frame);
+
+    /** The path to the journal file. */
+    std::string mPath;
+    /** The journal file. */
+    FILE* mJournal;
+    /** The frame store file, nullptr if there is none. */
+    FILE* mFrameStore;
+    /** Buffers of the replayed frame. */
+    CameraData mCameraData;
+    /** The number of replayed gamepad events. */
+    unsigned long mGamepadEvents;
+    /** The number of replayed frames. */
+    unsigned long mFrames;
+    /** The number of frames that were not replayed because of the state or missing image data. */
+    unsigned long mSkippedFrames;
+    /** The number of compared drive commands. */
+    unsigned long mComparisons;
+    /** The sum of absolute differences of steering. */
+    double mSteeringError;
+    /** The sum of absolute differences of throttle. */
+    double mThrottleError;
+    /** The maximum absolute difference of steering. */
+    double mMaxSteeringError;
+    /** The last predicted drive commands. */
+    DriveCommands mPrediction;
+    /** Flag indicating that drive commands were predicted for the last frame and not yet compared. */
+    bool mHasPrediction;
+    /** Time of processing replayed frames. */
+    LatencyStats mFrameStats;
+    /** The time of replaying the whole journal in seconds. */
+    double mDuration;
+    /** The recorded duration of the session in seconds. */
+    double mRecordedDuration;
+};
@@ -0,0 +1,414 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include "Configuration.h"
+#include "Settings.h"
+
+namespace
+{
+/** Keys whose values can be changed while running, see Settings::applyReloadable(). */
+const char* RELOADABLE_KEYS[] = {"steeringGain", "steeringOffset", "throttleGain", "intraOpThreads",
+                                 "tta", "ttaSteeringThreshold", "ttaChangeThreshold", "ttaTimeBudget"};
+
+/**
+ * Reports a value that was parsed but is out of range.
+ *  @param valid true if the value is in range.
+ *  @param key the key.
+ *  @param expected description of the range.
+ *  @return @p valid.
+ */
+bool check(const bool valid, const char* key, const char* expected)
+{
+    if (!valid)
+    {
+        printf("Configuration key %s is out of range, expected %s \n", key, expected);
+    }
+    return valid;
+}
+
+/**
+ * Parses and validates a comma separated list of numbers, empty elements are ignored.
+ *  @param config the configuration.
+ *  @param key the key.
+ *  @param integral true if the numbers have to be non-negative integers.
+ *  @param values the parsed numbers.
+ *  @return true if the key is present and all numbers are valid.
+ */
+bool parseList(const Configuration& config, const char* key, const bool integral, std::vector<double>& values)
+{
+    std::string list;
+    values.clear();
+    if (!config.getValue(key, list))
+    {
+        return false;
+    }
+    std::stringstream stream(list);
+    std::string element;
+    while (std::getline(stream, element, ','))
+    {
+        size_t parsed = 0;
+        double value = 0.0;
+        try
+        {
+            if (integral)
+            {
+                // negative CPUs are rejected like other non-negative integers
+                value = std::stoi(element, &parsed);
+                parsed = (value < 0.0) ? 0 : parsed;
+            }
+            else
+            {
+                value = std::stod(element, &parsed);
+            }
+        }
+        catch (const std::logic_error&)
+        {
+            parsed = 0;
+        }
+        if (!element.empty() && parsed != element.size())
+        {
+            printf("Configuration key %s has invalid value '%s', expected %s \n", key, list.c_str(),
+                   integral ? "comma separated non-negative integers" : "comma separated numbers");
+            values.clear();
+            return false;
+        }
+        if (!element.empty())
+        {
+            values.push_back(value);
+        }
+    }
+    return true;
+}
+
+/**
+ * Parses and validates a comma separated list of non-negative integers, empty elements are ignored.
+ *  @param config the configuration.
+ *  @param key the key.
+ *  @param values the parsed integers.
+ *  @return true if the key is present and all integers are valid.
+ */
+bool parseList(const Configuration& config, const char* key, std::vector<int>& values)
+{
+    std::vector<double> numbers;
+    bool retVal = parseList(config, key, true, numbers);
+    values.clear();
+    for (double number : numbers)
+    {
+        values.push_back(static_cast<int>(number));
+    }
+    return retVal;
+}
+
+/**
+ * Parses and validates lower resolution models listed as path@[width]x[height]@[throttle] separated by commas.
+ *  @param config the configuration.
+ *  @param models the parsed models.
+ *  @return true if the key is present and all models are valid.
+ */
+bool parseResolutionModels(const Configuration& config, std::vector<ResolutionModel>& models)
+{
+    std::string list;
+    models.clear();
+    if (!config.getValue("resolutionModels", list))
+    {
+        return false;
+    }
+    std::stringstream stream(list);
+    std::string element;
+    char path[256];
+    ResolutionModel model;
+    while (std::getline(stream, element, ','))
+    {
+        if (element.empty())
+        {
+            continue;
+        }
+        if (4 != sscanf(element.c_str(), "%255[^@]@%dx%d@%f", path, &model.mWidth, &model.mHeight, &model.mThrottle) ||
+            model.mWidth <= 0 || model.mHeight <= 0)
+        {
+            printf("Configuration key resolutionModels has invalid model '%s', expected path@[width]x[height]@[throttle] \n", element.c_str());
+            models.clear();
+            return false;
+        }
+        model.mPath = path;
+        models.push_back(model);
+    }
+    return true;
+}
+} // end of anonymouse namespace
+
+Settings::Settings()
+: mSteeringAxis(0),
+  mThrottleAxis(0),
+  mStatePageAxis(0),
+  mStopButton(0),
+  mStateConfButton(0),
+  mRcOverrideButton(0),
+  mSteeringGain(0.0f),
+  mSteeringOffset(0.0f),
+  mThrottleGain(0.0f),
+  mIsMono(false),
+  mMonoId(0),
+  mWidth(0),
+  mHeight(0),
+  mFramerate(0),
+  mRectificationCache(false),
+  mTta(TTA_OFF),
+  mTtaSteeringThreshold(0.0f),
+  mTtaChangeThreshold(0.0f),
+  mTtaTimeBudget(0.0),
+  mIntraOpThreads(0),
+  mInterOpThreads(0),
+  mPreloadModel(false),
+  mPreloadCamera(false),
+  mCameraStandby(false),
+  mProcessSplit(false),
+  mTaskPoolThreads(0),
+  mTaskPoolPinned(false),
+  mImuEnabled(false),
+  mMetricsEnabled(false),
+  mJournalEnabled(false),
+  mJournalQueue(0),
+  mGovernorEnabled(false),
+  mGovernorFrameDivider(0),
+  mSaverQuality(0),
+  mGovernorSaverQuality(0),
+  mPreviewEnabled(false),
+  mOledAddress(0),
+  mOledMaxWait(0),
+  mConfigReload(false),
+  mEmergencyStopPriority(0),
+  mResolutionHysteresis(0.0f),
+  mResolutionLatencyBudget(0.0),
+  mSkipThreshold(0.0),
+  mSkipMaxFrames(0),
+  mInferenceInstances(0),
+  mShadowThreads(0),
+  mShadowDivergenceThreshold(0.0f),
+  mTuneIterations(0),
+  mFrameRingSlots(0),
+  mRemoteTimeout(0.0),
+  mInferenceNice(0),
+  mRecorderNice(0),
+  mImuAddress(0),
+  mImuRate(0.0),
+  mImuYawSign(0.0),
+  mEstimatorYawRateGain(0.0),
+  mEstimatorCorrectionGain(0.0),
+  mEstimatorRate(0.0),
+  mEstimatorTimeout(0.0),
+  mMetricsPort(0),
+  mGovernorHysteresis(0.0),
+  mGovernorMinFrequency(0.0),
+  mGovernorPeriod(0.0),
+  mSelectionMinDifference(0.0),
+  mSelectionMinPerBin(0),
+  mSelectionMaxPerBin(0),
+  mSelectionSteeringBins(0),
+  mSelectionThrottleBins(0),
+  mPreviewPort(0),
+  mPreviewRate(0.0),
+  mPreviewScale(0.0),
+  mPreviewQuality(0),
+  mGamepadDevice(),
+  mImuDevice(),
+  mCalibration(),
+  mRectificationCacheFolder(),
+  mInferencePlugin(),
+  mModel(),
+  mOptimiseModel(false),
+  mOnnxModel(),
+  mBackend(),
+  mResolutionModels(),
+  mInferenceInstancesPinned(false),
+  mShadowModel(),
+  mShadowLog(),
+  mTuneFrames(),
+  mFrameRingName(),
+  mInferenceCpus(),
+  mRecorderCpus(),
+  mImuReplay(),
+  mImuRecord(),
+  mMetricsAddress(),
+  mGovernorTemperatures(),
+  mGovernorSysfsRoot(),
+  mGovernorGpuPath(),
+  mOverlay(),
+  mFrameSelection(false),
+  mPreviewHost()
+{
+}
+
+bool Settings::parse(const Configuration& config)
+{
+    std::string tta;
+    bool retVal = true;
+    // every key is parsed even after a failure, so that all problems are reported at once
+    retVal = config.getValue("steeringAxis", mSteeringAxis) && retVal;
+    retVal = config.getValue("throttleAxis", mThrottleAxis) && retVal;
+    retVal = config.getValue("statePageAxis", mStatePageAxis) && retVal;
+    retVal = config.getValue("gamepadDevice", mGamepadDevice) && retVal;
+    retVal = config.getValue("stopButton", mStopButton) && retVal;
+    retVal = config.getValue("stateConfButton", mStateConfButton) && retVal;
+    retVal = config.getValue("rcOverrideButton", mRcOverrideButton) && retVal;
+    retVal = config.getValue("steeringGain", mSteeringGain) && retVal;
+    retVal = config.getValue("steeringOffset", mSteeringOffset) && retVal;
+    retVal = config.getValue("throttleGain", mThrottleGain) && retVal;
+    retVal = config.getValue("isMono", mIsMono) && retVal;
+    retVal = config.getValue("monoID", mMonoId) && retVal;
+    retVal = config.getValue("width", mWidth) && check(mWidth > 0, "width", "a positive number") && retVal;
+    retVal = config.getValue("height", mHeight) && check(mHeight > 0, "height", "a positive number") && retVal;
+    retVal = config.getValue("framerate", mFramerate) && check(mFramerate > 0, "framerate", "a positive number") && retVal;
+    retVal = config.getValue("calibration", mCalibration) && retVal;
+    retVal = config.getValue("rectificationCache", mRectificationCache) && retVal;
+    retVal = config.getValue("rectificationCacheFolder", mRectificationCacheFolder) && retVal;
+    retVal = config.getValue("inferencePlugin", mInferencePlugin) && retVal;
+    retVal = config.getValue("model", mModel) && retVal;
+    retVal = config.getValue("optimiseModel", mOptimiseModel) && retVal;
+    retVal = config.getValue("onnxModel", mOnnxModel) && retVal;
+    retVal = config.getValue("backend", mBackend) &&
+             check(mBackend == "auto" || mBackend == "torch" || mBackend == "opencv", "backend", "auto, torch or opencv") && retVal;
+    retVal = parseResolutionModels(config, mResolutionModels) && retVal;
+    if (config.getValue("tta", tta))
+    {
+        retVal = check(Configuration::isBool(tta) || tta == "adaptive" || tta == "Adaptive", "tta", "false, true or adaptive") && retVal;
+        mTta = strToTtaMode(tta);
+    }
+    else
+    {
+        retVal = false;
+    }
+    retVal = config.getValue("ttaSteeringThreshold", mTtaSteeringThreshold) && retVal;
+    retVal = config.getValue("ttaChangeThreshold", mTtaChangeThreshold) && retVal;
+    retVal = config.getValue("ttaTimeBudget", mTtaTimeBudget) && check(mTtaTimeBudget >= 0.0, "ttaTimeBudget", "a non-negative number") && retVal;
+    mTtaTimeBudget /= 1000.0;
+    retVal = config.getValue("intraOpThreads", mIntraOpThreads) && check(mIntraOpThreads >= 0, "intraOpThreads", "a non-negative number") && retVal;
+    retVal = config.getValue("interOpThreads", mInterOpThreads) && check(mInterOpThreads >= 0, "interOpThreads", "a non-negative number") && retVal;
+    retVal = config.getValue("preloadModel", mPreloadModel) && retVal;
+    retVal = config.getValue("preloadCamera", mPreloadCamera) && retVal;
+    retVal = config.getValue("cameraStandby", mCameraStandby) && retVal;
+    retVal = config.getValue("processSplit", mProcessSplit) && retVal;
+    retVal = config.getValue("taskPoolThreads", mTaskPoolThreads) && retVal;
+    retVal = config.getValue("taskPoolPinned", mTaskPoolPinned) && retVal;
+    retVal = config.getValue("imuEnabled", mImuEnabled) && retVal;
+    retVal = config.getValue("metricsEnabled", mMetricsEnabled) && retVal;
+    retVal = config.getValue("journalEnabled", mJournalEnabled) && retVal;
+    retVal = config.getValue("journalQueue", mJournalQueue) && retVal;
+    retVal = config.getValue("governorEnabled", mGovernorEnabled) && retVal;
+    retVal = config.getValue("governorFrameDivider", mGovernorFrameDivider) && check(mGovernorFrameDivider > 0, "governorFrameDivider", "a positive number") && retVal;
+    retVal = config.getValue("saverQuality", mSaverQuality) && check(mSaverQuality >= 0 && mSaverQuality <= 100, "saverQuality", "0 to 100") && retVal;
+    retVal = config.getValue("governorSaverQuality", mGovernorSaverQuality) &&
+             check(mGovernorSaverQuality >= 0 && mGovernorSaverQuality <= 100, "governorSaverQuality", "0 to 100") && retVal;
+    retVal = config.getValue("previewEnabled", mPreviewEnabled) && retVal;
+    retVal = config.getValue("oledAddress", mOledAddress, 0) && retVal;
+    retVal = config.getValue("oledMaxWait", mOledMaxWait) && retVal;
+    retVal = config.getValue("overlay", mOverlay) && retVal;
+    retVal = config.getValue("configReload", mConfigReload) && retVal;
+    retVal = config.getValue("emergencyStopPriority", mEmergencyStopPriority) &&
+             check(mEmergencyStopPriority >= 0 && mEmergencyStopPriority <= 99, "emergencyStopPriority", "0 to 99") && retVal;
+    retVal = config.getValue("resolutionHysteresis", mResolutionHysteresis) &&
+             check(mResolutionHysteresis >= 0.0f, "resolutionHysteresis", "a non-negative number") && retVal;
+    retVal = config.getValue("resolutionLatencyBudget", mResolutionLatencyBudget) &&
+             check(mResolutionLatencyBudget >= 0.0, "resolutionLatencyBudget", "a non-negative number") && retVal;
+    mResolutionLatencyBudget /= 1000.0;
+    retVal = config.getValue("skipThreshold", mSkipThreshold) && check(mSkipThreshold >= 0.0, "skipThreshold", "a non-negative number") && retVal;
+    retVal = config.getValue("skipMaxFrames", mSkipMaxFrames) && retVal;
+    retVal = config.getValue("inferenceInstances", mInferenceInstances) &&
+             check(mInferenceInstances > 0, "inferenceInstances", "a positive number") && retVal;
+    retVal = config.getValue("inferenceInstancesPinned", mInferenceInstancesPinned) && retVal;
+    retVal = config.getValue("shadowModel", mShadowModel) && retVal;
+    retVal = config.getValue("shadowThreads", mShadowThreads) && check(mShadowThreads > 0, "shadowThreads", "a positive number") && retVal;
+    retVal = config.getValue("shadowDivergenceThreshold", mShadowDivergenceThreshold) &&
+             check(mShadowDivergenceThreshold >= 0.0f, "shadowDivergenceThreshold", "a non-negative number") && retVal;
+    retVal = config.getValue("shadowLog", mShadowLog) && retVal;
+    retVal = config.getValue("tuneIterations", mTuneIterations) && check(mTuneIterations > 0, "tuneIterations", "a positive number") && retVal;
+    retVal = config.getValue("tuneFrames", mTuneFrames) && retVal;
+    retVal = config.getValue("frameRingName", mFrameRingName) && retVal;
+    retVal = config.getValue("frameRingSlots", mFrameRingSlots) && check(mFrameRingSlots >= 3, "frameRingSlots", "at least 3") && retVal;
+    retVal = config.getValue("remoteTimeout", mRemoteTimeout) && check(mRemoteTimeout > 0.0, "remoteTimeout", "a positive number") && retVal;
+    retVal = parseList(config, "inferenceCpus", mInferenceCpus) && retVal;
+    retVal = config.getValue("inferenceNice", mInferenceNice) && check(mInferenceNice >= -20 && mInferenceNice <= 19, "inferenceNice", "-20 to 19") && retVal;
+    retVal = parseList(config, "recorderCpus", mRecorderCpus) && retVal;
+    retVal = config.getValue("recorderNice", mRecorderNice) && check(mRecorderNice >= -20 && mRecorderNice <= 19, "recorderNice", "-20 to 19") && retVal;
+    retVal = config.getValue("imuDevice", mImuDevice) && retVal;
+    retVal = config.getValue("imuAddress", mImuAddress, 0) && retVal;
+    retVal = config.getValue("imuRate", mImuRate) && check(mImuRate > 0.0, "imuRate", "a positive number") && retVal;
+    retVal = config.getValue("imuReplay", mImuReplay) && retVal;
+    retVal = config.getValue("imuRecord", mImuRecord) && retVal;
+    retVal = config.getValue("imuYawSign", mImuYawSign) && check(mImuYawSign == 1.0 || mImuYawSign == -1.0, "imuYawSign", "1 or -1") && retVal;
+    retVal = config.getValue("estimatorYawRateGain", mEstimatorYawRateGain) && retVal;
+    retVal = config.getValue("estimatorCorrectionGain", mEstimatorCorrectionGain) && retVal;
+    retVal = config.getValue("estimatorRate", mEstimatorRate) && check(mEstimatorRate > 0.0, "estimatorRate", "a positive number") && retVal;
+    retVal = config.getValue("estimatorTimeout", mEstimatorTimeout) && check(mEstimatorTimeout > 0.0, "estimatorTimeout", "a positive number") && retVal;
+    retVal = config.getValue("metricsAddress", mMetricsAddress) && retVal;
+    retVal = config.getValue("metricsPort", mMetricsPort) && check(mMetricsPort > 0 && mMetricsPort <= 65535, "metricsPort", "1 to 65535") && retVal;
+    retVal = parseList(config, "governorTemperatures", false, mGovernorTemperatures) && retVal;
+    retVal = config.getValue("governorHysteresis", mGovernorHysteresis) &&
+             check(mGovernorHysteresis >= 0.0, "governorHysteresis", "a non-negative number") && retVal;
+    retVal = config.getValue("governorMinFrequency", mGovernorMinFrequency) &&
+             check(mGovernorMinFrequency >= 0.0 && mGovernorMinFrequency <= 1.0, "governorMinFrequency", "0 to 1") && retVal;
+    retVal = config.getValue("governorPeriod", mGovernorPeriod) && check(mGovernorPeriod > 0.0, "governorPeriod", "a positive number") && retVal;
+    retVal = config.getValue("governorSysfsRoot", mGovernorSysfsRoot) && retVal;
+    retVal = config.getValue("governorGpuPath", mGovernorGpuPath) && retVal;
+    retVal = config.getValue("frameSelection", mFrameSelection) && retVal;
+    retVal = config.getValue("selectionMinDifference", mSelectionMinDifference) &&
+             check(mSelectionMinDifference >= 0.0, "selectionMinDifference", "a non-negative number") && retVal;
+    retVal = config.getValue("selectionMinPerBin", mSelectionMinPerBin) && retVal;
+    retVal = config.getValue("selectionMaxPerBin", mSelectionMaxPerBin) && retVal;
+    retVal = config.getValue("selectionSteeringBins", mSelectionSteeringBins) &&
+             check(mSelectionSteeringBins > 0, "selectionSteeringBins", "a positive number") && retVal;
+    retVal = config.getValue("selectionThrottleBins", mSelectionThrottleBins) &&
+             check(mSelectionThrottleBins > 0, "selectionThrottleBins", "a positive number") && retVal;
+    retVal = config.getValue("previewHost", mPreviewHost) && retVal;
+    retVal = config.getValue("previewPort", mPreviewPort) && check(mPreviewPort > 0 && mPreviewPort <= 65535, "previewPort", "1 to 65535") && retVal;
+    retVal = config.getValue("previewRate", mPreviewRate) && check(mPreviewRate > 0.0, "previewRate", "a positive number") && retVal;
+    retVal = config.getValue("previewScale", mPreviewScale) && check(mPreviewScale > 0.0 && mPreviewScale <= 1.0, "previewScale", "0 to 1") && retVal;
+    retVal = config.getValue("previewQuality", mPreviewQuality) &&
+             check(mPreviewQuality >= 0 && mPreviewQuality <= 100, "previewQuality", "0 to 100") && retVal;
+    return retVal;
+}
+
+void Settings::applyReloadable(const Settings& other)
+{
+    mSteeringGain = other.mSteeringGain;
+    mSteeringOffset = other.mSteeringOffset;
+    mThrottleGain = other.mThrottleGain;
+    mIntraOpThreads = other.mIntraOpThreads;
+    mTta = other.mTta;
+    mTtaSteeringThreshold = other.mTtaSteeringThreshold;
+    mTtaChangeThreshold = other.mTtaChangeThreshold;
+    mTtaTimeBudget = other.mTtaTimeBudget;
+}
+
+bool Settings::isReloadable(const std::string& key)
+{
+    for (const char* reloadable : RELOADABLE_KEYS)
+    {
+        if (key == reloadable)
+        {
+            return true;
+        }
+    }
+    return false;
+}
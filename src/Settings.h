@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <string>
+#include <vector>
+#include "E_TtaMode.h"
+
+class Configuration;
+
+/**
+ * A lower resolution model used from a throttle, listed as path@[width]x[height]@[throttle] in resolutionModels.
+ */
+struct ResolutionModel
+{
+    /** Path to the TorchScript or ONNX model. */
+    std::string mPath;
+    /** Width of a single input image. */
+    int mWidth;
+    /** Height of a single input image. */
+    int mHeight;
+    /** The absolute throttle from which the model is used. */
+    float mThrottle;
+};
+
+/**
+ * Typed values of the configuration used by the application, parsed and validated once when the configuration is
+ * loaded. Components are created from these values rather than from the configuration, so every value is parsed in
+ * one place and known to be valid before any component is created. Values that are safe to change while the car is
+ * running (racer gains, libtorch threads and test time augmentations) can be replaced by a reloaded configuration,
+ * see ConfigWatcher.
+ */
+struct Settings
+{
+    /**
+     * Basic constructor, values are set by parse().
+     */
+    Settings();
+
+    /**
+     * Parses and validates values of the configuration. Every missing key and invalid value is reported.
+     *  @param config the configuration.
+     *  @return true if all values are valid.
+     */
+    bool parse(const Configuration& config);
+
+    /**
+     * Replaces values that can be changed while running with values of other settings.
+     *  @param other the settings with new values.
+     */
+    void applyReloadable(const Settings& other);
+
+    /**
+     *  @param key a configuration key.
+     *  @return true if the value of the key can be changed while running.
+     */
+    static bool isReloadable(const std::string& key);
+
+    /** Gamepad axis of steering. */
+    int mSteeringAxis;
+    /** Gamepad axis of throttle. */
+    int mThrottleAxis;
+    /** Gamepad axis that pages through states. */
+    int mStatePageAxis;
+    /** Gamepad button of the emergency stop. */
+    int mStopButton;
+    /** Gamepad button that confirms the selected state. */
+    int mStateConfButton;
+    /** Gamepad button that enables state changes. */
+    int mRcOverrideButton;
+    /** Steering gain of the racer. */
+    float mSteeringGain;
+    /** Steering offset of the racer. */
+    float mSteeringOffset;
+    /** Throttle gain of the racer. */
+    float mThrottleGain;
+    /** Flag indicating a mono camera. */
+    bool mIsMono;
+    /** Sensor ID of the mono camera. */
+    int mMonoId;
+    /** Width of camera images. */
+    int mWidth;
+    /** Height of camera images. */
+    int mHeight;
+    /** Camera framerate in Hz. */
+    int mFramerate;
+    /** Flag indicating that stereo images are rectified with cached maps. */
+    bool mRectificationCache;
+    /** The test time augmentations mode. */
+    E_TtaMode mTta;
+    /** Absolute steering above which the adaptive TTA processes the flipped image. */
+    float mTtaSteeringThreshold;
+    /** Absolute change of steering above which the adaptive TTA processes the flipped image. */
+    float mTtaChangeThreshold;
+    /** Time budget in seconds per frame within which the adaptive TTA always processes the flipped image. */
+    double mTtaTimeBudget;
+    /** libtorch threads used within an operation, 0 for libtorch default. */
+    int mIntraOpThreads;
+    /** libtorch threads used to run independent operations, 0 for libtorch default. */
+    int mInterOpThreads;
+    /** Flag indicating that the model is loaded at startup. */
+    bool mPreloadModel;
+    /** Flag indicating that the camera is started at startup. */
+    bool mPreloadCamera;
+    /** Flag indicating that the camera is paused instead of stopped in RC state. */
+    bool mCameraStandby;
+    /** Flag indicating that inference and recording run in worker processes. */
+    bool mProcessSplit;
+    /** Threads of the task pool, 0 for one per core. */
+    unsigned long mTaskPoolThreads;
+    /** Flag indicating that workers of the task pool are pinned to cores. */
+    bool mTaskPoolPinned;
+    /** Flag indicating that the IMU is sampled. */
+    bool mImuEnabled;
+    /** Flag indicating that metrics are served. */
+    bool mMetricsEnabled;
+    /** Flag indicating that sessions are journalled. */
+    bool mJournalEnabled;
+    /** Capacity of the journal queue. */
+    unsigned long mJournalQueue;
+    /** Flag indicating that the performance governor runs. */
+    bool mGovernorEnabled;
+    /** Frame divider applied by the governor. */
+    unsigned long mGovernorFrameDivider;
+    /** JPEG quality of saved images. */
+    int mSaverQuality;
+    /** JPEG quality of saved images applied by the governor. */
+    int mGovernorSaverQuality;
+    /** Flag indicating that the preview is streamed. */
+    bool mPreviewEnabled;
+    /** I2C address of the OLED display. */
+    int mOledAddress;
+    /** Maximum wait of the OLED display. */
+    int mOledMaxWait;
+    /** Flag indicating that the configuration is reloaded when its file changes. */
+    bool mConfigReload;
+    /** Real-time priority of the emergency stop thread, 0 for default scheduling. */
+    int mEmergencyStopPriority;
+    /** Relative latency margin before a higher resolution model is selected again. */
+    float mResolutionHysteresis;
+    /** Latency budget in seconds per frame of a model, 0 for the camera frame period. */
+    double mResolutionLatencyBudget;
+    /** Mean grey-level difference below which inference is skipped, 0 to disable. */
+    double mSkipThreshold;
+    /** Maximum number of consecutive skipped frames. */
+    unsigned long mSkipMaxFrames;
+    /** Number of model instances run in turn. */
+    int mInferenceInstances;
+    /** Threads of the shadow model. */
+    int mShadowThreads;
+    /** Steering or throttle difference above which the shadow model diverges. */
+    float mShadowDivergenceThreshold;
+    /** Iterations of each setting measured by the tuner. */
+    unsigned long mTuneIterations;
+    /** Number of slots of the shared frame ring. */
+    unsigned long mFrameRingSlots;
+    /** Time in seconds after which a result of the remote model is stale. */
+    double mRemoteTimeout;
+    /** Nice value of the inference worker process. */
+    int mInferenceNice;
+    /** Nice value of the recorder worker process. */
+    int mRecorderNice;
+    /** I2C address of the IMU. */
+    int mImuAddress;
+    /** IMU sampling rate in Hz. */
+    double mImuRate;
+    /** Sign of the IMU yaw rate with respect to positive steering. */
+    double mImuYawSign;
+    /** Gain from yaw rate to steering of the estimator. */
+    double mEstimatorYawRateGain;
+    /** Gain of the correction of the estimator with measured steering. */
+    double mEstimatorCorrectionGain;
+    /** Estimator rate in Hz. */
+    double mEstimatorRate;
+    /** Time in seconds after which the estimator stops without drive commands. */
+    double mEstimatorTimeout;
+    /** Port of the metrics server. */
+    int mMetricsPort;
+    /** Temperature hysteresis of the governor in degrees Celsius. */
+    double mGovernorHysteresis;
+    /** Frequency ratio below which the governor treats the board as throttled. */
+    double mGovernorMinFrequency;
+    /** Period of the governor in seconds. */
+    double mGovernorPeriod;
+    /** Minimum mean grey-level difference of a novel frame. */
+    double mSelectionMinDifference;
+    /** Number of frames below which a steering-throttle bin is under-represented. */
+    unsigned long mSelectionMinPerBin;
+    /** Maximum number of frames per steering-throttle bin, 0 for no limit. */
+    unsigned long mSelectionMaxPerBin;
+    /** Number of steering bins of the frame selector. */
+    int mSelectionSteeringBins;
+    /** Number of throttle bins of the frame selector. */
+    int mSelectionThrottleBins;
+    /** UDP port of the preview. */
+    int mPreviewPort;
+    /** Maximum number of preview frames per second. */
+    double mPreviewRate;
+    /** Scale of preview images with respect to camera images. */
+    double mPreviewScale;
+    /** JPEG quality of preview images. */
+    int mPreviewQuality;
+    /** Path to the gamepad device. */
+    std::string mGamepadDevice;
+    /** Path to the I2C device of the IMU. */
+    std::string mImuDevice;
+    /** Path to the folder with stereo calibration files. */
+    std::string mCalibration;
+    /** Path to the folder with cached rectification maps. */
+    std::string mRectificationCacheFolder;
+    /** Path to the inference plugin. */
+    std::string mInferencePlugin;
+    /** Path to the TorchScript model. */
+    std::string mModel;
+    /** Flag indicating that the TorchScript model is frozen and optimised. */
+    bool mOptimiseModel;
+    /** Path to the ONNX model, empty if there is none. */
+    std::string mOnnxModel;
+    /** The inference backend: torch, opencv or auto. */
+    std::string mBackend;
+    /** Lower resolution models used when driving fast. */
+    std::vector<ResolutionModel> mResolutionModels;
+    /** Flag indicating that model instances are pinned to cores. */
+    bool mInferenceInstancesPinned;
+    /** Path to the shadow model, empty to disable it. */
+    std::string mShadowModel;
+    /** Path to the log of divergent frames of the shadow model, empty to disable it. */
+    std::string mShadowLog;
+    /** Path to the folder with frames used by the tuner, empty for synthetic frames. */
+    std::string mTuneFrames;
+    /** Name of the shared memory object of the frame ring. */
+    std::string mFrameRingName;
+    /** CPUs of the inference worker process, empty for any. */
+    std::vector<int> mInferenceCpus;
+    /** CPUs of the recorder worker process, empty for any. */
+    std::vector<int> mRecorderCpus;
+    /** Path to a recording of IMU samples replayed instead of the device, empty for the device. */
+    std::string mImuReplay;
+    /** Path to which IMU samples are recorded, empty to disable recording. */
+    std::string mImuRecord;
+    /** Address to which the metrics server binds. */
+    std::string mMetricsAddress;
+    /** Temperatures in degrees Celsius at which the governor steps up performance levels. */
+    std::vector<double> mGovernorTemperatures;
+    /** Root of sysfs read by the governor. */
+    std::string mGovernorSysfsRoot;
+    /** Path of the GPU devfreq node relative to the sysfs root. */
+    std::string mGovernorGpuPath;
+    /** Path to the configuration overlay. */
+    std::string mOverlay;
+    /** Flag indicating that the data saver keeps only novel and under-represented frames. */
+    bool mFrameSelection;
+    /** Host to which the preview is streamed. */
+    std::string mPreviewHost;
+};
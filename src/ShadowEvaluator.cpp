@@ -0,0 +1,230 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <ATen/Parallel.h>
+#include <ScopedLock.h>
+#include "BackendSelector.h"
+#include "Logger.h"
+#include "Settings.h"
+#include "ShadowEvaluator.h"
+#include "Timing.h"
+
+namespace
+{
+/** The period in seconds after which an idle shadow thread checks whether it should stop. */
+constexpr double SHADOW_TIMEOUT = 0.1;
+/** The number of first frames of the candidate, which are slower, excluded from latency. */
+constexpr unsigned long WARM_UP_FRAMES = 3;
+/** The weight of the latest sample in the moving average of latency. */
+constexpr double LATENCY_SMOOTHING = 0.2;
+/** The number of latency samples kept. */
+constexpr size_t LATENCY_SAMPLES = 10000;
+} // end of anonymouse namespace
+
+ShadowEvaluator::ShadowEvaluator()
+: GenericThread<ShadowEvaluator>(),
+  mAdapter(),
+  mImages(),
+  mPrimaryCommands(),
+  mPrimaryLatency(0.0),
+  mBusy(false),
+  mLatency(0.0),
+  mThreads(1),
+  mDivergenceThreshold(0.2f),
+  mLog(nullptr),
+  mStartTime(0.0),
+  mFrames(0),
+  mSkippedFrames(0),
+  mSteeringDifference(0.0),
+  mThrottleDifference(0.0),
+  mMaxSteeringDifference(0.0),
+  mDivergedFrames(0),
+  mStats(LATENCY_SAMPLES)
+{
+    pthread_mutex_init(&mStatsMutex, nullptr);
+}
+
+ShadowEvaluator::~ShadowEvaluator()
+{
+    stopThread(false);
+    if (isEnabled())
+    {
+        printStatistics();
+    }
+    if (mLog)
+    {
+        fclose(mLog);
+    }
+    pthread_mutex_destroy(&mStatsMutex);
+}
+
+bool ShadowEvaluator::initialise(const Settings& settings)
+{
+    const std::string& model = settings.mShadowModel;
+    if (model.empty() || isEnabled())
+    {
+        return isEnabled();
+    }
+
+    // the candidate is loaded as a model of the primary's resolution, with the same backend and augmentations
+    const cv::Size imageSize(settings.mWidth, settings.mHeight);
+    const bool isOnnx = model.size() > 5 && model.compare(model.size() - 5, 5, ".onnx") == 0;
+    BackendSelector selector(isOnnx ? "" : model, isOnnx ? model : "", imageSize, settings.mIsMono, settings.mOptimiseModel);
+    mAdapter.initialise(selector.select(isOnnx ? "opencv" : settings.mBackend, settings.mTta == TTA_ALWAYS), settings.mTta);
+    if (!isEnabled())
+    {
+        Logger::log(LOG_ERROR, "Failed to load shadow model %s", model);
+        return false;
+    }
+    mAdapter.setAdaptiveTta(settings.mTtaSteeringThreshold, settings.mTtaChangeThreshold, settings.mTtaTimeBudget);
+    mThreads = std::max(1, settings.mShadowThreads);
+    mDivergenceThreshold = settings.mShadowDivergenceThreshold;
+
+    const std::string& log = settings.mShadowLog;
+    if (!log.empty())
+    {
+        mLog = fopen(log.c_str(), "w");
+        if (mLog)
+        {
+            fprintf(mLog, "time,primary_steering,primary_throttle,primary_latency_ms,shadow_steering,shadow_throttle,shadow_latency_ms\n");
+        }
+        else
+        {
+            Logger::log(LOG_WARNING, "Failed to open shadow log %s", log);
+        }
+    }
+
+    startThread();
+    Logger::log(LOG_INFO, "Evaluating shadow model %s", model);
+    return true;
+}
+
+void ShadowEvaluator::setTtaMode(const E_TtaMode tta)
+{
+    mAdapter.setTtaMode(tta);
+}
+
+void ShadowEvaluator::setAdaptiveTta(const float steeringThreshold, const float changeThreshold, const double timeBudget)
+{
+    mAdapter.setAdaptiveTta(steeringThreshold, changeThreshold, timeBudget);
+}
+
+void ShadowEvaluator::offer(const cv::Mat& image, const cv::Mat& rightImage, const DriveCommands& driveCommands, const double latency, const double period)
+{
+    bool idle = false;
+    // the latency is not known until the candidate has warmed up, so the first frames are evaluated regardless
+    if (!isRunning() || (mLatency > 0.0 && mLatency > period - latency) || !mBusy.compare_exchange_strong(idle, true))
+    {
+        ++mSkippedFrames;
+        return;
+    }
+
+    image.copyTo(mImages[0]);
+    if (rightImage.empty())
+    {
+        mImages[1].release();
+    }
+    else
+    {
+        rightImage.copyTo(mImages[1]);
+    }
+    mPrimaryCommands = driveCommands;
+    mPrimaryLatency = latency;
+    sem_post(&mSemaphore);
+}
+
+void* ShadowEvaluator::threadBody()
+{
+    // the candidate must only use CPU time that no other thread wants, libtorch threads it creates inherit the policy
+    struct sched_param param = {};
+    if (0 != pthread_setschedparam(pthread_self(), SCHED_IDLE, &param))
+    {
+        Logger::log(LOG_WARNING, "Failed to lower priority of the shadow model thread");
+    }
+    at::set_num_threads(mThreads);
+    mStartTime = getMonotonicTime();
+
+    struct timespec wakeUp;
+    DriveCommands driveCommands;
+    double startTime;
+    double latency;
+    float steeringDifference;
+
+    while (isRunning())
+    {
+        clock_gettime(CLOCK_REALTIME, &wakeUp);
+        wakeUp.tv_nsec += static_cast<long>(SHADOW_TIMEOUT * 1e9);
+        if (wakeUp.tv_nsec >= 1000000000L)
+        {
+            ++wakeUp.tv_sec;
+            wakeUp.tv_nsec -= 1000000000L;
+        }
+        if ((0 != sem_timedwait(&mSemaphore, &wakeUp)) || !mBusy)
+        {
+            continue;
+        }
+
+        startTime = getMonotonicTime();
+        driveCommands = DriveCommands();
+        mAdapter.predict(mImages[0], mImages[1], driveCommands);
+        latency = getMonotonicTime() - startTime;
+
+        steeringDifference = fabs(driveCommands.mSteering - mPrimaryCommands.mSteering);
+        {
+            ScopedLock lock(mStatsMutex);
+            if (++mFrames > WARM_UP_FRAMES)
+            {
+                mLatency = (mLatency > 0.0) ? (1.0 - LATENCY_SMOOTHING) * mLatency + LATENCY_SMOOTHING * latency : latency;
+                mStats.addSample(latency);
+            }
+            mSteeringDifference += steeringDifference;
+            mThrottleDifference += fabs(driveCommands.mThrottle - mPrimaryCommands.mThrottle);
+            mMaxSteeringDifference = std::max(mMaxSteeringDifference, static_cast<double>(steeringDifference));
+            if (steeringDifference > mDivergenceThreshold)
+            {
+                ++mDivergedFrames;
+            }
+        }
+        if (mLog)
+        {
+            fprintf(mLog, "%.3f,%.4f,%.4f,%.2f,%.4f,%.4f,%.2f\n", startTime - mStartTime,
+                    mPrimaryCommands.mSteering, mPrimaryCommands.mThrottle, mPrimaryLatency * 1000.0,
+                    driveCommands.mSteering, driveCommands.mThrottle, latency * 1000.0);
+        }
+        mBusy = false;
+    }
+    return nullptr;
+}
+
+void ShadowEvaluator::printStatistics() const
+{
+    ScopedLock lock(mStatsMutex);
+    const double frames = static_cast<double>(std::max(mFrames, 1ul));
+    printf("Shadow model: evaluated %lu frames, skipped %lu, mean |steering difference| %.3f (max %.3f), mean |throttle difference| %.3f, diverged on %lu frames (%.1f%%) \n",
+           mFrames, mSkippedFrames.load(), mSteeringDifference / frames, mMaxSteeringDifference, mThrottleDifference / frames,
+           mDivergedFrames, 100.0 * mDivergedFrames / frames);
+    mStats.print("Shadow model latency");
+}
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <pthread.h>
+#include <GenericThread.h>
+#include "CameraDriveAdapter.h"
+#include "LatencyStats.h"
+
+/**
+ * Evaluates a candidate model in shadow mode: the candidate runs on frames of the primary model on its own idle priority
+ * thread, only after the primary model has finished a frame and the candidate is expected to finish before the next one.
+ * Commands of the candidate are never sent to the car, they are logged with commands of the primary model, and their
+ * divergence from the primary model and latency of the candidate are summarised in statistics.
+ */
+class ShadowEvaluator : public GenericThread<ShadowEvaluator>
+{
+public:
+    /**
+     * Basic constructor, the candidate is loaded at initialisation.
+     */
+    ShadowEvaluator();
+
+    /**
+     * Stops the thread, prints statistics and closes the log.
+     */
+    virtual ~ShadowEvaluator();
+
+    /**
+     * Loads the candidate given by "shadowModel" configuration key with the settings of the primary model, opens the log
+     * and starts the thread.
+     *  @param settings the settings of the application.
+     *  @return true if the candidate is evaluated, false if shadow mode is disabled or the candidate could not be loaded.
+     */
+    bool initialise(const Settings& settings);
+
+    /**
+     * Changes the test time augmentations mode of the candidate, so that it is evaluated as the primary model drives.
+     * This function is thread safe.
+     *  @param tta the test time augmentations mode.
+     */
+    void setTtaMode(const E_TtaMode tta);
+
+    /**
+     * Sets conditions under which the candidate processes the flipped image in the adaptive TTA mode. This function is
+     * thread safe.
+     *  @param steeringThreshold the absolute steering above which the prediction is considered uncertain.
+     *  @param changeThreshold the absolute change of steering from the previous frame above which the prediction is considered uncertain.
+     *  @param timeBudget the time in seconds per frame within which the flipped image is always processed, 0 to disable.
+     */
+    void setAdaptiveTta(const float steeringThreshold, const float changeThreshold, const double timeBudget);
+
+    /**
+     * Offers a frame processed by the primary model. The frame is copied and evaluated if the candidate is idle and
+     * its latency fits in the time left until the primary model processes its next frame. This function is thread safe.
+     *  @param image the mono image or the left image of a stereo camera.
+     *  @param rightImage the right image of a stereo camera, empty for a mono camera.
+     *  @param driveCommands the drive commands predicted by the primary model.
+     *  @param latency the time in seconds the primary model spent on the frame.
+     *  @param period the time in seconds between frames of the primary model.
+     */
+    void offer(const cv::Mat& image, const cv::Mat& rightImage, const DriveCommands& driveCommands, const double latency, const double period);
+
+    /**
+     * The main body of the shadow thread.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+    /**
+     * Prints the number of evaluated and skipped frames, divergence from the primary model and latency of the candidate.
+     */
+    void printStatistics() const;
+
+    /**
+     *  @return true if the candidate is evaluated.
+     */
+    inline bool isEnabled() const
+    {
+        return mAdapter.isInitialised();
+    }
+
+private:
+    /** The candidate model. */
+    CameraDriveAdapter mAdapter;
+    /** Copies of the offered images, the right one is empty for a mono camera. */
+    cv::Mat mImages[2];
+    /** Drive commands of the primary model for the offered frame. */
+    DriveCommands mPrimaryCommands;
+    /** Latency in seconds of the primary model for the offered frame. */
+    double mPrimaryLatency;
+    /** Flag indicating that a frame was offered and is being evaluated. */
+    std::atomic<bool> mBusy;
+    /** Exponential moving average of latency of the candidate in seconds. */
+    std::atomic<double> mLatency;
+    /** The number of libtorch threads of the candidate. */
+    int mThreads;
+    /** Absolute steering difference above which the candidate diverges from the primary model. */
+    float mDivergenceThreshold;
+    /** Log of commands of both models, nullptr if disabled. */
+    FILE* mLog;
+    /** The monotonic time at which the thread started. */
+    double mStartTime;
+    /** The number of evaluated frames. */
+    unsigned long mFrames;
+    /** The number of frames skipped because the candidate was busy or the time left was too short. */
+    std::atomic<unsigned long> mSkippedFrames;
+    /** Sum of absolute steering differences. */
+    double mSteeringDifference;
+    /** Sum of absolute throttle differences. */
+    double mThrottleDifference;
+    /** The largest absolute steering difference. */
+    double mMaxSteeringDifference;
+    /** The number of frames on which the candidate diverged from the primary model. */
+    unsigned long mDivergedFrames;
+    /** Latency statistics of the candidate. */
+    LatencyStats mStats;
+    /** Guards statistics. */
+    mutable pthread_mutex_t mStatsMutex;
+};
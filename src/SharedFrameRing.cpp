@@ -0,0 +1,393 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <CameraData.h>
+#include "Logger.h"
+#include "SharedFrameRing.h"
+#include "Timing.h"
+
+namespace
+{
+/** Identifies the layout of the ring, "JRFR". */
+constexpr uint32_t RING_MAGIC = 0x5246524a;
+/** Alignment of slots and images in bytes. */
+constexpr size_t ALIGNMENT = 64;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "Atomics shared between processes must be lock-free");
+
+/**
+ * Rounds up the size to the alignment.
+ *  @param size the size in bytes.
+ *  @return the aligned size.
+ */
+inline size_t align(const size_t size)
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+/**
+ * Sleeps until the futex word is changed by another process, or the timeout expires.
+ *  @param word the futex word.
+ *  @param expected the value of the word seen by the caller.
+ *  @param timeout the maximum time to wait in seconds.
+ */
+void futexWait(const std::atomic<uint32_t>& word, const uint32_t expected, const double timeout)
+{
+    struct timespec relative;
+    relative.tv_sec = static_cast<time_t>(timeout);
+    relative.tv_nsec = static_cast<long>((timeout - static_cast<double>(relative.tv_sec)) * 1e9);
+    syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&word), FUTEX_WAIT, expected, &relative, nullptr, 0);
+}
+
+/**
+ * Wakes up all processes waiting on the futex word.
+ *  @param word the futex word.
+ */
+void futexWake(std::atomic<uint32_t>& word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+} // end of anonymouse namespace
+
+SharedFrameRing::SharedFrameRing()
+: mName(),
+  mIsOwner(false),
+  mMemory(nullptr),
+  mSize(0),
+  mHeader(nullptr),
+  mImageBytes(0)
+{
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+    if (mMemory)
+    {
+        munmap(mMemory, mSize);
+    }
+    if (mIsOwner)
+    {
+        shm_unlink(mName.c_str());
+    }
+}
+
+bool SharedFrameRing::create(const std::string& name, const uint32_t slots, const cv::Size& imageSize, const int type, const int images)
+{
+    size_t imageBytes = align(static_cast<size_t>(imageSize.area()) * CV_ELEM_SIZE(type));
+    size_t slotSize = sizeof(Slot) + imageBytes * images;
+    size_t size = align(sizeof(Header)) + slotSize * slots;
+    int fd;
+
+    if (isOpen() || slots == 0)
+    {
+        return false;
+    }
+
+    // a ring left behind by a crashed process is replaced
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || 0 != ftruncate(fd, static_cast<off_t>(size)) || !map(fd, size))
+    {
+        Logger::log(LOG_ERROR, "Failed to create shared frame ring %s: %s", name, strerror(errno));
+        if (fd >= 0)
+        {
+            close(fd);
+            shm_unlink(name.c_str());
+        }
+        return false;
+    }
+    close(fd);
+
+    mName = name;
+    mIsOwner = true;
+    mImageBytes = imageBytes;
+    mHeader = new (mMemory) Header();
+    mHeader->mSlots = slots;
+    mHeader->mSlotSize = slotSize;
+    mHeader->mWidth = imageSize.width;
+    mHeader->mHeight = imageSize.height;
+    mHeader->mType = type;
+    mHeader->mImages = images;
+    for (uint32_t i = 0; i < slots; ++i)
+    {
+        new (reinterpret_cast<uint8_t*>(mMemory) + align(sizeof(Header)) + slotSize * i) Slot();
+    }
+    mHeader->mMagic.store(RING_MAGIC, std::memory_order_release);
+
+    Logger::log(LOG_INFO, "Created shared frame ring %s with %u slots of %zu bytes", name, slots, slotSize);
+    return true;
+}
+
+bool SharedFrameRing::open(const std::string& name)
+{
+    struct stat status;
+    int fd;
+
+    if (isOpen())
+    {
+        return false;
+    }
+
+    fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (0 != fstat(fd, &status) || status.st_size < static_cast<off_t>(sizeof(Header)) || !map(fd, static_cast<size_t>(status.st_size)))
+    {
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    Header* header = reinterpret_cast<Header*>(mMemory);
+    if (header->mMagic.load(std::memory_order_acquire) != RING_MAGIC || 
+        align(sizeof(Header)) + header->mSlotSize * header->mSlots > mSize)
+    {
+        munmap(mMemory, mSize);
+        mMemory = nullptr;
+        mSize = 0;
+        return false;
+    }
+
+    mName = name;
+    mHeader = header;
+    mImageBytes = align(static_cast<size_t>(header->mWidth) * header->mHeight * CV_ELEM_SIZE(header->mType));
+    return true;
+}
+
+bool SharedFrameRing::publish(const CameraData& cameraData, const DriveCommands& driveCommands)
+{
+    if (!isOpen() || static_cast<int>(cameraData.mImage.size()) != mHeader->mImages)
+    {
+        return false;
+    }
+
+    uint64_t frame = mHeader->mLastFrame.load(std::memory_order_relaxed) + 1;
+    uint32_t index = mHeader->mLastSlot.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    uint64_t sequence = 0;
+
+    // the slot is marked as being written before checking pins, so that a consumer pinning it at the same time
+    // either sees the odd sequence and retries, or its pin is seen here and the slot is skipped
+    for (uint32_t i = 0; i < mHeader->mSlots && !slot; ++i)
+    {
+        index = (index + 1) % mHeader->mSlots;
+        slot = getSlot(index);
+        sequence = slot->mSequence.load(std::memory_order_relaxed);
+        slot->mSequence.store(sequence + 1);
+        if (0 != slot->mPins.load())
+        {
+            slot->mSequence.store(sequence, std::memory_order_release);
+            slot = nullptr;
+        }
+    }
+    if (!slot)
+    {
+        return false;
+    }
+
+    uint8_t* data = reinterpret_cast<uint8_t*>(slot) + sizeof(Slot);
+    slot->mFrame.store(frame, std::memory_order_relaxed);
+    slot->mTime.store(getMonotonicTime(), std::memory_order_relaxed);
+    slot->mSteering.store(driveCommands.mSteering, std::memory_order_relaxed);
+    slot->mThrottle.store(driveCommands.mThrottle, std::memory_order_relaxed);
+    for (int i = 0; i < mHeader->mImages; ++i)
+    {
+        cv::Mat image(mHeader->mHeight, mHeader->mWidth, mHeader->mType, data + mImageBytes * i);
+        cameraData.mImage[i].createMatHeader().copyTo(image);
+    }
+    slot->mSequence.store(sequence + 2, std::memory_order_release);
+
+    mHeader->mLastSlot.store(index, std::memory_order_relaxed);
+    mHeader->mLastFrame.store(frame, std::memory_order_release);
+    mHeader->mFrameCounter.fetch_add(1, std::memory_order_release);
+    futexWake(mHeader->mFrameCounter);
+    return true;
+}
+
+bool SharedFrameRing::acquire(const E_FrameConsumer consumer, uint64_t& lastFrame, const double timeout, FrameView& view)
+{
+    const uint32_t pin = static_cast<uint32_t>(consumer);
+    double deadline = getMonotonicTime() + timeout;
+    double remaining = timeout;
+    uint32_t counter;
+    uint32_t index;
+    uint64_t frame;
+    uint64_t sequence;
+    Slot* slot;
+    uint8_t* data;
+
+    while (isOpen())
+    {
+        counter = mHeader->mFrameCounter.load(std::memory_order_acquire);
+        frame = mHeader->mLastFrame.load(std::memory_order_acquire);
+        if (frame > lastFrame)
+        {
+            index = mHeader->mLastSlot.load(std::memory_order_relaxed);
+            slot = getSlot(index);
+            sequence = slot->mSequence.load(std::memory_order_acquire);
+            if (0 != (sequence & 1) || slot->mFrame.load(std::memory_order_relaxed) != frame)
+            {
+                // a newer frame is being published
+                continue;
+            }
+            slot->mPins.fetch_or(pin);
+            // the producer did not start rewriting the slot before the pin became visible, so it never will
+            if (sequence != slot->mSequence.load() || slot->mFrame.load(std::memory_order_relaxed) != frame)
+            {
+                slot->mPins.fetch_and(~pin, std::memory_order_release);
+                continue;
+            }
+
+            data = reinterpret_cast<uint8_t*>(slot) + sizeof(Slot);
+            view.mFrame = frame;
+            view.mTime = slot->mTime.load(std::memory_order_relaxed);
+            view.mCommands.mSteering = slot->mSteering.load(std::memory_order_relaxed);
+            view.mCommands.mThrottle = slot->mThrottle.load(std::memory_order_relaxed);
+            for (int i = 0; i < 2; ++i)
+            {
+                view.mImage[i] = (i < mHeader->mImages) ? cv::Mat(mHeader->mHeight, mHeader->mWidth, mHeader->mType, data + mImageBytes * i)
+                                                        : cv::Mat();
+            }
+            view.mSlot = index;
+            view.mConsumer = consumer;
+            lastFrame = frame;
+            return true;
+        }
+
+        if (remaining <= 0.0)
+        {
+            break;
+        }
+        futexWait(mHeader->mFrameCounter, counter, remaining);
+        remaining = deadline - getMonotonicTime();
+    }
+    return false;
+}
+
+void SharedFrameRing::release(const FrameView& view)
+{
+    if (isOpen() && view.mSlot < mHeader->mSlots)
+    {
+        getSlot(view.mSlot)->mPins.fetch_and(~static_cast<uint32_t>(view.mConsumer), std::memory_order_release);
+    }
+}
+
+void SharedFrameRing::releaseAll(const E_FrameConsumer consumer)
+{
+    for (uint32_t i = 0; isOpen() && i < mHeader->mSlots; ++i)
+    {
+        getSlot(i)->mPins.fetch_and(~static_cast<uint32_t>(consumer), std::memory_order_release);
+    }
+}
+
+void SharedFrameRing::publishCommands(const DriveCommands& driveCommands)
+{
+    if (isOpen())
+    {
+        uint32_t sequence = mHeader->mCommandSequence.load(std::memory_order_relaxed);
+        mHeader->mCommandSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        mHeader->mSteering.store(driveCommands.mSteering, std::memory_order_relaxed);
+        mHeader->mThrottle.store(driveCommands.mThrottle, std::memory_order_relaxed);
+        mHeader->mCommandSequence.store(sequence + 2, std::memory_order_release);
+        mHeader->mCommandCounter.fetch_add(1, std::memory_order_release);
+        futexWake(mHeader->mCommandCounter);
+    }
+}
+
+bool SharedFrameRing::waitForCommands(uint32_t& lastCommands, const double timeout, DriveCommands& driveCommands) const
+{
+    double deadline = getMonotonicTime() + timeout;
+    double remaining = timeout;
+    uint32_t counter;
+    uint32_t sequence;
+
+    while (isOpen())
+    {
+        counter = mHeader->mCommandCounter.load(std::memory_order_acquire);
+        if (counter != lastCommands)
+        {
+            sequence = mHeader->mCommandSequence.load(std::memory_order_acquire);
+            driveCommands.mSteering = mHeader->mSteering.load(std::memory_order_relaxed);
+            driveCommands.mThrottle = mHeader->mThrottle.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (0 == (sequence & 1) && sequence == mHeader->mCommandSequence.load(std::memory_order_relaxed))
+            {
+                lastCommands = counter;
+                return true;
+            }
+            continue;
+        }
+
+        if (remaining <= 0.0)
+        {
+            break;
+        }
+        futexWait(mHeader->mCommandCounter, counter, remaining);
+        remaining = deadline - getMonotonicTime();
+    }
+    return false;
+}
+
+void SharedFrameRing::setConsumers(const uint32_t consumers)
+{
+    if (isOpen())
+    {
+        mHeader->mConsumers = consumers;
+    }
+}
+
+bool SharedFrameRing::hasConsumer(const E_FrameConsumer consumer) const
+{
+    return isOpen() && 0 != (mHeader->mConsumers & static_cast<uint32_t>(consumer));
+}
+
+bool SharedFrameRing::map(const int fd, const size_t size)
+{
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == memory)
+    {
+        return false;
+    }
+    mMemory = memory;
+    mSize = size;
+    return true;
+}
+
+SharedFrameRing::Slot* SharedFrameRing::getSlot(const uint32_t index) const
+{
+    uint8_t* slots = reinterpret_cast<uint8_t*>(mMemory) + align(sizeof(Header));
+    return reinterpret_cast<Slot*>(slots + mHeader->mSlotSize * index);
+}
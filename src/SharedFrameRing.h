@@ -0,0 +1,248 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <opencv2/core.hpp>
+#include <DriveCommands.h>
+
+struct CameraData;
+
+/**
+ * Consumers of frames published into the ring.
+ */
+enum E_FrameConsumer
+{
+    CONSUMER_INFERENCE = 1,
+    CONSUMER_RECORDER = 2
+};
+
+/**
+ * A frame in the ring that is pinned by a consumer and read in place until it is released.
+ */
+struct FrameView
+{
+    /** The number of the frame. */
+    uint64_t mFrame;
+    /** The monotonic time when the frame was published. */
+    double mTime;
+    /** The drive commands applied when the frame was published. */
+    DriveCommands mCommands;
+    /** Headers of the mono or the left and right images, pointing into shared memory. */
+    cv::Mat mImage[2];
+    /** The index of the slot. */
+    uint32_t mSlot;
+    /** The consumer that pinned the slot. */
+    E_FrameConsumer mConsumer;
+};
+
+/**
+ * A ring of pre-allocated frames in POSIX shared memory with a single producer and any number of consumers in other processes.
+ * Each slot is guarded by a sequence lock and carries a bitmask of consumers that pinned it. A consumer pins the latest frame and
+ * reads it in place until it releases it, the producer never waits and skips pinned slots, dropping the frame only if every
+ * slot is pinned. With two consumers the ring therefore needs at least three slots. Consumers are woken with a futex.
+ * The ring also carries drive commands predicted by the inference process back to the racer process.
+ */
+class SharedFrameRing
+{
+public:
+    /**
+     * Basic constructor, the ring is created or opened later.
+     */
+    SharedFrameRing();
+
+    /**
+     * Unmaps the memory, the creator also removes the shared memory object.
+     */
+    virtual ~SharedFrameRing();
+
+    /**
+     * Creates the shared memory object and pre-allocates all frames.
+     *  @param name the name of the shared memory object, starting with a slash.
+     *  @param slots the number of frames in the ring.
+     *  @param imageSize the size of a single image.
+     *  @param type the OpenCV type of images.
+     *  @param images 1 for a mono and 2 for a stereo camera.
+     *  @return true if the ring was created.
+     */
+    bool create(const std::string& name, const uint32_t slots, const cv::Size& imageSize, const int type, const int images);
+
+    /**
+     * Opens a ring created by another process.
+     *  @param name the name of the shared memory object, starting with a slash.
+     *  @return true if the ring was opened.
+     */
+    bool open(const std::string& name);
+
+    /**
+     * Copies camera images into the next slot that is not pinned and wakes up consumers. Called by the producer only.
+     *  @param cameraData the camera data from either mono or stereo camera.
+     *  @param driveCommands the drive commands applied at the time.
+     *  @return true if the frame was published, false if every slot was pinned and the frame was dropped.
+     */
+    bool publish(const CameraData& cameraData, const DriveCommands& driveCommands);
+
+    /**
+     * Waits for a frame newer than @p lastFrame and pins the latest one, skipping any that were missed.
+     * The frame cannot be overwritten until it is released.
+     *  @param consumer the consumer that pins the frame.
+     *  @param lastFrame the number of the last frame seen by the consumer, updated to the number of the returned frame.
+     *  @param timeout the maximum time to wait in seconds.
+     *  @param view the returned frame.
+     *  @return true if a frame was pinned, false on timeout.
+     */
+    bool acquire(const E_FrameConsumer consumer, uint64_t& lastFrame, const double timeout, FrameView& view);
+
+    /**
+     * Unpins a frame, so that the producer can overwrite it. The images of the view must not be used afterwards.
+     *  @param view a frame returned by acquire.
+     */
+    void release(const FrameView& view);
+
+    /**
+     * Unpins every slot pinned by the consumer, e.g. by a previous instance of a worker that crashed.
+     *  @param consumer the consumer to release.
+     */
+    void releaseAll(const E_FrameConsumer consumer);
+
+    /**
+     * Stores drive commands predicted by a consumer and wakes up the racer process.
+     *  @param driveCommands the predicted drive commands.
+     */
+    void publishCommands(const DriveCommands& driveCommands);
+
+    /**
+     * Waits for drive commands newer than @p lastCommands.
+     *  @param lastCommands the counter of the last drive commands seen, updated to the counter of the returned ones.
+     *  @param timeout the maximum time to wait in seconds.
+     *  @param driveCommands the returned drive commands.
+     *  @return true if new drive commands were returned, false on timeout.
+     */
+    bool waitForCommands(uint32_t& lastCommands, const double timeout, DriveCommands& driveCommands) const;
+
+    /**
+     * Selects which consumers should process published frames.
+     *  @param consumers bitmask of E_FrameConsumer.
+     */
+    void setConsumers(const uint32_t consumers);
+
+    /**
+     *  @param consumer the consumer to check.
+     *  @return true if the consumer should process published frames.
+     */
+    bool hasConsumer(const E_FrameConsumer consumer) const;
+
+    /**
+     *  @return true if the ring was created or opened.
+     */
+    inline bool isOpen() const
+    {
+        return mHeader != nullptr;
+    }
+
+private:
+    /**
+     * The header of the ring at the beginning of the shared memory.
+     */
+    struct Header
+    {
+        /** Identifies the layout of the ring, set once the ring is initialised. */
+        std::atomic<uint32_t> mMagic;
+        /** The number of slots. */
+        uint32_t mSlots;
+        /** The size of a slot in bytes, including its header. */
+        uint64_t mSlotSize;
+        /** The width of images. */
+        int32_t mWidth;
+        /** The height of images. */
+        int32_t mHeight;
+        /** The OpenCV type of images. */
+        int32_t mType;
+        /** The number of images per frame. */
+        int32_t mImages;
+        /** The number of the latest published frame, 0 if none. */
+        std::atomic<uint64_t> mLastFrame;
+        /** The index of the slot that holds the latest published frame. */
+        std::atomic<uint32_t> mLastSlot;
+        /** Futex word incremented with each published frame. */
+        std::atomic<uint32_t> mFrameCounter;
+        /** Bitmask of consumers that should process frames. */
+        std::atomic<uint32_t> mConsumers;
+        /** Futex word incremented with each published drive commands. */
+        std::atomic<uint32_t> mCommandCounter;
+        /** Sequence lock of drive commands, odd while they are being written. */
+        std::atomic<uint32_t> mCommandSequence;
+        /** The predicted steering. */
+        std::atomic<float> mSteering;
+        /** The predicted throttle. */
+        std::atomic<float> mThrottle;
+    };
+
+    /**
+     * The header of a slot, followed by image data.
+     */
+    struct alignas(64) Slot
+    {
+        /** Sequence lock of the slot, odd while the frame is being written. */
+        std::atomic<uint64_t> mSequence;
+        /** Bitmask of consumers that pinned the slot. */
+        std::atomic<uint32_t> mPins;
+        /** The number of the frame. */
+        std::atomic<uint64_t> mFrame;
+        /** The monotonic time when the frame was published. */
+        std::atomic<double> mTime;
+        /** The steering applied when the frame was published. */
+        std::atomic<float> mSteering;
+        /** The throttle applied when the frame was published. */
+        std::atomic<float> mThrottle;
+    };
+
+    /**
+     * Maps the shared memory object.
+     *  @param fd the file descriptor of the shared memory object.
+     *  @param size the size of the object.
+     *  @return true if the memory was mapped.
+     */
+    bool map(const int fd, const size_t size);
+
+    /**
+     *  @param index the index of the slot.
+     *  @return pointer to the slot.
+     */
+    Slot* getSlot(const uint32_t index) const;
+
+    /** The name of the shared memory object. */
+    std::string mName;
+    /** True if this instance created the ring and removes it when destroyed. */
+    bool mIsOwner;
+    /** The mapped memory. */
+    void* mMemory;
+    /** The size of the mapped memory. */
+    size_t mSize;
+    /** The header of the ring, nullptr if not open. */
+    Header* mHeader;
+    /** The size in bytes of a single image. */
+    size_t mImageBytes;
+};
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdio>
+#include <ScopedLock.h>
+#include "StartupTimeline.h"
+#include "Timing.h"
+
+StartupTimeline::StartupTimeline()
+: mOrigin(getMonotonicTime()),
+  mSteps()
+{
+    pthread_mutex_init(&mMutex, nullptr);
+}
+
+StartupTimeline::~StartupTimeline()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+bool StartupTimeline::measure(const std::string& name, const std::function<bool()>& step)
+{
+    double start = getElapsedTime();
+    bool retVal = step();
+    double end = getElapsedTime();
+
+    ScopedLock lock(mMutex);
+    mSteps.push_back({name, start, end, retVal});
+    return retVal;
+}
+
+double StartupTimeline::getElapsedTime() const
+{
+    return getMonotonicTime() - mOrigin;
+}
+
+void StartupTimeline::print()
+{
+    ScopedLock lock(mMutex);
+    std::sort(mSteps.begin(), mSteps.end(), [](const Step& a, const Step& b) { return a.mStart < b.mStart; });
+    puts("Startup timeline:");
+    for (const Step& step : mSteps)
+    {
+        printf("  %8.1f ms - %8.1f ms (%7.1f ms) %s%s \n", step.mStart * 1000.0, step.mEnd * 1000.0, 
+               (step.mEnd - step.mStart) * 1000.0, step.mName.c_str(), step.mSuccess ? "" : " FAILED");
+    }
+    printf("  ready after %.1f ms, resident memory %.1f MB \n", getElapsedTime() * 1000.0, getResidentMemory());
+}
+
+double StartupTimeline::getResidentMemory()
+{
+    unsigned long residentKb = 0;
+    char line[128];
+    FILE* status = fopen("/proc/self/status", "r");
+    if (status)
+    {
+        while (fgets(line, sizeof(line), status))
+        {
+            if (1 == sscanf(line, "VmRSS: %lu kB", &residentKb))
+            {
+                break;
+            }
+        }
+        fclose(status);
+    }
+    return static_cast<double>(residentKb) / 1024.0;
+}
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+/**
+ * Records start and end times of startup steps, which may run concurrently, and prints them as a timeline.
+ * Times are relative to the creation of the timeline.
+ */
+class StartupTimeline
+{
+public:
+    /**
+     * Initialises the mutex and the origin of the timeline.
+     */
+    StartupTimeline();
+
+    /**
+     * Destroys the mutex.
+     */
+    virtual ~StartupTimeline();
+
+    /**
+     * Runs a startup step and records its duration. This function is thread safe.
+     *  @param name the name of the step.
+     *  @param step the function that performs the step and returns true on success.
+     *  @return the result of the step.
+     */
+    bool measure(const std::string& name, const std::function<bool()>& step);
+
+    /**
+     *  @return the time in seconds since the creation of the timeline.
+     */
+    double getElapsedTime() const;
+
+    /**
+     * Prints all recorded steps sorted by their start time and the resident memory of the process.
+     */
+    void print();
+
+    /**
+     *  @return the resident memory of the process in MB, 0 if it cannot be read.
+     */
+    static double getResidentMemory();
+
+private:
+    /**
+     * A single recorded step.
+     */
+    struct Step
+    {
+        /** The name of the step. */
+        std::string mName;
+        /** The start time relative to the origin in seconds. */
+        double mStart;
+        /** The end time relative to the origin in seconds. */
+        double mEnd;
+        /** The result of the step. */
+        bool mSuccess;
+    };
+
+    /** The monotonic time when the timeline was created. */
+    double mOrigin;
+    /** Recorded steps. */
+    std::vector<Step> mSteps;
+    /** Mutex protecting recorded steps. */
+    pthread_mutex_t mMutex;
+};
@@ -21,9 +21,15 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <cmath>
+#include <ctime>
+#include <experimental/filesystem>
+#include <future>
 #include <NvidiaRacer.h>
+#include <ScopedLock.h>
 #include "Configuration.h"
+#include "Logger.h"
 #include "StateMachine.h"
+#include "Timing.h"
 
 namespace
 {
@@ -41,105 +47,266 @@ const std::string stateToStr(const E_State state)
         default: return "UNUSED";
     }
 }
-
-bool strToBool(const std::string& value)
-{
-    return value == "true" || value == "True" || value == "1";
-}
 } // end of anonymouse namespace 
 
-StateMachine::StateMachine(const Configuration& config, ICameraTalker* camera)
+StateMachine::StateMachine(const Configuration& config, const Settings& settings, ICameraTalker* camera)
 : GenericListener<GamepadEventData>(),
   GenericTalker<DriveCommands>(),
   mConfig(config),
+  mSettings(std::make_shared<const Settings>(settings)),
   mRacer(-1),
-  mOled(std::stoi(mConfig.at("oledAddress"), nullptr, 0), std::stoi(mConfig.at("oledMaxWait"))),
+  mEmergencyStop(settings, mRacer),
+  mOled(settings.mOledAddress, settings.mOledMaxWait),
   mCamera(camera),
-  mDataSaver(config),
+  mRectifier(settings),
+  mFrames(camera),
+  mDataSaver(settings),
+  mPreview(settings),
+  mGovernor(settings),
+  mMetrics(settings),
   mState(RC),
   mPreviousState(RC),
+  mActiveState(RC),
   mGamepad(),
-  mGamepadDrive(std::stoi(mConfig.at("steeringAxis")), std::stoi(mConfig.at("throttleAxis"))),
+  mGamepadDrive(settings.mSteeringAxis, settings.mThrottleAxis),
   mTorchDrive(),
-  mRcOverride(false)
+  mRemoteDrive(settings),
+  mImu(settings),
+  mEstimator(settings),
+  mProcessSplit(settings.mProcessSplit),
+  mPipeline(),
+  mTaskPool(settings.mTaskPoolThreads, settings.mTaskPoolPinned),
+  mJournal(SessionJournal::strToFrames(mConfig.at("journalFrames")), settings.mJournalQueue),
+  mGamepadTap(mJournal, JOURNAL_GAMEPAD),
+  mCameraTap(mJournal, JOURNAL_CAMERA),
+  mGamepadDriveTap(mJournal, JOURNAL_GAMEPAD_DRIVE),
+  mTorchDriveTap(mJournal, JOURNAL_TORCH_DRIVE),
+  mRcOverride(false),
+  mCameraStandby(settings.mCameraStandby),
+  mAxisActions(),
+  mButtonActions(),
+  mModelPreload(),
+  mPerformanceLevel(0)
 {
     sem_init(&mSemaphore, 0, 0);
+    pthread_mutex_init(&mLevelMutex, nullptr);
 
-    mRacer.setSteeringGain(std::stof(mConfig.at("steeringGain")));
-    mRacer.setSteeringOffset(std::stof(mConfig.at("steeringOffset")));
-    mRacer.setThrottleGain(std::stof(mConfig.at("throttleGain")));
+    mRacer.setSteeringGain(settings.mSteeringGain);
+    mRacer.setSteeringOffset(settings.mSteeringOffset);
+    mRacer.setThrottleGain(settings.mThrottleGain);
 
-    mAxisActions[std::stoi(mConfig.at("statePageAxis"))] = &StateMachine::processStatePageAxis;
+    mAxisActions[settings.mStatePageAxis] = &StateMachine::processStatePageAxis;
 
-    mButtonActions[std::stoi(mConfig.at("stopButton"))] = &StateMachine::processStopButton;
-    mButtonActions[std::stoi(mConfig.at("stateConfButton"))] = &StateMachine::processStateConfButton;
-    mButtonActions[std::stoi(mConfig.at("rcOverrideButton"))] = &StateMachine::processRcOverrideButton;
+    mButtonActions[settings.mStopButton] = &StateMachine::processStopButton;
+    mButtonActions[settings.mStateConfButton] = &StateMachine::processStateConfButton;
+    mButtonActions[settings.mRcOverrideButton] = &StateMachine::processRcOverrideButton;
 
     mGamepad.registerTo(this);
     mGamepad.registerTo(&mGamepadDrive);
-    mRacer.registerTo(&mGamepadDrive);
-    mRacer.registerTo(&mTorchDrive);
+    mEmergencyStop.setCallback([this]() { sem_post(&mSemaphore); });
+    mGovernor.setLevelCallback([this](const int level) { applyPerformanceLevel(level); });
+    static_cast<GenericListener<ImuData>&>(mEstimator).registerTo(&mImu);
+
+    if (!settings.mIsMono && settings.mRectificationCache)
+    {
+        mRectifier.registerTo(mCamera);
+        mFrames = &mRectifier;
+    }
+
+    mPipeline.setTaskPool(&mTaskPool);
+    mPipeline.addProducer<CameraData>("camera", mFrames);
+    mPipeline.addProducer<DriveCommands>("gamepadDrive", &mGamepadDrive);
+    mPipeline.addProducer<DriveCommands>("torchDrive", &mTorchDrive);
+    mPipeline.addProducer<DriveCommands>("remoteDrive", &mRemoteDrive);
+    mPipeline.addProducer<DriveCommands>("estimator", &mEstimator);
+    mPipeline.addConsumer<CameraData>("torchDrive", &mTorchDrive);
+    mPipeline.addConsumer<CameraData>("dataSaver", &mDataSaver);
+    mPipeline.addConsumer<DriveCommands>("dataSaver", &mDataSaver);
+    mPipeline.addConsumer<CameraData>("remoteDrive", &mRemoteDrive);
+    mPipeline.addConsumer<DriveCommands>("remoteDrive", &mRemoteDrive);
+    mPipeline.addConsumer<DriveCommands>("estimator", &mEstimator);
+    mPipeline.addConsumer<DriveCommands>("racer", &mEmergencyStop);
+    // the multi-process mode has its own graphs, in which frames are passed to workers by the remote drive
+    for (const E_State state : {RC, RC_IMAGES, ML})
+    {
+        std::string key = (mProcessSplit ? "pipelineSplit" : "pipeline") + stateToStr(state);
+        if (!mPipeline.addGraph(stateToStr(state), mConfig.at(key)))
+        {
+            Logger::log(LOG_ERROR, "Invalid pipeline %s", key);
+        }
+    }
+    mPipeline.activate(stateToStr(mState));
 }
 
 StateMachine::~StateMachine()
 {
     stop();
     sem_destroy(&mSemaphore);
+    pthread_mutex_destroy(&mLevelMutex);
 }
 
-bool StateMachine::initialise()
+bool StateMachine::initialise(StartupTimeline& timeline)
 {
-    if (mOled.initialise((mConfig.at("jetracerDevice").c_str())))
+    if (!mEmergencyStop.startThread())
     {
-        puts("OLED inititialised");
+        Logger::log(LOG_WARNING, "Failed to start emergency stop thread");
     }
-    else
+
+    // OLED and racer share the I2C bus, so they are initialised in sequence while the gamepad is opened concurrently
+    std::future<bool> i2cDevices = std::async(std::launch::async, [this, &timeline]() 
+    {
+        if (!timeline.measure("OLED", [this]() { return mOled.initialise(mConfig.at("jetracerDevice").c_str()); }))
+        {
+            Logger::log(LOG_ERROR, "Failed to initialise OLED display.");
+            return false;
+        }
+        Logger::log(LOG_INFO, "OLED inititialised");
+        if (!timeline.measure("Racer", [this]() { return mRacer.initialise(mConfig.at("jetracerDevice").c_str()); }))
+        {
+            Logger::log(LOG_ERROR, "Failed to initialise jetracer");
+            return false;
+        }
+        Logger::log(LOG_INFO, "Racer inititialised");
+        return true;
+    });
+    std::future<bool> gamepad = std::async(std::launch::async, [this, &timeline]() 
+    {
+        return timeline.measure("Gamepad", [this]() { return mGamepad.initialise(mSettings->mGamepadDevice.c_str()); });
+    });
+
+    if (mProcessSplit)
+    {
+        // the model is loaded by the inference worker, frames are passed to it through shared memory
+        if (!mRemoteDrive.initialise() || !mRemoteDrive.startThread())
+        {
+            Logger::log(LOG_ERROR, "Failed to initialise remote drive");
+            return false;
+        }
+    }
+    else if (mSettings->mPreloadModel)
+    {
+        mModelPreload = std::async(std::launch::async, [this, &timeline]()
+        {
+            timeline.measure("Model (background)", [this]() 
+            {
+                mTorchDrive.initialise(*std::atomic_load(&mSettings));
+                return mTorchDrive.isInitialised();
+            });
+            Logger::log(LOG_INFO, "Model preloaded %.1f ms after start", timeline.getElapsedTime() * 1000.0);
+        });
+    }
+
+    bool i2cInitialised = i2cDevices.get();
+    if (!gamepad.get())
+    {
+        Logger::log(LOG_ERROR, "Failed to initialise gamepad");
+        return false;
+    }
+    if (!i2cInitialised)
     {
-        puts("Failed to initialise OLED display.");
         return false;
     }
 
-    if (mRacer.initialise(mConfig.at("jetracerDevice").c_str()))
+    // the gamepad thread drives the racer, so it can be started only when all devices are ready
+    if (mGamepad.startThread())
     {
-        puts("Racer inititialised");
+        Logger::log(LOG_INFO, "Gamepad inititialised");
     }
     else
     {
-        puts("Failed to initialise jetracer");
+        Logger::log(LOG_ERROR, "Failed to start gamepad thread");
         return false;
     }
 
-    if (mGamepad.initialise(mConfig.at("gamepadDevice").c_str()))
+    if (mSettings->mPreviewEnabled)
     {
-        if (mGamepad.startThread())
-        {
-            puts("Gamepad inititialised");
-        }
-        else
+        static_cast<GenericListener<CameraData>&>(mPreview).registerTo(mFrames);
+        static_cast<GenericListener<DriveCommands>&>(mPreview).registerTo(&mGamepadDrive);
+        static_cast<GenericListener<DriveCommands>&>(mPreview).registerTo(&mTorchDrive);
+        static_cast<GenericListener<DriveCommands>&>(mPreview).registerTo(&mRemoteDrive);
+        if (!mPreview.startThread())
         {
-            puts("Failed to start gamepad thread");
-            return false;
+            Logger::log(LOG_WARNING, "Failed to start preview stream");
         }
     }
-    else
+
+    if (mSettings->mJournalEnabled)
     {
-        puts("Failed to initialise gamepad");
-        return false;
+        startJournal();
+    }
+
+    if (mSettings->mGovernorEnabled && !mGovernor.startThread())
+    {
+        Logger::log(LOG_WARNING, "Failed to start performance governor");
+    }
+
+    if (mSettings->mImuEnabled && !mImu.startThread())
+    {
+        Logger::log(LOG_WARNING, "Failed to start IMU, model commands are not propagated between frames");
+    }
+
+    if (mSettings->mMetricsEnabled)
+    {
+        startMetrics();
     }
     
     return true;
 }
 
+bool StateMachine::preloadCamera()
+{
+    if (!mCamera->isRunning())
+    {
+        startCamera();
+        // frames are not delivered until the camera is resumed when entering a state that needs it
+        mCamera->pause();
+    }
+    return mCamera->isRunning();
+}
+
+bool StateMachine::loadRectification()
+{
+    return mRectifier.load();
+}
+
 void StateMachine::stop()
 {
+    mGamepad.unregisterFrom(&mGamepadTap);
+    mCameraTap.unregisterFrom(mFrames);
+    mGamepadDriveTap.unregisterFrom(&mGamepadDrive);
+    mTorchDriveTap.unregisterFrom(&mTorchDrive);
+    mTorchDriveTap.unregisterFrom(&mRemoteDrive);
+    mJournal.close();
+    mMetrics.stopThread();
+    mMetrics.unregisterFrom(mFrames);
+    mImu.stopThread();
+    mGovernor.stopThread(true);
     mDataSaver.stopThread(true);
+    mPreview.stopThread(true);
+    static_cast<GenericListener<CameraData>&>(mPreview).unregisterFrom(mFrames);
+    static_cast<GenericListener<DriveCommands>&>(mPreview).unregisterFrom(&mGamepadDrive);
+    static_cast<GenericListener<DriveCommands>&>(mPreview).unregisterFrom(&mTorchDrive);
+    static_cast<GenericListener<DriveCommands>&>(mPreview).unregisterFrom(&mRemoteDrive);
+    mRemoteDrive.setConsumers(0);
+    mRemoteDrive.stopThread(true);
     mGamepad.stopThread();
     mGamepad.unregisterFrom(this);
     mGamepad.unregisterFrom(&mGamepadDrive);
-    mRacer.unregisterFrom(&mGamepadDrive);
-    mRacer.unregisterFrom(&mTorchDrive);
+    mPipeline.stop();
+    mPipeline.printStatistics();
+    if (mTaskPool.isRunning())
+    {
+        mTaskPool.stop();
+        mTaskPool.printStatistics();
+    }
     mCamera->stopCamera();
+    if (mFrames == &mRectifier)
+    {
+        mRectifier.unregisterFrom(mCamera);
+        mRectifier.printStatistics();
+    }
     mRacer.setThrottle(0.0f);
+    mEmergencyStop.stopThread();
 }
 
 void StateMachine::update(const GamepadEventData& eventData)
@@ -164,14 +331,14 @@ void StateMachine::update(const GamepadEventData& eventData)
 
 void StateMachine::processStopButton(const short value)
 {
-    printf("processStopButton, value=%d \n", value);
-    stop();
-    sem_post(&mSemaphore);
+    Logger::log(LOG_INFO, "processStopButton, value=%d", value);
+    // the rest is stopped by the main thread once it is woken up by the emergency stop
+    mEmergencyStop.engage();
 }
 
 void StateMachine::processRcOverrideButton(const short value)
 {
-    printf("processRcOverrideButton, value=%d, current state=%s \n", value, stateToStr(mState).c_str());
+    Logger::log(LOG_INFO, "processRcOverrideButton, value=%d, current state=%s", value, stateToStr(mState).c_str());
     mRcOverride = static_cast<bool>(value);
     if (mRcOverride)
     {
@@ -179,9 +346,10 @@ void StateMachine::processRcOverrideButton(const short value)
         switch (mState)
         {
             case ML:
-                mTorchDrive.pause();
+                static_cast<GenericListener<CameraData>&>(mTorchDrive).pause();
                 [[fallthrough]];
             case RC_IMAGES:
+                mRemoteDrive.setConsumers(0);
                 mCamera->pause();
                 mRacer.update(DriveCommands(0.0f, 0.0f));
                 break;
@@ -194,9 +362,12 @@ void StateMachine::processRcOverrideButton(const short value)
         switch (mPreviousState)
         {
             case ML:
-                mTorchDrive.resume();
-                [[fallthrough]];
+                static_cast<GenericListener<CameraData>&>(mTorchDrive).resume();
+                mRemoteDrive.setConsumers(mProcessSplit ? CONSUMER_INFERENCE : 0);
+                mCamera->resume();
+                break;
             case RC_IMAGES:
+                mRemoteDrive.setConsumers(mProcessSplit ? CONSUMER_RECORDER : 0);
                 mCamera->resume();
                 break;
             default:
@@ -210,72 +381,86 @@ void StateMachine::processStateConfButton(const short value)
 {
     if (mRcOverride && mState != mPreviousState)
     {
-        printf("processStateConfButton, value=%d, switching to state=%s \n", value, stateToStr(mState).c_str());
+        double startTime = getMonotonicTime();
+        Logger::log(LOG_INFO, "processStateConfButton, value=%d, switching to state=%s", value, stateToStr(mState).c_str());
         switch (mState)
         {
             case RC:
-                if (mCamera->isRunning())
+                if (mCameraStandby)
+                {
+                    // keep the pipeline running but discard frames, so that leaving RC does not wait for the camera
+                    Logger::log(LOG_INFO, "Pausing camera");
+                    mCamera->pause();
+                }
+                else if (mCamera->isRunning())
                 {
-                    puts("Stopping camera");
+                    Logger::log(LOG_INFO, "Stopping camera");
                     mCamera->stopCamera();
                 }
                 if (mDataSaver.isRunning())
                 {
-                    puts("Stopping datasaver thread");
+                    Logger::log(LOG_INFO, "Stopping datasaver thread");
                     mDataSaver.stopThread(true);
                 }
-                puts("Unregistering data saver");
-                static_cast<GenericListener<DriveCommands>&>(mDataSaver).unregisterFrom(&mGamepadDrive);
-                static_cast<GenericListener<CameraData>&>(mDataSaver).unregisterFrom(mCamera);
-                puts("Unregistering torch drive");
-                static_cast<GenericListener<CameraData>&>(mTorchDrive).unregisterFrom(mCamera);
+                mRemoteDrive.setConsumers(0);
                 break;
             case RC_IMAGES:
-                puts("Unregistering torch drive");
-                static_cast<GenericListener<CameraData>&>(mTorchDrive).unregisterFrom(mCamera);
-                puts("Registering data saver");
-                static_cast<GenericListener<DriveCommands>&>(mDataSaver).registerTo(&mGamepadDrive);
-                static_cast<GenericListener<CameraData>&>(mDataSaver).registerTo(mCamera);
+                if (mProcessSplit)
+                {
+                    Logger::log(LOG_INFO, "Passing frames to recorder worker");
+                    mRemoteDrive.setConsumers(CONSUMER_RECORDER);
+                }
                 if (!mCamera->isRunning())
                 {
-                    puts("Starting camera");
+                    Logger::log(LOG_INFO, "Starting camera");
                     startCamera();
                 }
-                if (!mDataSaver.isRunning())
+                if (!mProcessSplit && !mDataSaver.isRunning())
                 {
-                    puts("Starting datasaver thread");
+                    Logger::log(LOG_INFO, "Starting datasaver thread");
                     mDataSaver.startThread();
                 }
                 break;
             case ML:
                 if (mDataSaver.isRunning())
                 {
-                    puts("Stopping datasaver thread");
+                    Logger::log(LOG_INFO, "Stopping datasaver thread");
                     mDataSaver.stopThread(true);
                 }
-                if (!mTorchDrive.isInitialised())
+                if (mModelPreload.valid())
+                {
+                    Logger::log(LOG_INFO, "Waiting for torch inference to be preloaded");
+                    mModelPreload.get();
+                }
+                if (!mProcessSplit && !mTorchDrive.isInitialised())
                 {
-                    puts("Initilising torch inference");
-                    mTorchDrive.initialise(mConfig.at("model"), 
-                                           cv::Size(std::stoi(mConfig.at("width")), std::stoi(mConfig.at("height"))), 
-                                           strToBool(mConfig.at("isMono")), 
-                                           strToBool(mConfig.at("tta")));
+                    Logger::log(LOG_INFO, "Initilising torch inference");
+                    mTorchDrive.initialise(*std::atomic_load(&mSettings));
+                }
+                if (mProcessSplit)
+                {
+                    Logger::log(LOG_INFO, "Passing frames to inference worker");
+                    mRemoteDrive.setConsumers(CONSUMER_INFERENCE);
+                }
+                else if (!mTorchDrive.isInitialised())
+                {
+                    Logger::log(LOG_ERROR, "Failed to initialise inference backend");
                 }
-                puts("Unregistering data saver");
-                static_cast<GenericListener<DriveCommands>&>(mDataSaver).unregisterFrom(&mGamepadDrive);
-                static_cast<GenericListener<CameraData>&>(mDataSaver).unregisterFrom(mCamera);
-                puts("Registering torch drive");
-                static_cast<GenericListener<CameraData>&>(mTorchDrive).registerTo(mCamera);
                 if (!mCamera->isRunning())
                 {
-                    puts("Starting camera");
+                    Logger::log(LOG_INFO, "Starting camera");
                     startCamera();
                 }
                 break;
             default:
                 break;
         }
+        Logger::log(LOG_INFO, "Activating pipeline of state %s", stateToStr(mState).c_str());
+        mPipeline.activate(stateToStr(mState));
+        mActiveState = mState;
         mPreviousState = mState;
+        mJournal.recordState(mState);
+        Logger::log(LOG_INFO, "Transition to state %s took %.1f ms", stateToStr(mState).c_str(), (getMonotonicTime() - startTime) * 1000.0);
     }
 }
 
@@ -296,19 +481,20 @@ void StateMachine::processStatePageAxis(const short value)
         {
             mState = static_cast<E_State>(tempState);
         }
-        printf("Going from state: %s to state: %s \n", stateToStr(mPreviousState).c_str(), stateToStr(mState).c_str());
+        Logger::log(LOG_INFO, "Going from state: %s to state: %s", stateToStr(mPreviousState).c_str(), stateToStr(mState).c_str());
         mOled.selectImage(mState);
     }
 }
 
 void StateMachine::startCamera()
 {
-    cv::Size imageSize(std::stoi(mConfig.at("width")), std::stoi(mConfig.at("height")));
-    bool isMono = strToBool(mConfig.at("isMono"));
+    std::shared_ptr<const Settings> settings = std::atomic_load(&mSettings);
+    cv::Size imageSize(settings->mWidth, settings->mHeight);
+    bool isMono = settings->mIsMono;
     std::vector<uint8_t> ids;
     if (isMono)
     {
-        ids.push_back(std::stoi(mConfig.at("monoID")));
+        ids.push_back(static_cast<uint8_t>(settings->mMonoId));
     }
     else
     {
@@ -316,5 +502,113 @@ void StateMachine::startCamera()
         ids.push_back(1);
     }
 
-    mCamera->startCamera(imageSize, std::stoi(mConfig.at("framerate")), 0, ids, 2, isMono, !isMono);
+    mCamera->startCamera(imageSize, settings->mFramerate, 0, ids, 2, isMono, !isMono);
+}
+
+void StateMachine::applyPerformanceLevel(const int level)
+{
+    ScopedLock lock(mLevelMutex);
+    std::shared_ptr<const Settings> settings = std::atomic_load(&mSettings);
+    mPerformanceLevel = level;
+    mTorchDrive.setTtaMode(level >= 1 ? TTA_OFF : settings->mTta);
+    mTorchDrive.setFrameDivider(level >= 2 ? static_cast<unsigned int>(settings->mGovernorFrameDivider) : 1u);
+    mTorchDrive.setMinimumLevel(level >= 3 ? 1 : 0);
+    mDataSaver.setJpegQuality(level >= 4 ? settings->mGovernorSaverQuality : settings->mSaverQuality);
+}
+
+void StateMachine::applySettings(const Settings& settings)
+{
+    // the level of the governor may change at any time, so it is checked against the level applied last
+    ScopedLock lock(mLevelMutex);
+    std::shared_ptr<Settings> updated = std::make_shared<Settings>(*std::atomic_load(&mSettings));
+    updated->applyReloadable(settings);
+    std::atomic_store(&mSettings, std::shared_ptr<const Settings>(updated));
+
+    mRacer.setSteeringGain(updated->mSteeringGain);
+    mRacer.setSteeringOffset(updated->mSteeringOffset);
+    mRacer.setThrottleGain(updated->mThrottleGain);
+    mTorchDrive.setIntraOpThreads(updated->mIntraOpThreads);
+    mTorchDrive.setAdaptiveTta(updated->mTtaSteeringThreshold, updated->mTtaChangeThreshold, updated->mTtaTimeBudget);
+    // the governor turns augmentations off from its first level, and it keeps them off
+    if (mPerformanceLevel < 1)
+    {
+        mTorchDrive.setTtaMode(updated->mTta);
+    }
+    Logger::log(LOG_INFO, "Applied reloaded configuration: steering gain %.3f, steering offset %.3f, throttle gain %.3f",
+                updated->mSteeringGain, updated->mSteeringOffset, updated->mThrottleGain);
+}
+
+void StateMachine::startJournal()
+{
+    char name[32];
+    time_t now = time(nullptr);
+    strftime(name, sizeof(name), "/%Y%m%d_%H%M%S.journal", localtime(&now));
+    std::experimental::filesystem::create_directories(mConfig.at("journalFolder"));
+    if (mJournal.open(mConfig.at("journalFolder") + name))
+    {
+        mJournal.recordState(mState);
+        mGamepad.registerTo(&mGamepadTap);
+        mCameraTap.registerTo(mFrames);
+        mGamepadDriveTap.registerTo(&mGamepadDrive);
+        mTorchDriveTap.registerTo(&mTorchDrive);
+        mTorchDriveTap.registerTo(&mRemoteDrive);
+    }
+}
+
+void StateMachine::startMetrics()
+{
+    mMetrics.addGauge("jetracer_state", "The active state: 0 for RC, 1 for RC_IMAGES, 2 for ML.", [this]() { return static_cast<double>(mActiveState.load()); });
+    mMetrics.addHistogram("jetracer_inference_latency_seconds", "Time spent by the model on a frame with inference.", mTorchDrive.getLatencyHistogram());
+    mMetrics.addGauge("jetracer_saver_queue_depth", "Frames received by the data saver but not yet processed.", [this]() { return static_cast<double>(mDataSaver.getQueueDepth()); });
+    mMetrics.addCounter("jetracer_saver_images_total", "Images saved by the data saver.", [this]() { return static_cast<double>(mDataSaver.getSavedImages()); });
+    mMetrics.addCounter("jetracer_saver_written_bytes_total", "Bytes written to disk by the data saver.", [this]() { return static_cast<double>(mDataSaver.getBytesWritten()); });
+    if (mImu.isRunning())
+    {
+        mMetrics.addCounter("jetracer_imu_samples_total", "Samples read from the IMU.", [this]() { return static_cast<double>(mImu.getSamples()); });
+        mMetrics.addCounter("jetracer_estimator_propagated_total", "Drive commands issued by the estimator between commands of the model.", 
+                            [this]() { return static_cast<double>(mEstimator.getPropagated()); });
+    }
+    if (mGovernor.isRunning())
+    {
+        mMetrics.addGauge("jetracer_cpu_temperature_celsius", "The highest temperature of all thermal zones.", [this]() { return mGovernor.getTemperature(); });
+        mMetrics.addGauge("jetracer_performance_level", "The performance level of the governor, 0 for full performance.", [this]() { return static_cast<double>(mGovernor.getLevel()); });
+    }
+
+    for (const E_TaskClass taskClass : {TASK_CONTROL, TASK_INFERENCE, TASK_RECORDING, TASK_DISPLAY})
+    {
+        mMetrics.addGauge("jetracer_task_pool_utilisation", "Share of the task pool capacity spent on tasks of a class.", 
+                          [this, taskClass]() { return mTaskPool.getUtilisation(taskClass); }, 
+                          std::string("class=\"") + TaskPool::taskClassToStr(taskClass) + "\"");
+    }
+
+    // series of each metric are added together, so that they share a single description
+    std::vector<std::pair<std::string, const PipelineEdgeBase*>> edges;
+    for (const E_State state : {RC, RC_IMAGES, ML})
+    {
+        for (const PipelineEdgeBase* edge : mPipeline.getEdges(stateToStr(state)))
+        {
+            edges.push_back({"graph=\"" + stateToStr(state) + "\",edge=\"" + edge->getName() + "\"", edge});
+        }
+    }
+    for (const std::pair<std::string, const PipelineEdgeBase*>& edge : edges)
+    {
+        mMetrics.addCounter("jetracer_pipeline_delivered_total", "Items delivered by a pipeline edge.", 
+                            [edge]() { return static_cast<double>(edge.second->getDelivered()); }, edge.first);
+    }
+    for (const std::pair<std::string, const PipelineEdgeBase*>& edge : edges)
+    {
+        mMetrics.addCounter("jetracer_pipeline_dropped_total", "Items dropped by a pipeline edge because its queue was full.", 
+                            [edge]() { return static_cast<double>(edge.second->getDropped()); }, edge.first);
+    }
+    for (const std::pair<std::string, const PipelineEdgeBase*>& edge : edges)
+    {
+        mMetrics.addGauge("jetracer_pipeline_depth", "Items waiting for delivery by a pipeline edge.", 
+                          [edge]() { return static_cast<double>(edge.second->getDepth()); }, edge.first);
+    }
+
+    mMetrics.registerTo(mFrames);
+    if (!mMetrics.startThread())
+    {
+        Logger::log(LOG_WARNING, "Failed to start metrics server");
+    }
 }
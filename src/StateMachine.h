@@ -22,15 +22,31 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <future>
+#include <memory>
+#include <pthread.h>
 #include <semaphore.h>
 #include <Gamepad.h>
 #include <GamepadDriveAdapter.h>
 #include <ICameraTalker.h>
 #include <NvidiaRacer.h>
-#include "CameraDriveAdapter.h"
 #include "DataSaver.h"
+#include "DriveModelPlugin.h"
+#include "EmergencyStop.h"
+#include "ImuReader.h"
+#include "MetricsServer.h"
 #include "OledWrapper.h"
+#include "PerformanceGovernor.h"
+#include "PipelineGraph.h"
+#include "PreviewStreamer.h"
+#include "RemoteDriveAdapter.h"
+#include "SessionJournal.h"
+#include "Settings.h"
+#include "StartupTimeline.h"
+#include "StereoRectifier.h"
+#include "SteeringEstimator.h"
 
 class Configuration;
 
@@ -48,9 +64,10 @@ public:
      * Basic constructor that initialises parameters, populates maps with gamepad axis and button actions, 
      * and registers listeners with talkers.
      *  @param config the main configuration.
+     *  @param settings values of the main configuration, parsed and validated.
      *  @param camera pointer to the camera, either mono or stereo.
      */
-    StateMachine(const Configuration& config, ICameraTalker* camera);
+    StateMachine(const Configuration& config, const Settings& settings, ICameraTalker* camera);
 
     /**
      * Basic destructor that calls stop().
@@ -58,22 +75,51 @@ public:
     virtual ~StateMachine();
 
     /**
-     * Initialises all classes and threads.
+     * Initialises all classes and threads. Independent devices are initialised concurrently and the model
+     * is optionally preloaded in the background.
+     *  @param timeline the timeline where duration of each step is recorded. It must outlive the state machine.
      *  @return true if the operation was successful.
      */
-    bool initialise();
+    bool initialise(StartupTimeline& timeline);
+
+    /**
+     * Starts the camera in paused state, so that entering states which need images does not wait for it.
+     *  @return true if the camera is running.
+     */
+    bool preloadCamera();
+
+    /**
+     * Loads the cached rectification maps used in place of the calibration of the stereo camera.
+     *  @return true if maps are available.
+     */
+    bool loadRectification();
 
     /**
      * Stops all threads.
      */
     void stop();
 
+    /**
+     * Applies values of a reloaded configuration that can be changed while running: racer gains, libtorch threads
+     * and test time augmentations. Other values are kept. This function is thread safe.
+     *  @param settings values of the reloaded configuration.
+     */
+    void applySettings(const Settings& settings);
+
     /**
      * Gamepad events for controlling the state machine.
      *  @param eventData gamepad event data.
      */
     void update(const GamepadEventData& eventData) override;
 
+    /**
+     *  @return the emergency stop, which can be triggered from a signal handler.
+     */
+    inline EmergencyStop& getEmergencyStop()
+    {
+        return mEmergencyStop;
+    }
+
     /**
      *  @return the semaphore for the main thread to wait on it.
      */
@@ -84,7 +130,7 @@ public:
 
 protected:
     /**
-     * Processes stop button event, i.e., stops all threads and exists the application.
+     * Processes stop button event, i.e., engages the emergency stop, which lets the application exit.
      *  @param value the value of the button, 1 for pressed.
      */
     void processStopButton(const short value);
@@ -113,32 +159,95 @@ private:
      */
     void startCamera();
 
+    /**
+     * Applies a performance level of the governor. Each level keeps the degradations of the previous ones:
+     * 1 disables TTA, 2 lowers the control rate, 3 switches to a lower resolution model, 4 lowers quality of saved images.
+     *  @param level the performance level, 0 for full performance.
+     */
+    void applyPerformanceLevel(const int level);
+
+    /**
+     * Opens a new session journal in the configured folder and starts recording all talker streams.
+     */
+    void startJournal();
+
+    /**
+     * Adds metrics of all components to the metrics server and starts it.
+     */
+    void startMetrics();
+
     /** The main configuration. */
     const Configuration& mConfig;
+    /** Values of the configuration, replaced as a whole when the configuration is reloaded. */
+    std::shared_ptr<const Settings> mSettings;
     /** The racer class. */
     NvidiaRacer mRacer;
+    /** Passes drive commands to the racer and zeroes throttle when the stop button is pressed. */
+    EmergencyStop mEmergencyStop;
     /** The OLED wrapper class. */
     OledWrapper mOled;
     /** Pointer to camera interface for either mono or stereo camera. */
     ICameraTalker* mCamera;
+    /** Rectifies stereo images with cached maps instead of the camera. */
+    StereoRectifier mRectifier;
+    /** The source of images for all listeners, either the camera or the rectifier. */
+    GenericTalker<CameraData>* mFrames;
     /** The data saver class. */
     DataSaver mDataSaver;
+    /** The live preview streamer. */
+    PreviewStreamer mPreview;
+    /** The thermal and power aware performance governor. */
+    PerformanceGovernor mGovernor;
+    /** Serves metrics over HTTP. */
+    MetricsServer mMetrics;
     /** The current state of the state machine. */
     E_State mState;
     /** The previous state. */
     E_State mPreviousState;
+    /** The state whose pipeline is active, read by the metrics server. */
+    std::atomic<int> mActiveState;
 	/** Gamepad class. */
 	Gamepad mGamepad;
     /** An adapter class for converting gamepad inputs into drive commands. */
     GamepadDriveAdapter mGamepadDrive;
-    /** An adapter class for converting images inputs into drive commands. */
-    CameraDriveAdapter mTorchDrive;
+    /** An adapter class for converting images inputs into drive commands, loaded from the inference plugin. */
+    DriveModelPlugin mTorchDrive;
+    /** An adapter class that passes images to worker processes and their drive commands to the racer. */
+    RemoteDriveAdapter mRemoteDrive;
+    /** Samples the IMU. */
+    ImuReader mImu;
+    /** Propagates drive commands of the model between camera frames using the IMU. */
+    SteeringEstimator mEstimator;
+    /** Flag indicating if inference and recording run in worker processes. */
+    bool mProcessSplit;
+    /** Edges between the camera, adapters, data saver and racer, one graph per state. */
+    PipelineGraph mPipeline;
+    /** Threads shared by pipeline edges that deliver items with tasks, stopped before the pipeline is destroyed. */
+    TaskPool mTaskPool;
+    /** The journal of all talker streams. */
+    SessionJournal mJournal;
+    /** Records gamepad events. */
+    JournalTap<GamepadEventData> mGamepadTap;
+    /** Records camera frames. */
+    JournalTap<CameraData> mCameraTap;
+    /** Records drive commands from the gamepad. */
+    JournalTap<DriveCommands> mGamepadDriveTap;
+    /** Records drive commands predicted by the model. */
+    JournalTap<DriveCommands> mTorchDriveTap;
     /** Flag indicating if the remote-controlled override state has been activated. */
     bool mRcOverride;
+    /** Flag indicating if the camera should be kept running in all states once started. */
+    bool mCameraStandby;
     /** Semaphore for pausing the main application thread. */
     sem_t mSemaphore;
     /** Map of actions for associated gamepad axis events. */
     std::unordered_map<int, std::function<void(StateMachine&, const short)>> mAxisActions;
     /** Map of actions for associated gamepad button events. */
     std::unordered_map<int, std::function<void(StateMachine&, const short)>> mButtonActions;
+    /** The result of the model preloaded in the background, valid until the preloading is awaited. */
+    std::future<void> mModelPreload;
+    /** Serialises the performance level of the governor with reloaded settings that it overrides. */
+    pthread_mutex_t mLevelMutex;
+    /** The performance level applied last, guarded by mLevelMutex. */
+    int mPerformanceLevel;
 };
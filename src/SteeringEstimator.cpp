@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <ScopedLock.h>
+#include "Settings.h"
+#include "SteeringEstimator.h"
+
+namespace
+{
+/** The weight of a new sample in the average of the yaw rate bias. */
+constexpr double BIAS_WEIGHT = 0.01;
+/** Throttle below which the car is assumed to stand still. */
+constexpr double STILL_THROTTLE = 0.01;
+/** Tolerance of sample times, so that jitter of the clock does not skip a period. */
+constexpr double TIME_TOLERANCE = 1e-6;
+} // end of anonymouse namespace
+
+SteeringEstimator::SteeringEstimator(const Settings& settings)
+: GenericListener<DriveCommands>(),
+  GenericListener<ImuData>(),
+  GenericTalker<DriveCommands>(),
+  mYawRateGain(settings.mEstimatorYawRateGain),
+  mCorrectionGain(settings.mEstimatorCorrectionGain),
+  mYawSign(settings.mImuYawSign),
+  mPeriod(1.0 / settings.mEstimatorRate),
+  mTimeout(settings.mEstimatorTimeout),
+  mCommands(),
+  mHasCommands(false),
+  mSequence(0),
+  mPublished(0),
+  mCommandsTime(0.0),
+  mSampleTime(0.0),
+  mPublishTime(0.0),
+  mYawRate(0.0),
+  mBias(0.0),
+  mPropagated(0)
+{
+    pthread_mutex_init(&mMutex, nullptr);
+    pthread_mutex_init(&mPublishMutex, nullptr);
+}
+
+SteeringEstimator::~SteeringEstimator()
+{
+    pthread_mutex_destroy(&mMutex);
+    pthread_mutex_destroy(&mPublishMutex);
+}
+
+void SteeringEstimator::update(const DriveCommands& driveCommands)
+{
+    unsigned long sequence;
+    {
+        ScopedLock lock(mMutex);
+        mCommands = driveCommands;
+        mHasCommands = true;
+        mCommandsTime = mSampleTime;
+        mPublishTime = mSampleTime;
+        sequence = ++mSequence;
+    }
+    publish(sequence, driveCommands, false);
+}
+
+void SteeringEstimator::update(const ImuData& imuData)
+{
+    DriveCommands corrected;
+    unsigned long sequence;
+    {
+        ScopedLock lock(mMutex);
+        double yawRate = mYawSign * static_cast<double>(imuData.mGyro[2]);
+        mSampleTime = imuData.mTime;
+        if (!mHasCommands || std::fabs(mCommands.mThrottle) < STILL_THROTTLE)
+        {
+            mBias = mBias + BIAS_WEIGHT * (yawRate - mBias);
+        }
+        mYawRate = yawRate - mBias;
+
+        if (!mHasCommands || mSampleTime - mCommandsTime > mTimeout || mSampleTime - mPublishTime < mPeriod - TIME_TOLERANCE)
+        {
+            return;
+        }
+        double desired = mYawRateGain * mCommands.mSteering * std::fabs(mCommands.mThrottle);
+        corrected = mCommands;
+        corrected.mSteering = static_cast<float>(std::clamp(mCommands.mSteering + mCorrectionGain * (desired - mYawRate), -1.0, 1.0));
+        mPublishTime = mSampleTime;
+        sequence = mSequence;
+    }
+    if (publish(sequence, corrected, true))
+    {
+        ++mPropagated;
+    }
+}
+
+bool SteeringEstimator::publish(const unsigned long sequence, const DriveCommands& driveCommands, const bool isCorrection)
+{
+    // listeners are notified under the lock, so that a correction never overtakes a newer command of the model
+    ScopedLock lock(mPublishMutex);
+    bool isCurrent = isCorrection ? (sequence == mPublished && sequence == mSequence) : (sequence > mPublished);
+    if (isCurrent)
+    {
+        mPublished = sequence;
+        notifyListeners(driveCommands);
+    }
+    return isCurrent;
+}
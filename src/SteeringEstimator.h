@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <pthread.h>
+#include <DriveCommands.h>
+#include <GenericListener.h>
+#include <GenericTalker.h>
+#include "ImuData.h"
+
+struct Settings;
+
+/**
+ * Propagates drive commands of the model between camera frames using the yaw rate measured by the IMU. The steering
+ * of the model is taken as the desired yaw rate, proportional to steering and throttle, and on each IMU sample the
+ * steering is corrected by the difference between the desired and the measured yaw rate. Corrected commands are passed
+ * on at a fixed rate until the model is late by more than a timeout; without IMU samples, model commands are passed on as is.
+ * Each command of the model gets a sequence number and commands are passed on in order under a lock, so a correction
+ * computed from a command that is no longer current is dropped. The gyroscope bias is tracked while the car stands still.
+ */
+class SteeringEstimator : public GenericListener<DriveCommands>,
+                          public GenericListener<ImuData>,
+                          public GenericTalker<DriveCommands>
+{
+public:
+    /**
+     * Initialises parameters of the estimator.
+     *  @param settings the settings of the application.
+     */
+    explicit SteeringEstimator(const Settings& settings);
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~SteeringEstimator();
+
+    /**
+     * Stores drive commands of the model and passes them on.
+     *  @param driveCommands the latest drive commands predicted by the model.
+     */
+    void update(const DriveCommands& driveCommands) override;
+
+    /**
+     * Updates the yaw rate and passes on corrected drive commands if it is time to do so.
+     *  @param imuData the latest IMU sample.
+     */
+    void update(const ImuData& imuData) override;
+
+    /**
+     *  @return the number of drive commands issued between commands of the model.
+     */
+    inline unsigned long getPropagated() const
+    {
+        return mPropagated;
+    }
+
+    /**
+     *  @return the estimated bias of the yaw rate in rad/s.
+     */
+    inline double getYawRateBias() const
+    {
+        return mBias;
+    }
+
+private:
+    /**
+     * Passes on drive commands unless newer ones have already been passed on.
+     *  @param sequence the sequence number of the command of the model the drive commands are based on.
+     *  @param driveCommands the drive commands.
+     *  @param isCorrection true for commands corrected between commands of the model.
+     *  @return true if the drive commands were passed on.
+     */
+    bool publish(const unsigned long sequence, const DriveCommands& driveCommands, const bool isCorrection);
+
+    /** The yaw rate in rad/s at full steering and full throttle. */
+    double mYawRateGain;
+    /** The steering correction per rad/s of yaw rate error. */
+    double mCorrectionGain;
+    /** Sign of the yaw axis of the IMU with respect to the steering. */
+    double mYawSign;
+    /** The period in seconds of propagated commands. */
+    double mPeriod;
+    /** The time in seconds after a command of the model for which it is propagated. */
+    double mTimeout;
+    /** The latest drive commands of the model. */
+    DriveCommands mCommands;
+    /** Flag indicating that the model has issued commands. */
+    bool mHasCommands;
+    /** The sequence number of the latest commands of the model. */
+    std::atomic<unsigned long> mSequence;
+    /** The sequence number of the commands of the model that the last passed on commands are based on. */
+    unsigned long mPublished;
+    /** The time of the IMU sample at which the latest commands arrived. */
+    double mCommandsTime;
+    /** The time of the latest IMU sample. */
+    double mSampleTime;
+    /** The time of the latest propagated commands. */
+    double mPublishTime;
+    /** The bias-corrected yaw rate of the latest IMU sample. */
+    double mYawRate;
+    /** The estimated bias of the yaw rate. */
+    std::atomic<double> mBias;
+    /** The number of propagated commands. */
+    std::atomic<unsigned long> mPropagated;
+    /** Guards the state shared by the model and IMU threads. */
+    pthread_mutex_t mMutex;
+    /** Guards passing on of drive commands. */
+    pthread_mutex_t mPublishMutex;
+};
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include "RectificationVerifier.h"
+#include "Settings.h"
+#include "StereoRectifier.h"
+#include "Timing.h"
+
+StereoRectifier::StereoRectifier(const Settings& settings)
+: GenericListener<CameraData>(),
+  GenericTalker<CameraData>(),
+  mCalibration(settings.mCalibration),
+  mCacheFolder(settings.mRectificationCacheFolder),
+  mImageSize(settings.mWidth, settings.mHeight),
+  mCache(),
+  mRectified(),
+  mLatency()
+{
+}
+
+StereoRectifier::~StereoRectifier()
+{
+}
+
+bool StereoRectifier::load()
+{
+    RectificationVerifier verifier(mCalibration, mImageSize);
+    // maps are computed with guessed rectification parameters, so they are only cached if they match the camera's own rectification
+    return mCache.load(mCalibration, mImageSize, mCacheFolder, [&verifier](const RectificationCache& cache) { return verifier.verify(cache); });
+}
+
+void StereoRectifier::update(const CameraData& cameraData)
+{
+    if (!mCache.isLoaded() || cameraData.mImage.size() != 2)
+    {
+        notifyListeners(cameraData);
+        return;
+    }
+
+    double start = getMonotonicTime();
+    mRectified.mImage.resize(2);
+    for (int i = 0; i < 2; ++i)
+    {
+        const cv::cuda::HostMem& image = cameraData.mImage[i];
+        if (mRectified.mImage[i].rows != image.rows || mRectified.mImage[i].cols != image.cols || mRectified.mImage[i].type() != image.type())
+        {
+            mRectified.mImage[i].create(image.rows, image.cols, image.type());
+        }
+        cv::Mat rectified = mRectified.mImage[i].createMatHeader();
+        mCache.rectify(image.createMatHeader(), rectified, i);
+    }
+    mLatency.addSample(getMonotonicTime() - start);
+    notifyListeners(mRectified);
+}
+
+void StereoRectifier::printStatistics() const
+{
+    mLatency.print("Rectification");
+}
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <CameraData.h>
+#include <GenericListener.h>
+#include <GenericTalker.h>
+#include "LatencyStats.h"
+#include "RectificationCache.h"
+
+struct Settings;
+
+/**
+ * Rectifies raw stereo images with cached fixed-point maps and passes them to its own listeners.
+ * It is used in place of the rectification of the stereo camera, which is then started without calibration.
+ */
+class StereoRectifier : public GenericListener<CameraData>, public GenericTalker<CameraData>
+{
+public:
+    /**
+     * Reads the calibration and cache paths.
+     *  @param settings the settings of the application.
+     */
+    explicit StereoRectifier(const Settings& settings);
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~StereoRectifier();
+
+    /**
+     * Loads rectification maps from the cache, or computes them and caches them once they match the camera's rectification.
+     * The stereo camera must not be running, as it is used to verify computed maps.
+     *  @return true if maps are available.
+     */
+    bool load();
+
+    /**
+     * Rectifies both images and notifies listeners. Images are passed unchanged if maps are not available, in which case
+     * the camera has to be started with its calibration.
+     *  @param cameraData the latest camera data received from the stereo camera.
+     */
+    void update(const CameraData& cameraData) override;
+
+    /**
+     * Prints the per frame cost of rectification.
+     */
+    void printStatistics() const;
+
+private:
+    /** Path to the folder with calibration files. */
+    std::string mCalibration;
+    /** Path to the folder with cached maps. */
+    std::string mCacheFolder;
+    /** The size of a single image. */
+    cv::Size mImageSize;
+    /** Rectification maps. */
+    RectificationCache mCache;
+    /** Rectified images, reused between frames. */
+    CameraData mRectified;
+    /** The time of rectifying both images. */
+    LatencyStats mLatency;
+};
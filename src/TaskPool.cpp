@@ -0,0 +1,294 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <sched.h>
+#include <thread>
+#include <ScopedLock.h>
+#include "Logger.h"
+#include "TaskPool.h"
+#include "Timing.h"
+
+namespace
+{
+/** The period in seconds after which an idle worker checks whether it should stop. */
+constexpr double WORKER_TIMEOUT = 0.1;
+/** The names of task classes. */
+const char* TASK_CLASS_NAMES[TASK_CLASSES] = {"control", "inference", "recording", "display"};
+/** The worker running on the current thread, nullptr outside of any pool. */
+thread_local TaskWorker* currentWorker = nullptr;
+} // end of anonymouse namespace
+
+TaskWorker::TaskWorker(TaskPool& pool, const size_t index)
+: GenericThread<TaskWorker>(),
+  mPool(pool),
+  mIndex(index),
+  mQueues()
+{
+    pthread_mutex_init(&mQueueMutex, nullptr);
+}
+
+TaskWorker::~TaskWorker()
+{
+    stopThread(false);
+    pthread_mutex_destroy(&mQueueMutex);
+}
+
+void* TaskWorker::threadBody()
+{
+    currentWorker = this;
+    mPool.run(*this);
+    currentWorker = nullptr;
+    return nullptr;
+}
+
+TaskPool::TaskPool(const size_t threads, const bool pinned)
+: mWorkers(),
+  mPinned(pinned),
+  mRunning(false),
+  mNextWorker(0),
+  mBackground(0),
+  mStartTime(0.0),
+  mStolen(0)
+{
+    size_t count = (threads > 0) ? threads : std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < count; ++i)
+    {
+        mWorkers.push_back(std::make_unique<TaskWorker>(*this, i));
+    }
+    for (int i = 0; i < TASK_CLASSES; ++i)
+    {
+        mExecuted[i] = 0;
+        mBusyTime[i] = 0;
+        mWaitTime[i] = 0;
+    }
+    sem_init(&mTasks, 0, 0);
+}
+
+TaskPool::~TaskPool()
+{
+    stop();
+    sem_destroy(&mTasks);
+}
+
+bool TaskPool::start()
+{
+    bool retVal = true;
+    if (!mRunning)
+    {
+        mRunning = true;
+        mStartTime = getMonotonicTime();
+        for (std::unique_ptr<TaskWorker>& worker : mWorkers)
+        {
+            retVal = worker->startThread() && retVal;
+        }
+        Logger::log(LOG_INFO, "Task pool started with %zu threads", mWorkers.size());
+    }
+    return retVal;
+}
+
+void TaskPool::stop()
+{
+    if (mRunning)
+    {
+        mRunning = false;
+        for (size_t i = 0; i < mWorkers.size(); ++i)
+        {
+            sem_post(&mTasks);
+        }
+        for (std::unique_ptr<TaskWorker>& worker : mWorkers)
+        {
+            worker->stopThread(false);
+        }
+        for (std::unique_ptr<TaskWorker>& worker : mWorkers)
+        {
+            ScopedLock lock(worker->mQueueMutex);
+            for (std::deque<TaskWorker::QueuedTask>& queue : worker->mQueues)
+            {
+                queue.clear();
+            }
+        }
+    }
+}
+
+void TaskPool::submit(const E_TaskClass taskClass, const std::function<void()>& task)
+{
+    TaskWorker* worker = currentWorker;
+    if (nullptr == worker || &worker->mPool != this)
+    {
+        worker = mWorkers[mNextWorker++ % mWorkers.size()].get();
+    }
+    {
+        ScopedLock lock(worker->mQueueMutex);
+        worker->mQueues[taskClass].push_back({task, getMonotonicTime()});
+    }
+    sem_post(&mTasks);
+}
+
+double TaskPool::getUtilisation(const E_TaskClass taskClass) const
+{
+    double elapsed = (getMonotonicTime() - mStartTime) * static_cast<double>(mWorkers.size());
+    return (mStartTime > 0.0 && elapsed > 0.0) ? static_cast<double>(mBusyTime[taskClass]) * 1e-9 / elapsed : 0.0;
+}
+
+void TaskPool::printStatistics() const
+{
+    unsigned long executed;
+    for (int i = 0; i < TASK_CLASSES; ++i)
+    {
+        executed = mExecuted[i];
+        if (executed > 0)
+        {
+            printf("Task pool %s: %lu tasks, mean wait %.2f ms, mean run %.2f ms, utilisation %.1f%% \n", TASK_CLASS_NAMES[i], executed, 
+                   static_cast<double>(mWaitTime[i]) * 1e-6 / executed, static_cast<double>(mBusyTime[i]) * 1e-6 / executed,
+                   getUtilisation(static_cast<E_TaskClass>(i)) * 100.0);
+        }
+    }
+    printf("Task pool: %zu threads, %lu tasks stolen \n", mWorkers.size(), mStolen.load());
+}
+
+bool TaskPool::strToTaskClass(const std::string& name, E_TaskClass& taskClass)
+{
+    for (int i = 0; i < TASK_CLASSES; ++i)
+    {
+        if (name == TASK_CLASS_NAMES[i])
+        {
+            taskClass = static_cast<E_TaskClass>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* TaskPool::taskClassToStr(const E_TaskClass taskClass)
+{
+    return TASK_CLASS_NAMES[taskClass];
+}
+
+void TaskPool::run(TaskWorker& worker)
+{
+    struct timespec wakeUp;
+    TaskWorker::QueuedTask task;
+    E_TaskClass taskClass;
+    double startTime;
+
+    if (mPinned)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(static_cast<int>(worker.mIndex % std::max(1u, std::thread::hardware_concurrency())), &cpus);
+        if (0 != pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))
+        {
+            Logger::log(LOG_WARNING, "Failed to pin task pool thread %zu", worker.mIndex);
+        }
+    }
+
+    while (mRunning)
+    {
+        clock_gettime(CLOCK_REALTIME, &wakeUp);
+        wakeUp.tv_nsec += static_cast<long>(WORKER_TIMEOUT * 1e9);
+        if (wakeUp.tv_nsec >= 1000000000L)
+        {
+            ++wakeUp.tv_sec;
+            wakeUp.tv_nsec -= 1000000000L;
+        }
+        // a wake-up may be consumed by a worker that cannot take the task, so queues are drained before waiting again
+        if (-1 == sem_timedwait(&mTasks, &wakeUp) && EINTR == errno)
+        {
+            continue;
+        }
+        while (mRunning && take(worker, task, taskClass))
+        {
+            startTime = getMonotonicTime();
+            mWaitTime[taskClass] += static_cast<unsigned long long>((startTime - task.mSubmitTime) * 1e9);
+            task.mTask();
+            mBusyTime[taskClass] += static_cast<unsigned long long>((getMonotonicTime() - startTime) * 1e9);
+            ++mExecuted[taskClass];
+            if (taskClass >= TASK_RECORDING)
+            {
+                --mBackground;
+            }
+        }
+    }
+}
+
+bool TaskPool::take(TaskWorker& worker, TaskWorker::QueuedTask& task, E_TaskClass& taskClass)
+{
+    // with more than one worker, at least one is always left for control and inference tasks
+    const size_t backgroundLimit = std::max(static_cast<size_t>(1), mWorkers.size() - 1);
+    size_t background;
+    for (int i = 0; i < TASK_CLASSES; ++i)
+    {
+        taskClass = static_cast<E_TaskClass>(i);
+        if (taskClass >= TASK_RECORDING)
+        {
+            background = mBackground;
+            do
+            {
+                if (background >= backgroundLimit)
+                {
+                    return false;
+                }
+            } while (!mBackground.compare_exchange_weak(background, background + 1));
+        }
+        if (takeFrom(worker, true, taskClass, task))
+        {
+            return true;
+        }
+        for (size_t j = 1; j < mWorkers.size(); ++j)
+        {
+            if (takeFrom(*mWorkers[(worker.mIndex + j) % mWorkers.size()], false, taskClass, task))
+            {
+                ++mStolen;
+                return true;
+            }
+        }
+        if (taskClass >= TASK_RECORDING)
+        {
+            --mBackground;
+        }
+    }
+    return false;
+}
+
+bool TaskPool::takeFrom(TaskWorker& owner, const bool own, const E_TaskClass taskClass, TaskWorker::QueuedTask& task)
+{
+    ScopedLock lock(owner.mQueueMutex);
+    std::deque<TaskWorker::QueuedTask>& queue = owner.mQueues[taskClass];
+    if (queue.empty())
+    {
+        return false;
+    }
+    if (own)
+    {
+        task = std::move(queue.back());
+        queue.pop_back();
+    }
+    else
+    {
+        task = std::move(queue.front());
+        queue.pop_front();
+    }
+    return true;
+}
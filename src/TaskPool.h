@@ -0,0 +1,245 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <pthread.h>
+#include <semaphore.h>
+#include <string>
+#include <vector>
+#include <GenericThread.h>
+
+/**
+ * An enum representing priority classes of tasks, from the most to the least urgent.
+ */
+enum E_TaskClass
+{
+    TASK_CONTROL   = 0,
+    TASK_INFERENCE = 1,
+    TASK_RECORDING = 2,
+    TASK_DISPLAY   = 3,
+    TASK_CLASSES   = 4
+};
+
+class TaskPool;
+
+/**
+ * A thread of the task pool with its own queue of tasks per priority class.
+ */
+class TaskWorker : public GenericThread<TaskWorker>
+{
+public:
+    /**
+     * Basic constructor.
+     *  @param pool the pool that owns the worker.
+     *  @param index the index of the worker in the pool.
+     */
+    TaskWorker(TaskPool& pool, const size_t index);
+
+    /**
+     * Stops the thread.
+     */
+    virtual ~TaskWorker();
+
+    /**
+     * The main body of the worker thread.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    friend class TaskPool;
+
+    /**
+     * A queued task with the time at which it was submitted.
+     */
+    struct QueuedTask
+    {
+        /** The task. */
+        std::function<void()> mTask;
+        /** The monotonic time of submission. */
+        double mSubmitTime;
+    };
+
+    /** The pool that owns the worker. */
+    TaskPool& mPool;
+    /** The index of the worker in the pool. */
+    size_t mIndex;
+    /** Tasks of each class, the owner takes the newest and thieves the oldest. */
+    std::deque<QueuedTask> mQueues[TASK_CLASSES];
+    /** Guards the queues. */
+    pthread_mutex_t mQueueMutex;
+};
+
+/**
+ * A pool of worker threads, by default one per core, shared by pipeline components. Each worker queues tasks submitted
+ * from it and steals from other workers when its own queues are empty. Tasks are taken in the order of priority classes
+ * across all queues, and recording and display tasks never occupy all workers, so that control and inference tasks
+ * always find a free worker. Time spent on tasks of each class is accounted for utilisation statistics.
+ */
+class TaskPool
+{
+public:
+    /**
+     * Basic constructor.
+     *  @param threads the number of worker threads, 0 for one per core.
+     *  @param pinned true to pin each worker to a core.
+     */
+    TaskPool(const size_t threads, const bool pinned);
+
+    /**
+     * Stops the workers.
+     */
+    virtual ~TaskPool();
+
+    /**
+     * Starts the workers.
+     *  @return true if all workers started.
+     */
+    bool start();
+
+    /**
+     * Stops the workers, tasks that were not started are dropped.
+     */
+    void stop();
+
+    /**
+     * Queues a task. Tasks submitted by a worker are queued by that worker, other tasks are spread over all workers.
+     *  @param taskClass the priority class of the task.
+     *  @param task the task.
+     */
+    void submit(const E_TaskClass taskClass, const std::function<void()>& task);
+
+    /**
+     *  @return true if the workers are running.
+     */
+    inline bool isRunning() const
+    {
+        return mRunning;
+    }
+
+    /**
+     *  @return the number of worker threads.
+     */
+    inline size_t getThreads() const
+    {
+        return mWorkers.size();
+    }
+
+    /**
+     * Returns the share of the pool's capacity spent on tasks of the class since the pool started.
+     *  @param taskClass the priority class.
+     *  @return the utilisation between 0 and 1.
+     */
+    double getUtilisation(const E_TaskClass taskClass) const;
+
+    /**
+     *  @param taskClass the priority class.
+     *  @return the number of executed tasks of the class.
+     */
+    inline unsigned long getExecuted(const E_TaskClass taskClass) const
+    {
+        return mExecuted[taskClass];
+    }
+
+    /**
+     *  @return the number of tasks taken from queues of other workers.
+     */
+    inline unsigned long getStolen() const
+    {
+        return mStolen;
+    }
+
+    /**
+     * Prints the number of tasks, their mean queueing time and the utilisation of each class.
+     */
+    void printStatistics() const;
+
+    /**
+     * Converts the name of a priority class.
+     *  @param name the name: control, inference, recording or display.
+     *  @param taskClass the priority class.
+     *  @return true if the name is valid.
+     */
+    static bool strToTaskClass(const std::string& name, E_TaskClass& taskClass);
+
+    /**
+     *  @param taskClass the priority class.
+     *  @return the name of the class.
+     */
+    static const char* taskClassToStr(const E_TaskClass taskClass);
+
+private:
+    friend class TaskWorker;
+
+    /**
+     * Runs tasks on the worker thread until the pool stops.
+     *  @param worker the worker.
+     */
+    void run(TaskWorker& worker);
+
+    /**
+     * Takes the most urgent task, from the worker's own queues first and then from the other workers.
+     *  @param worker the worker looking for a task.
+     *  @param task the task taken.
+     *  @param taskClass the class of the task.
+     *  @return true if a task was taken.
+     */
+    bool take(TaskWorker& worker, TaskWorker::QueuedTask& task, E_TaskClass& taskClass);
+
+    /**
+     * Takes a task of the class from the queue of a worker.
+     *  @param owner the worker whose queue is searched.
+     *  @param own true if the owner is the calling worker, which takes the newest task rather than the oldest.
+     *  @param taskClass the class of the task.
+     *  @param task the task taken.
+     *  @return true if a task was taken.
+     */
+    bool takeFrom(TaskWorker& owner, const bool own, const E_TaskClass taskClass, TaskWorker::QueuedTask& task);
+
+    /** The worker threads. */
+    std::vector<std::unique_ptr<TaskWorker>> mWorkers;
+    /** Flag indicating that workers are pinned to cores. */
+    bool mPinned;
+    /** Flag indicating that the workers are running. */
+    std::atomic<bool> mRunning;
+    /** Counts submitted tasks to wake up idle workers. */
+    sem_t mTasks;
+    /** The index of the worker that receives the next task submitted from outside the pool. */
+    std::atomic<size_t> mNextWorker;
+    /** The number of workers running recording or display tasks. */
+    std::atomic<size_t> mBackground;
+    /** The time at which the pool started. */
+    double mStartTime;
+    /** The number of executed tasks of each class. */
+    std::atomic<unsigned long> mExecuted[TASK_CLASSES];
+    /** The time in nanoseconds spent on tasks of each class. */
+    std::atomic<unsigned long long> mBusyTime[TASK_CLASSES];
+    /** The time in nanoseconds tasks of each class waited in queues. */
+    std::atomic<unsigned long long> mWaitTime[TASK_CLASSES];
+    /** The number of tasks taken from queues of other workers. */
+    std::atomic<unsigned long> mStolen;
+};
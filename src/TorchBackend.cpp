@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <ATen/ATen.h>
+#include <torch/cuda.h>
+#include "Timing.h"
+#include "TorchBackend.h"
+#include "TorchScriptCache.h"
+
+TorchBackend::TorchBackend(const bool optimise)
+: IInferenceBackend(),
+  mDevice(torch::cuda::is_available() ? torch::kCUDA : torch::kCPU),
+  mModule(),
+  mOptimise(optimise)
+{
+}
+
+TorchBackend::~TorchBackend()
+{
+}
+
+bool TorchBackend::initialise(const std::string& pathToModel, const cv::Mat& input)
+{
+    if (mOptimise)
+    {
+        std::string optimisedPath = TorchScriptCache::prepare(pathToModel, input);
+        if (optimisedPath != pathToModel && load(optimisedPath))
+        {
+            return true;
+        }
+    }
+    return load(pathToModel);
+}
+
+void TorchBackend::process(const cv::Mat& blob, std::vector<cv::Vec2f>& outputs)
+{
+    torch::NoGradGuard noGrad;
+    // the blob outlives the forward pass, so it is wrapped instead of copied
+    at::Tensor input = torch::from_blob(const_cast<float*>(blob.ptr<float>()), {blob.size[0], blob.size[1], blob.size[2], blob.size[3]});
+    at::Tensor results = mModule.forward({input.to(mDevice)}).toTensor();
+
+    results = results.to(at::kCPU).to(at::kFloat).contiguous();
+    outputs.resize(static_cast<size_t>(results.size(0)));
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        outputs[i] = cv::Vec2f(results[i][0].item<float>(), results[i][1].item<float>());
+    }
+}
+
+bool TorchBackend::load(const std::string& pathToModel)
+{
+    double startTime = getMonotonicTime();
+    try
+    {
+        mModule = torch::jit::load(pathToModel, mDevice);
+        mModule.eval();
+    }
+    catch (const c10::Error& error)
+    {
+        printf("Failed to load torch model %s: %s \n", pathToModel.c_str(), error.what());
+        return false;
+    }
+    printf("Loaded torch model %s in %.1f ms \n", pathToModel.c_str(), (getMonotonicTime() - startTime) * 1000.0);
+    return true;
+}
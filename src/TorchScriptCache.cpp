@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <torch/cuda.h>
+#include <torch/script.h>
+#include <torch/version.h>
+#include "Logger.h"
+#include "Timing.h"
+#include "TorchScriptCache.h"
+
+namespace
+{
+/** Maximum absolute difference between outputs of the original and the optimised model for the latter to be cached. */
+constexpr float OUTPUT_TOLERANCE = 1e-3f;
+/** Version of the preparation, models cached by earlier versions were not checked on the shape of pre-processed input. */
+constexpr int CACHE_VERSION = 3;
+
+/**
+ * Updates FNV-1a hash with data.
+ *  @param hash the hash to update.
+ *  @param data the data.
+ *  @param size the size of the data in bytes.
+ */
+void fnv1a(uint64_t& hash, const void* data, const size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+}
+} // end of anonymouse namespace
+
+std::string TorchScriptCache::prepare(const std::string& pathToModel, const cv::Mat& input)
+{
+    // frozen modules have no parameters, so they cannot be moved between devices and are prepared on the target one
+    const torch::Device device(torch::cuda::is_available() ? torch::kCUDA : torch::kCPU);
+    const uint64_t hash = hashModel(pathToModel, device.str(), input);
+    char suffix[64];
+
+    if (input.dims != 4 || input.type() != CV_32F)
+    {
+        Logger::log(LOG_WARNING, "Input of %s is not an NCHW float blob, the model is not optimised", pathToModel);
+        return pathToModel;
+    }
+    if (0 == hash)
+    {
+        Logger::log(LOG_WARNING, "Failed to read %s, the model is not optimised", pathToModel);
+        return pathToModel;
+    }
+
+    std::string::size_type extension = pathToModel.rfind(".ts");
+    snprintf(suffix, sizeof(suffix), ".frozen_%016llx_%dx%dx%d.ts", static_cast<unsigned long long>(hash), input.size[0], input.size[3], input.size[2]);
+    std::string cachedPath = pathToModel.substr(0, extension) + suffix;
+    if (std::ifstream(cachedPath).good())
+    {
+        return cachedPath;
+    }
+
+    double startTime = getMonotonicTime();
+    std::string temporaryPath = cachedPath + ".tmp";
+    try
+    {
+        torch::NoGradGuard noGrad;
+        torch::jit::Module module = torch::jit::load(pathToModel, device);
+        module.eval();
+        // the optimisations may change numerics, so the optimised module has to reproduce the original on the real input shape
+        at::Tensor probe = torch::from_blob(const_cast<float*>(input.ptr<float>()), {input.size[0], input.size[1], input.size[2], input.size[3]}).to(device);
+        at::Tensor expected = module.forward({probe}).toTensor().to(at::kFloat);
+        torch::jit::Module frozen = torch::jit::freeze(module);
+        frozen = torch::jit::optimize_for_inference(frozen);
+        at::Tensor actual = frozen.forward({probe}).toTensor().to(at::kFloat);
+        if (actual.sizes() != expected.sizes())
+        {
+            Logger::log(LOG_WARNING, "Optimised %s changes the output shape, the original model is used", pathToModel);
+            return pathToModel;
+        }
+        float difference = (actual - expected).abs().max().item<float>();
+        if (!(difference <= OUTPUT_TOLERANCE))
+        {
+            Logger::log(LOG_WARNING, "Optimised %s differs from the original by %f, the original model is used", pathToModel, difference);
+            return pathToModel;
+        }
+        frozen.save(temporaryPath);
+    }
+    catch (const c10::Error& error)
+    {
+        Logger::log(LOG_WARNING, "Failed to optimise %s, the original model is used: %s", pathToModel, std::string(error.what()));
+        std::remove(temporaryPath.c_str());
+        return pathToModel;
+    }
+    if (0 != std::rename(temporaryPath.c_str(), cachedPath.c_str()))
+    {
+        Logger::log(LOG_WARNING, "Failed to cache the optimised model in %s, the original model is used", cachedPath);
+        std::remove(temporaryPath.c_str());
+        return pathToModel;
+    }
+    Logger::log(LOG_INFO, "Optimised model cached in %s in %.1f ms", cachedPath, (getMonotonicTime() - startTime) * 1000.0);
+    return cachedPath;
+}
+
+uint64_t TorchScriptCache::hashModel(const std::string& pathToModel, const std::string& device, const cv::Mat& input)
+{
+    std::ifstream file(pathToModel, std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    std::vector<int> shape(input.size.p, input.size.p + input.dims);
+
+    if (!file.is_open())
+    {
+        return 0;
+    }
+    while (file.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || file.gcount() > 0)
+    {
+        fnv1a(hash, buffer.data(), static_cast<size_t>(file.gcount()));
+    }
+    fnv1a(hash, TORCH_VERSION, sizeof(TORCH_VERSION));
+    fnv1a(hash, device.data(), device.size());
+    fnv1a(hash, shape.data(), shape.size() * sizeof(int));
+    fnv1a(hash, &CACHE_VERSION, sizeof(CACHE_VERSION));
+    return hash;
+}
@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <opencv2/core.hpp>
+
+/**
+ * Prepares TorchScript models for inference: the module is frozen, which inlines parameters as constants and folds
+ * convolutions with batch normalisation, and passed through inference optimisations of libtorch. The optimised module
+ * is cached only if it reproduces the output of the original on a pre-processed input, under the hash of the original,
+ * the libtorch version, the device and the input shape, so that the preparation runs only once per model and shape.
+ */
+class TorchScriptCache
+{
+public:
+    /**
+     * Returns the path to the optimised model, preparing and caching it if it has not been cached yet.
+     *  @param pathToModel path to the original model.
+     *  @param input the NCHW float input created by ImagePreprocessor, which is side-by-side for a stereo camera and
+     *               has a batch of 2 with test time augmentations.
+     *  @return the path to the optimised model, or the original path if the model could not be optimised or the optimised
+     *          model differs from the original.
+     */
+    static std::string prepare(const std::string& pathToModel, const cv::Mat& input);
+
+    /**
+     * Computes the key of the optimised model.
+     *  @param pathToModel path to the original model.
+     *  @param device the name of the device on which the model runs.
+     *  @param input the input of the model.
+     *  @return the hash, or 0 if the model could not be read.
+     */
+    static uint64_t hashModel(const std::string& pathToModel, const std::string& device, const cv::Mat& input);
+};
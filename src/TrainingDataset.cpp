@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cstdio>
+#include <experimental/filesystem>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <torch/types.h>
+#include "ImagePreprocessor.h"
+#include "Logger.h"
+#include "TrainingDataset.h"
+
+namespace
+{
+/**
+ * Resizes the image to the model input size if needed, as CameraDriveAdapter does it.
+ *  @param image the image.
+ *  @param imageSize size of the model input.
+ *  @param resized buffer for the resized image.
+ *  @return the image or the resized buffer.
+ */
+const cv::Mat& resizeToInput(const cv::Mat& image, const cv::Size& imageSize, cv::Mat& resized)
+{
+    if (image.size() == imageSize)
+    {
+        return image;
+    }
+    cv::resize(image, resized, imageSize, 0, 0, cv::INTER_AREA);
+    return resized;
+}
+} // end of anonymouse namespace
+
+TrainingDataset::TrainingDataset(const std::vector<std::string>& folders, const cv::Size& imageSize, const bool isMono)
+: torch::data::datasets::Dataset<TrainingDataset>(),
+  mSamples(),
+  mImageSize(imageSize),
+  mIsMono(isMono)
+{
+    Sample sample;
+    for (const std::string& folder : folders)
+    {
+        if (!std::experimental::filesystem::is_directory(folder))
+        {
+            Logger::log(LOG_WARNING, "Training folder %s does not exist", folder);
+            continue;
+        }
+        for (const std::experimental::filesystem::directory_entry& entry : std::experimental::filesystem::recursive_directory_iterator(folder))
+        {
+            sample.mPath = entry.path().string();
+            if (entry.path().extension() == ".jpg" && parseLabels(sample.mPath, sample.mDriveCommands))
+            {
+                mSamples.push_back(sample);
+            }
+        }
+    }
+
+    // directory order is not specified, sorting makes shuffling with a seed reproducible
+    std::sort(mSamples.begin(), mSamples.end(), [](const Sample& a, const Sample& b){ return a.mPath < b.mPath; });
+    Logger::log(LOG_INFO, "Loaded %zu training samples from %zu folders", mSamples.size(), folders.size());
+}
+
+TrainingDataset::~TrainingDataset()
+{
+}
+
+torch::data::Example<> TrainingDataset::get(size_t index)
+{
+    const cv::Size inputSize = getInputSize();
+    torch::Tensor input = torch::empty({getChannels(), inputSize.height, inputSize.width}, torch::kFloat);
+    torch::Tensor target = torch::empty({2}, torch::kFloat);
+    TORCH_CHECK(load(index, false, input.data_ptr<float>(), target.data_ptr<float>()), "Failed to decode ", mSamples[index].mPath);
+    return {input, target};
+}
+
+torch::optional<size_t> TrainingDataset::size() const
+{
+    return mSamples.size();
+}
+
+bool TrainingDataset::load(const size_t index, const bool flip, float* input, float* target) const
+{
+    // pre-processing buffers of each thread are reused across samples
+    thread_local ImagePreprocessor preprocessor;
+    thread_local cv::Mat resized[2];
+    thread_local cv::Mat normalised;
+    const Sample& sample = mSamples[index];
+    cv::Mat image = cv::imread(sample.mPath, mIsMono ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
+    if (image.empty() || (!mIsMono && (image.cols % 2 != 0)))
+    {
+        return false;
+    }
+
+    if (mIsMono)
+    {
+        preprocessor.normalise(resizeToInput(image, mImageSize, resized[0]), cv::Mat(), flip, normalised);
+    }
+    else
+    {
+        // DataSaver places the left and the right image side by side
+        const int width = image.cols / 2;
+        preprocessor.normalise(resizeToInput(image.colRange(0, width), mImageSize, resized[0]),
+                               resizeToInput(image.colRange(width, image.cols), mImageSize, resized[1]),
+                               flip, normalised);
+    }
+
+    // HWC to CHW, each channel is extracted directly into its plane of the input
+    const cv::Size inputSize = getInputSize();
+    for (int channel = 0; channel < normalised.channels(); ++channel)
+    {
+        cv::Mat plane(inputSize, CV_32FC1, input + static_cast<size_t>(channel) * static_cast<size_t>(inputSize.area()));
+        cv::extractChannel(normalised, plane, channel);
+    }
+    target[0] = flip ? -sample.mDriveCommands.mSteering : sample.mDriveCommands.mSteering;
+    target[1] = sample.mDriveCommands.mThrottle;
+    return true;
+}
+
+bool TrainingDataset::parseLabels(const std::string& path, DriveCommands& driveCommands)
+{
+    const std::string name = std::experimental::filesystem::path(path).filename().string();
+    unsigned long uid;
+    char extension[5] = {0};
+    return (sscanf(name.c_str(), "%f_%f_%lu.%4s", &driveCommands.mSteering, &driveCommands.mThrottle, &uid, extension) == 4) &&
+           (std::string(extension) == "jpg");
+}
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <torch/data/datasets/base.h>
+#include <torch/data/example.h>
+#include "DriveCommands.h"
+
+/**
+ * Dataset of images captured by DataSaver, labelled with the drive commands encoded in file names
+ * (steering_throttle_uid.jpg). Images are pre-processed exactly as CameraDriveAdapter does it for inference: resized to
+ * the model input size and normalised by ImagePreprocessor, colour images of a mono camera as RGB, greyscale images of
+ * a stereo camera side by side. A flipped sample is the mirrored scene with negated steering, which is the sign
+ * convention of test time augmentation. Samples can be loaded concurrently.
+ */
+class TrainingDataset : public torch::data::datasets::Dataset<TrainingDataset>
+{
+public:
+    /**
+     * Scans the folders and their subfolders for labelled images.
+     *  @param folders folders saved by DataSaver, or their parents (e.g. ./stereo).
+     *  @param imageSize size of a single model input image.
+     *  @param isMono true for colour images of a mono camera, false for side-by-side images of a stereo camera.
+     */
+    TrainingDataset(const std::vector<std::string>& folders, const cv::Size& imageSize, const bool isMono);
+
+    /**
+     * Basic destructor.
+     */
+    virtual ~TrainingDataset();
+
+    /**
+     * Loads a sample without augmentation.
+     *  @param index the index of the sample.
+     *  @return CHW float input and the target [steering, throttle].
+     */
+    torch::data::Example<> get(size_t index) override;
+
+    /**
+     *  @return the number of samples.
+     */
+    torch::optional<size_t> size() const override;
+
+    /**
+     * Decodes and pre-processes a sample into preallocated memory. This function is thread safe.
+     *  @param index the index of the sample.
+     *  @param flip true to load the mirrored sample.
+     *  @param input memory for getInputSize() CHW floats.
+     *  @param target memory for steering and throttle.
+     *  @return false if the image could not be decoded.
+     */
+    bool load(const size_t index, const bool flip, float* input, float* target) const;
+
+    /**
+     * Parses drive commands from the name of an image saved by DataSaver.
+     *  @param path path to the image.
+     *  @param driveCommands the parsed steering and throttle.
+     *  @return true if the name is in steering_throttle_uid.jpg format.
+     */
+    static bool parseLabels(const std::string& path, DriveCommands& driveCommands);
+
+    /**
+     *  @param index the index of the sample.
+     *  @return path to the image of the sample.
+     */
+    inline const std::string& getPath(const size_t index) const
+    {
+        return mSamples[index].mPath;
+    }
+
+    /**
+     *  @return the number of channels of the model input.
+     */
+    inline int getChannels() const
+    {
+        return mIsMono ? 3 : 1;
+    }
+
+    /**
+     *  @return the size of the model input, two images wide for a stereo camera.
+     */
+    inline cv::Size getInputSize() const
+    {
+        return cv::Size(mIsMono ? mImageSize.width : 2 * mImageSize.width, mImageSize.height);
+    }
+
+    /**
+     *  @return the number of floats of a single model input.
+     */
+    inline size_t getInputLength() const
+    {
+        return static_cast<size_t>(getChannels()) * static_cast<size_t>(getInputSize().area());
+    }
+
+private:
+    /**
+     * A labelled image.
+     */
+    struct Sample
+    {
+        /** Path to the image. */
+        std::string mPath;
+        /** Drive commands of the image. */
+        DriveCommands mDriveCommands;
+    };
+
+    /** Labelled images sorted by path. */
+    std::vector<Sample> mSamples;
+    /** Size of a single model input image. */
+    cv::Size mImageSize;
+    /** Flag indicating colour images of a mono camera. */
+    bool mIsMono;
+};
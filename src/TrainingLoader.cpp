@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cerrno>
+#include <numeric>
+#include <torch/cuda.h>
+#include "Logger.h"
+#include "Timing.h"
+#include "TrainingLoader.h"
+
+TrainingLoader::TrainingLoader(TrainingDataset& dataset, const size_t batchSize, const size_t prefetch, const size_t threads,
+                               const float flipProbability, const bool shuffle, const unsigned int seed)
+: mDataset(dataset),
+  mBatchSize(std::max<size_t>(1, batchSize)),
+  mFlipProbability(flipProbability),
+  mShuffle(shuffle),
+  mPinned(torch::cuda::is_available()),
+  mPool(threads, false),
+  mRandom(seed),
+  mOrder(dataset.size().value()),
+  mSlots(),
+  mNext(0),
+  mQueued(0),
+  mLoaded(0),
+  mFailed(0),
+  mWaitTime(0.0)
+{
+    const cv::Size inputSize = mDataset.getInputSize();
+    const torch::TensorOptions options = torch::TensorOptions().dtype(torch::kFloat).pinned_memory(mPinned);
+    std::iota(mOrder.begin(), mOrder.end(), 0);
+    for (size_t i = 0; i < std::max<size_t>(1, prefetch); ++i)
+    {
+        mSlots.emplace_back(new Batch());
+        mSlots.back()->mImages = torch::empty({static_cast<int64_t>(mBatchSize), mDataset.getChannels(), inputSize.height, inputSize.width}, options);
+        mSlots.back()->mTargets = torch::empty({static_cast<int64_t>(mBatchSize), 2}, options);
+        mSlots.back()->mSize = 0;
+        mSlots.back()->mRemaining = 0;
+        mSlots.back()->mDecoded.resize(mBatchSize, 0);
+        sem_init(&mSlots.back()->mReady, 0, 0);
+    }
+}
+
+TrainingLoader::~TrainingLoader()
+{
+    stop();
+    for (std::unique_ptr<Batch>& slot : mSlots)
+    {
+        sem_destroy(&slot->mReady);
+    }
+}
+
+bool TrainingLoader::start()
+{
+    return mPool.start();
+}
+
+void TrainingLoader::stop()
+{
+    mPool.stop();
+}
+
+void TrainingLoader::startEpoch()
+{
+    if (!mPool.isRunning())
+    {
+        return;
+    }
+
+    // batches in flight are written by the pool until they are complete
+    for (; mNext < mQueued; ++mNext)
+    {
+        while ((sem_wait(&mSlots[mNext % mSlots.size()]->mReady) != 0) && (errno == EINTR))
+        {
+        }
+    }
+
+    if (mShuffle)
+    {
+        std::shuffle(mOrder.begin(), mOrder.end(), mRandom);
+    }
+    mNext = 0;
+    for (mQueued = 0; mQueued < std::min(mSlots.size(), getBatches()); ++mQueued)
+    {
+        queue(mQueued);
+    }
+}
+
+bool TrainingLoader::next(torch::Tensor& images, torch::Tensor& targets)
+{
+    while (mPool.isRunning() && (mNext < mQueued))
+    {
+        // the batch returned or skipped before is not used anymore, so its slot can take the next batch
+        if ((mNext > 0) && (mQueued < getBatches()))
+        {
+            queue(mQueued++);
+        }
+
+        Batch& slot = *mSlots[mNext % mSlots.size()];
+        double startTime = getMonotonicTime();
+        while ((sem_wait(&slot.mReady) != 0) && (errno == EINTR))
+        {
+        }
+        mWaitTime += getMonotonicTime() - startTime;
+        ++mNext;
+
+        if (slot.mSize > 0)
+        {
+            images = slot.mImages.narrow(0, 0, static_cast<int64_t>(slot.mSize));
+            targets = slot.mTargets.narrow(0, 0, static_cast<int64_t>(slot.mSize));
+            return true;
+        }
+    }
+    return false;
+}
+
+void TrainingLoader::queue(const size_t batch)
+{
+    Batch& slot = *mSlots[batch % mSlots.size()];
+    const size_t first = batch * mBatchSize;
+    std::bernoulli_distribution flipDistribution(mFlipProbability);
+
+    slot.mSize = std::min(mBatchSize, mOrder.size() - first);
+    slot.mRemaining = slot.mSize;
+    for (size_t item = 0; item < slot.mSize; ++item)
+    {
+        // flips are drawn here rather than by the pool to be reproducible
+        const size_t index = mOrder[first + item];
+        const bool flip = flipDistribution(mRandom);
+        mPool.submit(TASK_INFERENCE, [this, &slot, item, index, flip](){ loadSample(slot, item, index, flip); });
+    }
+}
+
+void TrainingLoader::loadSample(Batch& slot, const size_t item, const size_t index, const bool flip)
+{
+    const size_t inputLength = mDataset.getInputLength();
+    float* input = slot.mImages.data_ptr<float>() + item * inputLength;
+    float* target = slot.mTargets.data_ptr<float>() + item * 2;
+    slot.mDecoded[item] = mDataset.load(index, flip, input, target) ? 1 : 0;
+    if (slot.mDecoded[item])
+    {
+        ++mLoaded;
+    }
+    else
+    {
+        ++mFailed;
+        Logger::log(LOG_WARNING, "Failed to decode training image %s, the sample is dropped", mDataset.getPath(index));
+    }
+
+    // the last task sees the samples of all other tasks
+    if (slot.mRemaining.fetch_sub(1) == 1)
+    {
+        compact(slot);
+        sem_post(&slot.mReady);
+    }
+}
+
+void TrainingLoader::compact(Batch& slot)
+{
+    const size_t inputLength = mDataset.getInputLength();
+    float* images = slot.mImages.data_ptr<float>();
+    float* targets = slot.mTargets.data_ptr<float>();
+    size_t size = 0;
+
+    for (size_t item = 0; item < slot.mSize; ++item)
+    {
+        if (slot.mDecoded[item])
+        {
+            if (size != item)
+            {
+                std::copy(images + item * inputLength, images + (item + 1) * inputLength, images + size * inputLength);
+                std::copy(targets + item * 2, targets + (item + 1) * 2, targets + size * 2);
+            }
+            ++size;
+        }
+    }
+    slot.mSize = size;
+}
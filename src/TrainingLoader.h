@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <semaphore.h>
+#include <vector>
+#include <torch/types.h>
+#include "TaskPool.h"
+#include "TrainingDataset.h"
+
+/**
+ * Loads shuffled batches of a training dataset. Images are decoded and pre-processed on a task pool, one task per
+ * sample, while the trainer works on earlier batches; up to the prefetch count of batches are in flight. Batches are
+ * filled in place into preallocated tensors, which are in pinned memory when CUDA is available, so that they can be
+ * copied to the GPU asynchronously. Samples that cannot be decoded are dropped and their batch shrinks, so that the model
+ * is never trained on blank images. Flip augmentation mirrors a sample with the given probability and negates its
+ * steering. Shuffling and flipping are reproducible for the same seed.
+ */
+class TrainingLoader
+{
+public:
+    /**
+     * Basic constructor.
+     *  @param dataset the dataset, which must outlive the loader.
+     *  @param batchSize the number of samples in a batch.
+     *  @param prefetch the number of batches loaded ahead, at least 1.
+     *  @param threads the number of decoding threads, 0 for one per core.
+     *  @param flipProbability probability of flipping a sample, 0 to disable augmentation.
+     *  @param shuffle true to shuffle samples in every epoch.
+     *  @param seed seed of shuffling and flipping.
+     */
+    TrainingLoader(TrainingDataset& dataset, const size_t batchSize, const size_t prefetch, const size_t threads,
+                   const float flipProbability, const bool shuffle, const unsigned int seed);
+
+    /**
+     * Stops the decoding threads.
+     */
+    virtual ~TrainingLoader();
+
+    /**
+     * Starts the decoding threads.
+     *  @return true if the threads started.
+     */
+    bool start();
+
+    /**
+     * Stops the decoding threads, the loader cannot be restarted.
+     */
+    void stop();
+
+    /**
+     * Shuffles samples and starts loading the first batches of a new epoch. Batches of the previous epoch that were
+     * not taken are dropped.
+     */
+    void startEpoch();
+
+    /**
+     * Waits for the next batch of the epoch. The tensors are reused for later batches and are valid until the next call,
+     * an asynchronous copy to the GPU must be complete by then (e.g. synchronised by reading the loss).
+     *  @param images NCHW float images, the last batch of an epoch and batches with undecodable samples are smaller.
+     *  @param targets Nx2 float targets of steering and throttle.
+     *  @return false at the end of the epoch or if the loader was stopped. Batches of which no sample could be decoded
+     *          are skipped.
+     */
+    bool next(torch::Tensor& images, torch::Tensor& targets);
+
+    /**
+     *  @return the number of batches in an epoch.
+     */
+    inline size_t getBatches() const
+    {
+        return (mOrder.size() + mBatchSize - 1) / mBatchSize;
+    }
+
+    /**
+     *  @return true if batches are in pinned memory.
+     */
+    inline bool isPinned() const
+    {
+        return mPinned;
+    }
+
+    /**
+     *  @return the number of loaded samples.
+     */
+    inline unsigned long getLoaded() const
+    {
+        return mLoaded;
+    }
+
+    /**
+     *  @return the number of samples that could not be decoded, which are dropped from their batches.
+     */
+    inline unsigned long getFailed() const
+    {
+        return mFailed;
+    }
+
+    /**
+     *  @return the total time in seconds that next() waited for batches.
+     */
+    inline double getWaitTime() const
+    {
+        return mWaitTime;
+    }
+
+private:
+    /**
+     * A preallocated batch.
+     */
+    struct Batch
+    {
+        /** NCHW images. */
+        torch::Tensor mImages;
+        /** Nx2 targets. */
+        torch::Tensor mTargets;
+        /** The number of samples of the loaded batch. */
+        size_t mSize;
+        /** The number of samples that are still being loaded. */
+        std::atomic<size_t> mRemaining;
+        /** Flags of decoded samples, each written only by the task loading the sample. */
+        std::vector<uint8_t> mDecoded;
+        /** Signalled when all samples are loaded. */
+        sem_t mReady;
+    };
+
+    /**
+     * Queues loading of a batch of the epoch into its slot.
+     *  @param batch the index of the batch in the epoch.
+     */
+    void queue(const size_t batch);
+
+    /**
+     * Moves decoded samples to the front of the batch and shrinks it to their count.
+     *  @param slot the loaded batch.
+     */
+    void compact(Batch& slot);
+
+    /**
+     * Loads a sample into a batch, compacts and signals the batch when it is the last one.
+     *  @param slot the batch.
+     *  @param item the position of the sample in the batch.
+     *  @param index the index of the sample in the dataset.
+     *  @param flip true to flip the sample.
+     */
+    void loadSample(Batch& slot, const size_t item, const size_t index, const bool flip);
+
+    /** The dataset. */
+    TrainingDataset& mDataset;
+    /** The number of samples in a batch. */
+    size_t mBatchSize;
+    /** Probability of flipping a sample. */
+    float mFlipProbability;
+    /** Flag indicating shuffling in every epoch. */
+    bool mShuffle;
+    /** Flag indicating that batches are in pinned memory. */
+    bool mPinned;
+    /** Threads that decode samples. */
+    TaskPool mPool;
+    /** Generator of shuffling and flipping. */
+    std::mt19937 mRandom;
+    /** Indices of samples in the order of the epoch. */
+    std::vector<size_t> mOrder;
+    /** Preallocated batches, batch i of the epoch is loaded into slot i modulo their count. */
+    std::vector<std::unique_ptr<Batch>> mSlots;
+    /** The index of the next batch to be returned. */
+    size_t mNext;
+    /** The number of batches of the epoch that were queued. */
+    size_t mQueued;
+    /** The number of loaded samples. */
+    std::atomic<unsigned long> mLoaded;
+    /** The number of samples that could not be decoded. */
+    std::atomic<unsigned long> mFailed;
+    /** Time spent waiting for batches. */
+    double mWaitTime;
+};
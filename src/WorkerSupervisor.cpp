@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Logger.h"
+#include "WorkerSupervisor.h"
+
+extern char** environ;
+
+namespace
+{
+/** Time in microseconds to wait before restarting a worker that has exited. */
+constexpr useconds_t RESTART_DELAY = 1000000;
+/** The number of 10 ms intervals to wait for a worker to exit after SIGTERM. */
+constexpr int TERMINATION_CHECKS = 100;
+} // end of anonymouse namespace
+
+WorkerSupervisor::WorkerSupervisor(const std::string& role, const std::string& configPath)
+: GenericThread<WorkerSupervisor>(),
+  mRole(role),
+  mConfigPath(configPath),
+  mPid(-1),
+  mRestarts(0)
+{
+}
+
+WorkerSupervisor::~WorkerSupervisor()
+{
+    stopThread();
+}
+
+bool WorkerSupervisor::startThread()
+{
+    return spawn() && GenericThread<WorkerSupervisor>::startThread();
+}
+
+void WorkerSupervisor::stopThread()
+{
+    int status;
+    bool wasRunning = isRunning();
+    // the thread is blocked in waitpid, which is a cancellation point
+    GenericThread<WorkerSupervisor>::stopThread(true);
+
+    if (mPid > 0)
+    {
+        kill(mPid, SIGTERM);
+        for (int i = 0; i < TERMINATION_CHECKS && 0 == waitpid(mPid, &status, WNOHANG); ++i)
+        {
+            usleep(10000);
+        }
+        if (0 == waitpid(mPid, &status, WNOHANG))
+        {
+            Logger::log(LOG_WARNING, "Killing %s worker", mRole);
+            kill(mPid, SIGKILL);
+            waitpid(mPid, &status, 0);
+        }
+        mPid = -1;
+    }
+    if (wasRunning)
+    {
+        printf("Worker %s: restarted %u times \n", mRole.c_str(), mRestarts);
+    }
+}
+
+void* WorkerSupervisor::threadBody()
+{
+    int status;
+
+    while (isRunning())
+    {
+        if (mPid > 0 && waitpid(mPid, &status, 0) == mPid)
+        {
+            mPid = -1;
+            if (WIFSIGNALED(status))
+            {
+                Logger::log(LOG_ERROR, "Worker %s killed by signal %d, restarting", mRole, WTERMSIG(status));
+            }
+            else
+            {
+                Logger::log(LOG_ERROR, "Worker %s exited with status %d, restarting", mRole, WEXITSTATUS(status));
+            }
+            usleep(RESTART_DELAY);
+            if (isRunning() && spawn())
+            {
+                ++mRestarts;
+            }
+        }
+        else if (mPid <= 0)
+        {
+            usleep(RESTART_DELAY);
+            spawn();
+        }
+    }
+    return nullptr;
+}
+
+bool WorkerSupervisor::spawn()
+{
+    posix_spawnattr_t attributes;
+    pid_t pid;
+    int result;
+    char* const arguments[] = {const_cast<char*>("JetRacer_RoadFollowing"), const_cast<char*>("--worker"),
+                               const_cast<char*>(mRole.c_str()), const_cast<char*>(mConfigPath.c_str()), nullptr};
+
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    result = posix_spawn(&pid, "/proc/self/exe", nullptr, &attributes, arguments, environ);
+    posix_spawnattr_destroy(&attributes);
+
+    if (0 != result)
+    {
+        Logger::log(LOG_ERROR, "Failed to spawn %s worker: %s", mRole, strerror(result));
+        return false;
+    }
+    mPid = pid;
+    Logger::log(LOG_INFO, "Spawned %s worker with PID %d", mRole, static_cast<int>(pid));
+    return true;
+}
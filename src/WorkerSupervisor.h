@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+#include <GenericThread.h>
+
+/**
+ * Runs a worker process, i.e., this executable started with --worker [role], and restarts it whenever it exits.
+ * The worker is placed in its own process group, so that ctrl+c in the terminal stops only the main process,
+ * which then terminates the worker.
+ */
+class WorkerSupervisor : public GenericThread<WorkerSupervisor>
+{
+public:
+    /**
+     * Initialises parameters of the worker.
+     *  @param role the role of the worker, see ProcessWorker.
+     *  @param configPath the path to the main configuration passed to the worker.
+     */
+    WorkerSupervisor(const std::string& role, const std::string& configPath);
+
+    /**
+     * Terminates the worker.
+     */
+    virtual ~WorkerSupervisor();
+
+    /**
+     * Overrides/shadows the baseclass function to spawn the worker before the thread starts supervising it.
+     *  @return true if the worker was spawned.
+     */
+    bool startThread();
+
+    /**
+     * Overrides/shadows the baseclass function to terminate the worker, killing it if it does not exit within a second.
+     */
+    void stopThread();
+
+    /**
+     * The main body of the thread that waits for the worker to exit and restarts it.
+     *  @return nullptr.
+     */
+    void* threadBody();
+
+private:
+    /**
+     * Spawns the worker process.
+     *  @return true if the worker was spawned.
+     */
+    bool spawn();
+
+    /** The role of the worker. */
+    std::string mRole;
+    /** The path to the main configuration. */
+    std::string mConfigPath;
+    /** The process ID of the worker, -1 if not running. */
+    volatile pid_t mPid;
+    /** The number of restarts. */
+    unsigned int mRestarts;
+};
@@ -21,12 +21,22 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <csignal>
+#include <cstring>
+#include <future>
 #include <CSI_Camera.h>
 #include <CSI_StereoCamera.h>
+#include "ConfigWatcher.h"
 #include "Configuration.h"
+#include "DriveModelPlugin.h"
+#include "Logger.h"
+#include "ProcessWorker.h"
+#include "SessionReplay.h"
+#include "Settings.h"
 #include "StateMachine.h"
+#include "WorkerSupervisor.h"
 
 sem_t* SEM_PTR = nullptr;
+EmergencyStop* ESTOP_PTR = nullptr;
 
 /**
  * Handler for signals.
@@ -34,56 +44,197 @@ sem_t* SEM_PTR = nullptr;
  */
 void handleSignals(int signum)
 {
-    if (signum == SIGINT && SEM_PTR)
+    // the emergency stop wakes up the main thread once throttle is zeroed, so it is only woken directly without it
+    if (signum == SIGINT && !(ESTOP_PTR && ESTOP_PTR->trigger()) && SEM_PTR)
     {
         sem_post(SEM_PTR);
     }
 }
 
-bool strToBool(const std::string& value)
-{
-    return value == "true" || value == "True" || value == "1";
-}
-
-void start(const Configuration& config)
+void start(const Configuration& config, const Settings& settings, const std::string& path, StartupTimeline& timeline)
 {
     std::unique_ptr<ICameraTalker> camera;
-    if (strToBool(config.at("isMono")))
+    std::future<bool> calibration;
+    bool isMono = settings.mIsMono;
+    if (isMono)
     {
         camera = std::make_unique<CSI_Camera>();
     }
     else
     {
-        cv::Size imageSize(std::stoi(config.at("width")), std::stoi(config.at("height")));
+        cv::Size imageSize(settings.mWidth, settings.mHeight);
         camera = std::make_unique<CSI_StereoCamera>(imageSize);
-        if (!static_cast<CSI_StereoCamera*>(camera.get())->loadCalibration(config.at("calibration")))
+    } 
+    StateMachine sm(config, settings, camera.get());
+    SEM_PTR = sm.getSem();
+    ESTOP_PTR = &sm.getEmergencyStop();
+
+    // calibration does not depend on other devices, so it is loaded while the state machine initialises
+    if (!isMono && settings.mRectificationCache)
+    {
+        // the camera is left without calibration, so it delivers raw images rectified by the state machine
+        calibration = std::async(std::launch::async, [&timeline, &sm]()
+        {
+            return timeline.measure("Rectification maps", [&sm]() { return sm.loadRectification(); });
+        });
+    }
+    else if (!isMono)
+    {
+        CSI_StereoCamera* stereoCamera = static_cast<CSI_StereoCamera*>(camera.get());
+        calibration = std::async(std::launch::async, [&settings, &timeline, stereoCamera]()
+        {
+            return timeline.measure("Stereo calibration", [&settings, stereoCamera]() { return stereoCamera->loadCalibration(settings.mCalibration); });
+        });
+    }
+
+    bool initialised = sm.initialise(timeline);
+    if (calibration.valid() && !calibration.get())
+    {
+        // without maps the rectifier passes raw images, so the camera has to rectify them before it is started
+        if (settings.mRectificationCache && static_cast<CSI_StereoCamera*>(camera.get())->loadCalibration(settings.mCalibration))
+        {
+            puts("Failed to load rectification maps, the stereo camera rectifies images instead");
+        }
+        else
         {
             puts("Failed to load stereo camera calibration");
         }
-    } 
-    StateMachine sm(config, camera.get());
-    SEM_PTR = sm.getSem();
+    }
 
-    if (sm.initialise())
+    if (initialised)
     {
+        // workers are restarted if they crash, while this process keeps remote control
+        std::unique_ptr<WorkerSupervisor> inferenceWorker;
+        std::unique_ptr<WorkerSupervisor> recorderWorker;
+        if (settings.mProcessSplit)
+        {
+            inferenceWorker = std::make_unique<WorkerSupervisor>("inference", path);
+            recorderWorker = std::make_unique<WorkerSupervisor>("recorder", path);
+            inferenceWorker->startThread();
+            recorderWorker->startThread();
+        }
+
+        if (settings.mPreloadCamera || settings.mCameraStandby)
+        {
+            timeline.measure("Camera", [&sm]() { return sm.preloadCamera(); });
+        }
+        timeline.print();
+
+        // reloaded settings are applied to the state machine from the watcher thread
+        std::unique_ptr<ConfigWatcher> configWatcher;
+        if (settings.mConfigReload)
+        {
+            configWatcher = std::make_unique<ConfigWatcher>(config, path, [&sm](const Settings& reloaded) { sm.applySettings(reloaded); });
+            configWatcher->startThread();
+        }
+
         while (0 != sem_wait(SEM_PTR))
         {
             ;
         }
+        if (configWatcher)
+        {
+            configWatcher->stopThread();
+        }
+    }
+}
+
+/**
+ * Replays a session journal through the model, see SessionReplay.
+ *  @param settings the settings of the application.
+ *  @param path the path to the journal.
+ *  @param realTime true to keep the recorded timing, false to replay as fast as possible.
+ *  @return true if the journal was replayed.
+ */
+bool replay(const Settings& settings, const std::string& path, const bool realTime)
+{
+    DriveModelPlugin torchDrive;
+    SessionReplay sessionReplay(path);
+
+    torchDrive.initialise(settings);
+    if (!torchDrive.isInitialised() || !sessionReplay.open())
+    {
+        return false;
     }
+    static_cast<GenericListener<CameraData>&>(torchDrive).registerTo(&sessionReplay);
+    static_cast<GenericListener<DriveCommands>&>(sessionReplay).registerTo(&torchDrive);
+    sessionReplay.run(realTime, ML);
+    sessionReplay.printStatistics();
+    static_cast<GenericListener<CameraData>&>(torchDrive).unregisterFrom(&sessionReplay);
+    static_cast<GenericListener<DriveCommands>&>(sessionReplay).unregisterFrom(&torchDrive);
+    return true;
 }
 
 int main(int argc, char** argv)
 {
+    StartupTimeline timeline;
     Configuration config;
-    std::string path = (argc > 1) ? argv[1] : "../config/config.ini";
+    std::string path = "../config/config.ini";
+    std::string workerRole;
+    std::string replayPath;
+    bool tune = false;
+    bool fast = false;
+    int retVal = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == strcmp(argv[i], "--tune"))
+        {
+            tune = true;
+        }
+        else if (0 == strcmp(argv[i], "--worker") && i + 1 < argc)
+        {
+            workerRole = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "--replay") && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "--fast"))
+        {
+            fast = true;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
 
     /* Register the SIGINT handler (ctrl+c) */
     signal(SIGINT, handleSignals);
 
     if (config.loadConfiguration(path))
     {
-        start(config);
+        if (!config.at("overlay").empty() && config.mergeConfiguration(config.at("overlay")))
+        {
+            printf("Loaded configuration overlay from: %s \n", config.at("overlay").c_str());
+        }
+
+        Logger::getInstance().initialise(config.at("logSink"), Logger::strToLevel(config.at("logLevel")));
+        Settings settings;
+        if (!settings.parse(config))
+        {
+            printf("Invalid configuration at path: %s \n", path.c_str());
+            retVal = 1;
+        }
+        else if (!workerRole.empty())
+        {
+            ProcessWorker worker(settings, workerRole);
+            retVal = worker.run();
+        }
+        else if (!replayPath.empty())
+        {
+            retVal = replay(settings, replayPath, !fast) ? 0 : 1;
+        }
+        else if (tune)
+        {
+            DriveModelPlugin plugin;
+            retVal = plugin.runTuner(settings) ? 0 : 1;
+        }
+        else
+        {
+            start(config, settings, path, timeline);
+        }
     }
     else
     {
@@ -91,5 +242,6 @@ int main(int argc, char** argv)
         puts("Either provide a valid path as the first argument, or ensure that there is a valid file under config/config.ini.");
     }
 
-    return 0;
+    Logger::getInstance().stop();
+    return retVal;
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+/**
+ * Checks shared by test programs, which count failed checks and print a line per check. Each program includes this
+ * header once and returns getExitCode() from main.
+ */
+namespace TestUtils
+{
+/** The number of failed checks. */
+inline int failures = 0;
+
+/**
+ * Prints the result of a check and counts failures.
+ *  @param name the name of the check.
+ *  @param passed true if the check passed.
+ *  @param details optional description of expected and actual values.
+ *  @return @p passed.
+ */
+inline bool check(const char* name, const bool passed, const std::string& details = std::string())
+{
+    if (details.empty())
+    {
+        printf("%s: %s \n", passed ? "PASS" : "FAIL", name);
+    }
+    else
+    {
+        printf("%s: %s (%s) \n", passed ? "PASS" : "FAIL", name, details.c_str());
+    }
+    failures += static_cast<int>(!passed);
+    return passed;
+}
+
+/**
+ * Checks that a value is within a tolerance of the expected one.
+ *  @param name the name of the check.
+ *  @param expected the expected value.
+ *  @param actual the actual value.
+ *  @param tolerance the allowed difference.
+ *  @return true if the check passed.
+ */
+inline bool checkNear(const char* name, const double expected, const double actual, const double tolerance = 1e-4)
+{
+    char details[128];
+    snprintf(details, sizeof(details), "expected %f, got %f", expected, actual);
+    return check(name, actual >= expected - tolerance && actual <= expected + tolerance, details);
+}
+
+/**
+ * Prints the summary of all checks.
+ *  @return the exit code of the test program, 0 if all checks passed.
+ */
+inline int getExitCode()
+{
+    printf("%s \n", failures == 0 ? "All tests passed." : "Some tests failed.");
+    return failures == 0 ? 0 : 1;
+}
+} // end of TestUtils namespace
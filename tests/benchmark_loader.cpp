@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cstdio>
+#include <experimental/filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/imgcodecs.hpp>
+#include <Configuration.h>
+#include <Timing.h>
+#include <TrainingDataset.h>
+#include <TrainingLoader.h>
+
+namespace
+{
+/** The number of synthetic images generated when no folder is given. */
+constexpr int SYNTHETIC_IMAGES = 512;
+/** The number of samples in a batch. */
+constexpr size_t BATCH_SIZE = 32;
+/** The number of batches loaded ahead. */
+constexpr size_t PREFETCH = 4;
+
+/**
+ * Saves random images with random labels as DataSaver does it.
+ *  @param folder the folder for the images.
+ *  @param imageSize size of a single image.
+ *  @param isMono true for colour images, false for side-by-side greyscale images.
+ */
+void generate(const std::string& folder, const cv::Size& imageSize, const bool isMono)
+{
+    cv::Mat image(imageSize.height, isMono ? imageSize.width : 2 * imageSize.width, isMono ? CV_8UC3 : CV_8UC1);
+    char path[256];
+    std::experimental::filesystem::create_directories(folder);
+    for (int i = 0; i < SYNTHETIC_IMAGES; ++i)
+    {
+        cv::randu(image, 0, 255);
+        snprintf(path, sizeof(path), "%s/%f_%f_%d.jpg", folder.c_str(), 2.0 * i / SYNTHETIC_IMAGES - 1.0, 0.5, i);
+        cv::imwrite(path, image);
+    }
+}
+
+/**
+ * Checks that a flipped sample has negated steering and a mirrored image.
+ *  @param dataset the dataset.
+ *  @return true if the sign convention holds.
+ */
+bool checkFlip(TrainingDataset& dataset)
+{
+    const cv::Size inputSize = dataset.getInputSize();
+    torch::Tensor input = torch::empty({dataset.getChannels(), inputSize.height, inputSize.width});
+    torch::Tensor flippedInput = torch::empty_like(input);
+    torch::Tensor target = torch::empty({2});
+    torch::Tensor flippedTarget = torch::empty({2});
+    if (!dataset.load(0, false, input.data_ptr<float>(), target.data_ptr<float>()) ||
+        !dataset.load(0, true, flippedInput.data_ptr<float>(), flippedTarget.data_ptr<float>()))
+    {
+        return false;
+    }
+    return torch::equal(input.flip({2}), flippedInput) &&
+           (flippedTarget[0].item<float>() == -target[0].item<float>()) &&
+           (flippedTarget[1].item<float>() == target[1].item<float>());
+}
+} // end of anonymouse namespace
+
+/**
+ * Measures the throughput of decoding and pre-processing training images, sequentially and with the loader.
+ * Usage: benchmark_loader [folder isMono width height], by default synthetic stereo 224x224 images are generated.
+ */
+int main(int argc, char** argv)
+{
+    const bool synthetic = (argc < 2);
+    const std::string folder = synthetic ? "/tmp/benchmark_loader" : argv[1];
+    const bool isMono = (argc > 2) && Configuration::strToBool(argv[2]);
+    const cv::Size imageSize((argc > 4) ? std::stoi(argv[3]) : 224, (argc > 4) ? std::stoi(argv[4]) : 224);
+    const size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    torch::Tensor images;
+    torch::Tensor targets;
+
+    if (synthetic)
+    {
+        generate(folder, imageSize, isMono);
+    }
+    TrainingDataset dataset({folder}, imageSize, isMono);
+    const size_t samples = dataset.size().value();
+    if (samples == 0)
+    {
+        puts("No labelled images found.");
+        return 1;
+    }
+    printf("Flip sign convention: %s \n", checkFlip(dataset) ? "ok" : "FAILED");
+
+    double startTime = getMonotonicTime();
+    for (size_t i = 0; i < samples; ++i)
+    {
+        dataset.get(i);
+    }
+    printf("sequential: %.0f images/s \n", samples / (getMonotonicTime() - startTime));
+
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        TrainingLoader loader(dataset, BATCH_SIZE, PREFETCH, threads, 0.5f, true, 0);
+        if (!loader.start())
+        {
+            puts("Failed to start the loader.");
+            return 1;
+        }
+        startTime = getMonotonicTime();
+        loader.startEpoch();
+        while (loader.next(images, targets))
+        {
+        }
+        printf("%zu threads: %.0f images/s, waited %.1f ms, pinned %d \n",
+               threads, samples / (getMonotonicTime() - startTime), loader.getWaitTime() * 1000.0, loader.isPinned());
+        loader.stop();
+    }
+
+    if (synthetic)
+    {
+        std::experimental::filesystem::remove_all(folder);
+    }
+    return 0;
+}
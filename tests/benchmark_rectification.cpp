@@ -0,0 +1,174 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
+#include <string>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+#include <RectificationCache.h>
+#include <RectificationVerifier.h>
+#include <Timing.h>
+#include "TestUtils.h"
+
+namespace
+{
+/** The number of frames rectified by each method. */
+constexpr int FRAMES = 200;
+
+/**
+ * Compares images rectified with cached maps against images rectified by the camera from the same calibration files.
+ * The camera has to look at a static scene, as raw and rectified pairs are captured one after another.
+ *  @param calibration the folder with left.xml, right.xml and stereo.xml.
+ *  @param imageSize the size of a single image.
+ *  @return 0 if both rectifications match.
+ */
+int verify(const std::string& calibration, const cv::Size& imageSize)
+{
+    const std::string cacheFolder = "/tmp/benchmark_rectification";
+    RectificationCache cache;
+    RectificationVerifier verifier(calibration, imageSize);
+
+    std::experimental::filesystem::remove_all(cacheFolder);
+    // the cache verifies maps itself before writing them, so the result is only reported here
+    bool verified = cache.load(calibration, imageSize, cacheFolder, [&verifier](const RectificationCache& maps) { return verifier.verify(maps); });
+    TestUtils::check("cached maps match the camera's rectification", verified,
+                     "mean difference left " + std::to_string(verifier.getDifference(0)) + ", right " + std::to_string(verifier.getDifference(1)));
+    std::experimental::filesystem::remove_all(cacheFolder);
+    return TestUtils::getExitCode();
+}
+
+/**
+ * Measures the average time of rectifying a stereo pair.
+ *  @param images the left and right image.
+ *  @param map1 the first map of the left and right camera.
+ *  @param map2 the second map of the left and right camera, empty for float maps with both coordinates in map1.
+ *  @return the average time per frame in seconds.
+ */
+double measureRemap(const cv::Mat images[2], const cv::Mat map1[2], const cv::Mat map2[2])
+{
+    cv::Mat rectified[2];
+    double start = getMonotonicTime();
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            cv::remap(images[i], rectified[i], map1[i], map2[i], cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+        }
+    }
+    return (getMonotonicTime() - start) / FRAMES;
+}
+} // end of anonymouse namespace
+
+/**
+ * Compares rectification with float maps computed at every start against fixed-point maps memory-mapped from the cache.
+ * Usage: benchmark_rectification [width height], the size defaults to 224x224 as in the default configuration.
+ * With --verify [calibration folder] [width height], cached maps are checked against the stereo camera's own rectification.
+ */
+int main(int argc, char** argv)
+{
+    cv::Size imageSize(224, 224);
+    if (argc >= 3 && 0 == strcmp(argv[1], "--verify"))
+    {
+        if (argc == 5)
+        {
+            imageSize = cv::Size(std::stoi(argv[3]), std::stoi(argv[4]));
+        }
+        return verify(argv[2], imageSize);
+    }
+    if (argc == 3)
+    {
+        imageSize = cv::Size(std::stoi(argv[1]), std::stoi(argv[2]));
+    }
+    const std::string cacheFolder = "/tmp/benchmark_rectification";
+    const std::string cachePath = cacheFolder + "/maps.bin";
+    const uint64_t hash = 1;
+
+    // a synthetic calibration of two cameras with mild distortion, a 6 cm baseline and a small relative rotation
+    double focal = imageSize.width * 0.8;
+    cv::Mat cameraMatrix[2];
+    cv::Mat distortion[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        cameraMatrix[i] = (cv::Mat_<double>(3, 3) << focal, 0.0, imageSize.width * 0.5, 0.0, focal, imageSize.height * 0.5, 0.0, 0.0, 1.0);
+        distortion[i] = (cv::Mat_<double>(1, 5) << -0.3, 0.1, 0.001, -0.001, 0.0);
+    }
+    cv::Mat rotation;
+    cv::Rodrigues(cv::Vec3d(0.01, -0.02, 0.005), rotation);
+    cv::Mat translation = (cv::Mat_<double>(3, 1) << -0.06, 0.0, 0.0);
+
+    // startup: computing float maps as done without the cache
+    double start = getMonotonicTime();
+    cv::Mat rectification[2], projection[2], disparityToDepth;
+    cv::Mat floatMap1[2], floatMap2[2];
+    cv::stereoRectify(cameraMatrix[0], distortion[0], cameraMatrix[1], distortion[1], imageSize, rotation, translation, 
+                      rectification[0], rectification[1], projection[0], projection[1], disparityToDepth, cv::CALIB_ZERO_DISPARITY, 0);
+    for (int i = 0; i < 2; ++i)
+    {
+        cv::initUndistortRectifyMap(cameraMatrix[i], distortion[i], rectification[i], projection[i], imageSize, CV_32FC1, floatMap1[i], floatMap2[i]);
+    }
+    double floatStartup = getMonotonicTime() - start;
+
+    // startup: computing fixed-point maps and writing the cache at the first start
+    std::experimental::filesystem::remove_all(cacheFolder);
+    std::experimental::filesystem::create_directories(cacheFolder);
+    RectificationCache computed;
+    start = getMonotonicTime();
+    computed.compute(cameraMatrix, distortion, rotation, translation, imageSize);
+    bool saved = computed.save(cachePath, hash);
+    double coldStartup = getMonotonicTime() - start;
+
+    // startup: memory-mapping the cache at subsequent starts
+    RectificationCache cached;
+    start = getMonotonicTime();
+    bool mapped = cached.map(cachePath, hash, imageSize);
+    double warmStartup = getMonotonicTime() - start;
+    if (!saved || !mapped)
+    {
+        puts("Failed to write or map the cache");
+        return 1;
+    }
+
+    cv::Mat images[2];
+    cv::Mat cachedMap1[2], cachedMap2[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        images[i].create(imageSize, CV_8UC1);
+        cv::randu(images[i], 0, 255);
+        cachedMap1[i] = cached.getMap1(i);
+        cachedMap2[i] = cached.getMap2(i);
+    }
+    // the first pass touches the mapped pages, so it is not measured
+    measureRemap(images, cachedMap1, cachedMap2);
+    double floatFrame = measureRemap(images, floatMap1, floatMap2);
+    double fixedFrame = measureRemap(images, cachedMap1, cachedMap2);
+
+    printf("Image size: %dx%d \n", imageSize.width, imageSize.height);
+    printf("Startup, float maps computed: %.2f ms \n", floatStartup * 1000.0);
+    printf("Startup, fixed-point maps computed and cached: %.2f ms \n", coldStartup * 1000.0);
+    printf("Startup, fixed-point maps memory-mapped: %.3f ms \n", warmStartup * 1000.0);
+    printf("Per frame, float maps: %.3f ms \n", floatFrame * 1000.0);
+    printf("Per frame, fixed-point maps: %.3f ms (%.2fx) \n", fixedFrame * 1000.0, floatFrame / fixedFrame);
+    std::experimental::filesystem::remove_all(cacheFolder);
+    return 0;
+}
@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <ImagePreprocessor.h>
+#include <LatencyStats.h>
+#include <Timing.h>
+#include <TorchBackend.h>
+#include <TorchScriptCache.h>
+
+namespace
+{
+/** The number of frames processed before latency is measured. */
+constexpr int WARM_UP_FRAMES = 10;
+/** The number of frames measured for each model. */
+constexpr int FRAMES = 200;
+
+/**
+ * Pre-processes random images into the input of the model, as CameraDriveAdapter does for camera frames.
+ *  @param imageSize size of a single image.
+ *  @param channels 3 for a mono colour camera, 1 for a greyscale stereo camera whose images are placed side by side.
+ *  @param tta true to add flipped images of test time augmentations to the batch.
+ *  @param blob the NCHW float input of the model.
+ */
+void createInput(const cv::Size& imageSize, const int channels, const bool tta, cv::Mat& blob)
+{
+    ImagePreprocessor preprocessor;
+    cv::Mat image(imageSize, channels == 3 ? CV_8UC3 : CV_8UC1);
+    cv::Mat rightImage;
+
+    cv::randu(image, 0, 255);
+    if (channels == 1)
+    {
+        rightImage = image.clone();
+    }
+    preprocessor.createBlob(tta, image, rightImage, blob);
+}
+
+/**
+ * Loads the model and measures the latency of processing the input.
+ *  @param optimise true to run the frozen and optimised model.
+ *  @param pathToModel path to the original model.
+ *  @param blob the pre-processed input.
+ *  @param stats latency of each frame.
+ *  @return the load time in seconds, negative if the model could not be loaded.
+ */
+double measure(const bool optimise, const std::string& pathToModel, const cv::Mat& blob, LatencyStats& stats)
+{
+    TorchBackend backend(optimise);
+    std::vector<cv::Vec2f> outputs;
+    double start = getMonotonicTime();
+    if (!backend.initialise(pathToModel, blob))
+    {
+        return -1.0;
+    }
+    double loadTime = getMonotonicTime() - start;
+
+    for (int i = 0; i < WARM_UP_FRAMES + FRAMES; ++i)
+    {
+        start = getMonotonicTime();
+        backend.process(blob, outputs);
+        if (i >= WARM_UP_FRAMES)
+        {
+            stats.addSample(getMonotonicTime() - start);
+        }
+    }
+    return loadTime;
+}
+} // end of anonymouse namespace
+
+/**
+ * Compares load time and per frame latency of the original TorchScript model against the frozen and optimised one.
+ * Usage: benchmark_torchscript model.ts [width height channels [tta]], the input defaults to a 224x224 stereo pair with
+ * 1 channel, placed side by side as in the default configuration; 3 channels run the mono path. With tta, flipped images
+ * double the batch. The optimised model is prepared first, so that its cached load is measured.
+ */
+int main(int argc, char** argv)
+{
+    if (argc != 2 && argc != 5 && argc != 6)
+    {
+        puts("Usage: benchmark_torchscript model.ts [width height channels [tta]]");
+        return 1;
+    }
+    const std::string pathToModel = argv[1];
+    cv::Size imageSize(224, 224);
+    int channels = 1;
+    bool tta = (argc == 6 && std::string(argv[5]) == "tta");
+    cv::Mat blob;
+    if (argc >= 5)
+    {
+        imageSize = cv::Size(std::stoi(argv[2]), std::stoi(argv[3]));
+        channels = std::stoi(argv[4]);
+    }
+    createInput(imageSize, channels, tta, blob);
+
+    double start = getMonotonicTime();
+    std::string optimisedPath = TorchScriptCache::prepare(pathToModel, blob);
+    double prepareTime = getMonotonicTime() - start;
+    if (optimisedPath == pathToModel)
+    {
+        puts("Failed to optimise the model");
+        return 1;
+    }
+
+    LatencyStats originalStats(FRAMES);
+    LatencyStats optimisedStats(FRAMES);
+    double originalLoad = measure(false, pathToModel, blob, originalStats);
+    double optimisedLoad = measure(true, pathToModel, blob, optimisedStats);
+    if (originalLoad < 0.0 || optimisedLoad < 0.0)
+    {
+        puts("Failed to load the model");
+        return 1;
+    }
+
+    printf("Input: batch %d, %d channels, %dx%d \n", blob.size[0], blob.size[1], blob.size[3], blob.size[2]);
+    printf("Preparation (once per model): %.1f ms \n", prepareTime * 1000.0);
+    printf("Load, original: %.1f ms \n", originalLoad * 1000.0);
+    printf("Load, optimised: %.1f ms \n", optimisedLoad * 1000.0);
+    printf("Per frame, original: median %.2f ms, p95 %.2f ms \n", originalStats.getPercentile(50.0) * 1000.0, 
+           originalStats.getPercentile(95.0) * 1000.0);
+    printf("Per frame, optimised: median %.2f ms, p95 %.2f ms (%.2fx) \n", optimisedStats.getPercentile(50.0) * 1000.0, 
+           optimisedStats.getPercentile(95.0) * 1000.0, originalStats.getPercentile(50.0) / optimisedStats.getPercentile(50.0));
+    return 0;
+}
@@ -21,11 +21,14 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <Configuration.h>
+#include <Settings.h>
 
 int main(int argc, char** argv)
 {
     Configuration config;
+    Settings settings;
     std::string path = (argc > 1) ? argv[1] : "../config/config.ini";
+    int retVal = 1;
 
     if (config.loadConfiguration(path))
     {
@@ -33,6 +36,11 @@ int main(int argc, char** argv)
         {
             printf("Read name: %s, and value: %s \n", item.first.c_str(), item.second.c_str());
         }
+        if (settings.parse(config))
+        {
+            puts("All values are valid.");
+            retVal = 0;
+        }
     }
     else
     {
@@ -40,5 +48,5 @@ int main(int argc, char** argv)
         puts("Either provide a valid path as the first argument, or ensure that there is a valid file under config/config.ini.");
     }
 
-    return 0;
+    return retVal;
 }
\ No newline at end of file
@@ -0,0 +1,191 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/joystick.h>
+#include <semaphore.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <EmergencyStop.h>
+#include <LatencyStats.h>
+#include <Settings.h>
+#include <Timing.h>
+#include "TestUtils.h"
+
+namespace
+{
+/** The number of times each path is measured. */
+constexpr int TRIALS = 50;
+/** The maximum accepted latency in seconds. */
+constexpr double MAX_LATENCY = 0.02;
+
+/**
+ * Stand-in for the racer, which records the time at which throttle was zeroed.
+ */
+class Racer : public GenericListener<DriveCommands>
+{
+public:
+    Racer()
+    : GenericListener<DriveCommands>(),
+      mThrottle(0.0f),
+      mZeroTime(0.0)
+    {
+    }
+
+    void update(const DriveCommands& driveCommands) override
+    {
+        if (driveCommands.mThrottle == 0.0f && mThrottle != 0.0f)
+        {
+            mZeroTime = getMonotonicTime();
+        }
+        mThrottle = driveCommands.mThrottle;
+    }
+
+    std::atomic<float> mThrottle;
+    std::atomic<double> mZeroTime;
+};
+
+/**
+ * Writes a button event to the stand-in gamepad device.
+ *  @param fd the file descriptor of the device.
+ *  @param type the type of the event.
+ *  @param number the number of the button.
+ *  @param value the value of the button, 1 for pressed.
+ */
+void writeButton(const int fd, const unsigned char type, const unsigned char number, const short value)
+{
+    struct js_event event = {0, value, type, number};
+    if (sizeof(event) != write(fd, &event, sizeof(event)))
+    {
+        puts("Failed to write the stand-in gamepad");
+    }
+}
+
+/**
+ * Waits for the emergency stop to call its callback.
+ *  @param semaphore the semaphore posted by the callback.
+ *  @return true if the callback was called within a second.
+ */
+bool waitForCallback(sem_t& semaphore)
+{
+    struct timespec wakeUp;
+    int result;
+    clock_gettime(CLOCK_REALTIME, &wakeUp);
+    ++wakeUp.tv_sec;
+    while (-1 == (result = sem_timedwait(&semaphore, &wakeUp)) && EINTR == errno)
+    {
+    }
+    return 0 == result;
+}
+
+/**
+ * Measures the time from the stop request to zero throttle at the racer.
+ *  @param settings the settings of the stop.
+ *  @param device the stand-in gamepad device.
+ *  @param button true to press the stop button, false to trigger the stop as the signal handler does.
+ *  @param stats the latency of each trial.
+ *  @return true if the stop engaged in all trials.
+ */
+bool measure(const Settings& settings, const int device, const bool button, LatencyStats& stats)
+{
+    sem_t engaged;
+    double startTime;
+    bool retVal = true;
+    sem_init(&engaged, 0, 0);
+
+    for (int i = 0; i < TRIALS && retVal; ++i)
+    {
+        Racer racer;
+        EmergencyStop emergencyStop(settings, racer);
+        emergencyStop.setCallback([&engaged]() { sem_post(&engaged); });
+        emergencyStop.startThread();
+        emergencyStop.update(DriveCommands(0.1f, 0.5f));
+        usleep(5000);
+
+        startTime = getMonotonicTime();
+        if (button)
+        {
+            writeButton(device, JS_EVENT_BUTTON, 0, 1);
+        }
+        else
+        {
+            retVal = emergencyStop.trigger();
+        }
+        retVal = waitForCallback(engaged) && racer.mThrottle == 0.0f && retVal;
+        stats.addSample(racer.mZeroTime - startTime);
+        emergencyStop.stopThread();
+    }
+    sem_destroy(&engaged);
+    return retVal;
+}
+} // end of anonymouse namespace
+
+int main()
+{
+    const std::string devicePath = "/tmp/test_emergencyStop_js";
+    Settings settings;
+    settings.mGamepadDevice = devicePath;
+    settings.mStopButton = 0;
+    settings.mEmergencyStopPriority = 0;
+
+    // a FIFO stands in for the gamepad, it is kept open for writing so that readers do not see a hang-up
+    unlink(devicePath.c_str());
+    mkfifo(devicePath.c_str(), 0600);
+    int device = open(devicePath.c_str(), O_RDWR | O_NONBLOCK);
+
+    {
+        Racer racer;
+        EmergencyStop emergencyStop(settings, racer);
+        emergencyStop.startThread();
+        emergencyStop.update(DriveCommands(0.1f, 0.5f));
+        writeButton(device, JS_EVENT_BUTTON | JS_EVENT_INIT, 0, 1);
+        writeButton(device, JS_EVENT_BUTTON, 1, 1);
+        usleep(50000);
+        TestUtils::check("initial state and other buttons ignored", !emergencyStop.isEngaged() && racer.mThrottle == 0.5f);
+        writeButton(device, JS_EVENT_BUTTON, 0, 1);
+        usleep(50000);
+        TestUtils::check("stop button zeroes throttle", emergencyStop.isEngaged() && racer.mThrottle == 0.0f);
+        emergencyStop.update(DriveCommands(0.1f, 0.5f));
+        TestUtils::check("drive commands blocked after the stop", racer.mThrottle == 0.0f);
+        emergencyStop.stopThread();
+        TestUtils::check("trigger without the thread is left to the caller", !emergencyStop.trigger());
+    }
+
+    LatencyStats buttonStats(TRIALS);
+    LatencyStats signalStats(TRIALS);
+    TestUtils::check("stop button engages in every trial", measure(settings, device, true, buttonStats));
+    TestUtils::check("trigger engages in every trial", measure(settings, device, false, signalStats));
+    printf("Button to zero throttle: median %.3f ms, max %.3f ms \n", buttonStats.getPercentile(50.0) * 1000.0, 
+           buttonStats.getPercentile(100.0) * 1000.0);
+    printf("Signal to zero throttle: median %.3f ms, max %.3f ms \n", signalStats.getPercentile(50.0) * 1000.0, 
+           signalStats.getPercentile(100.0) * 1000.0);
+    TestUtils::check("button latency bounded", buttonStats.getPercentile(100.0) < MAX_LATENCY);
+    TestUtils::check("signal latency bounded", signalStats.getPercentile(100.0) < MAX_LATENCY);
+
+    close(device);
+    unlink(devicePath.c_str());
+    return TestUtils::getExitCode();
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <experimental/filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <PerformanceGovernor.h>
+#include <Settings.h>
+#include "TestUtils.h"
+
+namespace
+{
+/**
+ * Writes a value to a file of the fake sysfs, creating its folder.
+ *  @param path the path to the file.
+ *  @param value the value to write.
+ */
+void writeValue(const std::string& path, const std::string& value)
+{
+    std::experimental::filesystem::create_directories(std::experimental::filesystem::path(path).parent_path());
+    std::ofstream file(path, std::ios::trunc);
+    file << value << std::endl;
+}
+
+/**
+ * Checks the performance level.
+ *  @param name the name of the check.
+ *  @param expected the expected level.
+ *  @param actual the actual level.
+ */
+void checkLevel(const char* name, const int expected, const int actual)
+{
+    TestUtils::check(name, expected == actual, "expected level " + std::to_string(expected) + ", got " + std::to_string(actual));
+}
+} // end of anonymouse namespace
+
+int main()
+{
+    const std::string root = "/tmp/test_governor_sysfs";
+    const std::string cpu = root + "/devices/system/cpu/cpu0/cpufreq/";
+    const std::string gpu = root + "/devices/gpu.0/devfreq/57000000.gpu/";
+    Settings settings;
+    std::vector<int> transitions;
+
+    std::experimental::filesystem::remove_all(root);
+    writeValue(root + "/class/thermal/thermal_zone0/temp", "40000");
+    writeValue(root + "/class/thermal/thermal_zone1/temp", "45000");
+    writeValue(cpu + "cpuinfo_max_freq", "1479000");
+    writeValue(cpu + "scaling_max_freq", "1479000");
+    writeValue(gpu + "available_frequencies", "76800000 153600000 921600000");
+    writeValue(gpu + "max_freq", "921600000");
+
+    settings.mGovernorSysfsRoot = root;
+    settings.mGovernorGpuPath = "devices/gpu.0/devfreq/57000000.gpu";
+    settings.mGovernorTemperatures = {60.0, 65.0, 70.0, 75.0};
+    settings.mGovernorHysteresis = 3.0;
+    settings.mGovernorMinFrequency = 0.9;
+    settings.mGovernorPeriod = 0.01;
+
+    PerformanceGovernor governor(settings);
+    governor.setLevelCallback([&transitions](const int level) { transitions.push_back(level); });
+
+    checkLevel("cool board", 0, governor.step());
+    writeValue(root + "/class/thermal/thermal_zone1/temp", "61000");
+    checkLevel("first threshold by the hottest zone", 1, governor.step());
+    writeValue(root + "/class/thermal/thermal_zone1/temp", "71500");
+    checkLevel("jump over two thresholds", 3, governor.step());
+    writeValue(root + "/class/thermal/thermal_zone1/temp", "68000");
+    checkLevel("hysteresis keeps the level", 3, governor.step());
+    writeValue(root + "/class/thermal/thermal_zone1/temp", "66000");
+    checkLevel("leave the level below hysteresis", 2, governor.step());
+    writeValue(gpu + "max_freq", "153600000");
+    checkLevel("capped GPU frequency raises the level", 3, governor.step());
+    checkLevel("steady cap does not raise the level again", 3, governor.step());
+    writeValue(root + "/class/thermal/thermal_zone1/temp", "50000");
+    checkLevel("steady cap keeps the level on a cool board", 3, governor.step());
+    writeValue(gpu + "max_freq", "921600000");
+    checkLevel("cool down to full performance", 0, governor.step());
+    writeValue(cpu + "scaling_max_freq", "918000");
+    checkLevel("new cap raises the level", 1, governor.step());
+    writeValue(cpu + "scaling_max_freq", "1479000");
+    checkLevel("lifted cap", 0, governor.step());
+    checkLevel("transitions reported to the callback", 7, static_cast<int>(transitions.size()));
+
+    // a power mode that caps the clocks from the start is not a throttle event
+    PerformanceGovernor powerMode(settings);
+    writeValue(cpu + "cpuinfo_max_freq", "1479000");
+    writeValue(cpu + "scaling_max_freq", "918000");
+    checkLevel("power mode cap", 0, powerMode.step());
+    checkLevel("steady power mode cap", 0, powerMode.step());
+    writeValue(cpu + "scaling_max_freq", "1479000");
+
+    // the thread reads sensors periodically
+    writeValue(root + "/class/thermal/thermal_zone0/temp", "80000");
+    if (governor.startThread())
+    {
+        for (int i = 0; i < 100 && governor.getLevel() != 4; ++i)
+        {
+            usleep(10000);
+        }
+        governor.stopThread(true);
+    }
+    checkLevel("governor thread", 4, governor.getLevel());
+
+    std::experimental::filesystem::remove_all(root);
+    return TestUtils::getExitCode();
+}
@@ -0,0 +1,153 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+#include <ImuReader.h>
+#include <Settings.h>
+#include <SteeringEstimator.h>
+#include "TestUtils.h"
+
+namespace
+{
+/**
+ * Collects drive commands issued by the estimator.
+ */
+class CommandsSink : public GenericListener<DriveCommands>
+{
+public:
+    void update(const DriveCommands& driveCommands) override
+    {
+        mCommands.push_back(driveCommands);
+    }
+
+    std::vector<DriveCommands> mCommands;
+};
+
+/**
+ * Collects IMU samples passed on by the reader.
+ */
+class SamplesSink : public GenericListener<ImuData>
+{
+public:
+    void update(const ImuData& imuData) override
+    {
+        mSamples.push_back(imuData);
+    }
+
+    std::vector<ImuData> mSamples;
+};
+
+/**
+ * Passes IMU samples with a constant yaw rate to the estimator.
+ *  @param estimator the estimator.
+ *  @param time the time of the first sample, advanced past the last sample.
+ *  @param duration the duration in seconds.
+ *  @param yawRate the yaw rate in rad/s.
+ */
+void feed(SteeringEstimator& estimator, double& time, const double duration, const float yawRate)
+{
+    ImuData sample;
+    sample.mGyro[2] = yawRate;
+    for (double end = time + duration; time < end - 1e-9; time += 0.005)
+    {
+        sample.mTime = time;
+        estimator.update(sample);
+    }
+}
+} // end of anonymouse namespace
+
+int main()
+{
+    const std::string recording = "/tmp/test_imu_recording.txt";
+    Settings settings;
+    settings.mImuDevice = "/dev/null";
+    settings.mImuAddress = 0x68;
+    settings.mImuRate = 200.0;
+    settings.mImuReplay = recording;
+    settings.mImuRecord = "";
+    settings.mImuYawSign = 1.0;
+    settings.mEstimatorYawRateGain = 3.0;
+    settings.mEstimatorCorrectionGain = 0.1;
+    settings.mEstimatorRate = 50.0;
+    settings.mEstimatorTimeout = 0.3;
+
+    SteeringEstimator estimator(settings);
+    CommandsSink sink;
+    double time = 100.0;
+    sink.registerTo(&estimator);
+
+    static_cast<GenericListener<DriveCommands>&>(estimator).update(DriveCommands(0.25f, 0.0f));
+    TestUtils::checkNear("model commands passed on without IMU", 0.25, sink.mCommands.back().mSteering);
+
+    // standing still with a biased gyroscope
+    feed(estimator, time, 5.0, 0.02f);
+    TestUtils::checkNear("yaw rate bias", 0.02, estimator.getYawRateBias(), 1e-3);
+    TestUtils::checkNear("no commands while standing still", 0, static_cast<double>(estimator.getPropagated()));
+
+    // turning at the rate expected for the steering: 3.0 * 0.5 * 0.4
+    static_cast<GenericListener<DriveCommands>&>(estimator).update(DriveCommands(0.5f, 0.4f));
+    sink.mCommands.clear();
+    feed(estimator, time, 0.1, 0.62f);
+    TestUtils::checkNear("commands issued at the estimator rate", 5, static_cast<double>(sink.mCommands.size()));
+    TestUtils::checkNear("steering kept at the expected yaw rate", 0.5, sink.mCommands.back().mSteering, 1e-3);
+    TestUtils::checkNear("throttle of the model kept", 0.4, sink.mCommands.back().mThrottle);
+
+    // turning too slowly, so steering is increased by 0.1 * (0.6 - 0.2)
+    feed(estimator, time, 0.1, 0.22f);
+    TestUtils::checkNear("steering corrected by the yaw rate error", 0.54, sink.mCommands.back().mSteering, 1e-3);
+
+    // the model is late
+    feed(estimator, time, 0.2, 0.22f);
+    sink.mCommands.clear();
+    feed(estimator, time, 0.2, 0.22f);
+    TestUtils::checkNear("no commands after the timeout", 0, static_cast<double>(sink.mCommands.size()));
+
+    // replay of a recorded file at its own pace
+    {
+        std::ofstream file(recording, std::ios::trunc);
+        for (int i = 0; i < 20; ++i)
+        {
+            file << 50.0 + i * 0.005 << " 0 0 " << i * 0.01 << " 0 0 9.81\n";
+        }
+    }
+    ImuReader reader(settings);
+    SamplesSink samples;
+    samples.registerTo(&reader);
+    if (reader.startThread())
+    {
+        usleep(300000);
+        reader.stopThread();
+    }
+    TestUtils::checkNear("replayed samples", 20, static_cast<double>(samples.mSamples.size()));
+    if (samples.mSamples.size() == 20)
+    {
+        TestUtils::checkNear("replayed yaw rate", 0.19, samples.mSamples.back().mGyro[2]);
+        TestUtils::checkNear("replayed interval", 0.095, samples.mSamples.back().mTime - samples.mSamples.front().mTime, 1e-6);
+        TestUtils::checkNear("replayed acceleration", 9.81, samples.mSamples.back().mAccel[2]);
+    }
+    unlink(recording.c_str());
+
+    return TestUtils::getExitCode();
+}
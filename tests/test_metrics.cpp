@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <LatencyHistogram.h>
+#include <MetricsServer.h>
+#include <Settings.h>
+#include "TestUtils.h"
+
+namespace
+{
+/**
+ * Sends an HTTP request to the server on localhost and reads the whole response.
+ *  @param port the port of the server.
+ *  @param path the requested path.
+ *  @return the response, empty if the server could not be reached.
+ */
+std::string request(const int port, const std::string& path)
+{
+    struct sockaddr_in address = {};
+    std::string response;
+    char buffer[4096];
+    ssize_t received;
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (0 == connect(client, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)))
+    {
+        std::string line = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        send(client, line.data(), line.size(), 0);
+        while ((received = recv(client, buffer, sizeof(buffer), 0)) > 0)
+        {
+            response.append(buffer, static_cast<size_t>(received));
+        }
+    }
+    close(client);
+    return response;
+}
+
+/**
+ * Checks that the response of the server contains a text.
+ *  @param name the name of the check.
+ *  @param response the response of the server.
+ *  @param expected the text expected in the response.
+ */
+void checkResponse(const char* name, const std::string& response, const std::string& expected)
+{
+    TestUtils::check(name, response.find(expected) != std::string::npos);
+}
+} // end of anonymouse namespace
+
+int main()
+{
+    Settings settings;
+    settings.mMetricsAddress = "127.0.0.1";
+    settings.mMetricsPort = 0;
+    MetricsServer server(settings);
+    LatencyHistogram histogram;
+    std::atomic<unsigned long> dropped(0);
+
+    server.addCounter("test_dropped_total", "Dropped items.", [&dropped]() { return static_cast<double>(dropped.load()); }, "edge=\"a>b\"");
+    server.addCounter("test_dropped_total", "Dropped items.", []() { return 7.0; }, "edge=\"a>c\"");
+    server.addGauge("test_state", "The state.", []() { return 2.0; });
+    server.addHistogram("test_latency_seconds", "Latency.", histogram);
+    if (!server.startThread())
+    {
+        puts("FAIL: server not started");
+        return 1;
+    }
+
+    dropped = 3;
+    histogram.observe(0.004);
+    histogram.observe(0.04);
+    histogram.observe(2.0);
+    server.update(CameraData());
+
+    std::string response = request(server.getPort(), "/metrics");
+    checkResponse("status line", response, "HTTP/1.1 200 OK\r\n");
+    checkResponse("content type", response, "Content-Type: text/plain; version=0.0.4");
+    checkResponse("single description of labelled series", response, "# TYPE test_dropped_total counter\ntest_dropped_total{edge=\"a>b\"} 3\ntest_dropped_total{edge=\"a>c\"} 7\n");
+    checkResponse("gauge", response, "# TYPE test_state gauge\ntest_state 2\n");
+    checkResponse("frame counter", response, "jetracer_camera_frames_total 1\n");
+    checkResponse("cumulative buckets", response, "test_latency_seconds_bucket{le=\"0.005\"} 1\n");
+    checkResponse("bucket of 40 ms", response, "test_latency_seconds_bucket{le=\"0.05\"} 2\n");
+    checkResponse("overflow bucket", response, "test_latency_seconds_bucket{le=\"+Inf\"} 3\n");
+    checkResponse("histogram count", response, "test_latency_seconds_count 3\n");
+    checkResponse("unknown path", request(server.getPort(), "/"), "HTTP/1.1 404 Not Found\r\n");
+
+    server.stopThread();
+    return TestUtils::getExitCode();
+}
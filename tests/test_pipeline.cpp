@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <semaphore.h>
+#include <unistd.h>
+#include <vector>
+#include <DriveCommands.h>
+#include <GenericListener.h>
+#include <GenericTalker.h>
+#include <PipelineGraph.h>
+#include "TestUtils.h"
+
+namespace
+{
+/**
+ * Producer of drive commands.
+ */
+class Producer : public GenericTalker<DriveCommands>
+{
+public:
+    /**
+     * Notifies listeners with steering set to the given value.
+     *  @param value the value.
+     */
+    void send(const float value)
+    {
+        notifyListeners(DriveCommands(value, 0.0f));
+    }
+};
+
+/**
+ * Consumer that records received steering values, optionally blocking until released.
+ */
+class Consumer : public GenericListener<DriveCommands>
+{
+public:
+    Consumer()
+    : GenericListener<DriveCommands>(),
+      mValues(),
+      mBlock(false)
+    {
+        sem_init(&mRelease, 0, 0);
+    }
+
+    virtual ~Consumer()
+    {
+        sem_destroy(&mRelease);
+    }
+
+    void update(const DriveCommands& driveCommands) override
+    {
+        if (mBlock)
+        {
+            sem_wait(&mRelease);
+        }
+        mValues.push_back(driveCommands.mSteering);
+    }
+
+    /** Received steering values. */
+    std::vector<float> mValues;
+    /** True to wait for release on each item. */
+    bool mBlock;
+    /** Releases a blocked item. */
+    sem_t mRelease;
+};
+
+/**
+ * Checks values received by a consumer.
+ *  @param name the name of the check.
+ *  @param expected the expected values.
+ *  @param actual the actual values.
+ */
+void checkValues(const char* name, const std::vector<float>& expected, const std::vector<float>& actual)
+{
+    TestUtils::check(name, expected == actual, "expected " + std::to_string(expected.size()) + " values, got " + std::to_string(actual.size()));
+}
+} // end of anonymouse namespace
+
+int main()
+{
+    Producer producer;
+    Consumer syncConsumer;
+    Consumer latestConsumer;
+    Consumer queueConsumer;
+    Consumer pooledConsumer;
+    PipelineGraph pipeline;
+    TaskPool pool(2, false);
+
+    pipeline.addProducer<DriveCommands>("producer", &producer);
+    pipeline.addConsumer<DriveCommands>("sync", &syncConsumer);
+    pipeline.addConsumer<DriveCommands>("latest", &latestConsumer);
+    pipeline.addConsumer<DriveCommands>("queue", &queueConsumer);
+    pipeline.addConsumer<DriveCommands>("pooled", &pooledConsumer);
+    pipeline.setTaskPool(&pool);
+    bool valid = pipeline.addGraph("invalid", "producer>unknown:sync,producer>sync:fifo");
+    TestUtils::check("invalid edges rejected", !valid);
+    pipeline.addGraph("active", "producer>sync:sync,producer>latest:latest,producer>queue:queue2:shared,producer>pooled:queue8:@recording");
+    pipeline.addGraph("idle", "");
+
+    // consumers of the worker threads are blocked on the first item, so the following ones have to wait in queues
+    latestConsumer.mBlock = true;
+    queueConsumer.mBlock = true;
+    pipeline.activate("active");
+    for (int i = 1; i <= 5; ++i)
+    {
+        producer.send(static_cast<float>(i));
+        usleep(20000);
+    }
+    checkValues("synchronous edge delivers everything", {1.0f, 2.0f, 3.0f, 4.0f, 5.0f}, syncConsumer.mValues);
+
+    latestConsumer.mBlock = false;
+    queueConsumer.mBlock = false;
+    sem_post(&latestConsumer.mRelease);
+    sem_post(&queueConsumer.mRelease);
+    usleep(200000);
+    checkValues("latest-only edge keeps the newest item", {1.0f, 5.0f}, latestConsumer.mValues);
+    checkValues("bounded queue drops the oldest items", {1.0f, 4.0f, 5.0f}, queueConsumer.mValues);
+    checkValues("pooled edge delivers everything in order", {1.0f, 2.0f, 3.0f, 4.0f, 5.0f}, pooledConsumer.mValues);
+
+    pipeline.activate("idle");
+    producer.send(6.0f);
+    usleep(200000);
+    checkValues("inactive graph delivers nothing", {1.0f, 2.0f, 3.0f, 4.0f, 5.0f}, syncConsumer.mValues);
+
+    pipeline.stop();
+    pool.stop();
+    pipeline.printStatistics();
+    return TestUtils::getExitCode();
+}
@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdio>
+#include <pthread.h>
+#include <semaphore.h>
+#include <string>
+#include <unistd.h>
+#include <ScopedLock.h>
+#include <TaskPool.h>
+#include "TestUtils.h"
+
+int main()
+{
+    pthread_mutex_t mutex;
+    sem_t gate;
+    pthread_mutex_init(&mutex, nullptr);
+    sem_init(&gate, 0, 0);
+
+    // a single worker is blocked while tasks of all classes are queued, they have to run in the order of priority
+    {
+        TaskPool pool(1, false);
+        std::string order;
+        pool.start();
+        pool.submit(TASK_CONTROL, [&gate]() { sem_wait(&gate); });
+        usleep(20000);
+        pool.submit(TASK_DISPLAY, [&]() { ScopedLock lock(mutex); order += 'd'; });
+        pool.submit(TASK_RECORDING, [&]() { ScopedLock lock(mutex); order += 'r'; });
+        pool.submit(TASK_INFERENCE, [&]() { ScopedLock lock(mutex); order += 'i'; });
+        pool.submit(TASK_CONTROL, [&]() { ScopedLock lock(mutex); order += 'c'; });
+        sem_post(&gate);
+        usleep(100000);
+        pool.stop();
+        printf("Order of classes: %s \n", order.c_str());
+        TestUtils::check("tasks run in the order of priority", order == "cird");
+    }
+
+    // tasks submitted by a worker are queued by it, so the other worker has to steal them
+    {
+        TaskPool pool(2, false);
+        std::atomic<int> executed(0);
+        pool.start();
+        pool.submit(TASK_INFERENCE, [&]()
+        {
+            for (int i = 0; i < 20; ++i)
+            {
+                pool.submit(TASK_INFERENCE, [&executed]() { usleep(5000); ++executed; });
+            }
+        });
+        usleep(200000);
+        pool.stop();
+        TestUtils::check("all tasks executed", executed == 20);
+        TestUtils::check("idle worker steals tasks", pool.getStolen() > 0);
+    }
+
+    // recording tasks never occupy all workers, so a control task runs while they are blocked
+    {
+        TaskPool pool(2, false);
+        std::atomic<bool> controlDone(false);
+        pool.start();
+        pool.submit(TASK_RECORDING, [&gate]() { sem_wait(&gate); });
+        pool.submit(TASK_RECORDING, [&gate]() { sem_wait(&gate); });
+        usleep(20000);
+        pool.submit(TASK_CONTROL, [&controlDone]() { controlDone = true; });
+        usleep(50000);
+        TestUtils::check("control task runs while recording tasks block", controlDone);
+        TestUtils::check("only one recording task runs", pool.getExecuted(TASK_RECORDING) == 0 && pool.getExecuted(TASK_CONTROL) == 1);
+        sem_post(&gate);
+        sem_post(&gate);
+        usleep(50000);
+        TestUtils::check("recording tasks finish", pool.getExecuted(TASK_RECORDING) == 2);
+        TestUtils::check("recording utilisation accounted", pool.getUtilisation(TASK_RECORDING) > 0.1);
+        pool.stop();
+        pool.printStatistics();
+    }
+
+    sem_destroy(&gate);
+    pthread_mutex_destroy(&mutex);
+    return TestUtils::getExitCode();
+}
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2023 Mateusz Malinowski
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <PreviewStreamer.h>
+
+int main(int argc, char** argv)
+{
+    int port = (argc > 1) ? std::stoi(argv[1]) : 5600;
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address = {};
+    struct timeval timeout = {0, 100000};
+    std::vector<uint8_t> datagram(65536);
+    PreviewHeader header;
+    uint32_t lastFrame = 0;
+    unsigned long lost = 0;
+    ssize_t size;
+    cv::Mat image;
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (sock < 0 || 0 != bind(sock, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address)))
+    {
+        printf("Failed to bind to port %d: %s \n", port, strerror(errno));
+        return 1;
+    }
+    // wake up periodically to keep the window responsive when no frames arrive
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    printf("Waiting for preview on port %d, press q to quit \n", port);
+
+    while (true)
+    {
+        size = recvfrom(sock, datagram.data(), datagram.size(), 0, nullptr, nullptr);
+        if (size > static_cast<ssize_t>(sizeof(header)))
+        {
+            memcpy(&header, datagram.data(), sizeof(header));
+            if (header.mMagic != PREVIEW_MAGIC)
+            {
+                continue;
+            }
+            if (lastFrame > 0 && header.mFrame > lastFrame + 1)
+            {
+                lost += header.mFrame - lastFrame - 1;
+            }
+            lastFrame = header.mFrame;
+            image = cv::imdecode(cv::Mat(1, static_cast<int>(size - sizeof(header)), CV_8UC1, datagram.data() + sizeof(header)), cv::IMREAD_COLOR);
+            if (!image.empty())
+            {
+                cv::imshow("JetRacer preview", image);
+                printf("\rFrame: %u, steering: %+.2f, throttle: %+.2f, lost: %lu ", header.mFrame, header.mSteering, header.mThrottle, lost);
+                fflush(stdout);
+            }
+        }
+        if ('q' == cv::waitKey(1))
+        {
+            break;
+        }
+    }
+    close(sock);
+    return 0;
+}